@@ -0,0 +1,856 @@
+/** Benchmarks for the libgeojson builders and serializers
+ *
+ *  Each benchmark reports the vertices per second, the bytes of GeoJSON per
+ *  second and the number of heap allocations per feature.
+ *
+ *  \file benchmarks.cpp
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "libgeojson/arena.h"
+#include "libgeojson/cbor.h"
+#include "libgeojson/flat_geometry.h"
+#include "libgeojson/flatgeobuf.h"
+#include "libgeojson/fragment.h"
+#include "libgeojson/libgeojson.h"
+#include "libgeojson/parallel.h"
+#include "libgeojson/parallel_reader.h"
+#include "libgeojson/producer.h"
+#include "libgeojson/reader.h"
+#include "libgeojson/schema.h"
+#include "libgeojson/spatial_index.h"
+#include "libgeojson/spatial_order.h"
+#include "libgeojson/tiles.h"
+#include "libgeojson/text.h"
+#include "libgeojson/writer.h"
+
+// Counts every allocation made through the global operator new
+static std::atomic<size_t> numAllocations(0);
+
+void* operator new(size_t size) {
+  numAllocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// The number of vertices in each line of the FeatureCollection benchmarks
+constexpr size_t kVerticesPerFeature = 100;
+
+// The number of vertices in each polygon of the MultiPolygon benchmarks
+constexpr size_t kVerticesPerPolygon = 1000;
+
+// The number of holes in the Polygon benchmarks
+constexpr size_t kNumHoles = 4;
+
+// Positions held in separate longitude and latitude arrays
+struct Positions {
+  std::vector<double> lon, lat;
+
+  size_t Size() const { return lon.size(); }
+
+  geojson::PositionSpan Span() const {
+    return geojson::PositionSpan::Separate(lon.data(), lat.data(), Size());
+  }
+};
+
+// Returns a CCW circle of positions with realistic, non-round coordinates
+Positions Circle(size_t numPoints, double lon, double lat, double radius) {
+  Positions circle;
+  circle.lon.resize(numPoints);
+  circle.lat.resize(numPoints);
+  for (size_t i = 0; i < numPoints; i++) {
+    double angle = 2 * kPi * static_cast<double>(i) / numPoints;
+    circle.lon[i] = lon + radius * std::cos(angle);
+    circle.lat[i] = lat + radius * std::sin(angle);
+  }
+  return circle;
+}
+
+// A polygon with an outer ring and kNumHoles holes, numPoints in total
+struct PolygonRings {
+  explicit PolygonRings(size_t numPoints, double lon = -77.0365,
+                        double lat = 38.8977) {
+    size_t holeSize = std::max<size_t>(3, numPoints / (2 * kNumHoles));
+    size_t holesSize = kNumHoles * holeSize;
+    size_t outerSize = numPoints > holesSize + 3 ? numPoints - holesSize : 3;
+    rings.push_back(Circle(outerSize, lon, lat, 1));
+    for (size_t i = 0; i < kNumHoles; i++) {
+      double angle = 2 * kPi * static_cast<double>(i) / kNumHoles;
+      rings.push_back(Circle(holeSize, lon + 0.5 * std::cos(angle),
+                             lat + 0.5 * std::sin(angle), 0.1));
+    }
+
+    // The interleaved copy of the rings, for the PositionSpan benchmarks
+    offsets.push_back(0);
+    for (const auto& ring : rings) {
+      for (size_t i = 0; i < ring.Size(); i++) {
+        interleaved.push_back(ring.lon[i]);
+        interleaved.push_back(ring.lat[i]);
+      }
+      offsets.push_back(interleaved.size() / 2);
+    }
+  }
+
+  size_t NumRings() const { return rings.size(); }
+  size_t RingLength(size_t ring) const { return rings[ring].Size(); }
+  void GetPoint(size_t ring, size_t pt, double& lon, double& lat) const {
+    lon = rings[ring].lon[pt];
+    lat = rings[ring].lat[pt];
+  }
+
+  geojson::PositionSpan Span() const {
+    return geojson::PositionSpan::Interleaved(interleaved.data(),
+                                              interleaved.size() / 2, 2);
+  }
+
+  std::vector<Positions> rings;
+  std::vector<double> interleaved;
+  std::vector<size_t> offsets;
+};
+
+// Runs the benchmark loop, where build() returns the GeoJSON text
+template <typename Build>
+void Run(benchmark::State& state, size_t numVertices, size_t numFeatures,
+         Build&& build) {
+  size_t numBytes = 0;
+  size_t allocationsBefore = numAllocations.load();
+  for (auto _ : state) {
+    std::string text = build();
+    numBytes = text.size();
+    benchmark::DoNotOptimize(text.data());
+  }
+  auto allocations =
+      static_cast<double>(numAllocations.load() - allocationsBefore);
+
+  auto iterations = static_cast<double>(state.iterations());
+  state.SetBytesProcessed(static_cast<int64_t>(numBytes * state.iterations()));
+  state.counters["vertices/s"] = benchmark::Counter(
+      numVertices * iterations, benchmark::Counter::kIsRate);
+  state.counters["allocs/feature"] =
+      benchmark::Counter(allocations / (iterations * numFeatures));
+}
+
+size_t NumVertices(const benchmark::State& state) {
+  return static_cast<size_t>(state.range(0));
+}
+
+// 10 to 10M vertices
+void VertexRange(benchmark::internal::Benchmark* bench) {
+  bench->RangeMultiplier(10)->Range(10, 10000000)->Unit(benchmark::kMicrosecond);
+}
+
+void BM_PointDom(benchmark::State& state) {
+  Run(state, 1, 1, [] { return geojson::Point(-77.036535, 38.897676).dump(); });
+}
+BENCHMARK(BM_PointDom);
+
+void BM_PointText(benchmark::State& state) {
+  Run(state, 1, 1, [] { return geojson::text::Point(-77.036535, 38.897676); });
+}
+BENCHMARK(BM_PointText);
+
+void BM_MultiPointDom(benchmark::State& state) {
+  auto pts = Circle(NumVertices(state), -77.0365, 38.8977, 1);
+  Run(state, pts.Size(), 1, [&] {
+    return geojson::MultiPoint(pts.Span()).dump();
+  });
+}
+BENCHMARK(BM_MultiPointDom)->Apply(VertexRange);
+
+void BM_MultiPointText(benchmark::State& state) {
+  auto pts = Circle(NumVertices(state), -77.0365, 38.8977, 1);
+  Run(state, pts.Size(), 1, [&] {
+    return geojson::text::MultiPoint(pts.Span());
+  });
+}
+BENCHMARK(BM_MultiPointText)->Apply(VertexRange);
+
+void BM_LineStringDom(benchmark::State& state) {
+  auto pts = Circle(NumVertices(state), -77.0365, 38.8977, 1);
+  Run(state, pts.Size(), 1, [&] {
+    return geojson::LineString(pts.Size(), [&](size_t i, double& lon,
+                                               double& lat) {
+             lon = pts.lon[i];
+             lat = pts.lat[i];
+           }).dump();
+  });
+}
+BENCHMARK(BM_LineStringDom)->Apply(VertexRange);
+
+void BM_LineStringArenaDom(benchmark::State& state) {
+  auto pts = Circle(NumVertices(state), -77.0365, 38.8977, 1);
+  geojson::MonotonicArena arena;
+  Run(state, pts.Size(), 1, [&] {
+    std::string text;
+    {
+      geojson::ArenaScope scope(arena);
+      text = geojson::LineString<geojson::ArenaJson>(pts.Span()).dump();
+    }
+    arena.Release();
+    return text;
+  });
+}
+BENCHMARK(BM_LineStringArenaDom)->Apply(VertexRange);
+
+void BM_LineStringText(benchmark::State& state) {
+  auto pts = Circle(NumVertices(state), -77.0365, 38.8977, 1);
+  Run(state, pts.Size(), 1, [&] {
+    return geojson::text::LineString(
+        pts.Size(), [&](size_t i, double& lon, double& lat) {
+          lon = pts.lon[i];
+          lat = pts.lat[i];
+        });
+  });
+}
+BENCHMARK(BM_LineStringText)->Apply(VertexRange);
+
+void BM_LineStringTextFixed(benchmark::State& state) {
+  auto pts = Circle(NumVertices(state), -77.0365, 38.8977, 1);
+  auto format = geojson::CoordinateFormat::Fixed(6);
+  Run(state, pts.Size(), 1, [&] {
+    return geojson::text::LineString(pts.Span(), format);
+  });
+}
+BENCHMARK(BM_LineStringTextFixed)->Apply(VertexRange);
+
+void BM_PolygonDom(benchmark::State& state) {
+  PolygonRings poly(NumVertices(state));
+  Run(state, poly.Span().Size(), 1, [&] {
+    return geojson::Polygon(
+               poly.NumRings(),
+               [&](size_t ring) { return poly.RingLength(ring); },
+               [&](size_t ring, size_t pt, double& lon, double& lat) {
+                 poly.GetPoint(ring, pt, lon, lat);
+               })
+        .dump();
+  });
+}
+BENCHMARK(BM_PolygonDom)->Apply(VertexRange);
+
+void BM_PolygonText(benchmark::State& state) {
+  PolygonRings poly(NumVertices(state));
+  Run(state, poly.Span().Size(), 1, [&] {
+    return geojson::text::Polygon(
+        poly.NumRings(), [&](size_t ring) { return poly.RingLength(ring); },
+        [&](size_t ring, size_t pt, double& lon, double& lat) {
+          poly.GetPoint(ring, pt, lon, lat);
+        });
+  });
+}
+BENCHMARK(BM_PolygonText)->Apply(VertexRange);
+
+void BM_PolygonSpanText(benchmark::State& state) {
+  PolygonRings poly(NumVertices(state));
+  Run(state, poly.Span().Size(), 1, [&] {
+    return geojson::text::Polygon(poly.Span(), poly.offsets.data(),
+                                  poly.NumRings());
+  });
+}
+BENCHMARK(BM_PolygonSpanText)->Apply(VertexRange);
+
+// Simplified to about 10 m, so the output stops growing with the vertices
+void BM_PolygonSpanTextSimplified(benchmark::State& state) {
+  PolygonRings poly(NumVertices(state));
+  auto format = geojson::CoordinateFormat::Fixed(6).WithSimplification(1e-4);
+  Run(state, poly.Span().Size(), 1, [&] {
+    return geojson::text::Polygon(poly.Span(), poly.offsets.data(),
+                                  poly.NumRings(), format);
+  });
+}
+BENCHMARK(BM_PolygonSpanTextSimplified)->Apply(VertexRange);
+
+// Each position checked as it is written, against BM_PolygonSpanText
+void BM_PolygonSpanTextValidated(benchmark::State& state) {
+  PolygonRings poly(NumVertices(state));
+  auto format = geojson::CoordinateFormat().WithValidation(
+      geojson::Validation::Basic());
+  Run(state, poly.Span().Size(), 1, [&] {
+    return geojson::text::Polygon(poly.Span(), poly.offsets.data(),
+                                  poly.NumRings(), format);
+  });
+}
+BENCHMARK(BM_PolygonSpanTextValidated)->Apply(VertexRange);
+
+// With each ring also swept for self-intersections
+void BM_PolygonSpanTextSelfIntersections(benchmark::State& state) {
+  PolygonRings poly(NumVertices(state));
+  auto format = geojson::CoordinateFormat().WithValidation(
+      geojson::Validation::Basic().WithSelfIntersections());
+  Run(state, poly.Span().Size(), 1, [&] {
+    return geojson::text::Polygon(poly.Span(), poly.offsets.data(),
+                                  poly.NumRings(), format);
+  });
+}
+BENCHMARK(BM_PolygonSpanTextSelfIntersections)->Apply(VertexRange);
+
+// Polygons of kVerticesPerPolygon vertices, numVertices in total
+std::vector<PolygonRings> MultiPolygonParts(size_t numVertices) {
+  std::vector<PolygonRings> polys;
+  size_t numPolygons = std::max<size_t>(1, numVertices / kVerticesPerPolygon);
+  for (size_t i = 0; i < numPolygons; i++) {
+    polys.emplace_back(std::min(numVertices, kVerticesPerPolygon),
+                       -180 + 360.0 * i / numPolygons, 0);
+  }
+  return polys;
+}
+
+void BM_MultiPolygonDom(benchmark::State& state) {
+  auto polys = MultiPolygonParts(NumVertices(state));
+  Run(state, NumVertices(state), 1, [&] {
+    return geojson::MultiPolygon(
+               polys.size(),
+               [&](size_t poly) { return polys[poly].NumRings(); },
+               [&](size_t poly, size_t ring) {
+                 return polys[poly].RingLength(ring);
+               },
+               [&](size_t poly, size_t ring, size_t pt, double& lon,
+                   double& lat) { polys[poly].GetPoint(ring, pt, lon, lat); })
+        .dump();
+  });
+}
+BENCHMARK(BM_MultiPolygonDom)->Apply(VertexRange);
+
+void BM_MultiPolygonText(benchmark::State& state) {
+  auto polys = MultiPolygonParts(NumVertices(state));
+  Run(state, NumVertices(state), 1, [&] {
+    return geojson::text::MultiPolygon(
+        polys.size(), [&](size_t poly) { return polys[poly].NumRings(); },
+        [&](size_t poly, size_t ring) { return polys[poly].RingLength(ring); },
+        [&](size_t poly, size_t ring, size_t pt, double& lon, double& lat) {
+          polys[poly].GetPoint(ring, pt, lon, lat);
+        });
+  });
+}
+BENCHMARK(BM_MultiPolygonText)->Apply(VertexRange);
+
+// Lines of kVerticesPerFeature vertices, numVertices in total
+struct FeatureLines {
+  explicit FeatureLines(size_t numVertices)
+      : numFeatures(std::max<size_t>(1, numVertices / kVerticesPerFeature)),
+        numPoints(std::min(numVertices, kVerticesPerFeature)),
+        pts(Circle(numFeatures * numPoints, -77.0365, 38.8977, 1)) {}
+
+  void GetPoint(size_t feature, size_t pt, double& lon, double& lat) const {
+    lon = pts.lon[feature * numPoints + pt];
+    lat = pts.lat[feature * numPoints + pt];
+  }
+
+  nlohmann::json Properties(size_t feature) const {
+    return nlohmann::json{{"name", "road"}, {"index", feature}};
+  }
+
+  nlohmann::json Feature(size_t i) const {
+    return geojson::Feature(
+        i,
+        geojson::LineString(numPoints,
+                            [&](size_t pt, double& lon, double& lat) {
+                              GetPoint(i, pt, lon, lat);
+                            }),
+        Properties(i));
+  }
+
+  std::string FeatureText(size_t i) const {
+    return geojson::text::Feature(
+        i,
+        geojson::text::LineString(numPoints,
+                                  [&](size_t pt, double& lon, double& lat) {
+                                    GetPoint(i, pt, lon, lat);
+                                  }),
+        Properties(i));
+  }
+
+  size_t numFeatures, numPoints;
+  Positions pts;
+};
+
+void BM_FeatureCollectionDom(benchmark::State& state) {
+  FeatureLines lines(NumVertices(state));
+  Run(state, lines.pts.Size(), lines.numFeatures, [&] {
+    return geojson::FeatureCollection(lines.numFeatures, [&](size_t i) {
+             return lines.Feature(i);
+           }).dump();
+  });
+}
+BENCHMARK(BM_FeatureCollectionDom)->Apply(VertexRange);
+
+void BM_FeatureCollectionWriter(benchmark::State& state) {
+  FeatureLines lines(NumVertices(state));
+  Run(state, lines.pts.Size(), lines.numFeatures, [&] {
+    std::string text;
+    geojson::WriteFeatureCollection(text, lines.numFeatures,
+                                    [&](size_t i) { return lines.Feature(i); });
+    return text;
+  });
+}
+BENCHMARK(BM_FeatureCollectionWriter)->Apply(VertexRange);
+
+void BM_FeatureCollectionText(benchmark::State& state) {
+  FeatureLines lines(NumVertices(state));
+  Run(state, lines.pts.Size(), lines.numFeatures, [&] {
+    std::string text;
+    geojson::BasicFeatureCollectionWriter<geojson::StringSink> writer(text);
+    for (size_t i = 0; i < lines.numFeatures; i++) {
+      writer.WriteRaw(lines.FeatureText(i));
+    }
+    writer.Close();
+    return text;
+  });
+}
+BENCHMARK(BM_FeatureCollectionText)->Apply(VertexRange);
+
+// Text features pulled in chunks of the default size, as a socket would
+void BM_FeatureCollectionProducer(benchmark::State& state) {
+  FeatureLines lines(NumVertices(state));
+  Run(state, lines.pts.Size(), lines.numFeatures, [&] {
+    geojson::FeatureCollectionProducer producer(
+        lines.numFeatures, [&](size_t i) { return lines.FeatureText(i); });
+    std::string text;
+    geojson::StringView chunk;
+    while (producer.Next(chunk)) text.append(chunk.Data(), chunk.Size());
+    return text;
+  });
+}
+BENCHMARK(BM_FeatureCollectionProducer)->Apply(VertexRange);
+
+void BM_FeatureCollectionParallelText(benchmark::State& state) {
+  FeatureLines lines(NumVertices(state));
+  Run(state, lines.pts.Size(), lines.numFeatures, [&] {
+    std::string text;
+    geojson::WriteFeatureCollectionParallel(
+        text, lines.numFeatures,
+        [&](size_t i) { return lines.FeatureText(i); });
+    return text;
+  });
+}
+BENCHMARK(BM_FeatureCollectionParallelText)
+    ->Apply(VertexRange)
+    ->UseRealTime();
+
+// Features that each reference one of a few shared lines, like records
+// referencing the boundaries of their regions
+static constexpr size_t kSharedGeometries = 16;
+
+std::string SharedLineText(const FeatureLines& lines, size_t i) {
+  size_t line = i % kSharedGeometries % lines.numFeatures;
+  return geojson::text::LineString(
+      lines.numPoints, [&](size_t pt, double& lon, double& lat) {
+        lines.GetPoint(line, pt, lon, lat);
+      });
+}
+
+void BM_SharedGeometryText(benchmark::State& state) {
+  FeatureLines lines(NumVertices(state));
+  Run(state, lines.pts.Size(), lines.numFeatures, [&] {
+    std::string text;
+    geojson::BasicFeatureCollectionWriter<geojson::StringSink> writer(text);
+    for (size_t i = 0; i < lines.numFeatures; i++) {
+      writer.WriteRaw(geojson::text::Feature(i, SharedLineText(lines, i),
+                                             lines.Properties(i)));
+    }
+    writer.Close();
+    return text;
+  });
+}
+BENCHMARK(BM_SharedGeometryText)->Apply(VertexRange);
+
+void BM_SharedGeometryFragments(benchmark::State& state) {
+  FeatureLines lines(NumVertices(state));
+  Run(state, lines.pts.Size(), lines.numFeatures, [&] {
+    std::string text;
+    geojson::BasicFragmentCache<size_t> cache;
+    geojson::BasicFeatureCollectionWriter<geojson::StringSink> writer(text);
+    for (size_t i = 0; i < lines.numFeatures; i++) {
+      const auto& geometry = cache.Get(i % kSharedGeometries, [&] {
+        return SharedLineText(lines, i);
+      });
+      geojson::WriteFeature(writer, i, geometry, lines.Properties(i));
+    }
+    writer.Close();
+    return text;
+  });
+}
+BENCHMARK(BM_SharedGeometryFragments)->Apply(VertexRange);
+
+// Features that all have the same twenty properties
+static constexpr size_t kNumColumns = 20;
+
+std::vector<std::string> ColumnNames() {
+  std::vector<std::string> names;
+  for (size_t c = 0; c < kNumColumns; c++) {
+    names.push_back("column" + std::to_string(c));
+  }
+  return names;
+}
+
+void BM_PropertyObjects(benchmark::State& state) {
+  FeatureLines lines(NumVertices(state));
+  auto names = ColumnNames();
+  Run(state, lines.pts.Size(), lines.numFeatures, [&] {
+    std::string text;
+    geojson::BasicFeatureCollectionWriter<geojson::StringSink> writer(text);
+    for (size_t i = 0; i < lines.numFeatures; i++) {
+      nlohmann::json properties;
+      for (size_t c = 0; c < kNumColumns; c += 4) {
+        properties[names[c]] = static_cast<int64_t>(i * c);
+        properties[names[c + 1]] = 0.5 * i + c;
+        properties[names[c + 2]] = "road";
+        properties[names[c + 3]] = i % 2 == 0;
+      }
+      size_t first = i * lines.numPoints;
+      writer.WriteRaw(geojson::text::Feature(
+          i,
+          geojson::text::LineString(
+              lines.pts.Span().Slice(first, first + lines.numPoints)),
+          properties));
+    }
+    writer.Close();
+    return text;
+  });
+}
+BENCHMARK(BM_PropertyObjects)->Apply(VertexRange);
+
+void BM_PropertySchema(benchmark::State& state) {
+  FeatureLines lines(NumVertices(state));
+  auto names = ColumnNames();
+  geojson::PropertySchema schema;
+  for (size_t c = 0; c < kNumColumns; c += 4) {
+    schema.AddInteger(names[c], [c](size_t i) { return int64_t(i * c); })
+        .AddDouble(names[c + 1], [c](size_t i) { return 0.5 * i + c; })
+        .AddString(names[c + 2], [](size_t) { return std::string("road"); })
+        .AddBool(names[c + 3], [](size_t i) { return i % 2 == 0; });
+  }
+  Run(state, lines.pts.Size(), lines.numFeatures, [&] {
+    std::string text;
+    geojson::BasicFeatureCollectionWriter<geojson::StringSink> writer(text);
+    for (size_t i = 0; i < lines.numFeatures; i++) {
+      size_t first = i * lines.numPoints;
+      geojson::WriteFeature(
+          writer, i,
+          geojson::RawFragment::FromText(geojson::text::LineString(
+              lines.pts.Span().Slice(first, first + lines.numPoints))),
+          schema, i);
+    }
+    writer.Close();
+    return text;
+  });
+}
+BENCHMARK(BM_PropertySchema)->Apply(VertexRange);
+
+// Features in Hilbert order, spilling runs of 1 MB to a temporary file
+void BM_FeatureCollectionHilbert(benchmark::State& state) {
+  FeatureLines lines(NumVertices(state));
+  auto format = geojson::CoordinateFormat().WithBoundingBoxes();
+  std::vector<std::string> features;
+  std::vector<geojson::BoundingBox> bounds;
+  for (size_t i = 0; i < lines.numFeatures; i++) {
+    size_t first = i * lines.numPoints;
+    auto span = lines.pts.Span().Slice(first, first + lines.numPoints);
+    features.push_back(geojson::text::Feature(
+        i, geojson::text::LineString(span, format), lines.Properties(i)));
+    bounds.push_back(span.Bounds());
+  }
+  Run(state, lines.pts.Size(), lines.numFeatures, [&] {
+    std::string text;
+    geojson::BasicHilbertFeatureCollectionWriter<geojson::StringSink> writer(
+        text, geojson::BoundingBox::FromCorners(-180, -90, 180, 90),
+        1024 * 1024);
+    for (size_t i = 0; i < features.size(); i++) {
+      writer.WriteRaw(features[i].data(), features[i].size(), bounds[i]);
+    }
+    writer.Close();
+    return text;
+  });
+}
+BENCHMARK(BM_FeatureCollectionHilbert)->Apply(VertexRange);
+
+void BM_FeatureCollectionFlatGeobuf(benchmark::State& state) {
+  FeatureLines lines(NumVertices(state));
+  Run(state, lines.pts.Size(), lines.numFeatures, [&] {
+    std::string data;
+    geojson::fgb::BasicFeatureCollectionWriter<geojson::StringSink> writer(
+        data);
+    for (size_t i = 0; i < lines.numFeatures; i++) {
+      writer.Write(geojson::FlatGeometry::LineString(
+                       lines.numPoints,
+                       [&](size_t pt, double& lon, double& lat) {
+                         lines.GetPoint(i, pt, lon, lat);
+                       }),
+                   lines.Properties(i));
+    }
+    writer.Close();
+    return data;
+  });
+}
+BENCHMARK(BM_FeatureCollectionFlatGeobuf)->Apply(VertexRange);
+
+// Writes the lines as CBOR with the given coordinate encoding
+void RunCbor(benchmark::State& state, geojson::cbor::Coordinates coordinates,
+             const geojson::CoordinateFormat& format) {
+  FeatureLines lines(NumVertices(state));
+  Run(state, lines.pts.Size(), lines.numFeatures, [&] {
+    std::string data;
+    geojson::cbor::BasicFeatureCollectionWriter<geojson::StringSink> writer(
+        geojson::StringSink(data), coordinates, format);
+    for (size_t i = 0; i < lines.numFeatures; i++) {
+      size_t first = i * lines.numPoints;
+      writer.Write(geojson::FlatGeometry::LineString(lines.pts.Span().Slice(
+                       first, first + lines.numPoints)),
+                   lines.Properties(i));
+    }
+    writer.Close();
+    return data;
+  });
+}
+
+void BM_FeatureCollectionCbor(benchmark::State& state) {
+  RunCbor(state, geojson::cbor::Coordinates::Float64,
+          geojson::CoordinateFormat());
+}
+BENCHMARK(BM_FeatureCollectionCbor)->Apply(VertexRange);
+
+void BM_FeatureCollectionCborDelta(benchmark::State& state) {
+  RunCbor(state, geojson::cbor::Coordinates::Delta,
+          geojson::CoordinateFormat::Fixed(6));
+}
+BENCHMARK(BM_FeatureCollectionCborDelta)->Apply(VertexRange);
+
+// Lines clipped to the zoom 8 tiles they cross, about 1.4 degrees across
+void BM_TilesParallel(benchmark::State& state) {
+  FeatureLines lines(NumVertices(state));
+  auto format = geojson::CoordinateFormat::Fixed(6);
+  Run(state, lines.pts.Size(), lines.numFeatures, [&] {
+    std::map<geojson::TileId, std::string> tiles;
+    geojson::BasicTileWriter<geojson::StringSink> writer(
+        8,
+        [&](const geojson::TileId& tile, bool) {
+          return geojson::StringSink(tiles[tile]);
+        },
+        format);
+    geojson::WriteTiles(writer, lines.numFeatures, [&](size_t i) {
+      size_t first = i * lines.numPoints;
+      return geojson::TileFeature{
+          geojson::FlatGeometry::LineString(
+              lines.pts.Span().Slice(first, first + lines.numPoints)),
+          lines.Properties(i)};
+    });
+    std::string text;
+    for (const auto& tile : tiles) text += tile.second;
+    return text;
+  });
+}
+BENCHMARK(BM_TilesParallel)->Apply(VertexRange)->UseRealTime();
+
+// Counts the positions and the features with a given name
+struct CountingHandler : public geojson::ReaderHandler {
+  void OnPosition(double lon, double, double) {
+    numPositions++;
+    benchmark::DoNotOptimize(lon);
+  }
+  void OnProperties(nlohmann::json&& props) {
+    if (props["name"] == "road") numRoads++;
+  }
+
+  size_t numPositions = 0, numRoads = 0;
+};
+
+// Filters on the name without parsing the properties
+struct RawCountingHandler : public CountingHandler {
+  void OnRawProperties(const geojson::RawJson& props) {
+    if (props.Find("name").Unquoted() == "road") numRoads++;
+  }
+};
+
+// Runs the benchmark loop, where read() reads the text of a collection
+template <typename Read>
+void RunRead(benchmark::State& state, Read&& read) {
+  FeatureLines lines(NumVertices(state));
+  std::string text;
+  geojson::WriteFeatureCollection(text, lines.numFeatures,
+                                  [&](size_t i) { return lines.Feature(i); });
+
+  size_t allocationsBefore = numAllocations.load();
+  for (auto _ : state) read(text);
+  auto allocations =
+      static_cast<double>(numAllocations.load() - allocationsBefore);
+
+  auto iterations = static_cast<double>(state.iterations());
+  state.SetBytesProcessed(
+      static_cast<int64_t>(text.size() * state.iterations()));
+  state.counters["vertices/s"] = benchmark::Counter(
+      lines.pts.Size() * iterations, benchmark::Counter::kIsRate);
+  state.counters["allocs/feature"] =
+      benchmark::Counter(allocations / (iterations * lines.numFeatures));
+}
+
+void BM_ReadDom(benchmark::State& state) {
+  RunRead(state, [](const std::string& text) {
+    auto j = nlohmann::json::parse(text);
+    benchmark::DoNotOptimize(j.size());
+  });
+}
+BENCHMARK(BM_ReadDom)->Apply(VertexRange);
+
+void BM_ReadStream(benchmark::State& state) {
+  RunRead(state, [](const std::string& text) {
+    std::istringstream is(text);
+    CountingHandler handler;
+    geojson::Read(is, handler);
+    benchmark::DoNotOptimize(handler.numPositions);
+  });
+}
+BENCHMARK(BM_ReadStream)->Apply(VertexRange);
+
+void BM_ReadMemory(benchmark::State& state) {
+  RunRead(state, [](const std::string& text) {
+    CountingHandler handler;
+    geojson::Read(text, handler);
+    benchmark::DoNotOptimize(handler.numPositions);
+  });
+}
+BENCHMARK(BM_ReadMemory)->Apply(VertexRange);
+
+void BM_ReadMemoryRaw(benchmark::State& state) {
+  RunRead(state, [](const std::string& text) {
+    RawCountingHandler handler;
+    geojson::Read(text, handler);
+    benchmark::DoNotOptimize(handler.numPositions);
+  });
+}
+BENCHMARK(BM_ReadMemoryRaw)->Apply(VertexRange);
+
+// Decodes the positions of a CBOR collection, for comparison with the text
+void BM_ReadCbor(benchmark::State& state) {
+  FeatureLines lines(NumVertices(state));
+  std::string data;
+  {
+    geojson::cbor::BasicFeatureCollectionWriter<geojson::StringSink> writer(
+        (geojson::StringSink(data)));
+    for (size_t i = 0; i < lines.numFeatures; i++) {
+      size_t first = i * lines.numPoints;
+      writer.Write(geojson::FlatGeometry::LineString(lines.pts.Span().Slice(
+                       first, first + lines.numPoints)),
+                   lines.Properties(i));
+    }
+  }
+
+  for (auto _ : state) {
+    size_t numPositions = 0;
+    geojson::cbor::ReadFeatureCollection(
+        data, [&](geojson::FlatGeometry geometry, nlohmann::json) {
+          numPositions += geometry.NumPositions();
+        });
+    benchmark::DoNotOptimize(numPositions);
+  }
+  auto iterations = static_cast<double>(state.iterations());
+  state.SetBytesProcessed(
+      static_cast<int64_t>(data.size() * state.iterations()));
+  state.counters["vertices/s"] = benchmark::Counter(
+      lines.pts.Size() * iterations, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ReadCbor)->Apply(VertexRange);
+
+// Keeps the geometry of every feature in a FlatGeometry
+struct FlatGeometryHandler : public geojson::FlatGeometryBuilder {
+  void OnFeatureEnd(size_t) { geometries.push_back(TakeGeometry()); }
+
+  std::vector<geojson::FlatGeometry> geometries;
+};
+
+void BM_ReadFlatGeometry(benchmark::State& state) {
+  RunRead(state, [](const std::string& text) {
+    FlatGeometryHandler handler;
+    geojson::Read(text, handler);
+    benchmark::DoNotOptimize(handler.geometries.data());
+  });
+}
+BENCHMARK(BM_ReadFlatGeometry)->Apply(VertexRange);
+
+void BM_ReadParallel(benchmark::State& state) {
+  RunRead(state, [](const std::string& text) {
+    auto handlers = geojson::ReadFeatureCollectionParallel(
+        text.data(), text.data() + text.size(),
+        [](size_t) { return CountingHandler(); });
+    benchmark::DoNotOptimize(handlers.data());
+  });
+}
+BENCHMARK(BM_ReadParallel)->Apply(VertexRange)->UseRealTime();
+
+// Small boxes spread over the world, as with the features of a large layer
+std::vector<geojson::BoundingBox> RandomBoxes(size_t numBoxes) {
+  std::vector<geojson::BoundingBox> boxes;
+  boxes.reserve(numBoxes);
+  uint64_t state = 1;
+  auto random = [&] {
+    state = state * 6364136223846793005 + 1442695040888963407;
+    return static_cast<double>(state >> 11) / (1ull << 53);
+  };
+  for (size_t i = 0; i < numBoxes; i++) {
+    double lon = random() * 360 - 180, lat = random() * 180 - 90;
+    boxes.push_back(geojson::BoundingBox::FromCorners(
+        lon, lat, lon + random() * 0.01, lat + random() * 0.01));
+  }
+  return boxes;
+}
+
+geojson::PackedRTree BuildTree(const std::vector<geojson::BoundingBox>& boxes) {
+  geojson::PackedRTree tree(boxes.size());
+  for (const auto& box : boxes) tree.Add(box);
+  tree.Finish();
+  return tree;
+}
+
+void BoxRange(benchmark::internal::Benchmark* bench) {
+  bench->RangeMultiplier(10)->Range(1000, 5000000)->Unit(
+      benchmark::kMicrosecond);
+}
+
+void BM_RTreeBuild(benchmark::State& state) {
+  auto boxes = RandomBoxes(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    auto tree = BuildTree(boxes);
+    benchmark::DoNotOptimize(tree.NumItems());
+  }
+  state.SetItemsProcessed(
+      static_cast<int64_t>(boxes.size() * state.iterations()));
+}
+BENCHMARK(BM_RTreeBuild)->Apply(BoxRange);
+
+// A viewport of about a city, queried at random places
+void BM_RTreeSearch(benchmark::State& state) {
+  auto boxes = RandomBoxes(static_cast<size_t>(state.range(0)));
+  auto tree = BuildTree(boxes);
+  auto queries = RandomBoxes(1024);
+  size_t i = 0, numFound = 0;
+  for (auto _ : state) {
+    const auto& query = queries[i++ % queries.size()];
+    tree.Search(query.MinLon(), query.MinLat(), query.MinLon() + 0.5,
+                query.MinLat() + 0.5, [&](size_t) { numFound++; });
+  }
+  state.counters["found/query"] =
+      benchmark::Counter(static_cast<double>(numFound) / state.iterations());
+}
+BENCHMARK(BM_RTreeSearch)->Apply(BoxRange);
+}
+
+BENCHMARK_MAIN();
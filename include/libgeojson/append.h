@@ -0,0 +1,581 @@
+/** Appending to GeoJSON files in place for libgeojson
+ *
+ *  \file append.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "libgeojson/libgeojson.h"
+#include "libgeojson/mapped_file.h"
+#include "libgeojson/parallel_reader.h"
+#include "libgeojson/sequence.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#error "Offset indices are only supported on little-endian machines"
+#endif
+
+namespace geojson {
+
+/** The layouts of the files a FeatureAppender appends to */
+enum class AppendFormat {
+  /** A FeatureCollection object, ending with its features array */
+  FeatureCollection,
+
+  /** A GeoJSON Text Sequence (RFC 8142), with record separators */
+  Sequence,
+
+  /** Newline-delimited GeoJSON, a sequence without record separators */
+  NewlineDelimited
+};
+
+/** Where a feature is in a file, as kept by the offset index of a
+ *  FeatureAppender
+ */
+struct FeatureExtent {
+  /** The byte offset of the text of the feature */
+  uint64_t offset;
+
+  /** The number of bytes of the feature's slot, its text possibly followed
+   *  by whitespace
+   */
+  uint32_t size;
+
+  /** 1 if the feature was removed, 0 otherwise */
+  uint32_t removed;
+};
+
+namespace detail {
+
+static_assert(sizeof(FeatureExtent) == 16, "FeatureExtent must be packed");
+
+/** The magic bytes that start an offset index, which are followed by the
+ *  size of the file it indexes and the extents of its features
+ */
+static constexpr char kOffsetIndexMagic[8] = {'G', 'J', 'S', 'O',
+                                              'N', 'I', 'D', 'X'};
+
+/** The size of the header of an offset index */
+static constexpr size_t kOffsetIndexHeaderSize = 16;
+
+/** The feature that takes the place of a removed feature of a
+ *  FeatureCollection, since the array cannot have a hole
+ */
+static constexpr char kRemovedFeature[] =
+    "{\"type\":\"Feature\",\"geometry\":null,\"properties\":null}";
+
+/** A file that is read and written at byte offsets */
+class RandomAccessFile {
+ public:
+  /** Opens a file
+   *
+   *  \param path  The path of the file
+   *  \param mode  The std::fopen() mode, "r+b" or "w+b"
+   *
+   *  \throws std::system_error if the file cannot be opened
+   */
+  RandomAccessFile(const std::string& path, const char* mode)
+      : file_(std::fopen(path.c_str(), mode)), path_(path) {
+    if (!file_) Fail();
+  }
+
+  RandomAccessFile(const RandomAccessFile&) = delete;
+  RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+
+  ~RandomAccessFile() { std::fclose(file_); }
+
+  /** Returns the number of bytes in the file */
+  uint64_t Size() {
+    Seek(0, SEEK_END);
+#ifdef _WIN32
+    auto size = _ftelli64(file_);
+#else
+    auto size = ftello(file_);
+#endif
+    if (size < 0) Fail();
+    return static_cast<uint64_t>(size);
+  }
+
+  /** Reads size bytes from an offset in the file */
+  void ReadAt(uint64_t offset, void* data, size_t size) {
+    Seek(offset, SEEK_SET);
+    if (size > 0 && std::fread(data, 1, size, file_) != size) Fail();
+  }
+
+  /** Writes size bytes at an offset in the file, extending it if needed */
+  void WriteAt(uint64_t offset, const void* data, size_t size) {
+    Seek(offset, SEEK_SET);
+    if (size > 0 && std::fwrite(data, 1, size, file_) != size) Fail();
+    Instrument::OnBytesWritten(size);
+  }
+
+  /** Writes any buffered output to the file */
+  void Flush() {
+    if (std::fflush(file_) != 0) Fail();
+  }
+
+ private:
+  void Seek(uint64_t offset, int origin) {
+#ifdef _WIN32
+    int result = _fseeki64(file_, static_cast<__int64>(offset), origin);
+#else
+    int result = fseeko(file_, static_cast<off_t>(offset), origin);
+#endif
+    if (result != 0) Fail();
+  }
+
+  [[noreturn]] void Fail() const {
+    int error = errno ? errno : EIO;
+    throw std::system_error(error, std::generic_category(), path_);
+  }
+
+  FILE* file_;
+  std::string path_;
+};
+
+/** Returns whether a file exists and can be opened */
+inline bool FileExists(const std::string& path) {
+  FILE* file = std::fopen(path.c_str(), "rb");
+  if (!file) return false;
+  std::fclose(file);
+  return true;
+}
+
+/** Returns the offset of the last character before end that is not JSON
+ *  whitespace, reading the file backwards
+ *
+ *  \throws std::domain_error if there is only whitespace before end
+ */
+inline uint64_t LastNonWhitespace(RandomAccessFile& file, uint64_t end) {
+  char buffer[256];
+  while (end > 0) {
+    size_t count = static_cast<size_t>(std::min<uint64_t>(end, sizeof(buffer)));
+    end -= count;
+    file.ReadAt(end, buffer, count);
+    for (size_t i = count; i-- > 0;) {
+      char c = buffer[i];
+      if (c != ' ' && c != '\t' && c != '\n' && c != '\r') return end + i;
+    }
+  }
+  throw std::domain_error("Expected a FeatureCollection ending with ]}");
+}
+
+/** Returns the extents of the features of a FeatureCollection, with
+ *  placeholders of removed features marked as removed
+ */
+inline std::vector<FeatureExtent> ScanFeatureCollection(const char* begin,
+                                                        const char* end) {
+  std::vector<FeatureExtent> extents;
+  StringView removed(kRemovedFeature, sizeof(kRemovedFeature) - 1);
+  for (const auto& chunk : FeatureChunks(begin, end, 1)) {
+    size_t size = static_cast<size_t>(chunk.last - chunk.first);
+    extents.push_back(FeatureExtent{
+        static_cast<uint64_t>(chunk.first - begin),
+        static_cast<uint32_t>(size),
+        StringView(chunk.first, size) == removed ? 1u : 0u});
+  }
+  return extents;
+}
+
+/** Returns the extents of the records of a sequence, without their record
+ *  separators and line feeds, with blank records marked as removed
+ */
+inline std::vector<FeatureExtent> ScanSequence(const char* begin,
+                                               const char* end,
+                                               bool recordSeparators) {
+  std::vector<FeatureExtent> extents;
+  char delimiter = recordSeparators ? kRecordSeparator : '\n';
+  const char* first = begin;
+  while (first != end) {
+    if (*first == delimiter) first++;
+    auto last = static_cast<const char*>(
+        std::memchr(first, delimiter, static_cast<size_t>(end - first)));
+    if (!last) last = end;
+    const char* textEnd = last;
+    if (recordSeparators && textEnd != first && textEnd[-1] == '\n') {
+      textEnd--;
+    }
+    if (textEnd != first) {
+      extents.push_back(
+          FeatureExtent{static_cast<uint64_t>(first - begin),
+                        static_cast<uint32_t>(textEnd - first),
+                        IsBlank(first, textEnd) ? 1u : 0u});
+    }
+    first = last;
+  }
+  return extents;
+}
+
+/** Reads an offset index, setting indexedSize to the size of the file it
+ *  was last updated for
+ */
+inline std::vector<FeatureExtent> ReadOffsetIndex(const std::string& path,
+                                                  uint64_t& indexedSize) {
+  RandomAccessFile file(path, "rb");
+  uint64_t size = file.Size();
+  char header[kOffsetIndexHeaderSize];
+  if (size < sizeof(header) ||
+      (size - sizeof(header)) % sizeof(FeatureExtent) != 0) {
+    throw std::domain_error("Not an offset index: " + path);
+  }
+  file.ReadAt(0, header, sizeof(header));
+  if (std::memcmp(header, kOffsetIndexMagic, sizeof(kOffsetIndexMagic)) !=
+      0) {
+    throw std::domain_error("Not an offset index: " + path);
+  }
+  std::memcpy(&indexedSize, header + sizeof(kOffsetIndexMagic),
+              sizeof(indexedSize));
+  std::vector<FeatureExtent> extents(
+      static_cast<size_t>((size - sizeof(header)) / sizeof(FeatureExtent)));
+  file.ReadAt(sizeof(header), extents.data(),
+              extents.size() * sizeof(FeatureExtent));
+  return extents;
+}
+}
+
+/** Reads the extents of the features from an offset index kept by a
+ *  FeatureAppender
+ *
+ *  \param path  The path of the offset index
+ *
+ *  \throws std::system_error if the index cannot be read
+ *  \throws std::domain_error if the file is not an offset index
+ */
+inline std::vector<FeatureExtent> ReadOffsetIndex(const std::string& path) {
+  uint64_t indexedSize;
+  return detail::ReadOffsetIndex(path, indexedSize);
+}
+
+/** Appends features to an existing FeatureCollection or sequence file in
+ *  place, without rewriting it
+ *
+ *  A FeatureCollection is reopened by seeking back from the end of the file
+ *  to the closing brackets of its features array, which must be its last
+ *  member, as BasicFeatureCollectionWriter writes it. Each feature is written
+ *  over the brackets and followed by them again, so the file is a complete
+ *  collection whenever it has been flushed. A sequence has each record
+ *  written at its end.
+ *  Files that do not exist are created empty.
+ *
+ *  The appender can keep a sidecar offset index of the extent of each
+ *  feature in the file, numbered in the order they were first written. It
+ *  is updated in place with each change, and a missing or out of date index
+ *  (i.e. the file was written without it) is rebuilt by scanning the file.
+ *  With an index, features can also be replaced and removed:
+ *    - A replacement that fits in the slot of the old feature is written over
+ *      it, padded with whitespace. Otherwise the old feature is removed and
+ *      the replacement is appended, keeping the number of the feature.
+ *    - A removed feature of a sequence is overwritten with whitespace, which
+ *      readers skip as a blank record. That of a FeatureCollection is
+ *      overwritten with a Feature with null geometry and properties, since
+ *      the array cannot have a hole.
+ *
+ *  Only one appender may have a file open at a time.
+ */
+class FeatureAppender : public detail::JsonFeatureWriter<FeatureAppender> {
+ public:
+  /** Constructor, opens or creates the file and its index
+   *
+   *  \param path       The path of the file
+   *  \param format     The layout of the file
+   *  \param indexPath  The path of the offset index to keep, or empty to
+   *                    keep none
+   *
+   *  \throws std::system_error if a file cannot be opened, read or written
+   *  \throws std::domain_error if the file is not in the given format
+   *  \throws nlohmann::json::parse_error if the index is rebuilt from a file
+   *          that is not valid JSON
+   */
+  explicit FeatureAppender(
+      const std::string& path,
+      AppendFormat format = AppendFormat::FeatureCollection,
+      const std::string& indexPath = std::string())
+      : file_(path, detail::FileExists(path) ? "r+b" : "w+b"),
+        format_(format), size_(file_.Size()), end_(0), empty_(true),
+        numFeatures_(0), closed_(false) {
+    if (format_ == AppendFormat::FeatureCollection) {
+      OpenFeatureCollection();
+    } else {
+      OpenSequence();
+    }
+    if (!indexPath.empty()) OpenIndex(path, indexPath);
+  }
+
+  FeatureAppender(const FeatureAppender&) = delete;
+  FeatureAppender& operator=(const FeatureAppender&) = delete;
+
+  /** Destructor, closes the files if Close() was not called */
+  ~FeatureAppender() {
+    try {
+      Close();
+    } catch (...) {
+    }
+  }
+
+  /** Appends an already serialized feature verbatim
+   *
+   *  \param data  The serialized GeoJSON Feature object, on one line for a
+   *               sequence
+   *  \param size  The number of bytes in data
+   */
+  void WriteRaw(const char* data, size_t size) {
+    CheckOpen();
+    auto extent = Append(data, size);
+    if (index_) AddExtent(extent);
+    numFeatures_++;
+  }
+
+  /** \overload */
+  void WriteRaw(const std::string& feature) {
+    WriteRaw(feature.data(), feature.size());
+  }
+
+  /** Replaces a feature
+   *
+   *  \param i        The number of the feature in the index
+   *  \param feature  A GeoJSON Feature object
+   *
+   *  \throws std::logic_error if no index is kept
+   *  \throws std::out_of_range if there is no such feature
+   */
+  void Replace(size_t i, const nlohmann::json& feature) {
+    detail::LibraryScope scope;
+    auto text = feature.dump();
+    ReplaceRaw(i, text.data(), text.size());
+  }
+
+  /** Replaces a feature with an already serialized one, see Replace() */
+  void ReplaceRaw(size_t i, const char* data, size_t size) {
+    auto extent = Extent(i);
+    if (size <= extent.size) {
+      std::string slot(data, size);
+      slot.append(extent.size - size, ' ');
+      file_.WriteAt(extent.offset, slot.data(), slot.size());
+      extent.removed = 0;
+    } else {
+      Clear(extent);
+      extent = Append(data, size);
+    }
+    SetExtent(i, extent);
+  }
+
+  /** \overload */
+  void ReplaceRaw(size_t i, const std::string& feature) {
+    ReplaceRaw(i, feature.data(), feature.size());
+  }
+
+  /** Removes a feature, which keeps its number in the index
+   *
+   *  \param i  The number of the feature in the index
+   *
+   *  \throws std::logic_error if no index is kept
+   *  \throws std::out_of_range if there is no such feature
+   *  \throws std::domain_error if the feature of a FeatureCollection is
+   *          shorter than the Feature that takes its place
+   */
+  void Remove(size_t i) {
+    auto extent = Extent(i);
+    if (extent.removed) return;
+    Clear(extent);
+    extent.removed = 1;
+    SetExtent(i, extent);
+  }
+
+  /** Writes any buffered output to the files */
+  void Flush() {
+    file_.Flush();
+    if (index_) index_->Flush();
+  }
+
+  /** Flushes and closes the files, further calls are no-ops */
+  void Close() {
+    if (closed_) return;
+    closed_ = true;
+    Flush();
+  }
+
+  /** Returns the number of features appended by this appender */
+  size_t NumFeatures() const { return numFeatures_; }
+
+  /** Returns the extents of the features in the index, which is empty if no
+   *  index is kept
+   */
+  const std::vector<FeatureExtent>& Extents() const { return extents_; }
+
+ private:
+  bool IsSequence() const {
+    return format_ != AppendFormat::FeatureCollection;
+  }
+
+  void OpenFeatureCollection() {
+    if (size_ == 0) {
+      static constexpr char kEmpty[] = "{\"type\":\"FeatureCollection\","
+                                       "\"features\":[]}";
+      file_.WriteAt(0, kEmpty, sizeof(kEmpty) - 1);
+      size_ = sizeof(kEmpty) - 1;
+    }
+
+    // Find the closing brackets of the features array
+    uint64_t brace = detail::LastNonWhitespace(file_, size_);
+    uint64_t bracket = detail::LastNonWhitespace(file_, brace);
+    if (CharAt(brace) != '}' || CharAt(bracket) != ']') {
+      throw std::domain_error("Expected a FeatureCollection ending with ]}");
+    }
+    end_ = bracket;
+    empty_ = CharAt(detail::LastNonWhitespace(file_, bracket)) == '[';
+  }
+
+  void OpenSequence() {
+    end_ = size_;
+    empty_ = size_ == 0;
+    if (empty_) return;
+
+    if ((CharAt(0) == kRecordSeparator) !=
+        (format_ == AppendFormat::Sequence)) {
+      throw std::domain_error(format_ == AppendFormat::Sequence
+                                  ? "Expected record separators"
+                                  : "Expected newline-delimited GeoJSON");
+    }
+
+    // Finish a record cut short, so the next one starts on its own
+    if (CharAt(size_ - 1) != '\n') {
+      file_.WriteAt(size_, "\n", 1);
+      end_ = ++size_;
+    }
+  }
+
+  void OpenIndex(const std::string& path, const std::string& indexPath) {
+    if (detail::FileExists(indexPath)) {
+      try {
+        uint64_t indexedSize;
+        extents_ = detail::ReadOffsetIndex(indexPath, indexedSize);
+        if (indexedSize == size_) {
+          index_.reset(new detail::RandomAccessFile(indexPath, "r+b"));
+          return;
+        }
+      } catch (const std::domain_error&) {
+      }
+    }
+
+    // Rebuild the index from the file
+    file_.Flush();
+    MappedFile mapped(path);
+    const char* begin = mapped.Data();
+    const char* end = begin + mapped.Size();
+    extents_ = IsSequence() ? detail::ScanSequence(
+                                  begin, end,
+                                  format_ == AppendFormat::Sequence)
+                            : detail::ScanFeatureCollection(begin, end);
+
+    index_.reset(new detail::RandomAccessFile(indexPath, "w+b"));
+    index_->WriteAt(0, detail::kOffsetIndexMagic,
+                    sizeof(detail::kOffsetIndexMagic));
+    index_->WriteAt(kExtentsOffset, extents_.data(),
+                    extents_.size() * sizeof(FeatureExtent));
+    WriteIndexedSize();
+  }
+
+  /** Writes a feature at the end of the file */
+  FeatureExtent Append(const char* data, size_t size) {
+    if (size > UINT32_MAX) {
+      throw std::domain_error("Features in an offset index must be < 4 GiB");
+    }
+
+    buffer_.clear();
+    if (IsSequence()) {
+      if (format_ == AppendFormat::Sequence) buffer_ += kRecordSeparator;
+    } else if (!empty_) {
+      buffer_ += ',';
+    }
+    uint64_t offset = end_ + buffer_.size();
+    buffer_.append(data, size);
+    buffer_ += IsSequence() ? "\n" : "]}";
+
+    // Whitespace that was after the old brackets stays after the new ones
+    uint64_t end = end_ + buffer_.size();
+    if (end < size_) buffer_.append(static_cast<size_t>(size_ - end), ' ');
+
+    file_.WriteAt(end_, buffer_.data(), buffer_.size());
+    end_ = IsSequence() ? end : offset + size;
+    size_ = std::max(size_, end);
+    empty_ = false;
+    return FeatureExtent{offset, static_cast<uint32_t>(size), 0};
+  }
+
+  /** Overwrites the slot of a feature with its removed placeholder */
+  void Clear(const FeatureExtent& extent) {
+    std::string slot;
+    if (!IsSequence()) {
+      if (extent.size < sizeof(detail::kRemovedFeature) - 1) {
+        throw std::domain_error("Feature is too short to be removed");
+      }
+      slot = detail::kRemovedFeature;
+    }
+    slot.append(extent.size - slot.size(), ' ');
+    file_.WriteAt(extent.offset, slot.data(), slot.size());
+  }
+
+  FeatureExtent Extent(size_t i) const {
+    CheckOpen();
+    if (!index_) {
+      throw std::logic_error("Features can only be changed with an index");
+    }
+    if (i >= extents_.size()) {
+      throw std::out_of_range("No such feature in the offset index");
+    }
+    return extents_[i];
+  }
+
+  void AddExtent(const FeatureExtent& extent) {
+    extents_.push_back(extent);
+    SetExtent(extents_.size() - 1, extent);
+  }
+
+  void SetExtent(size_t i, const FeatureExtent& extent) {
+    extents_[i] = extent;
+    index_->WriteAt(kExtentsOffset + i * sizeof(FeatureExtent), &extent,
+                    sizeof(extent));
+    WriteIndexedSize();
+  }
+
+  void WriteIndexedSize() {
+    index_->WriteAt(sizeof(detail::kOffsetIndexMagic), &size_, sizeof(size_));
+  }
+
+  char CharAt(uint64_t offset) {
+    char c;
+    file_.ReadAt(offset, &c, 1);
+    return c;
+  }
+
+  void CheckOpen() const {
+    if (closed_) throw std::logic_error("Cannot write to a closed appender");
+  }
+
+  static constexpr uint64_t kExtentsOffset = detail::kOffsetIndexHeaderSize;
+
+  detail::RandomAccessFile file_;
+  std::unique_ptr<detail::RandomAccessFile> index_;
+  std::vector<FeatureExtent> extents_;
+  std::string buffer_;
+  AppendFormat format_;
+  uint64_t size_;
+  uint64_t end_;
+  bool empty_;
+  size_t numFeatures_;
+  bool closed_;
+};
+}
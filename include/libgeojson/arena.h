@@ -0,0 +1,210 @@
+/** Arena allocation for libgeojson DOM trees
+ *
+ *  \file arena.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "libgeojson/libgeojson.h"
+
+namespace geojson {
+
+/** A monotonic arena of memory
+ *
+ *  Memory is handed out by bumping a pointer through large blocks and is only
+ *  given back all at once, by Release() or the destructor, with one call to
+ *  the system per block. The objects in it must still be destroyed before
+ *  then, which for a tree is a walk over its nodes, but gives no memory back
+ *  on the way. An arena is not thread-safe, each thread (or request) should
+ *  have its own.
+ */
+class MonotonicArena {
+ public:
+  /** The default size of the blocks requested from the system */
+  static constexpr size_t kDefaultBlockSize = 64 * 1024;
+
+  /** Constructor
+   *
+   *  \param blockSize  The size of the blocks requested from the system,
+   *                    larger allocations get a block of their own
+   */
+  explicit MonotonicArena(size_t blockSize = kDefaultBlockSize)
+      : blockSize_(blockSize), head_(nullptr), used_(0), bytesUsed_(0),
+        bytesReserved_(0) {}
+
+  MonotonicArena(const MonotonicArena&) = delete;
+  MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+  /** Destructor, gives all of the memory back to the system */
+  ~MonotonicArena() { Release(); }
+
+  /** Returns size bytes of memory aligned to the given power of two */
+  void* Allocate(size_t size, size_t alignment) {
+    char* ptr = head_ ? Align(Data(head_) + used_, alignment) : nullptr;
+    if (!head_ || ptr + size > Data(head_) + head_->capacity) {
+      AddBlock(size + alignment);
+      ptr = Align(Data(head_), alignment);
+    }
+    size_t consumed = static_cast<size_t>(ptr + size - (Data(head_) + used_));
+    used_ += consumed;
+    bytesUsed_ += consumed;
+    return ptr;
+  }
+
+  /** Gives all of the memory back to the system
+   *
+   *  Everything that was allocated from the arena is invalidated.
+   */
+  void Release() {
+    while (head_) {
+      Block* next = head_->next;
+      ::operator delete(head_);
+      head_ = next;
+    }
+    used_ = 0;
+    bytesUsed_ = 0;
+    bytesReserved_ = 0;
+  }
+
+  /** Returns the number of bytes handed out, including alignment padding */
+  size_t BytesUsed() const { return bytesUsed_; }
+
+  /** Returns the number of bytes requested from the system */
+  size_t BytesReserved() const { return bytesReserved_; }
+
+ private:
+  struct Block {
+    Block* next;
+    size_t capacity;
+  };
+
+  static char* Data(Block* block) {
+    return reinterpret_cast<char*>(block) + sizeof(Block);
+  }
+
+  static char* Align(char* ptr, size_t alignment) {
+    auto addr = reinterpret_cast<std::uintptr_t>(ptr);
+    addr = (addr + alignment - 1) & ~(std::uintptr_t(alignment) - 1);
+    return reinterpret_cast<char*>(addr);
+  }
+
+  void AddBlock(size_t minCapacity) {
+    size_t capacity = minCapacity > blockSize_ ? minCapacity : blockSize_;
+    auto block = static_cast<Block*>(::operator new(sizeof(Block) + capacity));
+    block->next = head_;
+    block->capacity = capacity;
+    head_ = block;
+    used_ = 0;
+    bytesReserved_ += sizeof(Block) + capacity;
+  }
+
+  size_t blockSize_;
+  Block* head_;
+  size_t used_;
+  size_t bytesUsed_;
+  size_t bytesReserved_;
+};
+
+namespace detail {
+
+/** Returns the arena that ArenaAllocator allocates from on this thread */
+inline MonotonicArena*& CurrentArena() {
+  static thread_local MonotonicArena* arena = nullptr;
+  return arena;
+}
+}
+
+/** Makes an arena the one that ArenaJson values are allocated from on the
+ *  current thread, for the lifetime of the scope
+ *
+ *  Scopes can be nested, the previous arena is restored on destruction.
+ */
+class ArenaScope {
+ public:
+  /** Constructor
+   *
+   *  \param arena  The arena to allocate from, must outlive the scope
+   */
+  explicit ArenaScope(MonotonicArena& arena)
+      : previous_(detail::CurrentArena()) {
+    detail::CurrentArena() = &arena;
+  }
+
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+
+  /** Destructor, restores the previous arena */
+  ~ArenaScope() { detail::CurrentArena() = previous_; }
+
+ private:
+  MonotonicArena* previous_;
+};
+
+/** A stateless allocator that allocates from the current thread's arena
+ *
+ *  nlohmann::basic_json default-constructs its allocators, so the arena
+ *  cannot be held by the allocator itself and is given by an ArenaScope
+ *  instead. Deallocation is a no-op, the memory is reclaimed when the arena
+ *  is released.
+ *
+ *  \tparam T  The type of the allocated objects
+ */
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  ArenaAllocator() noexcept {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>&) noexcept {}
+
+  /** Allocates room for n objects from the current arena
+   *
+   *  \throws std::logic_error if there is no ArenaScope on this thread
+   */
+  T* allocate(size_t n) {
+    MonotonicArena* arena = detail::CurrentArena();
+    if (!arena) {
+      throw std::logic_error("Arena allocations require an ArenaScope");
+    }
+    return static_cast<T*>(arena->Allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T*, size_t) noexcept {}
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>&) const noexcept {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>&) const noexcept {
+    return false;
+  }
+};
+
+/** A JSON type whose arrays, objects and nodes live in the current arena
+ *
+ *  All of the builders take it as their first template argument, e.g.
+ *  LineString<ArenaJson>(n, getPoint). Values must be created and modified
+ *  inside an ArenaScope and destroyed before its arena is released.
+ *  Destroying a value still visits each of its nodes, as for nlohmann::json,
+ *  but the only memory it frees is that of strings, which use the global
+ *  allocator. Short ones (such as every "type") fit in std::string's inline
+ *  buffer and are not allocated at all.
+ */
+using ArenaJson =
+    nlohmann::basic_json<std::map, std::vector, std::string, bool,
+                         std::int64_t, std::uint64_t, double, ArenaAllocator>;
+}
@@ -0,0 +1,992 @@
+/** Binary CBOR output for libgeojson
+ *
+ *  \file cbor.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "libgeojson/flat_geometry.h"
+#include "libgeojson/libgeojson.h"
+#include "libgeojson/reader.h"
+#include "libgeojson/writer.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#error "CBOR output is only supported on little-endian machines"
+#endif
+
+namespace geojson {
+
+/** CBOR (RFC 8949) output, with the positions held in typed arrays
+ *
+ *  Objects are CBOR maps with the same members as their GeoJSON text, so
+ *  any CBOR decoder can read them, but each array of positions, i.e. the
+ *  coordinates of a MultiPoint or LineString and each ring of a Polygon, is
+ *  a row-major array (RFC 8746 tag 40) of [numPositions, dims] whose elements
+ *  are one of
+ *
+ *   - Float64: a little-endian float64 typed array (tag 86)
+ *   - Float32: a little-endian float32 typed array (tag 85)
+ *   - Delta:   an array of integers, each the change in the coordinate times
+ *              10^decimals from the same coordinate of the previous position,
+ *              as Geobuf does, with the geometry given a "decimals" member
+ *
+ *  so a decoder copies the coordinates out rather than parsing each one.
+ *  CBOR integers already take 1 to 9 bytes by magnitude, so the deltas of
+ *  nearby positions take one or two bytes each. The positions of a Point
+ *  are a plain array of numbers, and rings are closed and wound as they are
+ *  by the geojson builders.
+ */
+namespace cbor {
+
+/** How the coordinates of positions are encoded */
+enum class Coordinates { Float64, Float32, Delta };
+
+namespace detail {
+
+using geojson::detail::Dimension;
+using geojson::detail::Instrument;
+using geojson::detail::LibraryScope;
+
+static constexpr uint8_t kUnsigned = 0;
+static constexpr uint8_t kNegative = 1;
+static constexpr uint8_t kBytes = 2;
+static constexpr uint8_t kText = 3;
+static constexpr uint8_t kArray = 4;
+static constexpr uint8_t kMap = 5;
+static constexpr uint8_t kTag = 6;
+static constexpr uint8_t kSimple = 7;
+
+static constexpr uint64_t kMultiDimensionalTag = 40;
+static constexpr uint64_t kFloat32ArrayTag = 85;
+static constexpr uint64_t kFloat64ArrayTag = 86;
+static constexpr uint8_t kIndefinite = 31;
+static constexpr uint8_t kBreak = 0xff;
+static constexpr uint8_t kNull = 0xf6;
+
+/** The deepest nesting of data items that the reader follows */
+static constexpr size_t kMaxNesting = 512;
+
+/** Appends the head of a data item, its major type and argument */
+inline void AppendHead(std::string& out, uint8_t major, uint64_t value) {
+  uint8_t type = static_cast<uint8_t>(major << 5);
+  int bytes;
+  if (value < 24) {
+    out.push_back(static_cast<char>(type | value));
+    return;
+  } else if (value <= 0xff) {
+    out.push_back(static_cast<char>(type | 24));
+    bytes = 1;
+  } else if (value <= 0xffff) {
+    out.push_back(static_cast<char>(type | 25));
+    bytes = 2;
+  } else if (value <= 0xffffffff) {
+    out.push_back(static_cast<char>(type | 26));
+    bytes = 4;
+  } else {
+    out.push_back(static_cast<char>(type | 27));
+    bytes = 8;
+  }
+  for (int i = bytes - 1; i >= 0; i--) {
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+/** Appends a text string */
+inline void AppendText(std::string& out, const char* text) {
+  size_t size = std::strlen(text);
+  AppendHead(out, kText, size);
+  out.append(text, size);
+}
+
+/** Appends a signed integer */
+inline void AppendInteger(std::string& out, int64_t value) {
+  if (value >= 0) {
+    AppendHead(out, kUnsigned, static_cast<uint64_t>(value));
+  } else {
+    AppendHead(out, kNegative, static_cast<uint64_t>(-(value + 1)));
+  }
+}
+
+/** Appends a float64, which CBOR holds big-endian */
+inline void AppendFloat64(std::string& out, double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  out.push_back(static_cast<char>(0xfb));
+  for (int i = 7; i >= 0; i--) {
+    out.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+  }
+}
+
+/** Appends a float32, which CBOR holds big-endian */
+inline void AppendFloat32(std::string& out, float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  out.push_back(static_cast<char>(0xfa));
+  for (int i = 3; i >= 0; i--) {
+    out.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+  }
+}
+
+/** Returns a coordinate as an integer number of 10^-decimals
+ *
+ *  \throws std::domain_error if it is not finite or too large
+ */
+inline int64_t Quantize(double value, double scale) {
+  double scaled = std::round(value * scale);
+  if (!(std::fabs(scaled) < CoordinateFormat::kMaxExactInteger)) {
+    throw std::domain_error("Coordinate cannot be delta encoded: " +
+                            std::to_string(value));
+  }
+  return static_cast<int64_t>(scaled);
+}
+
+/** Appends the CBOR encoding of FlatGeometry objects to a buffer */
+class GeometryEncoder {
+ public:
+  /** Constructor
+   *
+   *  \param out          The buffer to append to
+   *  \param coordinates  How the coordinates are encoded
+   *  \param format       How the coordinates are rounded, which must be
+   *                      fixed for delta coordinates
+   *
+   *  \throws std::domain_error if delta coordinates are not fixed
+   */
+  GeometryEncoder(std::string& out, Coordinates coordinates,
+                  const CoordinateFormat& format)
+      : out_(&out), coordinates_(coordinates), format_(format) {
+    if (coordinates == Coordinates::Delta && !format.IsFixed()) {
+      throw std::domain_error("Delta coordinates need a fixed precision");
+    }
+  }
+
+  /** Appends a geometry object
+   *
+   *  \return The bounds of the positions written
+   */
+  BoundingBox Write(const FlatGeometry& geometry) {
+    LibraryScope scope;
+    Type type = geometry.GetType();
+    bool bbox = format_.HasBoundingBoxes() && !geometry.Bounds().Empty();
+    bool delta = coordinates_ == Coordinates::Delta &&
+                 type != Type::GeometryCollection;
+    AppendHead(*out_, kMap, 2 + (bbox ? 1 : 0) + (delta ? 1 : 0));
+    AppendText(*out_, "type");
+    AppendText(*out_, TypeName(type));
+    if (delta) {
+      AppendText(*out_, "decimals");
+      AppendInteger(*out_, format_.Decimals());
+    }
+
+    BoundingBox bounds;
+    auto positions = geometry.Positions();
+    const size_t* parts = geometry.PartOffsets();
+    switch (type) {
+      case Type::Point:
+        geojson::detail::CheckPoint(geometry);
+        AppendText(*out_, "coordinates");
+        WritePoint(positions, bounds);
+        break;
+      case Type::MultiPoint:
+        AppendText(*out_, "coordinates");
+        WritePositions(positions, false, false, bounds);
+        break;
+      case Type::LineString:
+        AppendText(*out_, "coordinates");
+        WriteLine(positions, bounds);
+        break;
+      case Type::MultiLineString:
+        AppendText(*out_, "coordinates");
+        geojson::detail::CheckOffsets(parts, geometry.NumParts(),
+                                      positions.Size());
+        AppendHead(*out_, kArray, geometry.NumParts());
+        for (size_t i = 0; i < geometry.NumParts(); i++) {
+          WriteLine(positions.Slice(parts[i], parts[i + 1]), bounds);
+        }
+        break;
+      case Type::Polygon:
+        AppendText(*out_, "coordinates");
+        WritePolygon(geometry, 0, geometry.NumParts(), bounds);
+        break;
+      case Type::MultiPolygon: {
+        AppendText(*out_, "coordinates");
+        const size_t* polygons = geometry.PolygonOffsets();
+        geojson::detail::CheckOffsets(polygons, geometry.NumPolygons(),
+                                      geometry.NumParts());
+        AppendHead(*out_, kArray, geometry.NumPolygons());
+        for (size_t i = 0; i < geometry.NumPolygons(); i++) {
+          WritePolygon(geometry, polygons[i], polygons[i + 1], bounds);
+        }
+        break;
+      }
+      default:
+        AppendText(*out_, "geometries");
+        AppendHead(*out_, kArray, geometry.Geometries().size());
+        for (const auto& member : geometry.Geometries()) {
+          bounds.Extend(Write(member));
+        }
+        break;
+    }
+
+    if (bbox) {
+      AppendText(*out_, "bbox");
+      AppendHead(*out_, kArray, bounds.NumValues());
+      for (size_t i = 0; i < bounds.NumValues(); i++) {
+        AppendFloat64(*out_, bounds.Value(i));
+      }
+    }
+    return bounds;
+  }
+
+ private:
+  void WritePoint(const PositionSpan& positions, BoundingBox& bounds) {
+    if (positions.HasAltitude()) {
+      WritePoint(Dimension<3>(), positions, bounds);
+    } else {
+      WritePoint(Dimension<2>(), positions, bounds);
+    }
+  }
+
+  template <int Dims>
+  void WritePoint(Dimension<Dims> dims, const PositionSpan& positions,
+                  BoundingBox& bounds) {
+    double pos[Dims];
+    ReadRounded(dims, positions, 0, pos, bounds);
+    Instrument::OnVertices(1);
+    AppendHead(*out_, kArray, Dims);
+    for (int d = 0; d < Dims; d++) {
+      switch (coordinates_) {
+        case Coordinates::Float64:
+          AppendFloat64(*out_, pos[d]);
+          break;
+        case Coordinates::Float32:
+          AppendFloat32(*out_, static_cast<float>(pos[d]));
+          break;
+        case Coordinates::Delta:
+          AppendInteger(*out_, Quantize(pos[d], format_.Scale()));
+          break;
+      }
+    }
+  }
+
+  void WriteLine(const PositionSpan& positions, BoundingBox& bounds) {
+    if (positions.Size() <= 1) {
+      throw std::domain_error("LineString objects must have at least 2 points");
+    }
+    geojson::detail::PositionBuffer storage;
+    WritePositions(geojson::detail::PreparePositions(positions, false,
+                                                     format_, storage),
+                   false, false, bounds);
+  }
+
+  void WritePolygon(const FlatGeometry& geometry, size_t begin, size_t end,
+                    BoundingBox& bounds) {
+    AppendHead(*out_, kArray, end - begin);
+    for (size_t i = begin; i < end; i++) {
+      auto ring = geometry.Part(i);
+      if (ring.Size() < 3) {
+        throw std::domain_error("Linear rings must have at least 3 points");
+      }
+      geojson::detail::PositionBuffer storage;
+      WritePositions(geojson::detail::PreparePositions(ring, true, format_,
+                                                       storage),
+                     true, i == begin, bounds);
+    }
+  }
+
+  /** Appends an array of positions, closed and wound if it is a ring */
+  void WritePositions(const PositionSpan& positions, bool ring, bool ccw,
+                      BoundingBox& bounds) {
+    if (positions.HasAltitude()) {
+      WritePositions(Dimension<3>(), positions, ring, ccw, bounds);
+    } else {
+      WritePositions(Dimension<2>(), positions, ring, ccw, bounds);
+    }
+  }
+
+  template <int Dims>
+  void WritePositions(Dimension<Dims> dims, const PositionSpan& positions,
+                      bool ring, bool ccw, BoundingBox& bounds) {
+    size_t n = positions.Size();
+    size_t count = ring ? n + 1 : n;
+    bool reverse = ring && geojson::detail::IsCcw(positions) != ccw;
+    if (reverse) Instrument::OnRingReversed();
+    Instrument::OnVertices(count);
+
+    AppendHead(*out_, kTag, kMultiDimensionalTag);
+    AppendHead(*out_, kArray, 2);
+    AppendHead(*out_, kArray, 2);
+    AppendHead(*out_, kUnsigned, count);
+    AppendHead(*out_, kUnsigned, Dims);
+
+    size_t elementSize = coordinates_ == Coordinates::Float64   ? 8
+                         : coordinates_ == Coordinates::Float32 ? 4
+                                                                : 0;
+    if (elementSize > 0) {
+      AppendHead(*out_, kTag,
+                 elementSize == 8 ? kFloat64ArrayTag : kFloat32ArrayTag);
+      AppendHead(*out_, kBytes, count * Dims * elementSize);
+    } else {
+      AppendHead(*out_, kArray, count * Dims);
+    }
+
+    int64_t previous[Dims] = {};
+    double pos[Dims];
+    for (size_t i = 0; i < count; i++) {
+      size_t idx = ring ? i % n : i;
+      if (reverse) idx = n - idx - 1;
+      ReadRounded(dims, positions, idx, pos, bounds);
+      if (elementSize == 8) {
+        out_->append(reinterpret_cast<const char*>(pos), sizeof(pos));
+        continue;
+      }
+      for (int d = 0; d < Dims; d++) {
+        if (elementSize == 4) {
+          float value = static_cast<float>(pos[d]);
+          out_->append(reinterpret_cast<const char*>(&value), 4);
+        } else {
+          int64_t value = Quantize(pos[d], format_.Scale());
+          AppendInteger(*out_, value - previous[d]);
+          previous[d] = value;
+        }
+      }
+    }
+  }
+
+  /** Reads and rounds the coordinates of a position, adding it to bounds */
+  void ReadRounded(Dimension<2>, const PositionSpan& positions, size_t i,
+                   double* pos, BoundingBox& bounds) const {
+    pos[0] = format_.Round(positions.Lon(i));
+    pos[1] = format_.Round(positions.Lat(i));
+    bounds.Extend(pos[0], pos[1]);
+  }
+
+  void ReadRounded(Dimension<3>, const PositionSpan& positions, size_t i,
+                   double* pos, BoundingBox& bounds) const {
+    pos[0] = format_.Round(positions.Lon(i));
+    pos[1] = format_.Round(positions.Lat(i));
+    pos[2] = format_.Round(positions.Alt(i));
+    bounds.Extend(pos[0], pos[1], pos[2]);
+  }
+
+  std::string* out_;
+  Coordinates coordinates_;
+  CoordinateFormat format_;
+};
+
+/** Appends a Feature object with the given encoded geometry */
+inline void AppendFeature(std::string& out, const char* geometry,
+                          size_t size, const nlohmann::json& properties) {
+  AppendHead(out, kMap, 3);
+  AppendText(out, "type");
+  AppendText(out, "Feature");
+  AppendText(out, "geometry");
+  out.append(geometry, size);
+  AppendText(out, "properties");
+  nlohmann::json::to_cbor(properties,
+                          nlohmann::detail::output_adapter<char>(out));
+}
+}
+
+/** Returns the CBOR encoding of a geometry object
+ *
+ *  \param geometry     The geometry
+ *  \param coordinates  How the coordinates are encoded
+ *  \param format       How the coordinates are rounded, which must be fixed
+ *                      for Coordinates::Delta, and whether geometries have
+ *                      bbox members
+ *
+ *  \throws std::domain_error if the geometry is not valid GeoJSON, or a delta
+ *          encoded format is not fixed
+ */
+inline std::string Geometry(
+    const FlatGeometry& geometry,
+    Coordinates coordinates = Coordinates::Float64,
+    const CoordinateFormat& format = CoordinateFormat()) {
+  std::string out;
+  out.reserve(64 + geometry.NumPositions() * geometry.Dims() * 8);
+  detail::GeometryEncoder(out, coordinates, format).Write(geometry);
+  return out;
+}
+
+/** Returns the CBOR encoding of a Feature object
+ *
+ *  \param geometry    The encoding of its geometry, from Geometry()
+ *  \param properties  A JSON object holding properties for the feature
+ */
+inline std::string Feature(
+    const std::string& geometry,
+    const nlohmann::json& properties = nlohmann::json::object()) {
+  std::string out;
+  detail::AppendFeature(out, geometry.data(), geometry.size(), properties);
+  return out;
+}
+
+/** Writes the CBOR encoding of a FeatureCollection object incrementally
+ *
+ *  The features are an indefinite-length array, so the collection can be
+ *  streamed without knowing how many features it has, as with
+ *  geojson::BasicFeatureCollectionWriter.
+ *
+ *  \tparam Sink  A type with a member void Write(const char*, size_t)
+ */
+template <typename Sink>
+class BasicFeatureCollectionWriter {
+ public:
+  /** Constructor, writes the header of the collection
+   *
+   *  \param sink         The sink to which the collection is written
+   *  \param coordinates  How the coordinates are encoded
+   *  \param format       How the coordinates are rounded
+   */
+  explicit BasicFeatureCollectionWriter(
+      Sink sink, Coordinates coordinates = Coordinates::Float64,
+      const CoordinateFormat& format = CoordinateFormat())
+      : sink_(std::move(sink)), coordinates_(coordinates), format_(format),
+        numFeatures_(0), closed_(false) {
+    // Fails early on a format that cannot be encoded
+    std::string header;
+    detail::GeometryEncoder(header, coordinates, format);
+    detail::AppendHead(header, detail::kMap, 2);
+    detail::AppendText(header, "type");
+    detail::AppendText(header, "FeatureCollection");
+    detail::AppendText(header, "features");
+    header.push_back(static_cast<char>(detail::kArray << 5 |
+                                       detail::kIndefinite));
+    sink_.Write(header.data(), header.size());
+  }
+
+  BasicFeatureCollectionWriter(const BasicFeatureCollectionWriter&) = delete;
+  BasicFeatureCollectionWriter& operator=(const BasicFeatureCollectionWriter&) =
+      delete;
+
+  /** Destructor, closes the collection if Close() was not called, ignoring
+   *  errors, so call Close() to see them
+   */
+  ~BasicFeatureCollectionWriter() {
+    try {
+      Close();
+    } catch (...) {
+    }
+  }
+
+  /** Writes a feature to the collection
+   *
+   *  \param geometry    The geometry of the feature
+   *  \param properties  A JSON object holding properties for the feature
+   */
+  void Write(const FlatGeometry& geometry,
+             const nlohmann::json& properties = nlohmann::json::object()) {
+    CheckOpen();
+    detail::LibraryScope scope;
+    buffer_.clear();
+    detail::GeometryEncoder(buffer_, coordinates_, format_).Write(geometry);
+    feature_.clear();
+    detail::AppendFeature(feature_, buffer_.data(), buffer_.size(),
+                          properties);
+    WriteRaw(feature_.data(), feature_.size());
+  }
+
+  /** Writes an already encoded feature, from Feature(), verbatim */
+  void WriteRaw(const char* data, size_t size) {
+    CheckOpen();
+    sink_.Write(data, size);
+    numFeatures_++;
+  }
+
+  /** \overload */
+  void WriteRaw(const std::string& feature) {
+    WriteRaw(feature.data(), feature.size());
+  }
+
+  /** Ends the features of the collection, further calls are no-ops */
+  void Close() {
+    if (closed_) return;
+    closed_ = true;
+    const char end = static_cast<char>(detail::kBreak);
+    sink_.Write(&end, 1);
+    geojson::detail::FlushSink(sink_);
+  }
+
+  /** Returns the number of features written so far */
+  size_t NumFeatures() const { return numFeatures_; }
+
+ private:
+  void CheckOpen() const {
+    if (closed_) {
+      throw std::logic_error("Cannot write to a closed FeatureCollection");
+    }
+  }
+
+  Sink sink_;
+  Coordinates coordinates_;
+  CoordinateFormat format_;
+  std::string buffer_;
+  std::string feature_;
+  size_t numFeatures_;
+  bool closed_;
+};
+
+/** A CBOR FeatureCollection writer that writes to a std::ostream */
+using FeatureCollectionWriter = BasicFeatureCollectionWriter<StreamSink>;
+
+namespace detail {
+
+/** Reads the CBOR data items written by this namespace */
+class Reader {
+ public:
+  Reader(const char* begin, const char* end)
+      : p_(reinterpret_cast<const uint8_t*>(begin)),
+        end_(reinterpret_cast<const uint8_t*>(end)) {}
+
+  /** Returns the position of the next data item */
+  const char* Position() const { return reinterpret_cast<const char*>(p_); }
+
+  /** Returns the number of bytes left */
+  size_t Remaining() const { return static_cast<size_t>(end_ - p_); }
+
+  /** Returns whether the next byte ends an indefinite-length item */
+  bool AtBreak() const { return p_ < end_ && *p_ == kBreak; }
+
+  /** Returns whether the next data item is null, skipping it if so */
+  bool SkipNull() {
+    if (p_ < end_ && *p_ == kNull) {
+      p_++;
+      return true;
+    }
+    return false;
+  }
+
+  /** Returns the major type of the next data item */
+  uint8_t PeekMajor() const {
+    Need(1);
+    return *p_ >> 5;
+  }
+
+  /** Reads the head of a data item
+   *
+   *  \param major       Set to its major type
+   *  \param indefinite  Set to whether it has an indefinite length
+   *
+   *  \return Its argument
+   */
+  uint64_t ReadHead(uint8_t& major, bool& indefinite) {
+    Need(1);
+    uint8_t initial = *p_++;
+    major = initial >> 5;
+    uint8_t info = initial & 0x1f;
+    indefinite = false;
+    if (info < 24) return info;
+    if (info == kIndefinite) {
+      if (major < kBytes || major == kTag) Fail();
+      indefinite = true;
+      return 0;
+    }
+    if (info > 27) Fail();
+    size_t bytes = size_t(1) << (info - 24);
+    Need(bytes);
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; i++) value = value << 8 | *p_++;
+    return value;
+  }
+
+  /** Reads the head of an item of the given major type, which must have a
+   *  definite length, and returns its argument
+   */
+  uint64_t Expect(uint8_t major) {
+    uint8_t actual;
+    bool indefinite;
+    uint64_t value = ReadHead(actual, indefinite);
+    if (actual != major || indefinite) Fail();
+    return value;
+  }
+
+  /** Reads the head of an array or map, and returns its length or SIZE_MAX
+   *  if it ends with a break
+   */
+  size_t ReadLength(uint8_t major) {
+    uint8_t actual;
+    bool indefinite;
+    uint64_t value = ReadHead(actual, indefinite);
+    if (actual != major) Fail();
+    return indefinite ? SIZE_MAX : static_cast<size_t>(value);
+  }
+
+  /** Returns whether there is another element of an array or map of the
+   *  given length, skipping the break at the end of an indefinite one
+   */
+  bool Next(size_t length, size_t i) {
+    if (length != SIZE_MAX) return i < length;
+    if (!AtBreak()) return true;
+    p_++;
+    return false;
+  }
+
+  /** Reads a text string */
+  std::string ReadText() {
+    size_t size = static_cast<size_t>(Expect(kText));
+    Need(size);
+    std::string text(reinterpret_cast<const char*>(p_), size);
+    p_ += size;
+    return text;
+  }
+
+  /** Reads a byte string, returning its first byte and setting its size */
+  const char* ReadBytes(size_t& size) {
+    size = static_cast<size_t>(Expect(kBytes));
+    Need(size);
+    const char* bytes = Position();
+    p_ += size;
+    return bytes;
+  }
+
+  /** Reads an integer or floating point number */
+  double ReadNumber() {
+    uint8_t major;
+    bool indefinite;
+    const uint8_t* start = p_;
+    uint64_t value = ReadHead(major, indefinite);
+    if (major == kUnsigned) return static_cast<double>(value);
+    if (major == kNegative) return -1 - static_cast<double>(value);
+    if (major != kSimple) Fail();
+    switch (*start & 0x1f) {
+      case 25: {
+        int exponent = (value >> 10) & 0x1f;
+        double mantissa = static_cast<double>(value & 0x3ff);
+        double magnitude =
+            exponent == 0    ? std::ldexp(mantissa, -24)
+            : exponent == 31 ? (mantissa == 0 ? INFINITY : NAN)
+                             : std::ldexp(mantissa + 1024, exponent - 25);
+        return value & 0x8000 ? -magnitude : magnitude;
+      }
+      case 26: {
+        uint32_t bits = static_cast<uint32_t>(value);
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+      }
+      case 27: {
+        double d;
+        std::memcpy(&d, &value, sizeof(d));
+        return d;
+      }
+      default:
+        Fail();
+    }
+    return 0;
+  }
+
+  /** Skips the next data item
+   *
+   *  \param depth  The number of items it is nested in, up to kMaxNesting
+   */
+  void Skip(size_t depth = 0) {
+    if (depth > kMaxNesting) Fail();
+    uint8_t major;
+    bool indefinite;
+    uint64_t value = ReadHead(major, indefinite);
+    switch (major) {
+      case kBytes:
+      case kText:
+        if (indefinite) {
+          while (!AtBreak()) Skip(depth + 1);
+          p_++;
+        } else {
+          Need(static_cast<size_t>(value));
+          p_ += value;
+        }
+        break;
+      case kArray:
+      case kMap: {
+        uint64_t items = major == kMap ? 2 * value : value;
+        if (indefinite) {
+          while (!AtBreak()) Skip(depth + 1);
+          p_++;
+        } else {
+          for (uint64_t i = 0; i < items; i++) Skip(depth + 1);
+        }
+        break;
+      }
+      case kTag:
+        Skip(depth + 1);
+        break;
+      default:
+        break;
+    }
+  }
+
+  [[noreturn]] static void Fail() {
+    throw std::domain_error("Invalid CBOR GeoJSON");
+  }
+
+ private:
+  void Need(size_t bytes) const {
+    if (static_cast<size_t>(end_ - p_) < bytes) {
+      throw std::domain_error("Unexpected end of CBOR data");
+    }
+  }
+
+  const uint8_t* p_;
+  const uint8_t* end_;
+};
+
+/** Reads a position, a plain array of numbers, and adds it to a geometry
+ *
+ *  \param scale  10^decimals for quantized coordinates, or 0
+ */
+inline void ReadPosition(Reader& in, double scale, FlatGeometry& out) {
+  size_t length = in.ReadLength(kArray);
+  double pos[3];
+  size_t dims = 0;
+  for (size_t i = 0; in.Next(length, i); i++) {
+    double value = in.ReadNumber();
+    if (dims < 3) pos[dims++] = scale > 0 ? value / scale : value;
+  }
+  if (dims < 2) {
+    throw std::domain_error("Positions must have at least 2 elements");
+  }
+  if (dims == 3) {
+    out.AddPosition(pos[0], pos[1], pos[2]);
+  } else {
+    out.AddPosition(pos[0], pos[1]);
+  }
+}
+
+/** Reads an array of positions, a typed array or a plain array of
+ *  positions, and adds them to a geometry
+ */
+inline void ReadPositions(Reader& in, double scale, FlatGeometry& out,
+                          std::vector<double>& scratch) {
+  if (in.PeekMajor() != kTag) {
+    size_t length = in.ReadLength(kArray);
+    for (size_t i = 0; in.Next(length, i); i++) ReadPosition(in, scale, out);
+    return;
+  }
+
+  if (in.Expect(kTag) != kMultiDimensionalTag || in.Expect(kArray) != 2 ||
+      in.Expect(kArray) != 2) {
+    Reader::Fail();
+  }
+  size_t count = static_cast<size_t>(in.Expect(kUnsigned));
+  size_t dims = static_cast<size_t>(in.Expect(kUnsigned));
+  if (dims != 2 && dims != 3) {
+    throw std::domain_error("Positions must have 2 or 3 coordinates");
+  }
+  // Each coordinate takes at least a byte, so the scratch buffer is only
+  // sized for as many as the data left could hold
+  if (count > SIZE_MAX / sizeof(double) / dims ||
+      count * dims > in.Remaining()) {
+    Reader::Fail();
+  }
+
+  scratch.resize(count * dims);
+  if (in.PeekMajor() == kTag) {
+    uint64_t tag = in.Expect(kTag);
+    size_t size;
+    const char* bytes = in.ReadBytes(size);
+    if (tag == kFloat64ArrayTag && size == scratch.size() * 8) {
+      std::memcpy(scratch.data(), bytes, size);
+    } else if (tag == kFloat32ArrayTag && size == scratch.size() * 4) {
+      for (size_t i = 0; i < scratch.size(); i++) {
+        float value;
+        std::memcpy(&value, bytes + 4 * i, sizeof(value));
+        scratch[i] = value;
+      }
+    } else {
+      Reader::Fail();
+    }
+  } else {
+    if (!(scale > 0) || in.ReadLength(kArray) != scratch.size()) {
+      Reader::Fail();
+    }
+    double previous[3] = {0, 0, 0};
+    for (size_t i = 0; i < scratch.size(); i++) {
+      double& value = previous[i % dims];
+      value += in.ReadNumber();
+      scratch[i] = value / scale;
+    }
+  }
+
+  out.Reserve(out.NumPositions() + count);
+  for (size_t i = 0; i < scratch.size(); i += dims) {
+    if (dims == 3) {
+      out.AddPosition(scratch[i], scratch[i + 1], scratch[i + 2]);
+    } else {
+      out.AddPosition(scratch[i], scratch[i + 1]);
+    }
+  }
+}
+
+/** Reads the coordinates member of a geometry of the given type */
+inline void ReadCoordinates(Reader& in, Type type, double scale,
+                            FlatGeometry& out, std::vector<double>& scratch) {
+  switch (type) {
+    case Type::Point:
+      ReadPosition(in, scale, out);
+      return;
+    case Type::MultiPoint:
+    case Type::LineString:
+      ReadPositions(in, scale, out, scratch);
+      return;
+    case Type::MultiLineString:
+    case Type::Polygon: {
+      size_t length = in.ReadLength(kArray);
+      for (size_t i = 0; in.Next(length, i); i++) {
+        ReadPositions(in, scale, out, scratch);
+        if (type == Type::Polygon) {
+          out.EndRing();
+        } else {
+          out.EndPart();
+        }
+      }
+      return;
+    }
+    case Type::MultiPolygon: {
+      size_t length = in.ReadLength(kArray);
+      for (size_t i = 0; in.Next(length, i); i++) {
+        ReadCoordinates(in, Type::Polygon, scale, out, scratch);
+        out.EndPolygon();
+      }
+      return;
+    }
+    default:
+      Reader::Fail();
+  }
+}
+
+/** Reads a geometry object
+ *
+ *  \param depth  The number of collections it is nested in
+ */
+inline FlatGeometry ReadGeometry(Reader& in, std::vector<double>& scratch,
+                                 size_t depth = 0) {
+  if (depth > kMaxNesting) Reader::Fail();
+  // The members can come in any order, so the type and decimals are found
+  // before the coordinates are read
+  Reader start = in;
+  size_t length = in.ReadLength(kMap);
+  std::string typeName;
+  double scale = 0;
+  for (size_t i = 0; in.Next(length, i); i++) {
+    std::string key = in.ReadText();
+    if (key == "type") {
+      typeName = in.ReadText();
+    } else if (key == "decimals") {
+      double decimals = in.ReadNumber();
+      if (!(decimals >= 0 && decimals <= 15)) Reader::Fail();
+      scale = std::pow(10.0, decimals);
+    } else {
+      in.Skip();
+    }
+  }
+  if (typeName.empty()) {
+    throw std::domain_error("Geometry object has no type");
+  }
+  Type type = geojson::detail::GeometryType(typeName);
+  Reader end = in;
+
+  FlatGeometry geometry(type);
+  in = start;
+  length = in.ReadLength(kMap);
+  for (size_t i = 0; in.Next(length, i); i++) {
+    std::string key = in.ReadText();
+    if (key == "coordinates" && type != Type::GeometryCollection) {
+      ReadCoordinates(in, type, scale, geometry, scratch);
+    } else if (key == "geometries" && type == Type::GeometryCollection) {
+      size_t numGeometries = in.ReadLength(kArray);
+      for (size_t j = 0; in.Next(numGeometries, j); j++) {
+        geometry.AddGeometry(ReadGeometry(in, scratch, depth + 1));
+      }
+    } else {
+      in.Skip();
+    }
+  }
+  in = end;
+  return geometry;
+}
+}
+
+/** Reads a geometry object written by Geometry()
+ *
+ *  Plain arrays of positions, as nlohmann::json::to_cbor() writes them,
+ *  are read as well as typed arrays.
+ *
+ *  \param data  The CBOR data
+ *  \param size  The number of bytes of data
+ *
+ *  \throws std::domain_error if the data is not a CBOR geometry
+ */
+inline FlatGeometry ReadGeometry(const char* data, size_t size) {
+  detail::Reader in(data, data + size);
+  std::vector<double> scratch;
+  return detail::ReadGeometry(in, scratch);
+}
+
+/** \overload */
+inline FlatGeometry ReadGeometry(const std::string& data) {
+  return ReadGeometry(data.data(), data.size());
+}
+
+/** Reads the features of a FeatureCollection written by
+ *  BasicFeatureCollectionWriter
+ *
+ *  \tparam Callback  A callable of the form
+ *                    void(FlatGeometry geometry, nlohmann::json properties)
+ *  \param data       The CBOR data
+ *  \param size       The number of bytes of data
+ *  \param onFeature  Called with each feature in order, with an empty
+ *                    GeometryCollection for a null geometry
+ *
+ *  \throws std::domain_error if the data is not a CBOR FeatureCollection
+ */
+template <typename Callback>
+void ReadFeatureCollection(const char* data, size_t size,
+                           Callback&& onFeature) {
+  detail::Reader in(data, data + size);
+  std::vector<double> scratch;
+  size_t length = in.ReadLength(detail::kMap);
+  for (size_t i = 0; in.Next(length, i); i++) {
+    if (in.ReadText() != "features") {
+      in.Skip();
+      continue;
+    }
+    size_t numFeatures = in.ReadLength(detail::kArray);
+    for (size_t j = 0; in.Next(numFeatures, j); j++) {
+      FlatGeometry geometry;
+      nlohmann::json properties;
+      size_t numMembers = in.ReadLength(detail::kMap);
+      for (size_t k = 0; in.Next(numMembers, k); k++) {
+        std::string key = in.ReadText();
+        if (key == "geometry") {
+          if (!in.SkipNull()) geometry = detail::ReadGeometry(in, scratch);
+        } else if (key == "properties") {
+          const char* begin = in.Position();
+          in.Skip();
+          properties = nlohmann::json::from_cbor(begin, in.Position());
+        } else {
+          in.Skip();
+        }
+      }
+      onFeature(std::move(geometry), std::move(properties));
+    }
+  }
+}
+
+/** \overload */
+template <typename Callback>
+void ReadFeatureCollection(const std::string& data, Callback&& onFeature) {
+  ReadFeatureCollection(data.data(), data.size(),
+                        std::forward<Callback>(onFeature));
+}
+}
+}
@@ -0,0 +1,605 @@
+/** Compact native geometries for libgeojson
+ *
+ *  \file flat_geometry.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "libgeojson/libgeojson.h"
+#include "libgeojson/reader.h"
+#include "libgeojson/text.h"
+
+namespace geojson {
+
+/** A geometry held in a single flat coordinate buffer
+ *
+ *  All of the positions of the geometry are held interleaved in one array of
+ *  doubles, with its lines or rings given by offsets into the positions and,
+ *  for a MultiPolygon, its polygons by offsets into the rings, the same
+ *  layout that the PositionSpan builders take. This takes a small fraction of
+ *  the memory of the same geometry as a nlohmann::json tree, which holds
+ *  every coordinate and every array in a node of its own, and the positions
+ *  can be handed to other libraries without copying them.
+ *
+ *  The number of coordinates in each position is taken from the first
+ *  position added, unless it is given when the geometry is made.
+ */
+class FlatGeometry {
+ public:
+  /** Constructor, makes an empty GeometryCollection */
+  FlatGeometry() : FlatGeometry(Type::GeometryCollection) {}
+
+  /** Makes an empty geometry, to be filled in with AddPosition(), EndPart(),
+   *  EndRing(), EndPolygon() and AddGeometry()
+   *
+   *  \param type  The type of the geometry
+   *  \param dims  The number of coordinates in each position, 2 or 3, with 0
+   *               taking it from the first position added
+   *
+   *  \throws std::domain_error if type is not a geometry type
+   */
+  explicit FlatGeometry(Type type, size_t dims = 0)
+      : type_(type), dims_(static_cast<uint8_t>(dims)) {
+    if (type == Type::Feature || type == Type::FeatureCollection) {
+      throw std::domain_error("FlatGeometry must be a geometry type");
+    }
+    if (dims != 0 && dims != 2 && dims != 3) {
+      throw std::domain_error("Positions must have 2 or 3 coordinates");
+    }
+  }
+
+  /** Returns a Point (section 3.1.2) */
+  static FlatGeometry Point(double lon, double lat) {
+    FlatGeometry g(Type::Point, 2);
+    g.AddPosition(lon, lat);
+    return g;
+  }
+
+  /** \overload */
+  static FlatGeometry Point(double lon, double lat, double alt) {
+    FlatGeometry g(Type::Point, 3);
+    g.AddPosition(lon, lat, alt);
+    return g;
+  }
+
+  /** Returns a MultiPoint (section 3.1.3) holding a copy of the positions */
+  static FlatGeometry MultiPoint(const PositionSpan& positions) {
+    return FromPositions(Type::MultiPoint, positions);
+  }
+
+  /** Returns a LineString (section 3.1.4) holding a copy of the positions */
+  static FlatGeometry LineString(const PositionSpan& positions) {
+    return FromPositions(Type::LineString, positions);
+  }
+
+  /** Returns a MultiLineString (section 3.1.5) holding a copy of the
+   *  positions, see geojson::MultiLineString()
+   */
+  static FlatGeometry MultiLineString(const PositionSpan& positions,
+                                      const size_t* lineOffsets,
+                                      size_t numLines) {
+    detail::CheckOffsets(lineOffsets, numLines, positions.Size());
+    auto g = FromPositions(Type::MultiLineString, positions);
+    g.SetPartOffsets(lineOffsets, numLines);
+    return g;
+  }
+
+  /** Returns a Polygon (section 3.1.6) holding a copy of the positions, see
+   *  geojson::Polygon()
+   *
+   *  As with the builders, the rings are held without their closing
+   *  positions, and they are closed and wound when the geometry is written.
+   */
+  static FlatGeometry Polygon(const PositionSpan& positions,
+                              const size_t* ringOffsets, size_t numRings) {
+    detail::CheckOffsets(ringOffsets, numRings, positions.Size());
+    auto g = FromPositions(Type::Polygon, positions);
+    g.SetPartOffsets(ringOffsets, numRings);
+    return g;
+  }
+
+  /** Returns a MultiPolygon (section 3.1.7) holding a copy of the positions,
+   *  see geojson::MultiPolygon()
+   */
+  static FlatGeometry MultiPolygon(const PositionSpan& positions,
+                                   const size_t* polygonOffsets,
+                                   size_t numPolygons,
+                                   const size_t* ringOffsets) {
+    size_t numRings = polygonOffsets[numPolygons];
+    detail::CheckOffsets(polygonOffsets, numPolygons, numRings);
+    detail::CheckOffsets(ringOffsets, numRings, positions.Size());
+    auto g = FromPositions(Type::MultiPolygon, positions);
+    g.SetPartOffsets(ringOffsets, numRings);
+    g.polygonOffsets_.assign(polygonOffsets, polygonOffsets + numPolygons + 1);
+    return g;
+  }
+
+  /** Returns a GeometryCollection (section 3.1.8) of the given geometries */
+  static FlatGeometry GeometryCollection(
+      std::vector<FlatGeometry> geometries) {
+    FlatGeometry g(Type::GeometryCollection);
+    g.geometries_ = std::move(geometries);
+    return g;
+  }
+
+  /** Returns a MultiPoint from a point callback, see geojson::MultiPoint()
+   *
+   *  \tparam Callable  A callable of the form
+   *                    void(size_t index, double& lon, double& lat,
+   *                         double& alt)
+   *                    or void(size_t index, double& lon, double& lat)
+   */
+  template <typename Callable>
+  static FlatGeometry MultiPoint(size_t numPoints, Callable&& getPoint) {
+    FlatGeometry g(Type::MultiPoint);
+    g.AddCallbackLine(numPoints, getPoint);
+    return g;
+  }
+
+  /** Returns a LineString from a point callback, see geojson::LineString()
+   *
+   *  \throws std::domain_error if there are fewer than 2 points
+   */
+  template <typename Callable>
+  static FlatGeometry LineString(size_t numPoints, Callable&& getPoint) {
+    CheckLineLength(numPoints);
+    FlatGeometry g(Type::LineString);
+    g.AddCallbackLine(numPoints, getPoint);
+    return g;
+  }
+
+  /** Returns a MultiLineString from callbacks, see geojson::MultiLineString()
+   *
+   *  \throws std::domain_error if a line has fewer than 2 points
+   */
+  template <typename GetLineLength, typename GetPoint>
+  static FlatGeometry MultiLineString(size_t numLines,
+                                      GetLineLength&& getLineLength,
+                                      GetPoint&& getPoint) {
+    FlatGeometry g(Type::MultiLineString);
+    for (size_t i = 0; i < numLines; i++) {
+      size_t numPoints = getLineLength(i);
+      CheckLineLength(numPoints);
+      g.AddCallbackLine(numPoints, getPoint, i);
+      g.EndPart();
+    }
+    return g;
+  }
+
+  /** Returns a Polygon from callbacks, see geojson::Polygon()
+   *
+   *  The rings are given without their closing positions, as with the
+   *  builders.
+   *
+   *  \throws std::domain_error if a ring has fewer than 3 points
+   */
+  template <typename GetRingLength, typename GetPoint>
+  static FlatGeometry Polygon(size_t numRings, GetRingLength&& getRingLength,
+                              GetPoint&& getPoint) {
+    FlatGeometry g(Type::Polygon);
+    for (size_t i = 0; i < numRings; i++) {
+      size_t numPoints = getRingLength(i);
+      CheckRingLength(numPoints);
+      g.AddCallbackLine(numPoints, getPoint, i);
+      g.EndPart();
+    }
+    return g;
+  }
+
+  /** Returns a MultiPolygon from callbacks, see geojson::MultiPolygon()
+   *
+   *  \throws std::domain_error if a ring has fewer than 3 points
+   */
+  template <typename GetNumRings, typename GetRingLength, typename GetPoint>
+  static FlatGeometry MultiPolygon(size_t numPolygons,
+                                   GetNumRings&& getNumRings,
+                                   GetRingLength&& getRingLength,
+                                   GetPoint&& getPoint) {
+    FlatGeometry g(Type::MultiPolygon);
+    for (size_t i = 0; i < numPolygons; i++) {
+      size_t numRings = getNumRings(i);
+      for (size_t j = 0; j < numRings; j++) {
+        size_t numPoints = getRingLength(i, j);
+        CheckRingLength(numPoints);
+        g.AddCallbackLine(numPoints, getPoint, i, j);
+        g.EndPart();
+      }
+      g.EndPolygon();
+    }
+    return g;
+  }
+
+  /** Returns a GeometryCollection from a callback that gives each of its
+   *  geometries as a FlatGeometry
+   */
+  template <typename Callable>
+  static FlatGeometry GeometryCollection(size_t numGeometries,
+                                         Callable&& getGeometry) {
+    FlatGeometry g(Type::GeometryCollection);
+    g.geometries_.reserve(numGeometries);
+    for (size_t i = 0; i < numGeometries; i++) {
+      g.AddGeometry(getGeometry(i));
+    }
+    return g;
+  }
+
+  /** Returns the type of the geometry */
+  Type GetType() const { return type_; }
+
+  /** Returns the number of coordinates in each position, 2 or 3 */
+  size_t Dims() const { return dims_ == 0 ? 2 : dims_; }
+
+  /** Returns whether the positions have altitudes */
+  bool HasAltitude() const { return dims_ == 3; }
+
+  /** Returns the number of positions */
+  size_t NumPositions() const { return coords_.size() / Dims(); }
+
+  /** Returns the interleaved coordinates of the positions */
+  const double* Coordinates() const { return coords_.data(); }
+
+  /** Returns a view of the positions, valid until the geometry is changed */
+  PositionSpan Positions() const {
+    return PositionSpan::Interleaved(coords_.data(), NumPositions(), Dims());
+  }
+
+  /** Returns the number of lines of a MultiLineString or rings of a Polygon
+   *  or MultiPolygon
+   */
+  size_t NumParts() const {
+    return partOffsets_.empty() ? 0 : partOffsets_.size() - 1;
+  }
+
+  /** Returns the NumParts() + 1 offsets of the parts into the positions */
+  const size_t* PartOffsets() const { return OffsetsOrZero(partOffsets_); }
+
+  /** Returns a view of the positions of the i'th line or ring */
+  PositionSpan Part(size_t i) const {
+    if (i >= NumParts()) {
+      throw std::out_of_range("Part index is outside of the geometry");
+    }
+    return Positions().Slice(partOffsets_[i], partOffsets_[i + 1]);
+  }
+
+  /** Returns the number of polygons of a MultiPolygon */
+  size_t NumPolygons() const {
+    return polygonOffsets_.empty() ? 0 : polygonOffsets_.size() - 1;
+  }
+
+  /** Returns the NumPolygons() + 1 offsets of the polygons into the parts */
+  const size_t* PolygonOffsets() const {
+    return OffsetsOrZero(polygonOffsets_);
+  }
+
+  /** Returns the geometries of a GeometryCollection */
+  const std::vector<FlatGeometry>& Geometries() const { return geometries_; }
+
+  /** Returns the bounds of the positions, including those of the geometries
+   *  of a GeometryCollection
+   */
+  BoundingBox Bounds() const {
+    BoundingBox bounds = Positions().Bounds();
+    for (const auto& g : geometries_) bounds.Extend(g.Bounds());
+    return bounds;
+  }
+
+  /** Adds a position to the end of the geometry
+   *
+   *  The altitude is dropped if the geometry has 2D positions, and a 2D
+   *  position is given a NaN altitude if the geometry has 3D positions.
+   */
+  void AddPosition(double lon, double lat) {
+    if (dims_ == 0) dims_ = 2;
+    coords_.push_back(lon);
+    coords_.push_back(lat);
+    if (dims_ == 3) coords_.push_back(NAN);
+  }
+
+  /** \overload */
+  void AddPosition(double lon, double lat, double alt) {
+    if (dims_ == 0) dims_ = 3;
+    coords_.push_back(lon);
+    coords_.push_back(lat);
+    if (dims_ == 3) coords_.push_back(alt);
+  }
+
+  /** Ends the current line or ring at the last position added */
+  void EndPart() {
+    if (partOffsets_.empty()) partOffsets_.push_back(0);
+    partOffsets_.push_back(NumPositions());
+  }
+
+  /** Ends the current ring at the last position added, dropping that
+   *  position if it closes the ring
+   */
+  void EndRing() {
+    size_t first = partOffsets_.empty() ? 0 : partOffsets_.back();
+    size_t dims = Dims();
+    if (NumPositions() > first + 1 &&
+        std::equal(coords_.end() - dims, coords_.end(),
+                   coords_.begin() + first * dims)) {
+      coords_.resize(coords_.size() - dims);
+    }
+    EndPart();
+  }
+
+  /** Ends the current polygon of a MultiPolygon at the last ring ended */
+  void EndPolygon() {
+    if (polygonOffsets_.empty()) polygonOffsets_.push_back(0);
+    polygonOffsets_.push_back(NumParts());
+  }
+
+  /** Adds a geometry to the end of a GeometryCollection */
+  void AddGeometry(FlatGeometry geometry) {
+    geometries_.push_back(std::move(geometry));
+  }
+
+  /** Reserves space for the given number of positions */
+  void Reserve(size_t numPositions) { coords_.reserve(numPositions * Dims()); }
+
+  /** Returns the number of bytes of memory held by the geometry */
+  size_t MemoryUsage() const {
+    size_t bytes = sizeof(*this) + coords_.capacity() * sizeof(double) +
+                   (partOffsets_.capacity() + polygonOffsets_.capacity()) *
+                       sizeof(size_t);
+    for (const auto& g : geometries_) bytes += g.MemoryUsage();
+    return bytes +
+           (geometries_.capacity() - geometries_.size()) * sizeof(*this);
+  }
+
+ private:
+  static FlatGeometry FromPositions(Type type, const PositionSpan& positions) {
+    FlatGeometry g(type, positions.HasAltitude() ? 3 : 2);
+    g.Reserve(positions.Size());
+    for (size_t i = 0; i < positions.Size(); i++) {
+      if (positions.HasAltitude()) {
+        g.AddPosition(positions.Lon(i), positions.Lat(i), positions.Alt(i));
+      } else {
+        g.AddPosition(positions.Lon(i), positions.Lat(i));
+      }
+    }
+    return g;
+  }
+
+  static void CheckLineLength(size_t numPoints) {
+    if (numPoints <= 1) {
+      throw std::domain_error("LineString objects must have at least 2 points");
+    }
+  }
+
+  static void CheckRingLength(size_t numPoints) {
+    if (numPoints < 3) {
+      throw std::domain_error("Linear rings must have at least 3 points");
+    }
+  }
+
+  /** Adds the positions of a point callback that takes the given indices
+   *  before the index of the point
+   */
+  template <typename GetPoint, typename... Indices>
+  void AddCallbackLine(size_t numPoints, GetPoint& getPoint,
+                       Indices... indices) {
+    AddCallbackLine(detail::CallbackDimension<GetPoint&, Indices..., size_t>(),
+                    numPoints, getPoint, indices...);
+  }
+
+  template <int Dims, typename GetPoint, typename... Indices>
+  void AddCallbackLine(detail::Dimension<Dims> dims, size_t numPoints,
+                       GetPoint& getPoint, Indices... indices) {
+    detail::LibraryScope scope;
+    double pos[Dims];
+    for (size_t i = 0; i < numPoints; i++) {
+      detail::ReadPoint(dims, pos, getPoint, indices..., i);
+      AddPosition(dims, pos);
+    }
+  }
+
+  void AddPosition(detail::Dimension<2>, const double* pos) {
+    AddPosition(pos[0], pos[1]);
+  }
+
+  void AddPosition(detail::Dimension<3>, const double* pos) {
+    AddPosition(pos[0], pos[1], pos[2]);
+  }
+
+  static const size_t* OffsetsOrZero(const std::vector<size_t>& offsets) {
+    static const size_t kNoOffsets = 0;
+    return offsets.empty() ? &kNoOffsets : offsets.data();
+  }
+
+  void SetPartOffsets(const size_t* offsets, size_t count) {
+    partOffsets_.assign(offsets, offsets + count + 1);
+  }
+
+  Type type_;
+  uint8_t dims_;
+  std::vector<double> coords_;
+  std::vector<size_t> partOffsets_;
+  std::vector<size_t> polygonOffsets_;
+  std::vector<FlatGeometry> geometries_;
+};
+
+namespace detail {
+
+/** Checks that a Point holds exactly one position */
+inline void CheckPoint(const FlatGeometry& geometry) {
+  if (geometry.NumPositions() != 1) {
+    throw std::domain_error("Point must have exactly one position");
+  }
+}
+}
+
+/** Returns the GeoJSON object of a FlatGeometry
+ *
+ *  \param geometry  The geometry
+ *  \param format    How the coordinates are encoded
+ *
+ *  \return A GeoJSON geometry object
+ *
+ *  \throws std::domain_error if the geometry is not valid GeoJSON
+ */
+template <typename Json = nlohmann::json>
+Json Geometry(const FlatGeometry& geometry,
+              const CoordinateFormat& format = CoordinateFormat()) {
+  auto positions = geometry.Positions();
+  switch (geometry.GetType()) {
+    case Type::Point:
+      detail::CheckPoint(geometry);
+      return positions.HasAltitude()
+                 ? Point<Json>(positions.Lon(0), positions.Lat(0),
+                               positions.Alt(0), format)
+                 : Point<Json>(positions.Lon(0), positions.Lat(0), format);
+    case Type::MultiPoint:
+      return MultiPoint<Json>(positions, format);
+    case Type::LineString:
+      return LineString<Json>(positions, format);
+    case Type::MultiLineString:
+      return MultiLineString<Json>(positions, geometry.PartOffsets(),
+                                   geometry.NumParts(), format);
+    case Type::Polygon:
+      return Polygon<Json>(positions, geometry.PartOffsets(),
+                           geometry.NumParts(), format);
+    case Type::MultiPolygon:
+      return MultiPolygon<Json>(positions, geometry.PolygonOffsets(),
+                                geometry.NumPolygons(),
+                                geometry.PartOffsets(), geometry.NumParts(),
+                                format);
+    default:
+      break;
+  }
+  const auto& geometries = geometry.Geometries();
+  return GeometryCollection<Json>(geometries.size(), [&](size_t i) {
+    return Geometry<Json>(geometries[i], format);
+  });
+}
+
+namespace text {
+
+/** Text version of geojson::Geometry() for a FlatGeometry */
+inline std::string Geometry(
+    const FlatGeometry& geometry,
+    const CoordinateFormat& format = CoordinateFormat()) {
+  auto positions = geometry.Positions();
+  switch (geometry.GetType()) {
+    case Type::Point:
+      geojson::detail::CheckPoint(geometry);
+      return positions.HasAltitude()
+                 ? Point(positions.Lon(0), positions.Lat(0), positions.Alt(0),
+                         format)
+                 : Point(positions.Lon(0), positions.Lat(0), format);
+    case Type::MultiPoint:
+      return MultiPoint(positions, format);
+    case Type::LineString:
+      return LineString(positions, format);
+    case Type::MultiLineString:
+      return MultiLineString(positions, geometry.PartOffsets(),
+                             geometry.NumParts(), format);
+    case Type::Polygon:
+      return Polygon(positions, geometry.PartOffsets(), geometry.NumParts(),
+                     format);
+    case Type::MultiPolygon:
+      return MultiPolygon(positions, geometry.PolygonOffsets(),
+                          geometry.NumPolygons(), geometry.PartOffsets(),
+                          geometry.NumParts(), format);
+    default:
+      break;
+  }
+  const auto& geometries = geometry.Geometries();
+  return GeometryCollection(geometries.size(), [&](size_t i) {
+    return Geometry(geometries[i], format);
+  });
+}
+}
+
+/** A handler for Read() that builds FlatGeometry objects from the geometry
+ *  events, without building a JSON tree
+ *
+ *  Handlers derive from this and take each geometry in their OnFeatureEnd(),
+ *  or read a lone geometry object and take it afterwards.
+ */
+class FlatGeometryBuilder : public ReaderHandler {
+ public:
+  FlatGeometryBuilder() : hasGeometry_(false) {}
+
+  void OnGeometryBegin(Type type) { stack_.emplace_back(type); }
+
+  void OnGeometryEnd(Type type) {
+    (void)type;
+    FlatGeometry geometry = std::move(stack_.back());
+    stack_.pop_back();
+    if (!stack_.empty()) {
+      stack_.back().AddGeometry(std::move(geometry));
+    } else {
+      geometry_ = std::move(geometry);
+      hasGeometry_ = true;
+    }
+  }
+
+  void OnPosition(double lon, double lat, double alt) {
+    if (std::isnan(alt)) {
+      stack_.back().AddPosition(lon, lat);
+    } else {
+      stack_.back().AddPosition(lon, lat, alt);
+    }
+  }
+
+  void OnLineEnd() { stack_.back().EndPart(); }
+
+  void OnRingEnd() { stack_.back().EndRing(); }
+
+  void OnPolygonEnd() { stack_.back().EndPolygon(); }
+
+  /** Returns whether a geometry has been read since the last TakeGeometry() */
+  bool HasGeometry() const { return hasGeometry_; }
+
+  /** Returns the last geometry read, moving it out of the builder
+   *
+   *  \throws std::logic_error if no geometry has been read
+   */
+  FlatGeometry TakeGeometry() {
+    if (!hasGeometry_) throw std::logic_error("No geometry has been read");
+    hasGeometry_ = false;
+    return std::move(geometry_);
+  }
+
+ private:
+  std::vector<FlatGeometry> stack_;
+  FlatGeometry geometry_;
+  bool hasGeometry_;
+};
+
+/** Reads a GeoJSON geometry object, or the geometry of a Feature, held in
+ *  memory into a FlatGeometry
+ *
+ *  \param begin  The start of the text
+ *  \param end    One past the end of the text
+ *
+ *  \throws nlohmann::json::parse_error if the input is not valid JSON
+ *  \throws std::domain_error if the input is not valid GeoJSON or has no
+ *          geometry
+ */
+inline FlatGeometry ReadFlatGeometry(const char* begin, const char* end) {
+  FlatGeometryBuilder builder;
+  Read(begin, end, builder);
+  if (!builder.HasGeometry()) {
+    throw std::domain_error("Expected a geometry");
+  }
+  return builder.TakeGeometry();
+}
+
+/** \overload */
+inline FlatGeometry ReadFlatGeometry(const std::string& text) {
+  return ReadFlatGeometry(text.data(), text.data() + text.size());
+}
+}
@@ -0,0 +1,1022 @@
+/** FlatGeobuf output for libgeojson
+ *
+ *  \file flatgeobuf.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "libgeojson/flat_geometry.h"
+#include "libgeojson/libgeojson.h"
+#include "libgeojson/schema.h"
+#include "libgeojson/spatial_index.h"
+#include "libgeojson/spatial_order.h"
+#include "libgeojson/writer.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#error "FlatGeobuf output is only supported on little-endian machines"
+#endif
+
+namespace geojson {
+
+/** FlatGeobuf (https://flatgeobuf.org) output
+ *
+ *  The features are given as FlatGeometry objects, made with the same
+ *  callbacks as the geojson builders, and a properties object, and are
+ *  written as FlatBuffers along with a packed Hilbert R-tree of their bounds.
+ */
+namespace fgb {
+
+/** The GeometryType enum of the FlatGeobuf schema */
+enum class GeometryType : uint8_t {
+  Unknown = 0,
+  Point = 1,
+  LineString = 2,
+  Polygon = 3,
+  MultiPoint = 4,
+  MultiLineString = 5,
+  MultiPolygon = 6,
+  GeometryCollection = 7
+};
+
+/** The ColumnType enum of the FlatGeobuf schema */
+enum class ColumnType : uint8_t {
+  Byte = 0,
+  UByte = 1,
+  Bool = 2,
+  Short = 3,
+  UShort = 4,
+  Int = 5,
+  UInt = 6,
+  Long = 7,
+  ULong = 8,
+  Float = 9,
+  Double = 10,
+  String = 11,
+  Json = 12,
+  DateTime = 13,
+  Binary = 14
+};
+
+/** A property column of a FlatGeobuf file */
+struct Column {
+  std::string name;
+  ColumnType type;
+};
+
+/** Returns the columns of the properties of a schema, in its order, with the
+ *  FlatGeobuf type of each one's values (Bool, Long, Double, String or Json)
+ */
+inline std::vector<Column> Columns(const PropertySchema& schema) {
+  std::vector<Column> columns;
+  for (size_t c = 0; c < schema.NumColumns(); c++) {
+    ColumnType type = ColumnType::Json;
+    switch (schema.Type(c)) {
+      case PropertyType::Bool:
+        type = ColumnType::Bool;
+        break;
+      case PropertyType::Integer:
+        type = ColumnType::Long;
+        break;
+      case PropertyType::Double:
+        type = ColumnType::Double;
+        break;
+      case PropertyType::String:
+        type = ColumnType::String;
+        break;
+      default:
+        break;
+    }
+    columns.push_back(Column{schema.Name(c), type});
+  }
+  return columns;
+}
+
+/** A feature to be written to a FlatGeobuf file */
+struct Feature {
+  /** Constructor, makes a feature with a null geometry
+   *
+   *  \param properties  The properties object of the feature, or null
+   */
+  explicit Feature(nlohmann::json properties = nlohmann::json::object())
+      : hasGeometry(false), properties(std::move(properties)) {}
+
+  /** Constructor
+   *
+   *  \param geometry    The geometry of the feature
+   *  \param properties  The properties object of the feature, or null
+   */
+  Feature(FlatGeometry geometry,
+          nlohmann::json properties = nlohmann::json::object())
+      : hasGeometry(true), geometry(std::move(geometry)),
+        properties(std::move(properties)) {}
+
+  bool hasGeometry;
+  FlatGeometry geometry;
+  nlohmann::json properties;
+};
+
+namespace detail {
+
+using geojson::detail::AppendBytes;
+
+/** The magic bytes at the start of a FlatGeobuf file, version 3.0 */
+static constexpr char kMagic[8] = {'f', 'g', 'b', 3, 'f', 'g', 'b', 0};
+
+/** Appends a little-endian scalar to a buffer */
+template <typename T>
+void AppendScalar(std::string& buf, T value) {
+  AppendBytes(buf, &value, 1);
+}
+
+/** Appends zero bytes until there are size bytes after a multiple of
+ *  alignment
+ */
+inline void PadBuffer(std::string& buf, size_t alignment, size_t size = 0) {
+  while ((buf.size() + size) % alignment != 0) buf.push_back('\0');
+}
+
+/** Sets the offset at a position of a buffer to point to another position */
+inline void PatchOffset(std::string& buf, size_t at, size_t target) {
+  auto offset = static_cast<uint32_t>(target - at);
+  std::memcpy(&buf[at], &offset, sizeof(offset));
+}
+
+/** Appends a FlatBuffers vector of scalars, returning where it starts */
+template <typename T>
+size_t AppendVector(std::string& buf, const T* values, size_t count) {
+  PadBuffer(buf, std::max<size_t>(sizeof(uint32_t), sizeof(T)),
+            sizeof(uint32_t));
+  size_t pos = buf.size();
+  AppendScalar(buf, static_cast<uint32_t>(count));
+  AppendBytes(buf, values, count);
+  return pos;
+}
+
+/** Appends a FlatBuffers string, returning where it starts */
+inline size_t AppendString(std::string& buf, const std::string& str) {
+  PadBuffer(buf, sizeof(uint32_t));
+  size_t pos = buf.size();
+  AppendScalar(buf, static_cast<uint32_t>(str.size()));
+  buf.append(str);
+  buf.push_back('\0');
+  return pos;
+}
+
+/** Appends a FlatBuffers vector of count offsets to be set with
+ *  PatchOffset(), returning where it starts
+ */
+inline size_t AppendOffsetVector(std::string& buf, size_t count) {
+  PadBuffer(buf, sizeof(uint32_t));
+  size_t pos = buf.size();
+  AppendScalar(buf, static_cast<uint32_t>(count));
+  buf.append(count * sizeof(uint32_t), '\0');
+  return pos;
+}
+
+/** The position of the i'th offset of a vector from AppendOffsetVector() */
+inline size_t OffsetVectorElement(size_t vector, size_t i) {
+  return vector + sizeof(uint32_t) * (i + 1);
+}
+
+/** The fields of a FlatBuffers table, written front to back
+ *
+ *  The vtable is written first, then the table, and then the strings,
+ *  vectors and tables that it refers to, whose offsets are set afterwards.
+ *  Fields are written whether or not they hold their default values.
+ */
+class FlatTable {
+ public:
+  /** Adds a scalar field */
+  template <typename T>
+  void Scalar(uint16_t id, T value) {
+    Field field{id, sizeof(T), {}, 0};
+    std::memcpy(field.bytes, &value, sizeof(T));
+    fields_.push_back(field);
+  }
+
+  /** Adds a field that refers to a string, vector or table */
+  void Offset(uint16_t id) { fields_.push_back(Field{id, 4, {}, 0}); }
+
+  /** Appends the vtable and the table, returning where the table starts */
+  size_t Write(std::string& buf) {
+    // Fields are laid out by size, starting after the vtable offset
+    size_t numSlots = 0, size = sizeof(int32_t), alignment = sizeof(int32_t);
+    for (size_t fieldSize : {4, 8, 2, 1}) {
+      for (auto& field : fields_) {
+        if (field.size != fieldSize) continue;
+        size = (size + fieldSize - 1) / fieldSize * fieldSize;
+        field.offset = size;
+        size += fieldSize;
+        alignment = std::max(alignment, fieldSize);
+        numSlots = std::max<size_t>(numSlots, field.id + 1);
+      }
+    }
+
+    PadBuffer(buf, sizeof(uint16_t));
+    size_t vtable = buf.size();
+    std::vector<uint16_t> slots(numSlots + 2);
+    slots[0] = static_cast<uint16_t>(sizeof(uint16_t) * slots.size());
+    slots[1] = static_cast<uint16_t>(size);
+    for (const auto& field : fields_) {
+      slots[field.id + 2] = static_cast<uint16_t>(field.offset);
+    }
+    AppendBytes(buf, slots.data(), slots.size());
+
+    PadBuffer(buf, alignment);
+    table_ = buf.size();
+    AppendScalar(buf, static_cast<int32_t>(table_ - vtable));
+    buf.resize(table_ + size, '\0');
+    for (const auto& field : fields_) {
+      std::memcpy(&buf[table_ + field.offset], field.bytes, field.size);
+    }
+    return table_;
+  }
+
+  /** Returns where a field is in the buffer, once the table is written */
+  size_t FieldPosition(uint16_t id) const {
+    for (const auto& field : fields_) {
+      if (field.id == id) return table_ + field.offset;
+    }
+    throw std::logic_error("FlatBuffers table has no such field");
+  }
+
+ private:
+  struct Field {
+    uint16_t id;
+    size_t size;
+    char bytes[8];
+    size_t offset;
+  };
+
+  std::vector<Field> fields_;
+  size_t table_ = 0;
+};
+
+/** Starts a size-prefixed FlatBuffer, whose root offset is set by
+ *  FinishBuffer()
+ */
+inline void StartBuffer(std::string& buf) {
+  buf.assign(2 * sizeof(uint32_t), '\0');
+}
+
+/** Sets the root table and the size prefix of a FlatBuffer */
+inline void FinishBuffer(std::string& buf, size_t root) {
+  PatchOffset(buf, sizeof(uint32_t), root);
+  auto size = static_cast<uint32_t>(buf.size() - sizeof(uint32_t));
+  std::memcpy(&buf[0], &size, sizeof(size));
+}
+
+/** Returns the FlatGeobuf type of a geometry type */
+inline GeometryType ToGeometryType(Type type) {
+  switch (type) {
+    case Type::Point:
+      return GeometryType::Point;
+    case Type::MultiPoint:
+      return GeometryType::MultiPoint;
+    case Type::LineString:
+      return GeometryType::LineString;
+    case Type::MultiLineString:
+      return GeometryType::MultiLineString;
+    case Type::Polygon:
+      return GeometryType::Polygon;
+    case Type::MultiPolygon:
+      return GeometryType::MultiPolygon;
+    case Type::GeometryCollection:
+      return GeometryType::GeometryCollection;
+    default:
+      return GeometryType::Unknown;
+  }
+}
+
+/** The coordinate arrays of one FlatGeobuf Geometry table */
+struct GeometryArrays {
+  /** Adds positions, with NaN altitudes for 2D ones in 3D geometries */
+  void Add(const PositionSpan& positions, size_t first, size_t count,
+           bool reverse) {
+    if (hasZ && positions.HasAltitude()) {
+      Add(geojson::detail::Dimension<3>(), positions, first, count, reverse);
+    } else {
+      Add(geojson::detail::Dimension<2>(), positions, first, count, reverse);
+    }
+  }
+
+  template <int Dims>
+  void Add(geojson::detail::Dimension<Dims> dims,
+           const PositionSpan& positions, size_t first, size_t count,
+           bool reverse) {
+    geojson::detail::SpanPoints points(positions);
+    geojson::detail::Instrument::OnVertices(count);
+    double pos[Dims];
+    for (size_t i = 0; i < count; i++) {
+      size_t idx = first + (reverse ? count - i - 1 : i);
+      geojson::detail::ReadPoint(dims, pos, points, idx);
+      xy.push_back(pos[0]);
+      xy.push_back(pos[1]);
+      AddAltitude(dims, pos);
+    }
+  }
+
+  void AddAltitude(geojson::detail::Dimension<2>, const double*) {
+    if (hasZ) z.push_back(NAN);
+  }
+
+  void AddAltitude(geojson::detail::Dimension<3>, const double* pos) {
+    z.push_back(pos[2]);
+  }
+
+  /** Adds the positions of a line and ends it */
+  void AddLine(const PositionSpan& line) {
+    if (line.Size() <= 1) {
+      throw std::domain_error("LineString objects must have at least 2 points");
+    }
+    Add(line, 0, line.Size(), false);
+    ends.push_back(static_cast<uint32_t>(xy.size() / 2));
+  }
+
+  /** Adds the positions of a ring, wound and closed, and ends it */
+  void AddRing(const PositionSpan& ring, bool ccw) {
+    size_t n = ring.Size();
+    if (n < 3) {
+      throw std::domain_error("Linear rings must have at least 3 points");
+    }
+    bool reverse = geojson::detail::IsCcw(ring) != ccw;
+    if (reverse) geojson::detail::Instrument::OnRingReversed();
+    Add(ring, 0, n, reverse);
+    Add(ring, reverse ? n - 1 : 0, 1, false);
+    ends.push_back(static_cast<uint32_t>(xy.size() / 2));
+  }
+
+  bool hasZ;
+  std::vector<double> xy;
+  std::vector<double> z;
+  std::vector<uint32_t> ends;
+};
+
+/** Appends a FlatGeobuf Geometry table, returning where it starts
+ *
+ *  \throws std::domain_error if the geometry is not valid GeoJSON
+ */
+inline size_t WriteGeometry(std::string& buf, const FlatGeometry& geometry,
+                            bool hasZ) {
+  GeometryArrays arrays{hasZ, {}, {}, {}};
+  auto positions = geometry.Positions();
+  const size_t* offsets = geometry.PartOffsets();
+  std::vector<FlatGeometry> polygons;
+  const std::vector<FlatGeometry>* parts = nullptr;
+  switch (geometry.GetType()) {
+    case Type::Point:
+      geojson::detail::CheckPoint(geometry);
+      arrays.Add(positions, 0, 1, false);
+      break;
+    case Type::MultiPoint:
+      arrays.Add(positions, 0, positions.Size(), false);
+      break;
+    case Type::LineString:
+      arrays.AddLine(positions);
+      break;
+    case Type::MultiLineString:
+      for (size_t i = 0; i < geometry.NumParts(); i++) {
+        arrays.AddLine(geometry.Part(i));
+      }
+      break;
+    case Type::Polygon:
+      for (size_t i = 0; i < geometry.NumParts(); i++) {
+        arrays.AddRing(geometry.Part(i), i == 0);
+      }
+      break;
+    case Type::MultiPolygon:
+      for (size_t i = 0; i < geometry.NumPolygons(); i++) {
+        size_t first = geometry.PolygonOffsets()[i];
+        size_t last = geometry.PolygonOffsets()[i + 1];
+        std::vector<size_t> ringOffsets(offsets + first, offsets + last + 1);
+        for (auto& offset : ringOffsets) offset -= offsets[first];
+        polygons.push_back(FlatGeometry::Polygon(
+            positions.Slice(offsets[first], offsets[last]), ringOffsets.data(),
+            last - first));
+      }
+      parts = &polygons;
+      break;
+    default:
+      parts = &geometry.Geometries();
+      break;
+  }
+  // A single line or ring needs no ends
+  if (arrays.ends.size() <= 1) arrays.ends.clear();
+
+  FlatTable table;
+  if (!arrays.ends.empty()) table.Offset(0);
+  if (!arrays.xy.empty()) table.Offset(1);
+  if (!arrays.z.empty()) table.Offset(2);
+  table.Scalar<uint8_t>(6, static_cast<uint8_t>(
+                               ToGeometryType(geometry.GetType())));
+  if (parts) table.Offset(7);
+  size_t pos = table.Write(buf);
+
+  if (!arrays.ends.empty()) {
+    PatchOffset(buf, table.FieldPosition(0),
+                AppendVector(buf, arrays.ends.data(), arrays.ends.size()));
+  }
+  if (!arrays.xy.empty()) {
+    PatchOffset(buf, table.FieldPosition(1),
+                AppendVector(buf, arrays.xy.data(), arrays.xy.size()));
+  }
+  if (!arrays.z.empty()) {
+    PatchOffset(buf, table.FieldPosition(2),
+                AppendVector(buf, arrays.z.data(), arrays.z.size()));
+  }
+  if (parts) {
+    size_t vector = AppendOffsetVector(buf, parts->size());
+    PatchOffset(buf, table.FieldPosition(7), vector);
+    for (size_t i = 0; i < parts->size(); i++) {
+      PatchOffset(buf, OffsetVectorElement(vector, i),
+                  WriteGeometry(buf, (*parts)[i], hasZ));
+    }
+  }
+  return pos;
+}
+
+/** Writes integer properties, checking that they fit in their column */
+template <typename T>
+bool AppendInteger(std::string& buf, const nlohmann::json& value) {
+  if (value.is_number_unsigned()) {
+    auto u = value.get<uint64_t>();
+    if (u > static_cast<uint64_t>(std::numeric_limits<T>::max())) return false;
+    AppendScalar(buf, static_cast<T>(u));
+    return true;
+  }
+  if (!value.is_number_integer()) return false;
+  auto s = value.get<int64_t>();
+  if (s < static_cast<int64_t>(std::numeric_limits<T>::min()) ||
+      (s > 0 && static_cast<uint64_t>(s) >
+                    static_cast<uint64_t>(std::numeric_limits<T>::max()))) {
+    return false;
+  }
+  AppendScalar(buf, static_cast<T>(s));
+  return true;
+}
+
+/** Appends a string or blob property */
+inline void AppendBlob(std::string& buf, const std::string& value) {
+  AppendScalar(buf, static_cast<uint32_t>(value.size()));
+  buf.append(value);
+}
+
+/** Appends a property value as its column type, returning false if it does
+ *  not fit in that type
+ */
+inline bool AppendProperty(std::string& buf, ColumnType type,
+                           const nlohmann::json& value) {
+  switch (type) {
+    case ColumnType::Byte:
+      return AppendInteger<int8_t>(buf, value);
+    case ColumnType::UByte:
+      return AppendInteger<uint8_t>(buf, value);
+    case ColumnType::Bool:
+      if (!value.is_boolean()) return false;
+      AppendScalar<uint8_t>(buf, value.get<bool>() ? 1 : 0);
+      return true;
+    case ColumnType::Short:
+      return AppendInteger<int16_t>(buf, value);
+    case ColumnType::UShort:
+      return AppendInteger<uint16_t>(buf, value);
+    case ColumnType::Int:
+      return AppendInteger<int32_t>(buf, value);
+    case ColumnType::UInt:
+      return AppendInteger<uint32_t>(buf, value);
+    case ColumnType::Long:
+      return AppendInteger<int64_t>(buf, value);
+    case ColumnType::ULong:
+      return AppendInteger<uint64_t>(buf, value);
+    case ColumnType::Float:
+      if (!value.is_number()) return false;
+      AppendScalar(buf, value.get<float>());
+      return true;
+    case ColumnType::Double:
+      if (!value.is_number()) return false;
+      AppendScalar(buf, value.get<double>());
+      return true;
+    case ColumnType::Json:
+      AppendBlob(buf, value.dump());
+      return true;
+    default:
+      if (!value.is_string()) return false;
+      AppendBlob(buf, value.get_ref<const std::string&>());
+      return true;
+  }
+}
+
+/** Appends the value of a schema's column as the type of a file's column,
+ *  returning false if it does not fit in that type. The types that Columns()
+ *  gives are written straight from the schema's callbacks.
+ */
+inline bool AppendProperty(std::string& buf, ColumnType type,
+                           const PropertySchema& schema, size_t column,
+                           size_t index) {
+  switch (schema.Type(column)) {
+    case PropertyType::Bool:
+      if (type != ColumnType::Bool) break;
+      AppendScalar<uint8_t>(buf, schema.BoolValue(column, index) ? 1 : 0);
+      return true;
+    case PropertyType::Integer:
+      if (type != ColumnType::Long) break;
+      AppendScalar(buf, schema.IntegerValue(column, index));
+      return true;
+    case PropertyType::Double:
+      if (type != ColumnType::Double) break;
+      AppendScalar(buf, schema.DoubleValue(column, index));
+      return true;
+    case PropertyType::String:
+      if (type != ColumnType::String) break;
+      AppendBlob(buf, schema.StringValue(column, index));
+      return true;
+    default:
+      if (type != ColumnType::Json) break;
+      AppendBlob(buf, schema.JsonValue(column, index).dump());
+      return true;
+  }
+  return AppendProperty(buf, type, schema.Value(column, index));
+}
+
+/** Returns the column type that a property is given when it is first seen */
+inline ColumnType InferColumnType(const nlohmann::json& value) {
+  if (value.is_boolean()) return ColumnType::Bool;
+  if (value.is_number_unsigned()) {
+    return value.get<uint64_t>() >
+                   static_cast<uint64_t>(std::numeric_limits<int64_t>::max())
+               ? ColumnType::ULong
+               : ColumnType::Long;
+  }
+  if (value.is_number_integer()) return ColumnType::Long;
+  if (value.is_number()) return ColumnType::Double;
+  if (value.is_string()) return ColumnType::String;
+  return ColumnType::Json;
+}
+
+/** The columns of a file, which encodes the properties of its features */
+class PropertyEncoder {
+ public:
+  explicit PropertyEncoder(std::vector<Column> columns)
+      : columns_(std::move(columns)) {
+    for (size_t i = 0; i < columns_.size(); i++) {
+      if (!index_.emplace(columns_[i].name, i).second) {
+        throw std::domain_error("Duplicate FlatGeobuf column " +
+                                columns_[i].name);
+      }
+    }
+  }
+
+  /** Returns the columns, along with those added for new properties */
+  const std::vector<Column>& Columns() const { return columns_; }
+
+  /** Encodes the non-null properties of a feature, adding a column for each
+   *  one that is not known yet
+   *
+   *  \throws std::domain_error if properties is not an object or null, or a
+   *                            property does not fit the type of its column
+   */
+  void Encode(const nlohmann::json& properties, std::string& buf) {
+    if (properties.is_null()) return;
+    if (!properties.is_object()) {
+      throw std::domain_error("Feature properties must be an object or null");
+    }
+    for (auto it = properties.begin(); it != properties.end(); ++it) {
+      if (it->is_null()) continue;
+      auto column = index_.find(it.key());
+      if (column == index_.end()) {
+        if (columns_.size() > std::numeric_limits<uint16_t>::max()) {
+          throw std::domain_error("FlatGeobuf files have at most 65536 "
+                                  "columns");
+        }
+        column = index_.emplace(it.key(), columns_.size()).first;
+        columns_.push_back(Column{it.key(), InferColumnType(*it)});
+      }
+      AppendScalar(buf, static_cast<uint16_t>(column->second));
+      if (!AppendProperty(buf, columns_[column->second].type, *it)) {
+        throw std::domain_error("Property " + it.key() +
+                                " does not fit the type of its column");
+      }
+    }
+  }
+
+  /** Encodes the non-null properties of a feature of a schema, adding a
+   *  column, typed as in fgb::Columns(), for each one that is not known yet
+   *
+   *  \throws std::domain_error if a property does not fit the type of its
+   *                            column
+   */
+  void Encode(const PropertySchema& schema, size_t index, std::string& buf) {
+    MapSchema(schema);
+    for (size_t c = 0; c < schema.NumColumns(); c++) {
+      if (schema.IsNullValue(c, index)) continue;
+      size_t column = schemaColumns_[c];
+      AppendScalar(buf, static_cast<uint16_t>(column));
+      if (!AppendProperty(buf, columns_[column].type, schema, c, index)) {
+        throw std::domain_error("Property " + schema.Name(c) +
+                                " does not fit the type of its column");
+      }
+    }
+  }
+
+ private:
+  /** Finds the columns of a schema's properties, unless they are those of
+   *  the last schema, which is checked by name
+   */
+  void MapSchema(const PropertySchema& schema) {
+    bool mapped = schemaColumns_.size() == schema.NumColumns();
+    for (size_t c = 0; c < schemaColumns_.size() && mapped; c++) {
+      mapped = columns_[schemaColumns_[c]].name == schema.Name(c);
+    }
+    if (mapped) return;
+
+    auto types = fgb::Columns(schema);
+    schemaColumns_.clear();
+    for (size_t c = 0; c < types.size(); c++) {
+      auto column = index_.find(types[c].name);
+      if (column == index_.end()) {
+        if (columns_.size() > std::numeric_limits<uint16_t>::max()) {
+          throw std::domain_error("FlatGeobuf files have at most 65536 "
+                                  "columns");
+        }
+        column = index_.emplace(types[c].name, columns_.size()).first;
+        columns_.push_back(types[c]);
+      }
+      schemaColumns_.push_back(column->second);
+    }
+  }
+
+  std::vector<Column> columns_;
+  std::unordered_map<std::string, size_t> index_;
+
+  // The file's columns of the last schema's properties
+  std::vector<size_t> schemaColumns_;
+};
+
+/** Returns a size-prefixed FlatGeobuf Feature
+ *
+ *  \param geometry    The geometry of the feature, or null for none
+ *  \param hasZ        Whether the positions of the file have altitudes
+ *  \param properties  The encoded properties of the feature
+ */
+inline std::string EncodeFeature(const FlatGeometry* geometry, bool hasZ,
+                                 const std::string& properties) {
+  std::string buf;
+  StartBuffer(buf);
+  FlatTable table;
+  if (geometry) table.Offset(0);
+  if (!properties.empty()) table.Offset(1);
+  size_t root = table.Write(buf);
+  if (geometry) {
+    PatchOffset(buf, table.FieldPosition(0),
+                WriteGeometry(buf, *geometry, hasZ));
+  }
+  if (!properties.empty()) {
+    PatchOffset(buf, table.FieldPosition(1),
+                AppendVector(buf, properties.data(), properties.size()));
+  }
+  FinishBuffer(buf, root);
+  return buf;
+}
+
+/** The fields of the Header of a FlatGeobuf file */
+struct HeaderFields {
+  std::string name;
+  BoundingBox envelope;
+  GeometryType geometryType;
+  bool hasZ;
+  const std::vector<Column>* columns;
+  uint64_t numFeatures;
+  uint16_t indexNodeSize;
+};
+
+/** Returns a size-prefixed FlatGeobuf Header */
+inline std::string EncodeHeader(const HeaderFields& fields) {
+  std::string buf;
+  StartBuffer(buf);
+  FlatTable header;
+  if (!fields.name.empty()) header.Offset(0);
+  if (!fields.envelope.Empty()) header.Offset(1);
+  header.Scalar<uint8_t>(2, static_cast<uint8_t>(fields.geometryType));
+  header.Scalar<uint8_t>(3, fields.hasZ ? 1 : 0);
+  header.Offset(7);
+  header.Scalar<uint64_t>(8, fields.numFeatures);
+  header.Scalar<uint16_t>(9, fields.indexNodeSize);
+  header.Offset(10);
+  size_t root = header.Write(buf);
+
+  if (!fields.name.empty()) {
+    PatchOffset(buf, header.FieldPosition(0), AppendString(buf, fields.name));
+  }
+  if (!fields.envelope.Empty()) {
+    const auto& e = fields.envelope;
+    double envelope[4] = {e.MinLon(), e.MinLat(), e.MaxLon(), e.MaxLat()};
+    PatchOffset(buf, header.FieldPosition(1),
+                AppendVector(buf, envelope, 4));
+  }
+
+  const auto& columns = *fields.columns;
+  size_t vector = AppendOffsetVector(buf, columns.size());
+  PatchOffset(buf, header.FieldPosition(7), vector);
+  for (size_t i = 0; i < columns.size(); i++) {
+    FlatTable column;
+    column.Offset(0);
+    column.Scalar<uint8_t>(1, static_cast<uint8_t>(columns[i].type));
+    PatchOffset(buf, OffsetVectorElement(vector, i), column.Write(buf));
+    PatchOffset(buf, column.FieldPosition(0),
+                AppendString(buf, columns[i].name));
+  }
+
+  // GeoJSON positions are always WGS 84
+  FlatTable crs;
+  crs.Offset(0);
+  crs.Scalar<int32_t>(1, 4326);
+  PatchOffset(buf, header.FieldPosition(10), crs.Write(buf));
+  PatchOffset(buf, crs.FieldPosition(0), AppendString(buf, "EPSG"));
+
+  FinishBuffer(buf, root);
+  return buf;
+}
+
+/** A feature of a file, as it is placed in the index */
+struct IndexedFeature {
+  uint64_t key;
+  uint64_t size;
+  BoundingBox bounds;
+};
+
+/** Appends the packed R-tree of FlatGeobuf over features in file order
+ *
+ *  Unlike a PackedRTree, the levels are stored from the root down, and each
+ *  node holds the index of its first child, or for the leaves the offset of
+ *  the feature from the start of the features.
+ */
+inline void AppendIndex(std::string& buf,
+                        const std::vector<IndexedFeature>& features,
+                        size_t nodeSize) {
+  std::vector<size_t> levelSizes{features.size()};
+  size_t numNodes = features.size();
+  do {
+    levelSizes.push_back((levelSizes.back() + nodeSize - 1) / nodeSize);
+    numNodes += levelSizes.back();
+  } while (levelSizes.back() != 1);
+
+  std::vector<size_t> levelOffsets;
+  size_t offset = numNodes;
+  for (size_t size : levelSizes) levelOffsets.push_back(offset -= size);
+
+  struct Node {
+    double minX, minY, maxX, maxY;
+    uint64_t offset;
+  };
+  static_assert(sizeof(Node) == 40, "FlatGeobuf nodes are 40 bytes");
+  std::vector<Node> nodes(numNodes);
+  uint64_t featureOffset = 0;
+  for (size_t i = 0; i < features.size(); i++) {
+    const auto& b = features[i].bounds;
+    nodes[levelOffsets[0] + i] = Node{b.MinLon(), b.MinLat(), b.MaxLon(),
+                                      b.MaxLat(), featureOffset};
+    featureOffset += features[i].size;
+  }
+  for (size_t level = 0; level + 1 < levelSizes.size(); level++) {
+    size_t child = levelOffsets[level];
+    size_t end = child + levelSizes[level];
+    for (size_t parent = levelOffsets[level + 1]; child < end; parent++) {
+      Node node = nodes[child];
+      node.offset = child;
+      for (size_t last = std::min(end, child + nodeSize); ++child < last;) {
+        node.minX = std::min(node.minX, nodes[child].minX);
+        node.minY = std::min(node.minY, nodes[child].minY);
+        node.maxX = std::max(node.maxX, nodes[child].maxX);
+        node.maxY = std::max(node.maxY, nodes[child].maxY);
+      }
+      nodes[parent] = node;
+    }
+  }
+  AppendBytes(buf, nodes.data(), nodes.size());
+}
+}
+
+/** Writes the features of a collection to a FlatGeobuf file
+ *
+ *  The file starts with its header, which holds the number of features and
+ *  their schema, and then the index, so the features are held until Close()
+ *  by a HilbertFeatureSorter, encoded as they are given. This also puts them
+ *  in the order of the Hilbert curve through the centers of their bounds, as
+ *  the index expects. Beyond the sorter, a few dozen bytes are held per
+ *  feature.
+ *
+ *  The properties of the features are written in columns, which are either
+ *  given up front or added as new properties are seen, with a type inferred
+ *  from the first value. Null properties are left out. The positions of all
+ *  of the features have the number of coordinates of the first geometry,
+ *  with altitudes dropped or set to NaN as in FlatGeometry::AddPosition().
+ *
+ *  \tparam Sink  A type with a member void Write(const char*, size_t)
+ */
+template <typename Sink>
+class BasicFeatureCollectionWriter {
+ public:
+  /** Constructor
+   *
+   *  \param sink      The sink to which the file is written
+   *  \param name      The name of the dataset in the header
+   *  \param columns   The columns of the properties known up front
+   *  \param nodeSize  The number of children of each node of the index, with
+   *                   0 writing no index and keeping the features in order
+   *  \param extent    The area over which the features are ordered for the
+   *                   index, best the bounds of the dataset, since features
+   *                   closer than a 65536th of it are not told apart
+   *
+   *  \throws std::domain_error if a column name is given twice, or nodeSize
+   *                            is 1 or more than 65535
+   */
+  explicit BasicFeatureCollectionWriter(
+      Sink sink, std::string name = std::string(),
+      std::vector<Column> columns = std::vector<Column>(),
+      size_t nodeSize = kDefaultRTreeNodeSize,
+      const BoundingBox& extent = BoundingBox::FromCorners(-180, -90, 180, 90))
+      : sink_(std::move(sink)), name_(std::move(name)),
+        properties_(std::move(columns)), nodeSize_(nodeSize),
+        hasType_(false), type_(GeometryType::Unknown), hasDims_(false),
+        hasZ_(false), closed_(false), sorter_(extent), numFeatures_(0) {
+    if (nodeSize == 1 || nodeSize > std::numeric_limits<uint16_t>::max()) {
+      throw std::domain_error("Index node size must be 0 or in [2, 65535]");
+    }
+  }
+
+  BasicFeatureCollectionWriter(const BasicFeatureCollectionWriter&) = delete;
+  BasicFeatureCollectionWriter& operator=(const BasicFeatureCollectionWriter&) =
+      delete;
+
+  /** Destructor, closes the file if Close() was not called, ignoring
+   *  errors, so call Close() to see them
+   */
+  ~BasicFeatureCollectionWriter() {
+    try {
+      Close();
+    } catch (...) {
+    }
+  }
+
+  /** Adds a feature to the file
+   *
+   *  \throws std::domain_error if the geometry is not valid GeoJSON or a
+   *                            property does not fit the type of its column
+   *  \throws std::logic_error if the file is closed
+   */
+  void Write(const Feature& feature) {
+    if (closed_) throw std::logic_error("Cannot write to a closed FlatGeobuf");
+    geojson::detail::LibraryScope scope;
+    propertyBuffer_.clear();
+    properties_.Encode(feature.properties, propertyBuffer_);
+    Add(feature.hasGeometry ? &feature.geometry : nullptr);
+  }
+
+  /** \overload */
+  void Write(const FlatGeometry& geometry, const nlohmann::json& properties) {
+    Write(Feature(geometry, properties));
+  }
+
+  /** Adds a feature whose properties are those of a feature of a schema,
+   *  encoded straight from the schema's callbacks
+   *
+   *  The columns of the schema's properties are best given up front, as
+   *  fgb::Columns(schema), and are otherwise added when first written.
+   *
+   *  \param geometry  The geometry of the feature
+   *  \param schema    The properties of the features
+   *  \param index     The index of the feature in the schema
+   *
+   *  \throws std::domain_error if the geometry is not valid GeoJSON or a
+   *                            property does not fit the type of its column
+   *  \throws std::logic_error if the file is closed
+   */
+  void Write(const FlatGeometry& geometry, const PropertySchema& schema,
+             size_t index) {
+    if (closed_) throw std::logic_error("Cannot write to a closed FlatGeobuf");
+    geojson::detail::LibraryScope scope;
+    propertyBuffer_.clear();
+    properties_.Encode(schema, index, propertyBuffer_);
+    Add(&geometry);
+  }
+
+  /** Writes the header, the index and the features, further calls are no-ops
+   */
+  void Close() {
+    if (closed_) return;
+    closed_ = true;
+
+    std::stable_sort(features_.begin(), features_.end(),
+                     [](const detail::IndexedFeature& a,
+                        const detail::IndexedFeature& b) {
+                       return a.key < b.key;
+                     });
+    bool indexed = nodeSize_ > 0 && !features_.empty();
+    sink_.Write(detail::kMagic, sizeof(detail::kMagic));
+    auto header = detail::EncodeHeader(detail::HeaderFields{
+        name_, envelope_, type_, hasZ_, &properties_.Columns(),
+        features_.size(), static_cast<uint16_t>(indexed ? nodeSize_ : 0)});
+    sink_.Write(header.data(), header.size());
+    if (indexed) {
+      std::string index;
+      detail::AppendIndex(index, features_, nodeSize_);
+      sink_.Write(index.data(), index.size());
+    }
+    features_ = std::vector<detail::IndexedFeature>();
+    sorter_.Drain([this](const char* data, size_t size, const BoundingBox&) {
+      sink_.Write(data, size);
+    });
+    geojson::detail::FlushSink(sink_);
+  }
+
+  /** Returns the number of features written so far */
+  size_t NumFeatures() const { return numFeatures_; }
+
+  /** Returns the columns of the properties seen so far */
+  const std::vector<Column>& Columns() const { return properties_.Columns(); }
+
+ private:
+  /** Encodes a feature with the properties in propertyBuffer_ */
+  void Add(const FlatGeometry* geometry) {
+    BoundingBox bounds;
+    if (geometry) {
+      if (!hasDims_) {
+        hasDims_ = true;
+        hasZ_ = geometry->HasAltitude();
+      }
+      auto type = detail::ToGeometryType(geometry->GetType());
+      if (!hasType_) {
+        hasType_ = true;
+        type_ = type;
+      } else if (type != type_) {
+        type_ = GeometryType::Unknown;
+      }
+      bounds = geometry->Bounds();
+    }
+
+    auto data = detail::EncodeFeature(geometry, hasZ_, propertyBuffer_);
+    envelope_.Extend(bounds);
+
+    // Without an index, every feature has the same key and keeps its place
+    if (nodeSize_ == 0) bounds = BoundingBox();
+    features_.push_back(
+        detail::IndexedFeature{sorter_.SortKey(bounds), data.size(), bounds});
+    sorter_.AddRaw(data.data(), data.size(), bounds);
+    numFeatures_++;
+  }
+
+  Sink sink_;
+  std::string name_;
+  detail::PropertyEncoder properties_;
+  size_t nodeSize_;
+  bool hasType_;
+  GeometryType type_;
+  bool hasDims_;
+  bool hasZ_;
+  bool closed_;
+  BoundingBox envelope_;
+  HilbertFeatureSorter sorter_;
+  std::vector<detail::IndexedFeature> features_;
+  size_t numFeatures_;
+  std::string propertyBuffer_;
+};
+
+/** A FlatGeobuf writer that writes to a std::ostream */
+using FeatureCollectionWriter = BasicFeatureCollectionWriter<StreamSink>;
+
+/** Writes a FlatGeobuf file of a collection to a stream
+ *
+ *  \tparam Callback    A callable of the form fgb::Feature(size_t index)
+ *  \param os           The stream to write to
+ *  \param numFeatures  The number of features in the collection
+ *  \param getFeature   Callback that takes the feature index and gives back
+ *                      the feature.
+ *  \param name         The name of the dataset in the header
+ *
+ *  \throws std::domain_error if a geometry is not valid GeoJSON
+ */
+template <typename Callback>
+void WriteFeatureCollection(std::ostream& os, size_t numFeatures,
+                            Callback&& getFeature,
+                            const std::string& name = std::string()) {
+  FeatureCollectionWriter writer(StreamSink(os), name);
+  for (size_t i = 0; i < numFeatures; i++) {
+    writer.Write(getFeature(i));
+  }
+  writer.Close();
+}
+}
+}
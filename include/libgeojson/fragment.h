@@ -0,0 +1,265 @@
+/** Pre-serialized fragments of features for libgeojson
+ *
+ *  Geometries and properties that are shared by many features, like the
+ *  boundaries of regions referenced by many records, can be serialized once
+ *  into a RawFragment, which the text encoders and the streaming writers
+ *  splice into each feature verbatim.
+ *
+ *  \file fragment.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "libgeojson/libgeojson.h"
+#include "libgeojson/text.h"
+
+namespace geojson {
+
+/** The serialized text of a JSON value, shared by its copies
+ *
+ *  Copying a fragment does not copy its text, so fragments can be kept in
+ *  caches and given to any number of features.
+ */
+class RawFragment {
+ public:
+  /** Constructs an empty fragment, which is written as null */
+  RawFragment() {}
+
+  /** Constructor (implicit, so JSON can be given where fragments are)
+   *
+   *  \param value  The value to serialize
+   */
+  RawFragment(const nlohmann::json& value) : RawFragment(value.dump(), 0) {}
+
+  /** \overload for other nlohmann::basic_json types, e.g. ArenaJson */
+  template <typename Json,
+            typename = typename std::enable_if<
+                nlohmann::detail::is_basic_json<Json>::value &&
+                !std::is_same<Json, nlohmann::json>::value>::type>
+  RawFragment(const Json& value) : RawFragment(value.dump(), 0) {}
+
+  /** Returns a fragment holding already serialized text, e.g. from the
+   *  encoders in geojson::text
+   *
+   *  \param text  The text of a single JSON value, which is not checked
+   */
+  static RawFragment FromText(std::string text) {
+    return RawFragment(std::move(text), 0);
+  }
+
+  /** Returns the text of the value */
+  const std::string& Text() const {
+    static const std::string kNull("null");
+    return data_ ? data_->text : kNull;
+  }
+
+  /** Returns whether the fragment has no value */
+  bool Empty() const { return !data_; }
+
+  /** Returns the offset of the bbox array that ends the text of a geometry
+   *  written by the encoders, so features can copy it
+   */
+  size_t BoundingBoxBegin() const { return data_ ? data_->bboxBegin : 0; }
+
+  /** Returns the length of the bbox array, or 0 if there is none */
+  size_t BoundingBoxSize() const { return data_ ? data_->bboxSize : 0; }
+
+  /** Returns whether two fragments share the same text in memory */
+  bool SharesText(const RawFragment& other) const {
+    return data_ == other.data_;
+  }
+
+ private:
+  struct Data {
+    std::string text;
+    size_t bboxBegin;
+    size_t bboxSize;
+  };
+
+  RawFragment(std::string text, int) : data_(MakeData(std::move(text))) {}
+
+  static std::shared_ptr<const Data> MakeData(std::string text) {
+    auto data = std::make_shared<Data>();
+    data->text = std::move(text);
+    data->bboxBegin = data->text.size();
+    data->bboxSize = 0;
+    if (text::detail::FindBoundingBox(data->text, data->bboxBegin)) {
+      data->bboxSize = data->text.size() - 1 - data->bboxBegin;
+    }
+    return data;
+  }
+
+  std::shared_ptr<const Data> data_;
+};
+
+namespace detail {
+
+/** Makes a fragment from what a cache's callback gives back */
+inline RawFragment ToFragment(RawFragment fragment) { return fragment; }
+inline RawFragment ToFragment(std::string text) {
+  return RawFragment::FromText(std::move(text));
+}
+template <typename Json,
+          typename = typename std::enable_if<
+              nlohmann::detail::is_basic_json<Json>::value>::type>
+RawFragment ToFragment(const Json& value) {
+  return RawFragment(value);
+}
+
+/** Appends the text of a Feature object made of fragments
+ *
+ *  \param out         The string to append to
+ *  \param idText      The serialized ID of the feature, or empty for none
+ *  \param geometry    The geometry of the feature
+ *  \param properties  The properties of the feature
+ */
+inline void AppendFeature(std::string& out, const std::string& idText,
+                          const RawFragment& geometry,
+                          const RawFragment& properties) {
+  text::detail::AppendFeatureText(out, idText, geometry.Text(),
+                                  geometry.BoundingBoxBegin(),
+                                  geometry.BoundingBoxSize(),
+                                  properties.Text());
+}
+}
+
+/** Caches the fragments of geometries or properties under the IDs that the
+ *  caller gives them, e.g. the IDs of the regions they are the boundaries of
+ *
+ *  A fragment is made by a callback the first time its ID is asked for.
+ *  Fragments with the same text, found by the hash of their text, share a
+ *  single copy of it, even when they have different IDs.
+ *
+ *  \tparam Key  The type of the IDs, which must be hashable
+ */
+template <typename Key = std::string>
+class BasicFragmentCache {
+ public:
+  /** Returns the fragment with an ID, making it if it is not cached
+   *
+   *  \tparam Callable  A callable of the form RawFragment(), which can also
+   *                    give back JSON or the text of a value as a std::string
+   *  \param id         The ID of the fragment
+   *  \param make       Callback that makes the fragment
+   *
+   *  \return The fragment, valid until the cache is cleared or destroyed
+   */
+  template <typename Callable>
+  const RawFragment& Get(const Key& id, Callable&& make) {
+    auto it = fragments_.find(id);
+    if (it != fragments_.end()) return it->second;
+
+    RawFragment fragment = detail::ToFragment(make());
+    size_t hash = std::hash<std::string>()(fragment.Text());
+    bool shared = false;
+    auto range = byHash_.equal_range(hash);
+    for (auto other = range.first; other != range.second && !shared; ++other) {
+      if (other->second.Text() == fragment.Text()) {
+        fragment = other->second;
+        shared = true;
+      }
+    }
+    if (!shared) byHash_.emplace(hash, fragment);
+    return fragments_.emplace(id, std::move(fragment)).first->second;
+  }
+
+  /** Returns whether a fragment with an ID is cached */
+  bool Contains(const Key& id) const {
+    return fragments_.find(id) != fragments_.end();
+  }
+
+  /** Returns the number of IDs with cached fragments */
+  size_t Size() const { return fragments_.size(); }
+
+  /** Returns the number of distinct texts of the cached fragments */
+  size_t NumDistinct() const { return byHash_.size(); }
+
+  /** Removes all of the fragments */
+  void Clear() {
+    fragments_.clear();
+    byHash_.clear();
+  }
+
+ private:
+  std::unordered_map<Key, RawFragment> fragments_;
+  std::unordered_multimap<size_t, RawFragment> byHash_;
+};
+
+/** A fragment cache with string IDs */
+using FragmentCache = BasicFragmentCache<std::string>;
+
+namespace text {
+
+/** Text version of geojson::Feature() (section 3.2), from fragments
+ *
+ *  \param geometry   The geometry of the feature, e.g. a cached fragment
+ *  \param properties The properties of the feature
+ *
+ *  \return The text of a GeoJSON Feature object
+ */
+inline std::string Feature(const RawFragment& geometry,
+                           const RawFragment& properties) {
+  std::string out;
+  geojson::detail::AppendFeature(out, std::string(), geometry, properties);
+  return out;
+}
+
+/** \overload */
+inline std::string Feature(const std::string& id, const RawFragment& geometry,
+                           const RawFragment& properties) {
+  std::string out;
+  geojson::detail::AppendFeature(out, nlohmann::json(id).dump(), geometry,
+                                 properties);
+  return out;
+}
+
+/** \overload */
+template <typename T, typename = typename std::enable_if<
+                          std::is_arithmetic<T>::value>::type>
+inline std::string Feature(T id, const RawFragment& geometry,
+                           const RawFragment& properties) {
+  std::string out;
+  geojson::detail::AppendFeature(out, nlohmann::json(id).dump(), geometry,
+                                 properties);
+  return out;
+}
+}
+
+/** Writes a feature made of fragments, which are spliced in verbatim, to a
+ *  writer of GeoJSON text
+ *
+ *  \tparam Writer     A writer with a member void WriteRaw(const std::string&),
+ *                     e.g. FeatureCollectionWriter or SequenceWriter
+ *  \param writer      The writer to write the feature to
+ *  \param geometry    The geometry of the feature, e.g. a cached fragment
+ *  \param properties  The properties of the feature
+ */
+template <typename Writer>
+void WriteFeature(Writer& writer, const RawFragment& geometry,
+                  const RawFragment& properties) {
+  detail::LibraryScope scope;
+  std::string text;
+  detail::AppendFeature(text, std::string(), geometry, properties);
+  writer.WriteRaw(text);
+}
+
+/** \overload with the ID of the feature */
+template <typename Writer>
+void WriteFeature(Writer& writer, const nlohmann::json& id,
+                  const RawFragment& geometry, const RawFragment& properties) {
+  detail::LibraryScope scope;
+  std::string text;
+  detail::AppendFeature(text, id.dump(), geometry, properties);
+  writer.WriteRaw(text);
+}
+}
@@ -0,0 +1,273 @@
+/** Opt-in instrumentation of the builders and writers
+ *
+ *  The library reports what it does through the static hooks of an
+ *  instrumentation policy, chosen at compile time by defining
+ *  LIBGEOJSON_INSTRUMENTATION to the policy type before libgeojson is
+ *  included, the same way in every translation unit, e.g.
+ *
+ *      -DLIBGEOJSON_INSTRUMENTATION=geojson::CountingInstrumentation
+ *
+ *  The default, geojson::NoInstrumentation, has empty inline hooks that
+ *  compile away. geojson::CountingInstrumentation keeps per-thread counters
+ *  that can be read for the calling thread or summed over all threads. A
+ *  policy of one's own needs the same static members as NoInstrumentation.
+ *
+ *  \file instrumentation.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace geojson {
+
+/** The instrumentation policy that does nothing */
+struct NoInstrumentation {
+  /** The given number of positions were written to a geometry */
+  static void OnVertices(size_t) {}
+
+  /** A ring was reversed to wind it as RFC 7946 asks */
+  static void OnRingReversed() {}
+
+  /** Bytes were written to one of the library's sinks */
+  static void OnBytesWritten(size_t) {}
+
+  /** The library allocated a buffer of the given size */
+  static void OnAllocation(size_t) {}
+
+  /** The library called, and returned from, a point callback */
+  static void OnCallbackBegin() {}
+  static void OnCallbackEnd() {}
+
+  /** The library began, and finished, writing positions or serializing */
+  static void OnLibraryBegin() {}
+  static void OnLibraryEnd() {}
+};
+
+/** Counters reported by CountingInstrumentation */
+struct Counters {
+  /** Positions written to geometries, including those closing rings */
+  uint64_t vertices = 0;
+
+  /** Rings reversed to wind them */
+  uint64_t ringsReversed = 0;
+
+  /** Bytes written to the library's sinks */
+  uint64_t bytesWritten = 0;
+
+  /** Buffers the library allocated itself, and their total size. Nodes of
+   *  JSON objects are allocated by the Json type and are not counted.
+   */
+  uint64_t allocations = 0;
+  uint64_t allocatedBytes = 0;
+
+  /** Nanoseconds spent in point callbacks */
+  uint64_t callbackNanos = 0;
+
+  /** Nanoseconds spent writing positions and serializing, outside of the
+   *  point callbacks
+   */
+  uint64_t libraryNanos = 0;
+
+  Counters& operator+=(const Counters& other) {
+    vertices += other.vertices;
+    ringsReversed += other.ringsReversed;
+    bytesWritten += other.bytesWritten;
+    allocations += other.allocations;
+    allocatedBytes += other.allocatedBytes;
+    callbackNanos += other.callbackNanos;
+    libraryNanos += other.libraryNanos;
+    return *this;
+  }
+
+  Counters& operator-=(const Counters& other) {
+    vertices -= other.vertices;
+    ringsReversed -= other.ringsReversed;
+    bytesWritten -= other.bytesWritten;
+    allocations -= other.allocations;
+    allocatedBytes -= other.allocatedBytes;
+    callbackNanos -= other.callbackNanos;
+    libraryNanos -= other.libraryNanos;
+    return *this;
+  }
+};
+
+inline Counters operator+(Counters a, const Counters& b) { return a += b; }
+inline Counters operator-(Counters a, const Counters& b) { return a -= b; }
+
+/** An instrumentation policy that counts into per-thread Counters
+ *
+ *  Each thread only writes its own counters, so counting is a relaxed load
+ *  and store without contention. The counters of a call are the difference
+ *  of ThreadCounters() before and after it, and TotalCounters() sums the
+ *  counters of every thread, including threads that have finished. Timing
+ *  reads the clock around every point callback, which costs tens of
+ *  nanoseconds a position.
+ */
+class CountingInstrumentation {
+ public:
+  static void OnVertices(size_t count) { Add(kVertices, count); }
+  static void OnRingReversed() { Add(kRingsReversed, 1); }
+  static void OnBytesWritten(size_t size) { Add(kBytesWritten, size); }
+
+  static void OnAllocation(size_t size) {
+    Add(kAllocations, 1);
+    Add(kAllocatedBytes, size);
+  }
+
+  static void OnCallbackBegin() { Local().callbackStart = Clock::now(); }
+
+  static void OnCallbackEnd() {
+    auto& slot = Local();
+    uint64_t nanos = Nanos(Clock::now() - slot.callbackStart);
+    slot.callbackNanos += nanos;
+    Add(kCallbackNanos, nanos);
+  }
+
+  static void OnLibraryBegin() {
+    auto& slot = Local();
+    if (slot.depth++ > 0) return;
+    slot.libraryStart = Clock::now();
+    slot.callbackNanosAtStart = slot.callbackNanos;
+  }
+
+  static void OnLibraryEnd() {
+    auto& slot = Local();
+    if (--slot.depth > 0) return;
+    uint64_t nanos = Nanos(Clock::now() - slot.libraryStart);
+    uint64_t callbacks = slot.callbackNanos - slot.callbackNanosAtStart;
+    Add(kLibraryNanos, nanos > callbacks ? nanos - callbacks : 0);
+  }
+
+  /** Returns the counters of the calling thread */
+  static Counters ThreadCounters() { return Local().Read(); }
+
+  /** Returns the counters summed over all threads */
+  static Counters TotalCounters() {
+    auto& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    Counters total = registry.finished;
+    for (const Slot* slot : registry.slots) total += slot->Read();
+    return total;
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  enum Counter {
+    kVertices,
+    kRingsReversed,
+    kBytesWritten,
+    kAllocations,
+    kAllocatedBytes,
+    kCallbackNanos,
+    kLibraryNanos,
+    kNumCounters
+  };
+
+  struct Slot;
+
+  struct Registry {
+    std::mutex mutex;
+    std::vector<const Slot*> slots;
+    Counters finished;
+  };
+
+  /** The counters of one thread, which only it writes */
+  struct Slot {
+    Slot() : depth(0), callbackNanos(0), callbackNanosAtStart(0) {
+      for (auto& value : values) value.store(0, std::memory_order_relaxed);
+      auto& registry = GetRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      registry.slots.push_back(this);
+    }
+
+    ~Slot() {
+      auto& registry = GetRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      registry.finished += Read();
+      for (size_t i = 0; i < registry.slots.size(); i++) {
+        if (registry.slots[i] == this) {
+          registry.slots[i] = registry.slots.back();
+          registry.slots.pop_back();
+          break;
+        }
+      }
+    }
+
+    Counters Read() const {
+      Counters c;
+      c.vertices = Value(kVertices);
+      c.ringsReversed = Value(kRingsReversed);
+      c.bytesWritten = Value(kBytesWritten);
+      c.allocations = Value(kAllocations);
+      c.allocatedBytes = Value(kAllocatedBytes);
+      c.callbackNanos = Value(kCallbackNanos);
+      c.libraryNanos = Value(kLibraryNanos);
+      return c;
+    }
+
+    uint64_t Value(Counter counter) const {
+      return values[counter].load(std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> values[kNumCounters];
+    int depth;
+    Clock::time_point libraryStart;
+    Clock::time_point callbackStart;
+    uint64_t callbackNanos;
+    uint64_t callbackNanosAtStart;
+  };
+
+  static Registry& GetRegistry() {
+    static Registry registry;
+    return registry;
+  }
+
+  static Slot& Local() {
+    static thread_local Slot slot;
+    return slot;
+  }
+
+  static void Add(Counter counter, uint64_t amount) {
+    auto& value = Local().values[counter];
+    value.store(value.load(std::memory_order_relaxed) + amount,
+                std::memory_order_relaxed);
+  }
+
+  static uint64_t Nanos(Clock::duration duration) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+            .count());
+  }
+};
+
+#ifndef LIBGEOJSON_INSTRUMENTATION
+#define LIBGEOJSON_INSTRUMENTATION ::geojson::NoInstrumentation
+#endif
+
+namespace detail {
+
+/** The instrumentation policy the library was compiled with */
+using Instrument = LIBGEOJSON_INSTRUMENTATION;
+
+/** Reports the time spent in a point callback, while in scope */
+struct CallbackScope {
+  CallbackScope() { Instrument::OnCallbackBegin(); }
+  ~CallbackScope() { Instrument::OnCallbackEnd(); }
+};
+
+/** Reports the time spent in library code, while in scope */
+struct LibraryScope {
+  LibraryScope() { Instrument::OnLibraryBegin(); }
+  ~LibraryScope() { Instrument::OnLibraryEnd(); }
+};
+}
+}
@@ -7,12 +7,27 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <functional>
+#include <iterator>
+#include <limits>
+#include <set>
 #include <stdexcept>
+#include <string>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <nlohmann/json.hpp>
 
+#include "instrumentation.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace geojson {
 
 enum class Type {
@@ -75,68 +90,713 @@ const char* TypeName() {
   return TypeName(G);
 }
 
+/** The bounds (section 5) of a set of positions
+ *
+ *  The box has altitude bounds only if every position added to it had an
+ *  altitude. Coordinates that are NaN are ignored.
+ */
+class BoundingBox {
+ public:
+  /** Constructor, makes an empty box */
+  BoundingBox()
+      : min_{kInfinity, kInfinity, kInfinity},
+        max_{-kInfinity, -kInfinity, -kInfinity}, hasAltitude_(true) {}
+
+  /** Returns a box with the given corners */
+  static BoundingBox FromCorners(double minLon, double minLat, double maxLon,
+                                 double maxLat) {
+    BoundingBox bounds;
+    bounds.Extend(minLon, minLat);
+    bounds.Extend(maxLon, maxLat);
+    return bounds;
+  }
+
+  /** \overload */
+  static BoundingBox FromCorners(double minLon, double minLat, double minAlt,
+                                 double maxLon, double maxLat, double maxAlt) {
+    BoundingBox bounds;
+    bounds.Extend(minLon, minLat, minAlt);
+    bounds.Extend(maxLon, maxLat, maxAlt);
+    return bounds;
+  }
+
+  /** Grows the box to hold a position */
+  void Extend(double lon, double lat) {
+    ExtendAxis(0, lon);
+    ExtendAxis(1, lat);
+    hasAltitude_ = false;
+  }
+
+  /** \overload */
+  void Extend(double lon, double lat, double alt) {
+    ExtendAxis(0, lon);
+    ExtendAxis(1, lat);
+    ExtendAxis(2, alt);
+  }
+
+  /** Grows the box to hold another box */
+  void Extend(const BoundingBox& other) {
+    if (other.Empty()) return;
+    for (int axis = 0; axis < 3; axis++) {
+      ExtendAxis(axis, other.min_[axis]);
+      ExtendAxis(axis, other.max_[axis]);
+    }
+    hasAltitude_ = hasAltitude_ && other.hasAltitude_;
+  }
+
+  /** Returns whether no positions have been added */
+  bool Empty() const { return !(min_[0] <= max_[0] && min_[1] <= max_[1]); }
+
+  /** Returns whether the box has altitude bounds */
+  bool HasAltitude() const {
+    return !Empty() && hasAltitude_ && min_[2] <= max_[2];
+  }
+
+  double MinLon() const { return min_[0]; }
+  double MinLat() const { return min_[1]; }
+  double MinAlt() const { return min_[2]; }
+  double MaxLon() const { return max_[0]; }
+  double MaxLat() const { return max_[1]; }
+  double MaxAlt() const { return max_[2]; }
+
+  /** Returns the number of values in the bbox member, 0, 4 or 6 */
+  size_t NumValues() const { return Empty() ? 0 : HasAltitude() ? 6 : 4; }
+
+  /** Returns the i'th value of the bbox member, all of the minimums followed
+   *  by all of the maximums
+   */
+  double Value(size_t i) const {
+    size_t dims = NumValues() / 2;
+    return i < dims ? min_[i] : max_[i - dims];
+  }
+
+  /** Returns the bbox member of a GeoJSON object */
+  template <typename Json = nlohmann::json>
+  Json ToJson() const {
+    auto j = Json::array();
+    for (size_t i = 0; i < NumValues(); i++) j.push_back(Value(i));
+    return j;
+  }
+
+  /** Returns the bounds given by the bbox member of a GeoJSON object
+   *
+   *  \throws std::domain_error if the value is not an array of 4 or 6 numbers
+   */
+  template <typename Json>
+  static BoundingBox FromJson(const Json& bbox) {
+    if (!bbox.is_array() || (bbox.size() != 4 && bbox.size() != 6)) {
+      throw std::domain_error("bbox must be an array of 4 or 6 numbers");
+    }
+    for (const auto& value : bbox) {
+      if (!value.is_number()) {
+        throw std::domain_error("bbox must be an array of 4 or 6 numbers");
+      }
+    }
+    auto v = [&](size_t i) { return bbox[i].template get<double>(); };
+    return bbox.size() == 4
+               ? FromCorners(v(0), v(1), v(2), v(3))
+               : FromCorners(v(0), v(1), v(2), v(3), v(4), v(5));
+  }
+
+ private:
+  static constexpr double kInfinity = std::numeric_limits<double>::infinity();
+
+  void ExtendAxis(int axis, double value) {
+    if (value < min_[axis]) min_[axis] = value;
+    if (value > max_[axis]) max_[axis] = value;
+  }
+
+  double min_[3];
+  double max_[3];
+  bool hasAltitude_;
+};
+
+/** Thrown when the positions of a line or ring fail a check of a Validation
+ */
+class ValidationError : public std::domain_error {
+ public:
+  /** Constructor
+   *
+   *  \param message  What is wrong with the positions
+   *  \param index    The index of the offending position, in the order the
+   *                  positions were given
+   */
+  ValidationError(const std::string& message, size_t index)
+      : std::domain_error(message), index_(index) {}
+
+  /** Returns the index of the offending position in the line or ring */
+  size_t Index() const { return index_; }
+
+ private:
+  size_t index_;
+};
+
+/** Controls how the positions of lines and rings are checked as they are
+ *  encoded
+ *
+ *  Basic() checks each position as it is read from the callbacks or spans,
+ *  at a constant cost a position: every coordinate is finite, longitudes are
+ *  in [-180, 180] and latitudes in [-90, 90], no position repeats the one
+ *  before it, and rings do not repeat their first position at the end, as
+ *  they are given open. Positions are compared as the format rounds them.
+ *
+ *  WithSelfIntersections() also sweeps each line and ring for segments that
+ *  cross or touch, other than neighbors sharing their end, in O(n log n).
+ *  WithRepair() drops positions that are not finite or repeat the one before
+ *  them, and wraps longitudes into [-180, 180], rather than failing. Both
+ *  read the line or ring into a buffer first, as simplifying does.
+ *
+ *  A failed check throws a ValidationError out of the builder or encoder of
+ *  the geometry, so nothing of it reaches a writer.
+ */
+class Validation {
+ public:
+  /** Constructor, checks nothing */
+  Validation() : positions_(false), selfIntersections_(false), repair_(false) {}
+
+  /** Returns a validation with the checks of each position */
+  static Validation Basic() {
+    Validation validation;
+    validation.positions_ = true;
+    return validation;
+  }
+
+  /** Returns a copy of this validation that sweeps for self-intersections,
+   *  or does not
+   */
+  Validation WithSelfIntersections(bool enable = true) const {
+    Validation validation(*this);
+    validation.selfIntersections_ = enable;
+    return validation;
+  }
+
+  /** Returns a copy of this validation that repairs the positions it can,
+   *  or does not, checking each position either way
+   */
+  Validation WithRepair(bool enable = true) const {
+    Validation validation(*this);
+    validation.positions_ = validation.positions_ || enable;
+    validation.repair_ = enable;
+    return validation;
+  }
+
+  /** Returns whether each position is checked */
+  bool ChecksPositions() const { return positions_; }
+
+  /** Returns whether lines and rings are swept for self-intersections */
+  bool ChecksSelfIntersections() const { return selfIntersections_; }
+
+  /** Returns whether positions are repaired rather than failing */
+  bool Repairs() const { return repair_; }
+
+ private:
+  bool positions_;
+  bool selfIntersections_;
+  bool repair_;
+};
+
+/** Controls how the coordinates of positions are encoded
+ *
+ *  By default, coordinates are kept at full precision and serialized with the
+ *  shortest text that round-trips to the same double. Fixed(n) rounds
+ *  coordinates to n decimal places (6 is about 10 cm), which makes the output
+ *  smaller and lets the text encoders use a much faster integer formatter.
+ *
+ *  WithBoundingBoxes() also gives each geometry a bbox member (section 5),
+ *  found as its positions are written rather than by another pass over them.
+ *
+ *  WithSimplification() drops the positions of lines and rings that are
+ *  within a tolerance of the simplified shape (Douglas-Peucker), so the size
+ *  of the output follows the resolution asked for rather than the resolution
+ *  of the source.
+ *
+ *  WithValidation() checks the positions of lines and rings as they are
+ *  encoded, and repairs them if asked to (see Validation).
+ */
+class CoordinateFormat {
+ public:
+  /** Constructor, keeps coordinates at full precision */
+  CoordinateFormat()
+      : decimals_(-1), scale_(1), tolerance_(0), boundingBoxes_(false) {}
+
+  /** Returns a format that rounds coordinates to a number of decimal places
+   *
+   *  \param decimals  The number of decimal places in [0, 15]
+   */
+  static CoordinateFormat Fixed(int decimals) {
+    if (decimals < 0 || decimals > kMaxDecimals) {
+      throw std::domain_error("Coordinate precision must be in [0, 15]");
+    }
+    return CoordinateFormat(decimals);
+  }
+
+  /** Returns a copy of this format that gives geometries bbox members, or
+   *  does not
+   */
+  CoordinateFormat WithBoundingBoxes(bool enable = true) const {
+    CoordinateFormat format(*this);
+    format.boundingBoxes_ = enable;
+    return format;
+  }
+
+  /** Returns whether geometries are given bbox members */
+  bool HasBoundingBoxes() const { return boundingBoxes_; }
+
+  /** Returns a copy of this format that simplifies lines and rings
+   *
+   *  Positions within the tolerance of the line between the positions kept
+   *  around them are dropped, measured in longitude and latitude. The ends of
+   *  lines are always kept, and rings keep at least 3 positions and their
+   *  winding order.
+   *
+   *  \param tolerance  The distance in decimal degrees, 0 not simplifying
+   */
+  CoordinateFormat WithSimplification(double tolerance) const {
+    if (!(tolerance >= 0) || std::isinf(tolerance)) {
+      throw std::domain_error("Simplification tolerance must be finite and "
+                              "non-negative");
+    }
+    CoordinateFormat format(*this);
+    format.tolerance_ = tolerance;
+    return format;
+  }
+
+  /** Returns whether lines and rings are simplified */
+  bool IsSimplified() const { return tolerance_ > 0; }
+
+  /** Returns the simplification tolerance in decimal degrees, or 0 */
+  double SimplificationTolerance() const { return tolerance_; }
+
+  /** Returns a copy of this format that checks lines and rings as given
+   *
+   *  \param validation  The checks, Validation() checking nothing
+   */
+  CoordinateFormat WithValidation(const Validation& validation) const {
+    CoordinateFormat format(*this);
+    format.validation_ = validation;
+    return format;
+  }
+
+  /** Returns how lines and rings are checked */
+  const Validation& Checks() const { return validation_; }
+
+  /** Returns the bounds with their corners rounded as the coordinates are,
+   *  which bound the rounded positions
+   */
+  BoundingBox Round(const BoundingBox& bounds) const {
+    if (!IsFixed() || bounds.Empty()) return bounds;
+    return bounds.HasAltitude()
+               ? BoundingBox::FromCorners(
+                     Round(bounds.MinLon()), Round(bounds.MinLat()),
+                     Round(bounds.MinAlt()), Round(bounds.MaxLon()),
+                     Round(bounds.MaxLat()), Round(bounds.MaxAlt()))
+               : BoundingBox::FromCorners(
+                     Round(bounds.MinLon()), Round(bounds.MinLat()),
+                     Round(bounds.MaxLon()), Round(bounds.MaxLat()));
+  }
+
+  /** Returns whether coordinates are rounded to a fixed number of decimals */
+  bool IsFixed() const { return decimals_ >= 0; }
+
+  /** Returns the number of decimal places, or -1 for full precision */
+  int Decimals() const { return decimals_; }
+
+  /** Returns 10^Decimals() */
+  double Scale() const { return scale_; }
+
+  /** Rounds the value to the number of decimal places of this format
+   *
+   *  Values that are not finite or too large to be rounded exactly are
+   *  returned unchanged.
+   */
+  double Round(double value) const {
+    if (!IsFixed()) return value;
+    double scaled = value * scale_;
+    if (!(std::fabs(scaled) < kMaxExactInteger)) return value;
+    return std::round(scaled) / scale_;
+  }
+
+  /** The largest magnitude integer that a double can hold exactly */
+  static constexpr double kMaxExactInteger = 9007199254740992.0;
+
+ private:
+  static constexpr int kMaxDecimals = 15;
+
+  explicit CoordinateFormat(int decimals)
+      : decimals_(decimals), scale_(std::pow(10.0, decimals)), tolerance_(0),
+        boundingBoxes_(false) {}
+
+  int decimals_;
+  double scale_;
+  double tolerance_;
+  bool boundingBoxes_;
+  Validation validation_;
+};
+
 /** Returns a position array (section 3.1.1)
  *
- *  \param lon  The longitude in decimal degrees
- *  \param lat  The latitude in decimal degrees
- *  \param alt  The altitude in WGS84 ellipsoidal meters
+ *  \param lon     The longitude in decimal degrees
+ *  \param lat     The latitude in decimal degrees
+ *  \param alt     The altitude in WGS84 ellipsoidal meters
+ *  \param format  How the coordinates are encoded
  *
  *  \return A JSON array with the position
  */
-inline nlohmann::json Position(double lon, double lat, double alt) {
-  return nlohmann::json::array({lon, lat, alt});
+template <typename Json = nlohmann::json>
+Json Position(double lon, double lat, double alt,
+              const CoordinateFormat& format = CoordinateFormat()) {
+  detail::Instrument::OnVertices(1);
+  return Json::array({format.Round(lon), format.Round(lat), format.Round(alt)});
 }
 
 /** \overload */
-inline nlohmann::json Position(double lon, double lat) {
-  return nlohmann::json::array({lon, lat});
+template <typename Json = nlohmann::json>
+Json Position(double lon, double lat,
+              const CoordinateFormat& format = CoordinateFormat()) {
+  detail::Instrument::OnVertices(1);
+  return Json::array({format.Round(lon), format.Round(lat)});
 }
 
+/** A view of positions held in contiguous memory
+ *
+ *  The positions can either be interleaved in a single array, where each
+ *  position starts a fixed stride after the previous one, or held in separate
+ *  longitude, latitude and (optional) altitude arrays. The view does not own
+ *  the memory, which must outlive it.
+ */
+class PositionSpan {
+ public:
+  /** Returns a view of interleaved [lon, lat(, alt)] positions
+   *
+   *  \param data       Pointer to the longitude of the first position
+   *  \param numPoints  The number of positions
+   *  \param dims       The number of coordinates in each position, 2 or 3
+   *  \param stride     The number of doubles from the start of one position to
+   *                    the next, 0 meaning dims
+   */
+  static PositionSpan Interleaved(const double* data, size_t numPoints,
+                                  size_t dims, size_t stride = 0) {
+    if (dims != 2 && dims != 3) {
+      throw std::domain_error("Positions must have 2 or 3 coordinates");
+    }
+    if (stride == 0) stride = dims;
+    if (stride < dims) {
+      throw std::domain_error("Position stride is smaller than its size");
+    }
+    return PositionSpan(data, data + 1, dims == 3 ? data + 2 : nullptr,
+                        numPoints, stride);
+  }
+
+  /** Returns a view of positions held in separate coordinate arrays
+   *
+   *  \param lon        The longitudes in decimal degrees
+   *  \param lat        The latitudes in decimal degrees
+   *  \param alt        The altitudes in WGS84 ellipsoidal meters
+   *  \param numPoints  The number of positions
+   */
+  static PositionSpan Separate(const double* lon, const double* lat,
+                               const double* alt, size_t numPoints) {
+    return PositionSpan(lon, lat, alt, numPoints, 1);
+  }
+
+  /** \overload */
+  static PositionSpan Separate(const double* lon, const double* lat,
+                               size_t numPoints) {
+    return PositionSpan(lon, lat, nullptr, numPoints, 1);
+  }
+
+  /** Returns the number of positions */
+  size_t Size() const { return size_; }
+
+  /** Returns whether the positions have altitudes */
+  bool HasAltitude() const { return alt_ != nullptr; }
+
+  /** Returns the longitude of the i'th position */
+  double Lon(size_t i) const { return lon_[i * stride_]; }
+
+  /** Returns the latitude of the i'th position */
+  double Lat(size_t i) const { return lat_[i * stride_]; }
+
+  /** Returns the altitude of the i'th position, must have altitudes */
+  double Alt(size_t i) const { return alt_[i * stride_]; }
+
+  /** Returns a view of the positions in [begin, end) */
+  PositionSpan Slice(size_t begin, size_t end) const {
+    if (begin > end || end > size_) {
+      throw std::out_of_range("Position range is outside of the span");
+    }
+    size_t offset = begin * stride_;
+    return PositionSpan(lon_ + offset, lat_ + offset,
+                        alt_ ? alt_ + offset : nullptr, end - begin, stride_);
+  }
+
+  /** Returns the bounds of the positions
+   *
+   *  With SSE2, interleaved longitudes and latitudes are bounded together in
+   *  one vector, and separate arrays two positions at a time.
+   */
+  BoundingBox Bounds() const {
+    static constexpr double kInf = std::numeric_limits<double>::infinity();
+    double minLon = kInf, minLat = kInf, minAlt = kInf;
+    double maxLon = -kInf, maxLat = -kInf, maxAlt = -kInf;
+    size_t i = 0;
+#ifdef __SSE2__
+    // The new value goes first, as the second operand is kept when either is
+    // NaN, so NaN coordinates are skipped as in the scalar loop
+    if (lat_ == lon_ + 1) {
+      __m128d lo0 = _mm_set1_pd(kInf), lo1 = lo0;
+      __m128d hi0 = _mm_set1_pd(-kInf), hi1 = hi0;
+      for (; i + 2 <= size_; i += 2) {
+        __m128d a = _mm_loadu_pd(lon_ + i * stride_);
+        __m128d b = _mm_loadu_pd(lon_ + (i + 1) * stride_);
+        lo0 = _mm_min_pd(a, lo0);
+        hi0 = _mm_max_pd(a, hi0);
+        lo1 = _mm_min_pd(b, lo1);
+        hi1 = _mm_max_pd(b, hi1);
+      }
+      double lo[2], hi[2];
+      _mm_storeu_pd(lo, _mm_min_pd(lo1, lo0));
+      _mm_storeu_pd(hi, _mm_max_pd(hi1, hi0));
+      minLon = lo[0];
+      minLat = lo[1];
+      maxLon = hi[0];
+      maxLat = hi[1];
+    } else if (stride_ == 1) {
+      __m128d loLon = _mm_set1_pd(kInf), loLat = loLon;
+      __m128d hiLon = _mm_set1_pd(-kInf), hiLat = hiLon;
+      for (; i + 2 <= size_; i += 2) {
+        __m128d lon = _mm_loadu_pd(lon_ + i);
+        __m128d lat = _mm_loadu_pd(lat_ + i);
+        loLon = _mm_min_pd(lon, loLon);
+        hiLon = _mm_max_pd(lon, hiLon);
+        loLat = _mm_min_pd(lat, loLat);
+        hiLat = _mm_max_pd(lat, hiLat);
+      }
+      double lo[2], hi[2];
+      _mm_storeu_pd(lo, loLon);
+      _mm_storeu_pd(hi, hiLon);
+      minLon = std::min(lo[0], lo[1]);
+      maxLon = std::max(hi[0], hi[1]);
+      _mm_storeu_pd(lo, loLat);
+      _mm_storeu_pd(hi, hiLat);
+      minLat = std::min(lo[0], lo[1]);
+      maxLat = std::max(hi[0], hi[1]);
+    }
+#endif
+    for (; i < size_; i++) {
+      double lon = Lon(i), lat = Lat(i);
+      if (lon < minLon) minLon = lon;
+      if (lon > maxLon) maxLon = lon;
+      if (lat < minLat) minLat = lat;
+      if (lat > maxLat) maxLat = lat;
+    }
+    if (!(minLon <= maxLon && minLat <= maxLat)) return BoundingBox();
+    if (alt_) {
+      for (i = 0; i < size_; i++) {
+        double alt = Alt(i);
+        if (alt < minAlt) minAlt = alt;
+        if (alt > maxAlt) maxAlt = alt;
+      }
+    }
+    if (!(minAlt <= maxAlt)) {
+      return BoundingBox::FromCorners(minLon, minLat, maxLon, maxLat);
+    }
+    return BoundingBox::FromCorners(minLon, minLat, minAlt, maxLon, maxLat,
+                                    maxAlt);
+  }
+
+ private:
+  PositionSpan(const double* lon, const double* lat, const double* alt,
+               size_t size, size_t stride)
+      : lon_(lon), lat_(lat), alt_(alt), size_(size), stride_(stride) {}
+
+  const double* lon_;
+  const double* lat_;
+  const double* alt_;
+  size_t size_;
+  size_t stride_;
+};
+
 namespace detail {
 
 /** Returns the coordinates array of a Point object (section 3.1.2)
  *
- *  \param lon  The longitude in decimal degrees
- *  \param lat  The latitude in decimal degrees
- *  \param alt  The altitude in WGS84 ellipsoidal meters
+ *  \param lon     The longitude in decimal degrees
+ *  \param lat     The latitude in decimal degrees
+ *  \param alt     The altitude in WGS84 ellipsoidal meters
+ *  \param format  How the coordinates are encoded
  *
  *  \return A JSON array that can go into the coordinates property of a Point
  *          object
  */
-inline nlohmann::json PointCoordinates(double lon, double lat, double alt) {
-  return Position(lon, lat, alt);
+template <typename Json = nlohmann::json>
+Json PointCoordinates(double lon, double lat, double alt,
+                      const CoordinateFormat& format = CoordinateFormat()) {
+  return Position<Json>(lon, lat, alt, format);
 }
 
 /** \overload */
-inline nlohmann::json PointCoordinates(double lon, double lat) {
-  return Position(lon, lat);
+template <typename Json = nlohmann::json>
+Json PointCoordinates(double lon, double lat,
+                      const CoordinateFormat& format = CoordinateFormat()) {
+  return Position<Json>(lon, lat, format);
+}
+
+/** Makes a function parameter a non-deduced context */
+template <typename T>
+struct Identity {
+  using type = T;
+};
+
+/** Returns an empty JSON array with room for the given number of elements */
+template <typename Json = nlohmann::json>
+Json ReservedArray(size_t capacity) {
+  auto array = Json::array();
+  array.template get_ref<typename Json::array_t&>().reserve(capacity);
+  if (capacity > 0) Instrument::OnAllocation(capacity * sizeof(Json));
+  return array;
 }
 
 /** Returns a GeoJSON object, with a "type" and "coordinates" object */
-template <Type T>
-inline nlohmann::json CoordinatesObject(nlohmann::json&& coords) {
-  return nlohmann::json{{"type", TypeName<T>()},
-                        {"coordinates", std::move(coords)}};
+template <Type T, typename Json = nlohmann::json>
+Json CoordinatesObject(typename Identity<Json>::type&& coords) {
+  return Json{{"type", TypeName<T>()}, {"coordinates", std::move(coords)}};
+}
+
+/** \overload with a "bbox" member, unless the bounds are empty */
+template <Type T, typename Json = nlohmann::json>
+Json CoordinatesObject(typename Identity<Json>::type&& coords,
+                       const BoundingBox& bounds) {
+  auto j = CoordinatesObject<T, Json>(std::move(coords));
+  if (!bounds.Empty()) j["bbox"] = bounds.template ToJson<Json>();
+  return j;
+}
+
+/** Extends the bounds by the positions of a coordinates array of any depth,
+ *  which are read back as they were encoded, i.e. rounded and only those
+ *  kept by simplifying or repairing
+ */
+template <typename Json>
+void ExtendByCoordinates(BoundingBox& bounds, const Json& coords) {
+  if (coords.empty()) return;
+  if (!coords[0].is_number()) {
+    for (const auto& child : coords) ExtendByCoordinates(bounds, child);
+  } else if (coords.size() >= 3) {
+    bounds.Extend(coords[0].template get<double>(),
+                  coords[1].template get<double>(),
+                  coords[2].template get<double>());
+  } else {
+    bounds.Extend(coords[0].template get<double>(),
+                  coords[1].template get<double>());
+  }
+}
+
+/** Returns the bounds of the positions of a coordinates array */
+template <typename Json>
+BoundingBox CoordinatesBounds(const Json& coords) {
+  BoundingBox bounds;
+  ExtendByCoordinates(bounds, coords);
+  return bounds;
+}
+
+/** Returns a GeoJSON object with the coordinates returned by
+ *  makeCoordinates(format), with the bounds of those coordinates if the
+ *  format asks for bounding boxes
+ */
+template <Type T, typename Json, typename MakeCoordinates>
+Json BoundedCoordinatesObject(const CoordinateFormat& format,
+                              MakeCoordinates&& makeCoordinates) {
+  Json coords = makeCoordinates(format);
+  if (!format.HasBoundingBoxes()) {
+    return CoordinatesObject<T, Json>(std::move(coords));
+  }
+  auto bounds = CoordinatesBounds(coords);
+  return CoordinatesObject<T, Json>(std::move(coords), bounds);
+}
+
+/** Returns whether lines and rings are encoded from other positions than
+ *  those given, as they are simplified or repaired
+ */
+inline bool RewritesPositions(const CoordinateFormat& format) {
+  return format.IsSimplified() || format.Checks().Repairs();
+}
+
+/** Returns whether lines and rings are read into a buffer to be prepared
+ *  before they are encoded, rather than checked as they are read
+ */
+inline bool BuffersPositions(const CoordinateFormat& format) {
+  return RewritesPositions(format) ||
+         format.Checks().ChecksSelfIntersections();
+}
+
+/** Returns a GeoJSON object with coordinates made from positions held in
+ *  contiguous memory
+ *
+ *  Simplified or repaired positions are bounded from the coordinates, as
+ *  only the kept ones are in the bbox, and the others in one pass over the
+ *  memory.
+ */
+template <Type T, typename Json>
+Json SpanCoordinatesObject(typename Identity<Json>::type&& coords,
+                           const PositionSpan& positions,
+                           const CoordinateFormat& format) {
+  if (!format.HasBoundingBoxes()) {
+    return CoordinatesObject<T, Json>(std::move(coords));
+  }
+  if (RewritesPositions(format)) {
+    auto bounds = CoordinatesBounds(coords);
+    return CoordinatesObject<T, Json>(std::move(coords), bounds);
+  }
+  return CoordinatesObject<T, Json>(std::move(coords),
+                                    format.Round(positions.Bounds()));
+}
+
+/** Returns the positions indexed by an offsets array with count + 1 entries
+ */
+inline PositionSpan OffsetPositions(const PositionSpan& positions,
+                                    const size_t* offsets, size_t count) {
+  return positions.Slice(offsets[0], offsets[count]);
+}
+
+/** Adds the bbox member of a GeoJSON object to the bounds
+ *
+ *  \return Whether the object has a bbox member
+ */
+template <typename Json>
+bool ExtendBounds(BoundingBox& bounds, const Json& object) {
+  auto it = object.find("bbox");
+  if (it == object.end()) return false;
+  bounds.Extend(BoundingBox::FromJson(*it));
+  return true;
 }
 }
 
 /** Returns a GeoJSON Point object (section 3.1.2)
  *
- *  \param lon  The longitude in decimal degrees
- *  \param lat  The latitude in decimal degrees
- *  \param alt  The altitude in WGS84 ellipsoidal meters
+ *  \param lon     The longitude in decimal degrees
+ *  \param lat     The latitude in decimal degrees
+ *  \param alt     The altitude in WGS84 ellipsoidal meters
+ *  \param format  How the coordinates are encoded
  *
  *  \return A GeoJSON Point object
  */
-inline nlohmann::json Point(double lon, double lat, double alt) {
-  return detail::CoordinatesObject<Type::Point>(
-      detail::PointCoordinates(lon, lat, alt));
+template <typename Json = nlohmann::json>
+Json Point(double lon, double lat, double alt,
+           const CoordinateFormat& format = CoordinateFormat()) {
+  return detail::BoundedCoordinatesObject<Type::Point, Json>(
+      format, [&](const CoordinateFormat& f) {
+        return detail::PointCoordinates<Json>(lon, lat, alt, f);
+      });
 }
 
 /** \overload */
-inline nlohmann::json Point(double lon, double lat) {
-  return detail::CoordinatesObject<Type::Point>(
-      detail::PointCoordinates(lon, lat));
+template <typename Json = nlohmann::json>
+Json Point(double lon, double lat,
+           const CoordinateFormat& format = CoordinateFormat()) {
+  return detail::BoundedCoordinatesObject<Type::Point, Json>(
+      format, [&](const CoordinateFormat& f) {
+        return detail::PointCoordinates<Json>(lon, lat, f);
+      });
 }
 
 namespace detail {
@@ -176,43 +836,285 @@ using IsCallbackSignature = typename std::enable_if<
     std::is_same<typename detail::invoke_result<F, Args...>::type, R>::value,
     bool>::type;
 
+/** Selects the kernel for positions with Dims coordinates at compile time,
+ *  2 for [lon, lat] or 3 for [lon, lat, alt]
+ *
+ *  The builders and writers are written once over the dimension, so each
+ *  instantiation reads and writes a fixed number of coordinates without
+ *  branching on it per position.
+ */
+template <int Dims>
+using Dimension = std::integral_constant<int, Dims>;
+
+/** Returns the number of coordinates in the positions of a point callback
+ *  that takes the given index arguments before the coordinates
+ */
+template <typename Callable, typename... Indices>
+constexpr int CallbackDims() {
+  return is_invocable_r<void, Callable, Indices..., double&, double&,
+                        double&>::value
+             ? 3
+             : 2;
+}
+
+/** The Dimension of the positions of a point callback */
+template <typename Callable, typename... Indices>
+using CallbackDimension = Dimension<CallbackDims<Callable, Indices...>()>;
+
+/** Enables an overload for point callbacks that take the given index
+ *  arguments before either 2 or 3 coordinates
+ */
+template <typename Callable, typename... Indices>
+using IsPointCallback = typename std::enable_if<
+    is_invocable_r<void, Callable, Indices..., double&, double&,
+                   double&>::value ||
+        is_invocable_r<void, Callable, Indices..., double&, double&>::value,
+    bool>::type;
+
+/** A point callback that reads the positions of a span, so the kernels also
+ *  serve positions held in contiguous memory
+ */
+class SpanPoints {
+ public:
+  explicit SpanPoints(const PositionSpan& positions)
+      : positions_(&positions) {}
+
+  void operator()(size_t i, double& lon, double& lat) const {
+    lon = positions_->Lon(i);
+    lat = positions_->Lat(i);
+  }
+
+  void operator()(size_t i, double& lon, double& lat, double& alt) const {
+    lon = positions_->Lon(i);
+    lat = positions_->Lat(i);
+    alt = positions_->Alt(i);
+  }
+
+ private:
+  const PositionSpan* positions_;
+};
+
+/** Enables the overloads of ReadPoint() for callbacks, which are timed as
+ *  callbacks, rather than for spans
+ */
+template <typename GetPoint>
+using IsNotSpanPoints = typename std::enable_if<
+    !std::is_same<typename std::decay<GetPoint>::type, SpanPoints>::value,
+    bool>::type;
+
+/** Reads a position through a point callback
+ *
+ *  \param pos       Set to the Dims coordinates of the position
+ *  \param getPoint  The callback
+ *  \param indices   The indices of the position, given to the callback
+ */
+template <typename GetPoint, IsNotSpanPoints<GetPoint> = true,
+          typename... Indices>
+void ReadPoint(Dimension<2>, double* pos, GetPoint& getPoint,
+               Indices... indices) {
+  CallbackScope scope;
+  getPoint(indices..., pos[0], pos[1]);
+}
+
+/** \overload */
+template <typename GetPoint, IsNotSpanPoints<GetPoint> = true,
+          typename... Indices>
+void ReadPoint(Dimension<3>, double* pos, GetPoint& getPoint,
+               Indices... indices) {
+  CallbackScope scope;
+  getPoint(indices..., pos[0], pos[1], pos[2]);
+}
+
+/** \overload for a span, which is read by library code, not a callback */
+inline void ReadPoint(Dimension<2>, double* pos, const SpanPoints& points,
+                      size_t i) {
+  points(i, pos[0], pos[1]);
+}
+
+/** \overload */
+inline void ReadPoint(Dimension<3>, double* pos, const SpanPoints& points,
+                      size_t i) {
+  points(i, pos[0], pos[1], pos[2]);
+}
+
+/** Throws a ValidationError for a position of a line or ring
+ *
+ *  \param index    The index of the position
+ *  \param ring     Whether the position is of a ring
+ *  \param problem  What is wrong with it, following "Position i of a ring"
+ */
+[[noreturn]] inline void InvalidPosition(size_t index, bool ring,
+                                         const char* problem) {
+  throw ValidationError("Position " + std::to_string(index) + " of a " +
+                            (ring ? "ring " : "line ") + problem,
+                        index);
+}
+
+/** Returns whether the dims coordinates of a position are finite */
+inline bool IsFinitePosition(int dims, const double* pos) {
+  for (int d = 0; d < dims; d++) {
+    if (!std::isfinite(pos[d])) return false;
+  }
+  return true;
+}
+
+/** Returns whether a longitude is in [-180, 180] */
+inline bool IsLongitude(double lon) { return lon >= -180 && lon <= 180; }
+
+/** Returns whether a latitude is in [-90, 90] */
+inline bool IsLatitude(double lat) { return lat >= -90 && lat <= 90; }
+
+/** Checks the positions of a line or ring as they are encoded, for the
+ *  checks of each position that the format's Validation asks for
+ *
+ *  Rings may be read backwards to wind them, so a repeated position is
+ *  reported at the later of the two indices, as they were given.
+ */
+class PositionChecker {
+ public:
+  /** Constructor, checks nothing */
+  PositionChecker() : format_(nullptr), ring_(false), count_(0) {}
+
+  /** Constructor
+   *
+   *  \param format  How the coordinates are encoded, which must outlive the
+   *                 checker
+   *  \param ring    Whether the positions are of a ring
+   */
+  PositionChecker(const CoordinateFormat& format, bool ring)
+      : format_(format.Checks().ChecksPositions() ? &format : nullptr),
+        ring_(ring), count_(0) {}
+
+  /** Checks the position with the given index */
+  template <int Dims>
+  void operator()(Dimension<Dims>, const double* pos, size_t index) {
+    if (format_) Check(Dims, pos, index);
+  }
+
+  /** Checks that a ring does not end with its first position, once all of
+   *  its positions are checked
+   */
+  void Close() {
+    if (!format_ || count_ < 2) return;
+    if (first_[0] == last_[0] && first_[1] == last_[1]) {
+      InvalidPosition(std::max(firstIndex_, lastIndex_), ring_,
+                      "repeats the first, rings are given open");
+    }
+  }
+
+ private:
+  void Check(int dims, const double* pos, size_t index) {
+    if (!IsFinitePosition(dims, pos)) {
+      InvalidPosition(index, ring_, "is not finite");
+    }
+    if (!IsLongitude(pos[0])) {
+      InvalidPosition(index, ring_, "has a longitude outside [-180, 180]");
+    }
+    if (!IsLatitude(pos[1])) {
+      InvalidPosition(index, ring_, "has a latitude outside [-90, 90]");
+    }
+
+    double lon = format_->Round(pos[0]), lat = format_->Round(pos[1]);
+    if (count_ > 0 && lon == last_[0] && lat == last_[1]) {
+      InvalidPosition(std::max(index, lastIndex_), ring_,
+                      "repeats the one before it");
+    }
+    if (count_++ == 0) {
+      first_[0] = lon;
+      first_[1] = lat;
+      firstIndex_ = index;
+    }
+    last_[0] = lon;
+    last_[1] = lat;
+    lastIndex_ = index;
+  }
+
+  const CoordinateFormat* format_;
+  bool ring_;
+  size_t count_;
+  double first_[2];
+  double last_[2];
+  size_t firstIndex_;
+  size_t lastIndex_;
+};
+
+/** Returns the position array of Dims coordinates */
+template <typename Json>
+Json PositionCoordinates(Dimension<2>, const double* pos,
+                         const CoordinateFormat& format) {
+  return PointCoordinates<Json>(pos[0], pos[1], format);
+}
+
+/** \overload */
+template <typename Json>
+Json PositionCoordinates(Dimension<3>, const double* pos,
+                         const CoordinateFormat& format) {
+  return PointCoordinates<Json>(pos[0], pos[1], pos[2], format);
+}
+
+/** Returns the array of the positions given by a point callback
+ *
+ *  \param dims       The dimension of the positions
+ *  \param numPoints  The number of points
+ *  \param format     How the coordinates are encoded
+ *  \param checker    Checks each position as it is read
+ *  \param getPoint   A callback that takes the indices followed by the point
+ *                    index and sets the coordinates
+ *  \param indices    The leading indices given to the callback
+ */
+template <typename Json, int Dims, typename GetPoint, typename... Indices>
+Json MultiPointCoordinates(Dimension<Dims> dims, size_t numPoints,
+                           const CoordinateFormat& format,
+                           PositionChecker checker, GetPoint& getPoint,
+                           Indices... indices) {
+  LibraryScope scope;
+  auto coords = ReservedArray<Json>(numPoints);
+  double pos[Dims];
+  for (size_t i = 0; i < numPoints; i++) {
+    ReadPoint(dims, pos, getPoint, indices..., i);
+    checker(dims, pos, i);
+    coords.push_back(PositionCoordinates<Json>(dims, pos, format));
+  }
+  return coords;
+}
+
 /** Returns the coordinates array of a MultiPoint object (section 3.1.3)
  *
  *  \tparam Callable A callable of the form
  *                   void(size_t index, double& lon, double& lat,
  *                        double& alt)
+ *                   or void(size_t index, double& lon, double& lat)
  *  \param numPoints The number of points
  *  \param getPoint  A callback that takes the point index and sets the
  *                   lat/lon/altitude
+ *  \param format    How the coordinates are encoded
  *
  *  \return A JSON array that can go into the coordinates property of a
  *          MultiPoint object
  */
-template <typename Callable,
-          detail::IsCallbackSignature<Callable, void, size_t, double&, double&,
-                                      double&> = true>
-nlohmann::json MultiPointCoordinates(size_t numPoints, Callable&& getPoint) {
-  auto coords = nlohmann::json::array();
-  double lon, lat, alt;
-  for (size_t i = 0; i < numPoints; i++) {
-    getPoint(i, lon, lat, alt);
-    coords.push_back(PointCoordinates(lon, lat, alt));
-  }
-  return coords;
+template <typename Json = nlohmann::json, typename Callable,
+          detail::IsPointCallback<Callable, size_t> = true>
+Json MultiPointCoordinates(
+    size_t numPoints, Callable&& getPoint,
+    const CoordinateFormat& format = CoordinateFormat()) {
+  return MultiPointCoordinates<Json>(CallbackDimension<Callable, size_t>(),
+                                     numPoints, format, PositionChecker(),
+                                     getPoint);
 }
 
 /** \overload */
-template <typename Callable,
-          detail::IsCallbackSignature<Callable, void, size_t, double&,
-                                      double&> = true>
-nlohmann::json MultiPointCoordinates(size_t numPoints, Callable&& getPoint) {
-  auto coords = nlohmann::json::array();
-  double lon, lat;
-  for (size_t i = 0; i < numPoints; i++) {
-    getPoint(i, lon, lat);
-    coords.push_back(PointCoordinates(lon, lat));
+template <typename Json = nlohmann::json>
+Json MultiPointCoordinates(
+    const PositionSpan& positions,
+    const CoordinateFormat& format = CoordinateFormat(),
+    PositionChecker checker = PositionChecker()) {
+  SpanPoints points(positions);
+  if (positions.HasAltitude()) {
+    return MultiPointCoordinates<Json>(Dimension<3>(), positions.Size(),
+                                       format, checker, points);
   }
-  return coords;
+  return MultiPointCoordinates<Json>(Dimension<2>(), positions.Size(), format,
+                                     checker, points);
 }
 }
 
@@ -224,11 +1126,13 @@ nlohmann::json MultiPointCoordinates(size_t numPoints, Callable&& getPoint) {
  *  \param numPoints The number of points
  *  \param getPoint  A callback that takes the point index and sets the
  *                   lat/lon/altitude
+ *  \param format    How the coordinates are encoded
  *
  *  \return A JSON MultiPoint object
  */
-template <typename Callable>
-nlohmann::json MultiPoint(size_t numPoints, Callable&& getPoint) {
+template <typename Json = nlohmann::json, typename Callable>
+Json MultiPoint(size_t numPoints, Callable&& getPoint,
+                const CoordinateFormat& format = CoordinateFormat()) {
   static_assert(
       detail::is_invocable_r<void, Callable, size_t, double&, double&,
                              double&>::value ||
@@ -236,55 +1140,555 @@ nlohmann::json MultiPoint(size_t numPoints, Callable&& getPoint) {
                                  double&>::value,
       "Callback must either be void(size_t, double&, double&, double&) or "
       "void(size_t, double&, double&)");
-  return detail::CoordinatesObject<Type::MultiPoint>(
-      detail::MultiPointCoordinates(numPoints,
-                                    std::forward<Callable>(getPoint)));
+  return detail::BoundedCoordinatesObject<Type::MultiPoint, Json>(
+      format, [&](const CoordinateFormat& f) {
+        return detail::MultiPointCoordinates<Json>(
+            numPoints, std::forward<Callable>(getPoint), f);
+      });
+}
+
+/** Returns a GeoJSON MultiPoint object (section 3.1.3) from positions held
+ *  in contiguous memory
+ *
+ *  \param positions  The points
+ *  \param format     How the coordinates are encoded
+ *
+ *  \return A JSON MultiPoint object
+ */
+template <typename Json = nlohmann::json>
+Json MultiPoint(const PositionSpan& positions,
+                const CoordinateFormat& format = CoordinateFormat()) {
+  auto coords = detail::MultiPointCoordinates<Json>(positions, format);
+  return detail::SpanCoordinatesObject<Type::MultiPoint, Json>(
+      std::move(coords), positions, format);
 }
 
 namespace detail {
 
+/** Positions copied out of a line or ring, interleaved as [lon, lat(, alt)] */
+struct PositionBuffer {
+  /** Returns a view of the positions */
+  PositionSpan Span() const {
+    return PositionSpan::Interleaved(coords.data(), coords.size() / dims,
+                                     dims);
+  }
+
+  std::vector<double> coords;
+  size_t dims;
+};
+
+/** Reads positions through a point callback into a buffer
+ *
+ *  \param dims       The dimension of the positions
+ *  \param numPoints  The number of points
+ *  \param getPoint   A callback that takes the indices followed by the point
+ *                    index and sets the coordinates
+ *  \param indices    The leading indices given to the callback
+ */
+template <int Dims, typename GetPoint, typename... Indices>
+PositionBuffer ReadPositions(Dimension<Dims> dims, size_t numPoints,
+                             GetPoint& getPoint, Indices... indices) {
+  LibraryScope scope;
+  PositionBuffer buffer;
+  buffer.dims = Dims;
+  buffer.coords.resize(numPoints * Dims);
+  double* pos = buffer.coords.data();
+  for (size_t i = 0; i < numPoints; i++, pos += Dims) {
+    ReadPoint(dims, pos, getPoint, indices..., i);
+  }
+  return buffer;
+}
+
+/** Returns the squared distance from the i'th position to the segment
+ *  between positions a and b, in longitude and latitude
+ */
+inline double SquaredSegmentDistance(const PositionSpan& positions, size_t i,
+                                     size_t a, size_t b) {
+  double x = positions.Lon(a), y = positions.Lat(a);
+  double dx = positions.Lon(b) - x, dy = positions.Lat(b) - y;
+  double lengthSq = dx * dx + dy * dy;
+  if (lengthSq > 0) {
+    double t = ((positions.Lon(i) - x) * dx + (positions.Lat(i) - y) * dy) /
+               lengthSq;
+    if (t > 1) {
+      x += dx;
+      y += dy;
+    } else if (t > 0) {
+      x += t * dx;
+      y += t * dy;
+    }
+  }
+  dx = positions.Lon(i) - x;
+  dy = positions.Lat(i) - y;
+  return dx * dx + dy * dy;
+}
+
+/** Marks the positions strictly between first and last that Douglas-Peucker
+ *  keeps, where the positions are read modulo the size of the span
+ *
+ *  The ranges left to split are kept on a stack rather than recursing, so
+ *  long lines cannot overflow the call stack.
+ */
+inline void MarkDouglasPeucker(const PositionSpan& positions, size_t first,
+                               size_t last, double tolerance,
+                               std::vector<char>& keep) {
+  size_t n = positions.Size();
+  double toleranceSq = tolerance * tolerance;
+  std::vector<std::pair<size_t, size_t> > ranges(1, {first, last});
+  while (!ranges.empty()) {
+    size_t begin = ranges.back().first, end = ranges.back().second;
+    ranges.pop_back();
+
+    double farthest = toleranceSq;
+    size_t split = begin;
+    for (size_t i = begin + 1; i < end; i++) {
+      double distance = SquaredSegmentDistance(positions, i % n, begin % n,
+                                               end % n);
+      if (distance > farthest) {
+        farthest = distance;
+        split = i;
+      }
+    }
+    if (split == begin) continue;
+
+    keep[split % n] = 1;
+    ranges.emplace_back(begin, split);
+    ranges.emplace_back(split, end);
+  }
+}
+
+/** Copies the marked positions into a buffer */
+inline PositionBuffer KeptPositions(const PositionSpan& positions,
+                                    const std::vector<char>& keep) {
+  PositionBuffer buffer;
+  buffer.dims = positions.HasAltitude() ? 3 : 2;
+  buffer.coords.reserve(buffer.dims *
+                        std::count(keep.begin(), keep.end(), 1));
+  for (size_t i = 0; i < positions.Size(); i++) {
+    if (!keep[i]) continue;
+    buffer.coords.push_back(positions.Lon(i));
+    buffer.coords.push_back(positions.Lat(i));
+    if (buffer.dims == 3) buffer.coords.push_back(positions.Alt(i));
+  }
+  return buffer;
+}
+
+/** Simplifies a line with Douglas-Peucker, keeping both of its ends
+ *
+ *  \param positions  The positions of the line, at least 2
+ *  \param tolerance  The distance in decimal degrees
+ */
+inline PositionBuffer SimplifyLine(const PositionSpan& positions,
+                                   double tolerance) {
+  size_t n = positions.Size();
+  std::vector<char> keep(n, 0);
+  keep[0] = keep[n - 1] = 1;
+  MarkDouglasPeucker(positions, 0, n - 1, tolerance, keep);
+  return KeptPositions(positions, keep);
+}
+
+/** Simplifies an open ring with Douglas-Peucker
+ *
+ *  The ring is split at its first position and the position farthest from
+ *  it, and each half is simplified as a line. If that leaves only those two,
+ *  the position farthest from the segment between them is kept too, so the
+ *  ring stays at least a triangle.
+ *
+ *  \param positions  The positions of the ring, at least 3
+ *  \param tolerance  The distance in decimal degrees
+ */
+inline PositionBuffer SimplifyRing(const PositionSpan& positions,
+                                   double tolerance) {
+  size_t n = positions.Size();
+  size_t opposite = 1;
+  double farthest = -1;
+  for (size_t i = 1; i < n; i++) {
+    double distance = SquaredSegmentDistance(positions, i, 0, 0);
+    if (distance > farthest) {
+      farthest = distance;
+      opposite = i;
+    }
+  }
+
+  std::vector<char> keep(n, 0);
+  keep[0] = keep[opposite] = 1;
+  MarkDouglasPeucker(positions, 0, opposite, tolerance, keep);
+  MarkDouglasPeucker(positions, opposite, n, tolerance, keep);
+
+  if (std::count(keep.begin(), keep.end(), 1) < 3) {
+    size_t third = 0;
+    farthest = -1;
+    for (size_t i = 1; i < n; i++) {
+      if (i == opposite) continue;
+      double distance = SquaredSegmentDistance(positions, i, 0, opposite);
+      if (distance > farthest) {
+        farthest = distance;
+        third = i;
+      }
+    }
+    keep[third] = 1;
+  }
+  return KeptPositions(positions, keep);
+}
+
+/** Reads the i'th position of a span into pos */
+inline void SpanPosition(const PositionSpan& positions, size_t i,
+                         double* pos) {
+  pos[0] = positions.Lon(i);
+  pos[1] = positions.Lat(i);
+  if (positions.HasAltitude()) pos[2] = positions.Alt(i);
+}
+
+/** Checks each position of a line or ring held in contiguous memory, as
+ *  PositionChecker does
+ */
+inline void CheckPositions(const PositionSpan& positions, bool ring,
+                           const CoordinateFormat& format) {
+  PositionChecker checker(format, ring);
+  double pos[3];
+  for (size_t i = 0; i < positions.Size(); i++) {
+    SpanPosition(positions, i, pos);
+    if (positions.HasAltitude()) {
+      checker(Dimension<3>(), pos, i);
+    } else {
+      checker(Dimension<2>(), pos, i);
+    }
+  }
+  if (ring) checker.Close();
+}
+
+/** Copies the positions of a line or ring, dropping those that are not
+ *  finite or repeat the one kept before them, and wrapping longitudes into
+ *  [-180, 180]. A ring also drops the positions at its end that repeat its
+ *  first.
+ *
+ *  \throws ValidationError for a latitude outside [-90, 90], or if fewer
+ *          than 2 positions of a line or 3 of a ring are left
+ */
+inline PositionBuffer RepairPositions(const PositionSpan& positions,
+                                      bool ring,
+                                      const CoordinateFormat& format) {
+  PositionBuffer buffer;
+  buffer.dims = positions.HasAltitude() ? 3 : 2;
+  buffer.coords.reserve(buffer.dims * positions.Size());
+  double pos[3];
+  for (size_t i = 0; i < positions.Size(); i++) {
+    SpanPosition(positions, i, pos);
+    if (!IsFinitePosition(static_cast<int>(buffer.dims), pos)) continue;
+    if (!IsLongitude(pos[0])) pos[0] = std::remainder(pos[0], 360.0);
+    if (!IsLatitude(pos[1])) {
+      InvalidPosition(i, ring, "has a latitude outside [-90, 90]");
+    }
+
+    size_t size = buffer.coords.size();
+    if (size > 0 &&
+        format.Round(pos[0]) ==
+            format.Round(buffer.coords[size - buffer.dims]) &&
+        format.Round(pos[1]) ==
+            format.Round(buffer.coords[size - buffer.dims + 1])) {
+      continue;
+    }
+    buffer.coords.insert(buffer.coords.end(), pos, pos + buffer.dims);
+  }
+
+  while (ring && buffer.coords.size() > buffer.dims &&
+         format.Round(buffer.coords[buffer.coords.size() - buffer.dims]) ==
+             format.Round(buffer.coords[0]) &&
+         format.Round(buffer.coords[buffer.coords.size() - buffer.dims +
+                                    1]) == format.Round(buffer.coords[1])) {
+    buffer.coords.resize(buffer.coords.size() - buffer.dims);
+  }
+
+  size_t kept = buffer.coords.size() / buffer.dims;
+  if (kept < (ring ? 3u : 2u)) {
+    throw ValidationError(ring ? "A ring has fewer than 3 valid positions"
+                               : "A line has fewer than 2 valid positions",
+                          0);
+  }
+  return buffer;
+}
+
+/** A segment of a line or ring swept by CheckSelfIntersections() */
+struct SweepSegment {
+  /** The ends, the first being the lesser by longitude, then latitude */
+  double x1, y1, x2, y2;
+
+  /** The latitude of the segment at a longitude within its range, the
+   *  lower end for a vertical segment
+   */
+  double YAt(double x) const {
+    if (x2 == x1 || x <= x1) return y1;
+    if (x >= x2) return y2;
+    return y1 + (x - x1) * (y2 - y1) / (x2 - x1);
+  }
+
+  /** The slope of the segment, infinite if it is vertical */
+  double Slope() const {
+    return x2 == x1 ? std::numeric_limits<double>::infinity()
+                    : (y2 - y1) / (x2 - x1);
+  }
+};
+
+/** Returns the sign of the cross product of b - a and c - a, positive if
+ *  a, b, c turn counter-clockwise
+ */
+inline int Orientation(double ax, double ay, double bx, double by, double cx,
+                       double cy) {
+  double cross = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+  return (cross > 0) - (cross < 0);
+}
+
+/** Returns whether c, collinear with a and b, is within their bounds */
+inline bool WithinSegment(double ax, double ay, double bx, double by,
+                          double cx, double cy) {
+  return std::min(ax, bx) <= cx && cx <= std::max(ax, bx) &&
+         std::min(ay, by) <= cy && cy <= std::max(ay, by);
+}
+
+/** Returns whether two segments cross or touch */
+inline bool SegmentsIntersect(const SweepSegment& s, const SweepSegment& t) {
+  int o1 = Orientation(s.x1, s.y1, s.x2, s.y2, t.x1, t.y1);
+  int o2 = Orientation(s.x1, s.y1, s.x2, s.y2, t.x2, t.y2);
+  int o3 = Orientation(t.x1, t.y1, t.x2, t.y2, s.x1, s.y1);
+  int o4 = Orientation(t.x1, t.y1, t.x2, t.y2, s.x2, s.y2);
+  if (o1 != o2 && o3 != o4) return true;
+  return (o1 == 0 && WithinSegment(s.x1, s.y1, s.x2, s.y2, t.x1, t.y1)) ||
+         (o2 == 0 && WithinSegment(s.x1, s.y1, s.x2, s.y2, t.x2, t.y2)) ||
+         (o3 == 0 && WithinSegment(t.x1, t.y1, t.x2, t.y2, s.x1, s.y1)) ||
+         (o4 == 0 && WithinSegment(t.x1, t.y1, t.x2, t.y2, s.x2, s.y2));
+}
+
+/** Throws a ValidationError if two segments of a line or ring cross or
+ *  touch, other than neighbors meeting at their shared end
+ *
+ *  Repeated positions, other than consecutive ones and the ends of a closed
+ *  line, are found by sorting the positions. The segments between the rest
+ *  are then swept by longitude (Shamos-Hoey), keeping those the sweep line
+ *  crosses ordered by latitude and testing only the pairs that become
+ *  adjacent in that order, which finds an intersection if there is one in
+ *  O(n log n). Positions are compared as the format rounds them.
+ */
+inline void CheckSelfIntersections(const PositionSpan& positions, bool ring,
+                                   const CoordinateFormat& format) {
+  const char* name = ring ? "ring" : "line";
+  size_t n = positions.Size();
+  std::vector<double> x(n), y(n);
+  for (size_t i = 0; i < n; i++) {
+    x[i] = format.Round(positions.Lon(i));
+    y[i] = format.Round(positions.Lat(i));
+  }
+  auto same = [&](size_t a, size_t b) { return x[a] == x[b] && y[a] == y[b]; };
+
+  // The positions that start a segment, skipping consecutive repeats
+  std::vector<size_t> vertices;
+  vertices.reserve(n);
+  for (size_t i = 0; i < n; i++) {
+    if (vertices.empty() || !same(vertices.back(), i)) vertices.push_back(i);
+  }
+  bool cyclic = ring;
+  while (vertices.size() > 1 && same(vertices.back(), vertices.front())) {
+    vertices.pop_back();
+    cyclic = true;
+  }
+  size_t m = vertices.size();
+  if (m < 2) return;
+
+  std::vector<size_t> order(vertices);
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return x[a] < x[b] || (x[a] == x[b] && (y[a] < y[b] ||
+                                            (y[a] == y[b] && a < b)));
+  });
+  for (size_t k = 1; k < m; k++) {
+    if (same(order[k - 1], order[k])) {
+      throw ValidationError(
+          "Positions " + std::to_string(order[k - 1]) + " and " +
+              std::to_string(order[k]) + " of a " + name + " are the same",
+          order[k]);
+    }
+  }
+
+  size_t numSegments = cyclic ? m : m - 1;
+  std::vector<SweepSegment> segments(numSegments);
+  for (size_t k = 0; k < numSegments; k++) {
+    size_t a = vertices[k], b = vertices[(k + 1) % m];
+    if (x[b] < x[a] || (x[b] == x[a] && y[b] < y[a])) std::swap(a, b);
+    segments[k] = {x[a], y[a], x[b], y[b]};
+  }
+  auto next = [&](size_t k) {
+    return cyclic ? (k + 1) % numSegments : k + 1;
+  };
+  auto adjacent = [&](size_t s, size_t t) {
+    return next(s) == t || next(t) == s;
+  };
+  auto check = [&](size_t s, size_t t) {
+    bool intersect;
+    if (adjacent(s, t)) {
+      // Neighbors share an end, so only overlap if they fold back
+      if (next(s) != t) std::swap(s, t);
+      size_t a = vertices[s], b = vertices[t], c = vertices[(t + 1) % m];
+      intersect =
+          Orientation(x[a], y[a], x[b], y[b], x[c], y[c]) == 0 &&
+          (WithinSegment(x[a], y[a], x[b], y[b], x[c], y[c]) ||
+           WithinSegment(x[b], y[b], x[c], y[c], x[a], y[a]));
+    } else {
+      intersect = SegmentsIntersect(segments[s], segments[t]);
+    }
+    if (intersect) {
+      size_t first = vertices[std::min(s, t)];
+      size_t second = vertices[std::max(s, t)];
+      throw ValidationError("The segments at positions " +
+                                std::to_string(first) + " and " +
+                                std::to_string(second) + " of a " + name +
+                                " intersect",
+                            second);
+    }
+  };
+
+  // Each segment is added at its lesser end and removed at its greater one,
+  // adding before removing at the same position so that touching ends meet
+  struct Event {
+    double x, y;
+    bool remove;
+    size_t segment;
+  };
+  std::vector<Event> events;
+  events.reserve(2 * numSegments);
+  for (size_t k = 0; k < numSegments; k++) {
+    events.push_back({segments[k].x1, segments[k].y1, false, k});
+    events.push_back({segments[k].x2, segments[k].y2, true, k});
+  }
+  std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+    if (a.x != b.x) return a.x < b.x;
+    if (a.y != b.y) return a.y < b.y;
+    if (a.remove != b.remove) return b.remove;
+    return a.segment < b.segment;
+  });
+
+  double sweepX = 0;
+  auto below = [&](size_t s, size_t t) {
+    if (s == t) return false;
+    double ys = segments[s].YAt(sweepX), yt = segments[t].YAt(sweepX);
+    if (ys != yt) return ys < yt;
+    double slopeS = segments[s].Slope(), slopeT = segments[t].Slope();
+    if (slopeS != slopeT) return slopeS < slopeT;
+    return s < t;
+  };
+  std::set<size_t, decltype(below)> active(below);
+  std::vector<std::set<size_t, decltype(below)>::iterator> where(numSegments);
+  for (const auto& event : events) {
+    sweepX = event.x;
+    if (!event.remove) {
+      auto it = active.insert(event.segment).first;
+      where[event.segment] = it;
+      if (it != active.begin()) check(*std::prev(it), *it);
+      if (std::next(it) != active.end()) check(*it, *std::next(it));
+    } else {
+      auto it = where[event.segment];
+      if (it != active.begin() && std::next(it) != active.end()) {
+        check(*std::prev(it), *std::next(it));
+      }
+      active.erase(it);
+    }
+  }
+}
+
+/** Returns the positions of a line or ring as they are encoded: repaired or
+ *  checked, simplified, then swept for self-intersections, as the format
+ *  asks
+ *
+ *  \param positions  The positions of the line or ring, a ring being open
+ *  \param ring       Whether the positions are of a ring
+ *  \param format     How the coordinates are encoded
+ *  \param storage    Holds the positions returned, unless they are the
+ *                    positions given
+ */
+inline PositionSpan PreparePositions(const PositionSpan& positions, bool ring,
+                                     const CoordinateFormat& format,
+                                     PositionBuffer& storage) {
+  const auto& validation = format.Checks();
+  PositionSpan prepared = positions;
+  if (validation.Repairs()) {
+    storage = RepairPositions(positions, ring, format);
+    prepared = storage.Span();
+  } else if (validation.ChecksPositions()) {
+    CheckPositions(positions, ring, format);
+  }
+  if (format.IsSimplified()) {
+    double tolerance = format.SimplificationTolerance();
+    storage = ring ? SimplifyRing(prepared, tolerance)
+                   : SimplifyLine(prepared, tolerance);
+    prepared = storage.Span();
+  }
+  if (validation.ChecksSelfIntersections()) {
+    CheckSelfIntersections(prepared, ring, format);
+  }
+  return prepared;
+}
+
+/** Returns the coordinates array of a line given by a point callback
+ *
+ *  \param dims       The dimension of the positions
+ *  \param numPoints  The number of points
+ *  \param format     How the coordinates are encoded
+ *  \param getPoint   A callback that takes the indices followed by the point
+ *                    index and sets the coordinates
+ *  \param indices    The leading indices given to the callback
+ */
+template <typename Json, int Dims, typename GetPoint, typename... Indices>
+Json LineStringCoordinates(Dimension<Dims> dims, size_t numPoints,
+                           const CoordinateFormat& format, GetPoint& getPoint,
+                           Indices... indices) {
+  if (numPoints <= 1) {
+    throw std::domain_error("LineString objects must have at least 2 points");
+  }
+  if (BuffersPositions(format)) {
+    auto line = ReadPositions(dims, numPoints, getPoint, indices...);
+    PositionBuffer storage;
+    return MultiPointCoordinates<Json>(
+        PreparePositions(line.Span(), false, format, storage), format);
+  }
+  return MultiPointCoordinates<Json>(dims, numPoints, format,
+                                     PositionChecker(format, false), getPoint,
+                                     indices...);
+}
+
 /** Returns the coordinates array of a LineString object (section 3.1.4)
  *
  *  \tparam Callable A callable of the form
  *                   void(size_t index, double& lon, double& lat, double& alt)
+ *                   or void(size_t index, double& lon, double& lat)
  *  \param numPoints The number of points
  *  \param getPoint  A callback that takes the point index and sets the
  *                   lat/lon/altitude
+ *  \param format    How the coordinates are encoded
  *
  *  \return A JSON array that can go into the coordinates property of a
  *          LineString object
  */
-template <typename Callable,
-          detail::IsCallbackSignature<Callable, void, size_t, double&, double&,
-                                      double&> = true>
-nlohmann::json LineStringCoordinates(size_t numPoints, Callable&& getPoint) {
-  if (numPoints <= 1) {
-    throw std::domain_error("LineString objects must have at least 2 points");
-  }
-  auto coords = nlohmann::json::array();
-  double lon, lat, alt;
-  for (size_t i = 0; i < numPoints; i++) {
-    getPoint(i, lon, lat, alt);
-    coords.push_back(detail::PointCoordinates(lon, lat, alt));
-  }
-  return coords;
+template <typename Json = nlohmann::json, typename Callable,
+          detail::IsPointCallback<Callable, size_t> = true>
+Json LineStringCoordinates(
+    size_t numPoints, Callable&& getPoint,
+    const CoordinateFormat& format = CoordinateFormat()) {
+  return LineStringCoordinates<Json>(CallbackDimension<Callable, size_t>(),
+                                     numPoints, format, getPoint);
 }
 
 /** \overload */
-template <typename Callable,
-          detail::IsCallbackSignature<Callable, void, size_t, double&,
-                                      double&> = true>
-nlohmann::json LineStringCoordinates(size_t numPoints, Callable&& getPoint) {
-  if (numPoints <= 1) {
+template <typename Json = nlohmann::json>
+Json LineStringCoordinates(
+    const PositionSpan& positions,
+    const CoordinateFormat& format = CoordinateFormat()) {
+  if (positions.Size() <= 1) {
     throw std::domain_error("LineString objects must have at least 2 points");
   }
-  auto coords = nlohmann::json::array();
-  double lon, lat;
-  for (size_t i = 0; i < numPoints; i++) {
-    getPoint(i, lon, lat);
-    coords.push_back(detail::PointCoordinates(lon, lat));
+  if (BuffersPositions(format)) {
+    PositionBuffer storage;
+    return MultiPointCoordinates<Json>(
+        PreparePositions(positions, false, format, storage), format);
   }
-  return coords;
+  return MultiPointCoordinates<Json>(positions, format,
+                                     PositionChecker(format, false));
 }
 }
 
@@ -296,11 +1700,13 @@ nlohmann::json LineStringCoordinates(size_t numPoints, Callable&& getPoint) {
  *  \param numPoints The number of points
  *  \param getPoint  A callback that takes the point index and sets the
  *                   lat/lon/altitude
+ *  \param format    How the coordinates are encoded
  *
  *  \return A GeoJSON LineString object
  */
-template <typename Callable>
-nlohmann::json LineString(size_t numPoints, Callable&& getPoint) {
+template <typename Json = nlohmann::json, typename Callable>
+Json LineString(size_t numPoints, Callable&& getPoint,
+                const CoordinateFormat& format = CoordinateFormat()) {
   static_assert(
       detail::is_invocable_r<void, Callable, size_t, double&, double&,
                              double&>::value ||
@@ -308,9 +1714,27 @@ nlohmann::json LineString(size_t numPoints, Callable&& getPoint) {
                                  double&>::value,
       "Callback must either be void(size_t, double&, double&, double&) or "
       "void(size_t, double&, double&)");
-  return detail::CoordinatesObject<Type::LineString>(
-      detail::LineStringCoordinates(numPoints,
-                                    std::forward<Callable>(getPoint)));
+  return detail::BoundedCoordinatesObject<Type::LineString, Json>(
+      format, [&](const CoordinateFormat& f) {
+        return detail::LineStringCoordinates<Json>(
+            numPoints, std::forward<Callable>(getPoint), f);
+      });
+}
+
+/** Returns a GeoJSON LineString object (section 3.1.4) from positions held in
+ *  contiguous memory
+ *
+ *  \param positions  The points of the line
+ *  \param format     How the coordinates are encoded
+ *
+ *  \return A GeoJSON LineString object
+ */
+template <typename Json = nlohmann::json>
+Json LineString(const PositionSpan& positions,
+                const CoordinateFormat& format = CoordinateFormat()) {
+  auto coords = detail::LineStringCoordinates<Json>(positions, format);
+  return detail::SpanCoordinatesObject<Type::LineString, Json>(
+      std::move(coords), positions, format);
 }
 
 namespace detail {
@@ -322,43 +1746,60 @@ namespace detail {
  *  \tparam GetPoint      A callable of the form
  *                        void(size_t lineIndex, size_t pointIndex,
  *                             double& lon, double& lat, double& alt)
+ *                        or void(size_t lineIndex, size_t pointIndex,
+ *                                double& lon, double& lat)
  *  \param numLines       The number of lines
  *  \param getLineLength  A callback that takes the line index and returns
  *                        the length of the line
  *  \param getPoint       A callback that takes the line and point indices and
  *                        sets the lat/lon/altitude
+ *  \param format         How the coordinates are encoded
  *
  *  \return A JSON array that can go into the coordinates property of a
  *          MultiLineString object
  */
-template <typename GetLineLength, typename GetPoint,
-          detail::IsCallbackSignature<GetPoint, void, size_t, size_t, double&,
-                                      double&, double&> = true>
-nlohmann::json MultiLineStringCoordinates(size_t numLines,
-                                          GetLineLength&& getLineLength,
-                                          GetPoint&& getPoint) {
-  auto coords = nlohmann::json::array();
+template <typename Json = nlohmann::json, typename GetLineLength,
+          typename GetPoint,
+          detail::IsPointCallback<GetPoint, size_t, size_t> = true>
+Json MultiLineStringCoordinates(
+    size_t numLines, GetLineLength&& getLineLength, GetPoint&& getPoint,
+    const CoordinateFormat& format = CoordinateFormat()) {
+  CallbackDimension<GetPoint, size_t, size_t> dims;
+  auto coords = ReservedArray<Json>(numLines);
   for (size_t i = 0; i < numLines; i++) {
-    coords.push_back(detail::LineStringCoordinates(
-        getLineLength(i), [&](size_t j, double& lon, double& lat, double& alt) {
-          getPoint(i, j, lon, lat, alt);
-        }));
+    coords.push_back(detail::LineStringCoordinates<Json>(
+        dims, getLineLength(i), format, getPoint, i));
   }
   return coords;
 }
 
-/* \overload */
-template <typename GetLineLength, typename GetPoint,
-          detail::IsCallbackSignature<GetPoint, void, size_t, size_t, double&,
-                                      double&> = true>
-nlohmann::json MultiLineStringCoordinates(size_t numLines,
-                                          GetLineLength&& getLineLength,
-                                          GetPoint&& getPoint) {
-  auto coords = nlohmann::json::array();
+/** Checks that an offsets array is ascending and within the given size
+ *
+ *  \param offsets     The offsets array, of length count + 1
+ *  \param count       The number of ranges
+ *  \param size        The size of the indexed array
+ */
+inline void CheckOffsets(const size_t* offsets, size_t count, size_t size) {
+  for (size_t i = 0; i < count; i++) {
+    if (offsets[i] > offsets[i + 1]) {
+      throw std::domain_error("Offsets must be in ascending order");
+    }
+  }
+  if (offsets[count] > size) {
+    throw std::out_of_range("Offsets are outside of the indexed array");
+  }
+}
+
+/** \overload */
+template <typename Json = nlohmann::json>
+Json MultiLineStringCoordinates(
+    const PositionSpan& positions, const size_t* lineOffsets, size_t numLines,
+    const CoordinateFormat& format = CoordinateFormat()) {
+  CheckOffsets(lineOffsets, numLines, positions.Size());
+  auto coords = ReservedArray<Json>(numLines);
   for (size_t i = 0; i < numLines; i++) {
-    coords.push_back(detail::LineStringCoordinates(
-        getLineLength(i),
-        [&](size_t j, double& lon, double& lat) { getPoint(i, j, lon, lat); }));
+    coords.push_back(LineStringCoordinates<Json>(
+        positions.Slice(lineOffsets[i], lineOffsets[i + 1]), format));
   }
   return coords;
 }
@@ -375,13 +1816,15 @@ nlohmann::json MultiLineStringCoordinates(size_t numLines,
  *                        the length of the line
  *  \param getPoint       A callback that takes the line and point indices and
  *                        sets the lat/lon/altitude
+ *  \param format         How the coordinates are encoded
  *
  *  \return A GeoJSON MultiLineString object
  */
-template <typename GetLineLength, typename GetPoint>
-nlohmann::json MultiLineString(size_t numLineStrings,
-                               GetLineLength&& getLineLength,
-                               GetPoint&& getPoint) {
+template <typename Json = nlohmann::json, typename GetLineLength,
+          typename GetPoint>
+Json MultiLineString(size_t numLineStrings, GetLineLength&& getLineLength,
+                     GetPoint&& getPoint,
+                     const CoordinateFormat& format = CoordinateFormat()) {
   static_assert(
       detail::is_invocable_r<void, GetPoint, size_t, size_t, double&, double&,
                              double&>::value ||
@@ -389,10 +1832,34 @@ nlohmann::json MultiLineString(size_t numLineStrings,
                                  double&>::value,
       "GetPoint callback must either be void(size_t, size_t, double&, "
       "double&, double&) or void(size_t, size_t, double&, double&)");
-  return detail::CoordinatesObject<Type::MultiLineString>(
-      detail::MultiLineStringCoordinates(
-          numLineStrings, std::forward<GetLineLength>(getLineLength),
-          std::forward<GetPoint>(getPoint)));
+  return detail::BoundedCoordinatesObject<Type::MultiLineString, Json>(
+      format, [&](const CoordinateFormat& f) {
+        return detail::MultiLineStringCoordinates<Json>(
+            numLineStrings, std::forward<GetLineLength>(getLineLength),
+            std::forward<GetPoint>(getPoint), f);
+      });
+}
+
+/** Returns a MultiLineString GeoJSON object (section 3.1.5) from positions
+ *  held in contiguous memory
+ *
+ *  \param positions    The points of all of the lines
+ *  \param lineOffsets  Array of numLines + 1 offsets into positions, line i
+ *                      is made of positions [lineOffsets[i], lineOffsets[i+1])
+ *  \param numLines     The number of lines
+ *  \param format       How the coordinates are encoded
+ *
+ *  \return A GeoJSON MultiLineString object
+ */
+template <typename Json = nlohmann::json>
+Json MultiLineString(const PositionSpan& positions, const size_t* lineOffsets,
+                     size_t numLines,
+                     const CoordinateFormat& format = CoordinateFormat()) {
+  auto coords = detail::MultiLineStringCoordinates<Json>(
+      positions, lineOffsets, numLines, format);
+  return detail::SpanCoordinatesObject<Type::MultiLineString, Json>(
+      std::move(coords),
+      detail::OffsetPositions(positions, lineOffsets, numLines), format);
 }
 
 namespace detail {
@@ -418,40 +1885,212 @@ inline bool IsCcw(const nlohmann::json& coords) {
   return cwEdgeSum < 0;
 }
 
-/** Gets the coordinates array for a linear ring, ensures the vertices are
- * in CW or CCW order.
+/** Tests whether the ring given by a point callback is counter-clockwise, in
+ *  a single pass over the points
+ *
+ *  \param dims       The dimension of the positions
+ *  \param numPoints  The number of points in the ring
+ *  \param getPoint   A callback that takes the indices followed by the point
+ *                    index and sets the coordinates
+ *  \param indices    The leading indices given to the callback
  *
- *  \tparam GetPoint Either a 2D or 3D point callback
+ *  \return Whether the ring is in counter-clockwise order
+ */
+template <int Dims, typename GetPoint, typename... Indices>
+bool IsCcw(Dimension<Dims> dims, size_t numPoints, GetPoint& getPoint,
+           Indices... indices) {
+  if (numPoints == 0) return false;
+
+  // Sum (x2 - x1)(y2 + y1), that will be > 0, if the points are CW
+  double first[Dims], pos[Dims];
+  ReadPoint(dims, first, getPoint, indices..., size_t(0));
+
+  double cwEdgeSum = 0;
+  double lon1 = first[0], lat1 = first[1];
+  for (size_t i = 1; i < numPoints; i++) {
+    ReadPoint(dims, pos, getPoint, indices..., i);
+    cwEdgeSum += (pos[0] - lon1) * (pos[1] + lat1);
+    lon1 = pos[0];
+    lat1 = pos[1];
+  }
+  cwEdgeSum += (first[0] - lon1) * (first[1] + lat1);
+
+  return cwEdgeSum < 0;
+}
+
+/** \overload */
+inline bool IsCcw(const PositionSpan& positions) {
+  SpanPoints points(positions);
+  return IsCcw(Dimension<2>(), positions.Size(), points);
+}
+
+/** Tests whether the ring given by the callback is counter-clockwise, in a
+ *  single pass over the points
+ *
+ *  \tparam GetPoint A callable of the form
+ *                   void(size_t index, double& lon, double& lat, double& alt)
+ *                   or void(size_t index, double& lon, double& lat)
  *  \param numPoints The number of points in the ring
- *  \param ccw       Whether the ring shoudl be CCW
- *  \param getPoint  2D or 3D callback
+ *  \param getPoint  A callback that takes the point index and sets the
+ *                   lat/lon/altitude
  *
- *  \return A JSON array containing the positions in the linear ring
+ *  \return Whether the ring is in counter-clockwise order
  */
-template <typename GetPoint>
-nlohmann::json LinearRingCoordinates(size_t numPoints, bool ccw,
-                                     GetPoint&& getPoint) {
+template <typename GetPoint,
+          detail::IsPointCallback<GetPoint, size_t> = true>
+bool IsCcw(size_t numPoints, GetPoint&& getPoint) {
+  return IsCcw(CallbackDimension<GetPoint, size_t>(), numPoints, getPoint);
+}
+
+/** Returns the coordinates array of a ring given by a point callback, in CW
+ *  or CCW order and closed
+ *
+ *  The ring is read through the callback once to find its orientation and
+ *  once more to build it, backwards if it needs to be reversed.
+ *
+ *  \param dims       The dimension of the positions
+ *  \param numPoints  The number of points in the ring
+ *  \param ccw        Whether the ring should be CCW
+ *  \param format     How the coordinates are encoded
+ *  \param checker    Checks each position as it is written
+ *  \param getPoint   A callback that takes the indices followed by the point
+ *                    index and sets the coordinates
+ *  \param indices    The leading indices given to the callback
+ */
+template <typename Json, int Dims, typename GetPoint, typename... Indices>
+Json ClosedRingCoordinates(Dimension<Dims> dims, size_t numPoints, bool ccw,
+                           const CoordinateFormat& format,
+                           PositionChecker checker, GetPoint& getPoint,
+                           Indices... indices) {
+  LibraryScope scope;
+  bool reverse = IsCcw(dims, numPoints, getPoint, indices...) != ccw;
+  if (reverse) Instrument::OnRingReversed();
+
+  auto coords = ReservedArray<Json>(numPoints + 1);
+  double first[Dims], pos[Dims];
+  size_t index = reverse ? numPoints - 1 : 0;
+  ReadPoint(dims, first, getPoint, indices..., index);
+  checker(dims, first, index);
+  coords.push_back(PositionCoordinates<Json>(dims, first, format));
+  for (size_t i = 1; i < numPoints; i++) {
+    index = reverse ? numPoints - i - 1 : i;
+    ReadPoint(dims, pos, getPoint, indices..., index);
+    checker(dims, pos, index);
+    coords.push_back(PositionCoordinates<Json>(dims, pos, format));
+  }
+  checker.Close();
+
+  // Close the ring
+  coords.push_back(PositionCoordinates<Json>(dims, first, format));
+  return coords;
+}
+
+/** Returns the coordinates array of the positions of a ring in CW or CCW
+ *  order, closing it
+ */
+template <typename Json>
+Json ClosedRingCoordinates(const PositionSpan& positions, bool ccw,
+                           const CoordinateFormat& format,
+                           PositionChecker checker = PositionChecker()) {
+  SpanPoints points(positions);
+  if (positions.HasAltitude()) {
+    return ClosedRingCoordinates<Json>(Dimension<3>(), positions.Size(), ccw,
+                                       format, checker, points);
+  }
+  return ClosedRingCoordinates<Json>(Dimension<2>(), positions.Size(), ccw,
+                                     format, checker, points);
+}
+
+/** Returns the coordinates array of a linear ring given by a point callback,
+ *  checking and simplifying it as the format asks
+ *
+ *  \throws std::domain_error if there are fewer than 3 points
+ */
+template <typename Json, int Dims, typename GetPoint, typename... Indices>
+Json LinearRingCoordinates(Dimension<Dims> dims, size_t numPoints, bool ccw,
+                           const CoordinateFormat& format, GetPoint& getPoint,
+                           Indices... indices) {
   // We must be at least a triangle
   if (numPoints < 3) {
     throw std::domain_error("Linear rings must have at least 3 points");
   }
+  if (BuffersPositions(format)) {
+    auto ring = ReadPositions(dims, numPoints, getPoint, indices...);
+    PositionBuffer storage;
+    return ClosedRingCoordinates<Json>(
+        PreparePositions(ring.Span(), true, format, storage), ccw, format);
+  }
+  return ClosedRingCoordinates<Json>(dims, numPoints, ccw, format,
+                                     PositionChecker(format, true), getPoint,
+                                     indices...);
+}
 
-  // A linear ring is essentailly a line string
-  auto coords =
-      LineStringCoordinates(numPoints, std::forward<GetPoint>(getPoint));
+/** Gets the coordinates array for a linear ring, ensures the vertices are
+ * in CW or CCW order and closes the ring.
+ *
+ *  The ring is read through the callback once to find its orientation and
+ *  once more to build it, backwards if it needs to be reversed.
+ *
+ *  \tparam GetPoint A callable of the form
+ *                   void(size_t index, double& lon, double& lat, double& alt)
+ *                   or void(size_t index, double& lon, double& lat)
+ *  \param numPoints The number of points in the ring
+ *  \param ccw       Whether the ring should be CCW
+ *  \param getPoint  A callback that takes the point index and sets the
+ *                   lat/lon/altitude
+ *  \param format    How the coordinates are encoded
+ *
+ *  \return A JSON array containing the positions in the linear ring
+ */
+template <typename Json = nlohmann::json, typename GetPoint,
+          detail::IsPointCallback<GetPoint, size_t> = true>
+Json LinearRingCoordinates(
+    size_t numPoints, bool ccw, GetPoint&& getPoint,
+    const CoordinateFormat& format = CoordinateFormat()) {
+  return LinearRingCoordinates<Json>(CallbackDimension<GetPoint, size_t>(),
+                                     numPoints, ccw, format, getPoint);
+}
 
-  // Reverse if need it
-  bool isCcw = IsCcw(coords);
-  bool reverse = (isCcw && !ccw) || (!isCcw && ccw);
-  if (reverse) {
-    for (size_t i = 0; i < coords.size() / 2; i++) {
-      std::swap(coords[i], coords[coords.size() - i - 1]);
-    }
+/** \overload */
+template <typename Json = nlohmann::json>
+Json LinearRingCoordinates(
+    const PositionSpan& positions, bool ccw,
+    const CoordinateFormat& format = CoordinateFormat()) {
+  if (positions.Size() < 3) {
+    throw std::domain_error("Linear rings must have at least 3 points");
   }
+  if (BuffersPositions(format)) {
+    PositionBuffer storage;
+    return ClosedRingCoordinates<Json>(
+        PreparePositions(positions, true, format, storage), ccw, format);
+  }
+  return ClosedRingCoordinates<Json>(positions, ccw, format,
+                                     PositionChecker(format, true));
+}
 
-  // Close the ring
-  coords.push_back(coords[0]);
-
+/** Returns the coordinates array of a polygon given by point callbacks
+ *
+ *  \param dims           The dimension of the positions
+ *  \param numRings       The number of rings
+ *  \param getRingLength  A callback that takes the indices followed by the
+ *                        ring index and returns the length of the ring
+ *  \param format         How the coordinates are encoded
+ *  \param getPoint       A callback that takes the indices followed by the
+ *                        ring and point indices and sets the coordinates
+ *  \param indices        The leading indices given to the callbacks
+ */
+template <typename Json, int Dims, typename GetRingLength, typename GetPoint,
+          typename... Indices>
+Json PolygonCoordinates(Dimension<Dims> dims, size_t numRings,
+                        GetRingLength& getRingLength,
+                        const CoordinateFormat& format, GetPoint& getPoint,
+                        Indices... indices) {
+  auto coords = ReservedArray<Json>(numRings);
+  for (size_t i = 0; i < numRings; i++) {
+    coords.push_back(LinearRingCoordinates<Json>(
+        dims, getRingLength(indices..., i), i == 0, format, getPoint,
+        indices..., i));
+  }
   return coords;
 }
 
@@ -461,47 +2100,40 @@ nlohmann::json LinearRingCoordinates(size_t numPoints, bool ccw,
  *  \tparam GetPoint      A callable of the form
  *                        void(size_t ringIndex, size_t pointIndex, double& lon,
  *                             double& lat, double& alt)
+ *                        or void(size_t ringIndex, size_t pointIndex,
+ *                                double& lon, double& lat)
  *  \param numRings       The number of rings
  *  \param getRingLength  A callback that takes the ring index and returns the
  *                        length of the ring
  *  \param getPoint       A callback that takes the ring and point indices and
  *                        sets the lat/lon/altitude
+ *  \param format         How the coordinates are encoded
  *
  *  \return A JSON array that can go into the coordinates property of a
  *          Polygon object
  */
-template <typename GetRingLength, typename GetPoint,
-          detail::IsCallbackSignature<GetPoint, void, size_t, size_t, double&,
-                                      double&, double&> = true>
-nlohmann::json PolygonCoordinates(size_t numRings,
-                                  GetRingLength&& getRingLength,
-                                  GetPoint&& getPoint) {
-  nlohmann::json coords;
-  for (size_t i = 0; i < numRings; i++) {
-    coords.push_back(detail::LinearRingCoordinates(
-        getRingLength(i), i == 0,
-        [&](size_t j, double& lat, double& lon, double& alt) {
-          getPoint(i, j, lat, lon, alt);
-        }));
-  }
-
-  return coords;
+template <typename Json = nlohmann::json, typename GetRingLength,
+          typename GetPoint,
+          detail::IsPointCallback<GetPoint, size_t, size_t> = true>
+Json PolygonCoordinates(size_t numRings, GetRingLength&& getRingLength,
+                        GetPoint&& getPoint,
+                        const CoordinateFormat& format = CoordinateFormat()) {
+  return PolygonCoordinates<Json>(
+      CallbackDimension<GetPoint, size_t, size_t>(), numRings, getRingLength,
+      format, getPoint);
 }
 
 /** \overload */
-template <typename GetRingLength, typename GetPoint,
-          detail::IsCallbackSignature<GetPoint, void, size_t, size_t, double&,
-                                      double&> = true>
-nlohmann::json PolygonCoordinates(size_t numRings,
-                                  GetRingLength&& getRingLength,
-                                  GetPoint&& getPoint) {
-  nlohmann::json coords;
+template <typename Json = nlohmann::json>
+Json PolygonCoordinates(const PositionSpan& positions,
+                        const size_t* ringOffsets, size_t numRings,
+                        const CoordinateFormat& format = CoordinateFormat()) {
+  CheckOffsets(ringOffsets, numRings, positions.Size());
+  auto coords = ReservedArray<Json>(numRings);
   for (size_t i = 0; i < numRings; i++) {
-    coords.push_back(detail::LinearRingCoordinates(
-        getRingLength(i), i == 0,
-        [&](size_t j, double& lat, double& lon) { getPoint(i, j, lat, lon); }));
+    coords.push_back(LinearRingCoordinates<Json>(
+        positions.Slice(ringOffsets[i], ringOffsets[i + 1]), i == 0, format));
   }
-
   return coords;
 }
 }
@@ -517,12 +2149,15 @@ nlohmann::json PolygonCoordinates(size_t numRings,
  *                        length of the ring
  *  \param getPoint       A callback that takes the ring and point indices and
  *                        sets the lat/lon/altitude
+ *  \param format         How the coordinates are encoded
  *
  *  \return A GeoJSON Polygon object
  */
-template <typename GetRingLength, typename GetPoint>
-nlohmann::json Polygon(size_t numRings, GetRingLength&& getRingLength,
-                       GetPoint&& getPoint) {
+template <typename Json = nlohmann::json, typename GetRingLength,
+          typename GetPoint>
+Json Polygon(size_t numRings, GetRingLength&& getRingLength,
+             GetPoint&& getPoint,
+             const CoordinateFormat& format = CoordinateFormat()) {
   static_assert(
       detail::is_invocable_r<void, GetPoint, size_t, size_t, double&, double&,
                              double&>::value ||
@@ -530,9 +2165,34 @@ nlohmann::json Polygon(size_t numRings, GetRingLength&& getRingLength,
                                  double&>::value,
       "GetPoint callback must either be void(size_t, size_t, double&, "
       "double&, double&) or void(size_t, size_t, double&, double&)");
-  return detail::CoordinatesObject<Type::Polygon>(detail::PolygonCoordinates(
-      numRings, std::forward<GetRingLength>(getRingLength),
-      std::forward<GetPoint>(getPoint)));
+  return detail::BoundedCoordinatesObject<Type::Polygon, Json>(
+      format, [&](const CoordinateFormat& f) {
+        return detail::PolygonCoordinates<Json>(
+            numRings, std::forward<GetRingLength>(getRingLength),
+            std::forward<GetPoint>(getPoint), f);
+      });
+}
+
+/** Returns a Polygon GeoJSON object (section 3.1.6) from positions held in
+ *  contiguous memory
+ *
+ *  \param positions    The points of all of the rings
+ *  \param ringOffsets  Array of numRings + 1 offsets into positions, ring i
+ *                      is made of positions [ringOffsets[i], ringOffsets[i+1])
+ *  \param numRings     The number of rings, the first being the outer ring
+ *  \param format       How the coordinates are encoded
+ *
+ *  \return A GeoJSON Polygon object
+ */
+template <typename Json = nlohmann::json>
+Json Polygon(const PositionSpan& positions, const size_t* ringOffsets,
+             size_t numRings,
+             const CoordinateFormat& format = CoordinateFormat()) {
+  auto coords = detail::PolygonCoordinates<Json>(positions, ringOffsets,
+                                                numRings, format);
+  return detail::SpanCoordinatesObject<Type::Polygon, Json>(
+      std::move(coords),
+      detail::OffsetPositions(positions, ringOffsets, numRings), format);
 }
 
 namespace detail {
@@ -546,6 +2206,7 @@ namespace detail {
  *                        void(size_t polyIndex, size_t ringIndex,
  *                             size_t pointIndex, double& lon, double& lat,
  *                             double& alt)
+ *                        or the same without the altitude
  *  \param numPolygons    The number of polygons
  *  \param getNumRings    A callback that takes the polygon index and returns
  *                        the number of rings
@@ -553,45 +2214,40 @@ namespace detail {
  *                        returns the length of the ring
  *  \param getPoint       A callback that takes the polygon, ring and point
  *                        indices and sets the lat/lon/altitude
+ *  \param format         How the coordinates are encoded
  *
  *  \return A JSON array that can go into the coordinates property of a
  *          MultiPolygon object
  */
-template <typename GetNumRings, typename GetRingLength, typename GetPoint,
-          detail::IsCallbackSignature<GetPoint, void, size_t, size_t, size_t,
-                                      double&, double&, double&> = true>
-nlohmann::json MultiPolygonCoordinates(size_t numPolygons,
-                                       GetNumRings&& getNumRings,
-                                       GetRingLength&& getRingLength,
-                                       GetPoint&& getPoint) {
-  nlohmann::json coords;
+template <typename Json = nlohmann::json, typename GetNumRings,
+          typename GetRingLength, typename GetPoint,
+          detail::IsPointCallback<GetPoint, size_t, size_t, size_t> = true>
+Json MultiPolygonCoordinates(
+    size_t numPolygons, GetNumRings&& getNumRings,
+    GetRingLength&& getRingLength, GetPoint&& getPoint,
+    const CoordinateFormat& format = CoordinateFormat()) {
+  CallbackDimension<GetPoint, size_t, size_t, size_t> dims;
+  auto coords = ReservedArray<Json>(numPolygons);
   for (size_t i = 0; i < numPolygons; i++) {
-    coords.push_back(detail::PolygonCoordinates(
-        getNumRings(i),
-        [&](size_t ring) -> size_t { return getRingLength(i, ring); },
-        [&](size_t ring, size_t pt, double& lon, double& lat, double& alt) {
-          getPoint(i, ring, pt, lon, lat, alt);
-        }));
+    coords.push_back(PolygonCoordinates<Json>(dims, getNumRings(i),
+                                              getRingLength, format, getPoint,
+                                              i));
   }
   return coords;
 }
 
 /** \overload */
-template <typename GetNumRings, typename GetRingLength, typename GetPoint,
-          detail::IsCallbackSignature<GetPoint, void, size_t, size_t, size_t,
-                                      double&, double&> = true>
-nlohmann::json MultiPolygonCoordinates(size_t numPolygons,
-                                       GetNumRings&& getNumRings,
-                                       GetRingLength&& getRingLength,
-                                       GetPoint&& getPoint) {
-  nlohmann::json coords;
+template <typename Json = nlohmann::json>
+Json MultiPolygonCoordinates(
+    const PositionSpan& positions, const size_t* polygonOffsets,
+    size_t numPolygons, const size_t* ringOffsets, size_t numRings,
+    const CoordinateFormat& format = CoordinateFormat()) {
+  CheckOffsets(polygonOffsets, numPolygons, numRings);
+  auto coords = ReservedArray<Json>(numPolygons);
   for (size_t i = 0; i < numPolygons; i++) {
-    coords.push_back(PolygonCoordinates(
-        getNumRings(i),
-        [&](size_t ring) -> size_t { return getRingLength(i, ring); },
-        [&](size_t ring, size_t pt, double& lon, double& lat) {
-          getPoint(i, ring, pt, lon, lat);
-        }));
+    coords.push_back(PolygonCoordinates<Json>(
+        positions, ringOffsets + polygonOffsets[i],
+        polygonOffsets[i + 1] - polygonOffsets[i], format));
   }
   return coords;
 }
@@ -613,13 +2269,15 @@ nlohmann::json MultiPolygonCoordinates(size_t numPolygons,
  *                        returns the length of the ring
  *  \param getPoint       A callback that takes the polygon, ring and point
  *                        indices and sets the lat/lon/altitude
+ *  \param format         How the coordinates are encoded
  *
  *  \return A GeoJSON MultiPolygon object
  */
-template <typename GetNumRings, typename GetRingLength, typename GetPoint>
-nlohmann::json MultiPolygon(size_t numPolygons, GetNumRings&& getNumRings,
-                            GetRingLength&& getRingLength,
-                            GetPoint&& getPoint) {
+template <typename Json = nlohmann::json, typename GetNumRings,
+          typename GetRingLength, typename GetPoint>
+Json MultiPolygon(size_t numPolygons, GetNumRings&& getNumRings,
+                  GetRingLength&& getRingLength, GetPoint&& getPoint,
+                  const CoordinateFormat& format = CoordinateFormat()) {
   static_assert(
       detail::is_invocable_r<void, GetPoint, size_t, size_t, size_t, double&,
                              double&, double&>::value ||
@@ -627,14 +2285,51 @@ nlohmann::json MultiPolygon(size_t numPolygons, GetNumRings&& getNumRings,
                                  double&, double&>::value,
       "GetPoint callback must either be void(size_t, size_t, size_t, double&, "
       "double&, double&) or void(size_t, size_t, size_t, double&, double&)");
-  return detail::CoordinatesObject<Type::MultiPolygon>(
-      detail::MultiPolygonCoordinates(
-          numPolygons, std::forward<GetNumRings>(getNumRings),
-          std::forward<GetRingLength>(getRingLength),
-          std::forward<GetPoint>(getPoint)));
+  return detail::BoundedCoordinatesObject<Type::MultiPolygon, Json>(
+      format, [&](const CoordinateFormat& f) {
+        return detail::MultiPolygonCoordinates<Json>(
+            numPolygons, std::forward<GetNumRings>(getNumRings),
+            std::forward<GetRingLength>(getRingLength),
+            std::forward<GetPoint>(getPoint), f);
+      });
+}
+
+/** Returns a MultiPolygon GeoJSON object (section 3.1.7) from positions held
+ *  in contiguous memory
+ *
+ *  \param positions       The points of all of the rings of all polygons
+ *  \param polygonOffsets  Array of numPolygons + 1 offsets into ringOffsets,
+ *                         polygon i is made of rings
+ *                         [polygonOffsets[i], polygonOffsets[i+1])
+ *  \param numPolygons     The number of polygons
+ *  \param ringOffsets     Array of numRings + 1 offsets into positions, ring
+ *                         j is made of positions
+ *                         [ringOffsets[j], ringOffsets[j+1])
+ *  \param numRings        The number of rings, which the polygon offsets
+ *                         must not go past
+ *  \param format          How the coordinates are encoded
+ *
+ *  \return A GeoJSON MultiPolygon object
+ */
+template <typename Json = nlohmann::json>
+Json MultiPolygon(const PositionSpan& positions, const size_t* polygonOffsets,
+                  size_t numPolygons, const size_t* ringOffsets,
+                  size_t numRings,
+                  const CoordinateFormat& format = CoordinateFormat()) {
+  auto coords = detail::MultiPolygonCoordinates<Json>(
+      positions, polygonOffsets, numPolygons, ringOffsets, numRings, format);
+  return detail::SpanCoordinatesObject<Type::MultiPolygon, Json>(
+      std::move(coords),
+      positions.Slice(ringOffsets[polygonOffsets[0]],
+                      ringOffsets[polygonOffsets[numPolygons]]),
+      format);
 }
 
 /** Returns a GeometryCollection object (section 3.1.8)
+ *
+ *  If every geometry has a bbox member, i.e. they were built with
+ *  CoordinateFormat::WithBoundingBoxes(), the collection is given the union
+ *  of them.
  *
  *  \tparam Callable      A callable of the form
  *                        nlohmann::json(size_t index)
@@ -644,78 +2339,168 @@ nlohmann::json MultiPolygon(size_t numPolygons, GetNumRings&& getNumRings,
  *
  *  \return A GeometryCollection JSON object
  */
-template <typename Callable>
-nlohmann::json GeometryCollection(size_t numGeometries,
-                                  Callable&& getGeometry) {
-  nlohmann::json j;
+template <typename Json = nlohmann::json, typename Callable>
+Json GeometryCollection(size_t numGeometries, Callable&& getGeometry) {
+  auto j = detail::ReservedArray<Json>(numGeometries);
+  BoundingBox bounds;
+  bool bounded = numGeometries > 0;
   for (size_t i = 0; i < numGeometries; i++) {
     j.push_back(getGeometry(i));
+    bounded = bounded && detail::ExtendBounds(bounds, j.back());
   }
 
-  return nlohmann::json{{"type", TypeName<Type::GeometryCollection>()},
-                        {"geometries", j}};
+  Json collection{{"type", TypeName<Type::GeometryCollection>()},
+                  {"geometries", std::move(j)}};
+  if (bounded && !bounds.Empty()) {
+    collection["bbox"] = bounds.template ToJson<Json>();
+  }
+  return collection;
+}
+
+namespace detail {
+
+/** Returns a Feature object (section 3.2) made from the given members
+ *
+ *  The members are moved into the object, rather than going through an
+ *  initializer list or operator[], which would copy them or look them up.
+ *
+ *  \param geometry   A GeoJSON object for the geometry
+ *  \param properties A JSON object holding properties for the feature
+ *  \param id         The ID of the feature, or null for no ID
+ */
+template <typename Json>
+Json FeatureObject(Json&& geometry, Json&& properties, Json* id) {
+  Json j(Json::value_t::object);
+  auto& members = j.template get_ref<typename Json::object_t&>();
+  members.emplace("type", Json(TypeName<Type::Feature>()));
+  if (id) members.emplace("id", std::move(*id));
+  auto bbox = geometry.find("bbox");
+  if (bbox != geometry.end()) members.emplace("bbox", *bbox);
+  members.emplace("geometry", std::move(geometry));
+  members.emplace("properties", std::move(properties));
+  return j;
+}
+
+/** Enables the Feature overloads for geometries that are not a basic_json,
+ *  such as nullptr, or braces that leave the type to its default
+ */
+template <typename Geometry>
+using IsPlainGeometry = typename std::enable_if<
+    !nlohmann::detail::is_basic_json<Geometry>::value, bool>::type;
 }
 
 /** Returns a Feature object (section 3.2)
  *
+ *  The geometry and properties are taken by value, so they are moved into the
+ *  feature when given as rvalues, i.e. Feature(std::move(geometry), ...). The
+ *  feature is given the bbox member of the geometry, if it has one.
+ *
+ *  \tparam Json      The nlohmann::basic_json type, deduced from the geometry
  *  \param geometry   A GeoJSON object for the geometry
  *  \param properties A JSON object holding properties for the feature
  *
  *  \return A GeoJSON Feature object
  */
-inline nlohmann::json Feature(const nlohmann::json& geometry,
-                              const nlohmann::json& properties) {
-  return nlohmann::json{{"type", TypeName<Type::Feature>()},
-                        {"geometry", geometry},
-                        {"properties", properties}};
+template <typename Json>
+Json Feature(Json geometry, typename detail::Identity<Json>::type properties) {
+  return detail::FeatureObject<Json>(std::move(geometry),
+                                     std::move(properties), nullptr);
+}
+
+/** \overload for a geometry that is not a basic_json, e.g. a null geometry
+ *  as in Feature(nullptr, properties), or one given in braces, which make a
+ *  nlohmann::json feature
+ */
+template <typename Geometry = nlohmann::json::initializer_list_t,
+          detail::IsPlainGeometry<Geometry> = true>
+nlohmann::json Feature(Geometry geometry, nlohmann::json properties) {
+  return detail::FeatureObject<nlohmann::json>(
+      nlohmann::json(std::move(geometry)), std::move(properties), nullptr);
 }
 
 /** Returns a Feature object (section 3.2)
  *
+ *  \tparam Json      The nlohmann::basic_json type, deduced from the geometry
  *  \param id         The ID of the feature
  *  \param geometry   A GeoJSON object for the geometry
  *  \param properties A JSON object holding properties for the feature
  *
  *  \return A GeoJSON Feature object
  */
-inline nlohmann::json Feature(const std::string& id,
-                              const nlohmann::json& geometry,
-                              const nlohmann::json& properties) {
-  auto j = Feature(geometry, properties);
-  j["id"] = id;
-  return j;
+template <typename Json>
+Json Feature(std::string id, Json geometry,
+             typename detail::Identity<Json>::type properties) {
+  Json idJ(std::move(id));
+  return detail::FeatureObject<Json>(std::move(geometry),
+                                     std::move(properties), &idJ);
+}
+
+/** \overload for a geometry that is not a basic_json */
+template <typename Geometry = nlohmann::json::initializer_list_t,
+          detail::IsPlainGeometry<Geometry> = true>
+nlohmann::json Feature(std::string id, Geometry geometry,
+                       nlohmann::json properties) {
+  nlohmann::json idJ(std::move(id));
+  return detail::FeatureObject<nlohmann::json>(
+      nlohmann::json(std::move(geometry)), std::move(properties), &idJ);
 }
 
 /** \overload */
-template <typename T, typename = typename std::enable_if<
-                          std::is_arithmetic<T>::value>::type>
-inline nlohmann::json Feature(T id, const nlohmann::json& geometry,
-                              const nlohmann::json& properties) {
-  auto j = Feature(geometry, properties);
-  j["id"] = id;
-  return j;
+template <typename T, typename Json,
+          typename = typename std::enable_if<
+              std::is_arithmetic<T>::value>::type>
+Json Feature(T id, Json geometry,
+             typename detail::Identity<Json>::type properties) {
+  Json idJ(id);
+  return detail::FeatureObject<Json>(std::move(geometry),
+                                     std::move(properties), &idJ);
+}
+
+/** \overload for a geometry that is not a basic_json */
+template <typename T, typename Geometry = nlohmann::json::initializer_list_t,
+          typename = typename std::enable_if<
+              std::is_arithmetic<T>::value>::type,
+          detail::IsPlainGeometry<Geometry> = true>
+nlohmann::json Feature(T id, Geometry geometry, nlohmann::json properties) {
+  nlohmann::json idJ(id);
+  return detail::FeatureObject<nlohmann::json>(
+      nlohmann::json(std::move(geometry)), std::move(properties), &idJ);
 }
 
 /** Returns a FeatureCollection object (section 3.3)
  *
+ *  If every feature with a geometry has a bbox member, the collection is
+ *  given the union of them.
+ *
+ *  \tparam Json        The nlohmann::basic_json type of the collection
  *  \param numFeatures  The number of features in the collection
  *  \param getFeature   Callback that takes the feature index and gives back the
  *                      feature.
  *
  *  \return A GeoJSON Feature object
  */
-template <typename Callback>
-inline nlohmann::json FeatureCollection(size_t numFeatures,
-                                        Callback&& getFeature) {
-  static_assert(detail::is_invocable_r<nlohmann::json, Callback, size_t>::value,
-                "Callback must be of the form nlohmann::json(size_t)");
+template <typename Json = nlohmann::json, typename Callback>
+Json FeatureCollection(size_t numFeatures, Callback&& getFeature) {
+  static_assert(detail::is_invocable_r<Json, Callback, size_t>::value,
+                "Callback must be of the form Json(size_t)");
 
-  nlohmann::json j{{"type", TypeName<Type::FeatureCollection>()}};
+  Json j{{"type", TypeName<Type::FeatureCollection>()}};
 
   auto& featuresJ = j["features"];
-  featuresJ = nlohmann::json::array();
+  featuresJ = detail::ReservedArray<Json>(numFeatures);
+  BoundingBox bounds;
+  bool bounded = true;
   for (size_t i = 0; i < numFeatures; i++) {
     featuresJ.push_back(getFeature(i));
+    const auto& feature = featuresJ.back();
+    if (bounded && !detail::ExtendBounds(bounds, feature)) {
+      // Features without geometries have nothing to bound
+      auto geometry = feature.find("geometry");
+      bounded = geometry != feature.end() && geometry->is_null();
+    }
+  }
+  if (bounded && !bounds.Empty()) {
+    j["bbox"] = bounds.template ToJson<Json>();
   }
   return j;
 }
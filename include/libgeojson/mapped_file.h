@@ -0,0 +1,134 @@
+/** Memory-mapped GeoJSON input for libgeojson
+ *
+ *  \file mapped_file.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <string>
+#include <system_error>
+
+#ifdef _WIN32
+#include <fstream>
+#include <sstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "libgeojson/reader.h"
+
+namespace geojson {
+
+/** A file mapped read-only into memory
+ *
+ *  The pages are read in by the system as they are touched, so reading a file
+ *  through the mapping does not copy it into a buffer first. Where mapping is
+ *  not available, the file is read into memory instead.
+ */
+class MappedFile {
+ public:
+  /** Maps a file
+   *
+   *  \param path  The path of the file
+   *
+   *  \throws std::system_error if the file cannot be opened or mapped
+   */
+  explicit MappedFile(const std::string& path) : data_(nullptr), size_(0) {
+#ifdef _WIN32
+    std::ifstream is(path, std::ios::binary);
+    if (!is) {
+      throw std::system_error(errno, std::generic_category(), path);
+    }
+    std::ostringstream contents;
+    contents << is.rdbuf();
+    buffer_ = contents.str();
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), path);
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) Fail(fd, path);
+    size_ = static_cast<size_t>(info.st_size);
+    if (size_ > 0) {
+      void* addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED) Fail(fd, path);
+      ::madvise(addr, size_, MADV_SEQUENTIAL);
+      data_ = static_cast<const char*>(addr);
+    }
+    ::close(fd);
+#endif
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept
+      : data_(other.data_), size_(other.size_) {
+#ifdef _WIN32
+    buffer_ = std::move(other.buffer_);
+    data_ = buffer_.data();
+#endif
+    other.data_ = nullptr;
+    other.size_ = 0;
+  }
+
+  /** Destructor, unmaps the file */
+  ~MappedFile() {
+#ifndef _WIN32
+    if (data_) ::munmap(const_cast<char*>(data_), size_);
+#endif
+  }
+
+  /** Returns the contents of the file */
+  const char* Data() const { return data_; }
+
+  /** Returns the size of the file in bytes */
+  size_t Size() const { return size_; }
+
+  /** Returns a view of the contents of the file */
+  StringView Text() const { return StringView(data_, size_); }
+
+ private:
+#ifndef _WIN32
+  [[noreturn]] static void Fail(int fd, const std::string& path) {
+    int error = errno;
+    ::close(fd);
+    throw std::system_error(error, std::generic_category(), path);
+  }
+#else
+  std::string buffer_;
+#endif
+
+  const char* data_;
+  size_t size_;
+};
+
+/** Reads a GeoJSON file through a memory map, giving its contents to a
+ *  handler as it is parsed
+ *
+ *  See Read(const char*, const char*, Handler&). The views given to
+ *  OnRawId(), OnRawProperties() and OnRawGeometry() are only valid until this
+ *  returns, to keep them for longer, map the file with MappedFile and read
+ *  its Text() instead.
+ *
+ *  \param path      The path of the file
+ *  \param handler   The handler for the contents of the GeoJSON
+ *
+ *  \throws std::system_error if the file cannot be opened or mapped
+ *  \throws nlohmann::json::parse_error if the input is not valid JSON
+ *  \throws std::domain_error if the input is not valid GeoJSON
+ */
+template <typename Handler>
+void ReadFile(const std::string& path, Handler& handler) {
+  MappedFile file(path);
+  Read(file.Data(), file.Data() + file.Size(), handler);
+}
+}
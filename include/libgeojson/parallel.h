@@ -0,0 +1,364 @@
+/** Parallel FeatureCollection output for libgeojson
+ *
+ *  \file parallel.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "libgeojson/writer.h"
+
+namespace geojson {
+
+/** The default number of features serialized together by one thread */
+static constexpr size_t kDefaultParallelChunkSize = 64;
+
+namespace detail {
+
+/** Appends the serialized JSON to the string, without a temporary string */
+template <typename Json>
+void AppendDump(std::string& out, const Json& j) {
+  nlohmann::detail::serializer<Json> serializer(
+      nlohmann::detail::output_adapter<char>(out), ' ');
+  serializer.dump(j, false, false, 0);
+}
+
+/** Appends an already serialized feature to a chunk */
+inline void AppendFeature(std::string& out, const std::string& feature) {
+  out += feature;
+}
+
+/** Appends a feature to a chunk */
+inline void AppendFeature(std::string& out, const nlohmann::json& feature) {
+  AppendDump(out, feature);
+}
+
+/** \overload for other nlohmann::basic_json types */
+template <typename Json,
+          typename = typename std::enable_if<
+              nlohmann::detail::is_basic_json<Json>::value &&
+              !std::is_same<Json, nlohmann::json>::value>::type>
+void AppendFeature(std::string& out, const Json& feature) {
+  AppendDump(out, feature);
+}
+
+/** State shared between the writing thread and the workers
+ *
+ *  Chunks are claimed in index order, and only within a window of chunks
+ *  past the last one written, which bounds the amount of buffered output. A
+ *  worker that finds the window full returns rather than waiting for the
+ *  writing thread, which may be the one running it, e.g. with an executor
+ *  that runs tasks inline. The writing thread produces any chunk that no
+ *  worker has claimed, and starts workers again as the window moves on.
+ *
+ *  \tparam Result  What is produced for each chunk, e.g. its text
+ */
+template <typename Result>
+class BasicParallelChunks
+    : public std::enable_shared_from_this<BasicParallelChunks<Result>> {
+ public:
+  /** Constructor
+   *
+   *  \param numChunks  The number of chunks
+   *  \param window     How many chunks can be buffered at once
+   *  \param produce    Fills in the result of a chunk, only called for chunks
+   *                    claimed before Cancel()
+   */
+  BasicParallelChunks(size_t numChunks, size_t window,
+                      std::function<void(size_t, Result&)> produce)
+      : produced_(numChunks), producedFutures_(numChunks), window_(window),
+        nextChunk_(0), numWritten_(0), numWorkers_(0), cancelled_(false),
+        produce_(std::move(produce)) {
+    for (size_t i = 0; i < numChunks; i++) {
+      producedFutures_[i] = produced_[i].get_future();
+    }
+  }
+
+  size_t NumChunks() const { return produced_.size(); }
+
+  /** Gives the executor workers while there are chunks in the window for
+   *  them, with at most maxWorkers of them at once
+   *
+   *  Called by the writing thread before the first chunk and after each one
+   *  it writes. The workers hold on to the shared state, so ones that start
+   *  after the writing thread returns see that there is nothing left to do.
+   */
+  template <typename Executor>
+  void StartWorkers(Executor& executor, size_t maxWorkers) {
+    while (numWorkers_.load() < maxWorkers && CanClaim()) {
+      numWorkers_++;
+      auto self = this->shared_from_this();
+      executor(std::function<void()>([self] { self->Work(); }));
+    }
+  }
+
+  /** Returns the result of a chunk, producing it on this thread if no worker
+   *  has claimed it, and rethrows any error from producing it
+   */
+  Result Take(size_t chunk) {
+    size_t expected = chunk;
+    if (nextChunk_.compare_exchange_strong(expected, chunk + 1)) Run(chunk);
+    return producedFutures_[chunk].get();
+  }
+
+  /** Marks a chunk as written, moving the window on */
+  void MarkWritten(size_t chunk) { numWritten_ = chunk + 1; }
+
+  /** Stops the workers from claiming chunks and waits for the chunks that are
+   *  in flight
+   *
+   *  \param numWritten  The number of chunks that were marked as written
+   */
+  void Cancel(size_t numWritten) {
+    cancelled_ = true;
+    size_t claimed = std::min(nextChunk_.exchange(NumChunks()), NumChunks());
+    for (size_t i = numWritten; i < claimed; i++) {
+      if (producedFutures_[i].valid()) producedFutures_[i].wait();
+    }
+  }
+
+ private:
+  /** The loop run by each worker, until the window is full */
+  void Work() {
+    size_t chunk;
+    while (Claim(chunk)) Run(chunk);
+    numWorkers_--;
+  }
+
+  /** Returns whether the next chunk is in the window */
+  bool CanClaim() const {
+    size_t next = nextChunk_.load();
+    return next < NumChunks() && next < numWritten_.load() + window_;
+  }
+
+  /** Claims the next chunk if it is in the window */
+  bool Claim(size_t& chunk) {
+    size_t next = nextChunk_.load();
+    do {
+      if (next >= NumChunks() || next >= numWritten_.load() + window_) {
+        return false;
+      }
+    } while (!nextChunk_.compare_exchange_weak(next, next + 1));
+    chunk = next;
+    return true;
+  }
+
+  void Run(size_t chunk) {
+    Result result;
+    std::exception_ptr error;
+    if (!cancelled_) {
+      try {
+        produce_(chunk, result);
+      } catch (...) {
+        error = std::current_exception();
+      }
+    }
+    if (error) {
+      produced_[chunk].set_exception(error);
+    } else {
+      produced_[chunk].set_value(std::move(result));
+    }
+  }
+
+  std::vector<std::promise<Result>> produced_;
+  std::vector<std::future<Result>> producedFutures_;
+  size_t window_;
+  std::atomic<size_t> nextChunk_;
+  std::atomic<size_t> numWritten_;
+  std::atomic<size_t> numWorkers_;
+  std::atomic<bool> cancelled_;
+  std::function<void(size_t, Result&)> produce_;
+};
+
+/** Chunks of serialized features */
+using ParallelChunks = BasicParallelChunks<std::string>;
+
+/** Writes numFeatures features from getFeature to the given sink, with the
+ *  features serialized in parallel by workers given to the executor
+ */
+template <typename Sink, typename Callback, typename Executor>
+void WriteFeatureCollectionParallel(Sink sink, size_t numFeatures,
+                                    Callback& getFeature, Executor& executor,
+                                    size_t numWorkers, size_t chunkSize) {
+  if (chunkSize == 0) chunkSize = kDefaultParallelChunkSize;
+  size_t numChunks = (numFeatures + chunkSize - 1) / chunkSize;
+
+  auto chunks = std::make_shared<ParallelChunks>(
+      numChunks, 4 * (numWorkers + 1), [&](size_t chunk, std::string& out) {
+        size_t begin = chunk * chunkSize;
+        size_t end = std::min(numFeatures, begin + chunkSize);
+        for (size_t i = begin; i < end; i++) {
+          if (i > begin) out += ',';
+          AppendFeature(out, getFeature(i));
+        }
+      });
+
+  BasicFeatureCollectionWriter<Sink> writer(std::move(sink));
+  size_t numWritten = 0;
+  try {
+    chunks->StartWorkers(executor, numWorkers);
+    for (; numWritten < numChunks; numWritten++) {
+      writer.WriteRaw(chunks->Take(numWritten));
+      chunks->MarkWritten(numWritten);
+      chunks->StartWorkers(executor, numWorkers);
+    }
+  } catch (...) {
+    // The chunks in flight reference getFeature, so they must finish first
+    chunks->Cancel(numWritten);
+    throw;
+  }
+  writer.Close();
+}
+
+/** An executor that runs each task on a new thread
+ *
+ *  The threads whose tasks are done are joined when the next task is given,
+ *  and the others on destruction, so the threads held are about those of the
+ *  tasks running, however many tasks are given.
+ */
+class ThreadExecutor {
+ public:
+  ThreadExecutor() = default;
+  ThreadExecutor(const ThreadExecutor&) = delete;
+  ThreadExecutor& operator=(const ThreadExecutor&) = delete;
+
+  ~ThreadExecutor() {
+    for (auto& worker : workers_) worker.thread.join();
+  }
+
+  void operator()(std::function<void()> task) {
+    for (auto& worker : workers_) {
+      if (*worker.done) worker.thread.join();
+    }
+    workers_.erase(std::remove_if(workers_.begin(), workers_.end(),
+                                  [](const Worker& worker) {
+                                    return !worker.thread.joinable();
+                                  }),
+                   workers_.end());
+    auto done = std::make_shared<std::atomic<bool>>(false);
+    std::thread thread([task, done] {
+      task();
+      *done = true;
+    });
+    workers_.push_back({std::move(thread), done});
+  }
+
+ private:
+  struct Worker {
+    std::thread thread;
+    std::shared_ptr<std::atomic<bool>> done;
+  };
+
+  std::vector<Worker> workers_;
+};
+
+/** Returns the number of worker threads to use besides the calling thread */
+inline size_t NumWorkerThreads(size_t numThreads) {
+  if (numThreads == 0) numThreads = std::thread::hardware_concurrency();
+  return numThreads > 1 ? numThreads - 1 : 0;
+}
+
+template <typename Executor>
+using IsExecutor = typename std::enable_if<
+    is_invocable<Executor, std::function<void()>>::value, bool>::type;
+}
+
+/** Writes a FeatureCollection object (section 3.3) to a stream, with the
+ *  features produced and serialized in parallel
+ *
+ *  The features are split into chunks of consecutive features, which are
+ *  serialized into separate buffers by the workers and written in index
+ *  order, so the output is identical to that of WriteFeatureCollection().
+ *  getFeature is called concurrently from several threads.
+ *
+ *  \tparam Callback    A callable of the form nlohmann::json(size_t index) or
+ *                      std::string(size_t index), giving serialized features
+ *                      (i.e. from geojson::text)
+ *  \param os           The stream to write to
+ *  \param numFeatures  The number of features in the collection
+ *  \param getFeature   Callback that takes the feature index and gives back
+ *                      the feature.
+ *  \param numThreads   The number of threads, including the calling thread,
+ *                      0 meaning one per hardware thread
+ *  \param chunkSize    The number of features in each chunk
+ */
+template <typename Callback>
+void WriteFeatureCollectionParallel(
+    std::ostream& os, size_t numFeatures, Callback&& getFeature,
+    size_t numThreads = 0, size_t chunkSize = kDefaultParallelChunkSize) {
+  detail::ThreadExecutor executor;
+  detail::WriteFeatureCollectionParallel(
+      StreamSink(os), numFeatures, getFeature, executor,
+      detail::NumWorkerThreads(numThreads), chunkSize);
+}
+
+/** \overload */
+template <typename Callback>
+void WriteFeatureCollectionParallel(
+    std::string& str, size_t numFeatures, Callback&& getFeature,
+    size_t numThreads = 0, size_t chunkSize = kDefaultParallelChunkSize) {
+  detail::ThreadExecutor executor;
+  detail::WriteFeatureCollectionParallel(
+      StringSink(str), numFeatures, getFeature, executor,
+      detail::NumWorkerThreads(numThreads), chunkSize);
+}
+
+/** Writes a FeatureCollection object (section 3.3) to a stream, with the
+ *  features produced and serialized in parallel by tasks run on an executor
+ *
+ *  The calling thread serializes the chunks that no task has claimed, and
+ *  tasks return rather than wait for the calling thread, so the collection
+ *  is written whether the executor runs the tasks on other threads, runs
+ *  them inline before returning, or does not get to them. Tasks are given
+ *  to the executor again as chunks are written, so it may be called many
+ *  times.
+ *
+ *  \tparam Callback    A callable of the form nlohmann::json(size_t index) or
+ *                      std::string(size_t index)
+ *  \tparam Executor    A callable of the form void(std::function<void()>),
+ *                      i.e. one submitting the task to a thread pool
+ *  \param os           The stream to write to
+ *  \param numFeatures  The number of features in the collection
+ *  \param getFeature   Callback that takes the feature index and gives back
+ *                      the feature.
+ *  \param executor     The executor for the worker tasks
+ *  \param numWorkers   The most worker tasks to have given to the executor
+ *                      and not finished at once
+ *  \param chunkSize    The number of features in each chunk
+ */
+template <typename Callback, typename Executor,
+          detail::IsExecutor<Executor> = true>
+void WriteFeatureCollectionParallel(
+    std::ostream& os, size_t numFeatures, Callback&& getFeature,
+    Executor&& executor, size_t numWorkers,
+    size_t chunkSize = kDefaultParallelChunkSize) {
+  detail::WriteFeatureCollectionParallel(StreamSink(os), numFeatures,
+                                         getFeature, executor, numWorkers,
+                                         chunkSize);
+}
+
+/** \overload */
+template <typename Callback, typename Executor,
+          detail::IsExecutor<Executor> = true>
+void WriteFeatureCollectionParallel(
+    std::string& str, size_t numFeatures, Callback&& getFeature,
+    Executor&& executor, size_t numWorkers,
+    size_t chunkSize = kDefaultParallelChunkSize) {
+  detail::WriteFeatureCollectionParallel(StringSink(str), numFeatures,
+                                         getFeature, executor, numWorkers,
+                                         chunkSize);
+}
+}
@@ -0,0 +1,323 @@
+/** Parallel GeoJSON input for libgeojson
+ *
+ *  \file parallel_reader.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "libgeojson/parallel.h"
+#include "libgeojson/reader.h"
+#include "libgeojson/sequence.h"
+
+namespace geojson {
+
+/** The default number of bytes of input read together by one thread */
+static constexpr size_t kDefaultParallelReadChunkSize = 4 * 1024 * 1024;
+
+namespace detail {
+
+/** A range of the input that is read by one task */
+struct TextChunk {
+  const char* first;
+  const char* last;
+};
+
+/** The type of the handlers made by a MakeHandler */
+template <typename MakeHandler>
+using ChunkHandler = typename std::decay<decltype(
+    std::declval<MakeHandler&>()(std::declval<size_t>()))>::type;
+
+/** Runs numbered tasks on the calling thread and on workers, in any order
+ *
+ *  Once a task throws, the tasks that have not started are skipped.
+ */
+class ParallelTasks {
+ public:
+  ParallelTasks(size_t numTasks, std::function<void(size_t)> run)
+      : done_(numTasks), doneFutures_(numTasks), nextTask_(0),
+        cancelled_(false), run_(std::move(run)) {
+    for (size_t i = 0; i < numTasks; i++) {
+      doneFutures_[i] = done_[i].get_future();
+    }
+  }
+
+  size_t NumTasks() const { return done_.size(); }
+
+  /** The loop run by each worker and the calling thread */
+  void Work() {
+    for (;;) {
+      size_t task = nextTask_.fetch_add(1);
+      if (task >= NumTasks()) break;
+      try {
+        if (!cancelled_) run_(task);
+        done_[task].set_value();
+      } catch (...) {
+        cancelled_ = true;
+        done_[task].set_exception(std::current_exception());
+      }
+    }
+  }
+
+  /** Waits for every task, then rethrows the error of the first one that
+   *  failed, in task order
+   */
+  void Wait() {
+    for (auto& future : doneFutures_) future.wait();
+    for (auto& future : doneFutures_) future.get();
+  }
+
+ private:
+  std::vector<std::promise<void>> done_;
+  std::vector<std::future<void>> doneFutures_;
+  std::atomic<size_t> nextTask_;
+  std::atomic<bool> cancelled_;
+  std::function<void(size_t)> run_;
+};
+
+/** Reads each chunk into its own handler, with the chunks read in parallel by
+ *  workers given to the executor and the calling thread
+ */
+template <typename MakeHandler, typename Executor, typename ReadChunk>
+std::vector<ChunkHandler<MakeHandler>> ReadChunksParallel(
+    const std::vector<TextChunk>& chunks, MakeHandler& makeHandler,
+    Executor& executor, size_t numWorkers, ReadChunk&& readChunk) {
+  using Handler = ChunkHandler<MakeHandler>;
+  std::vector<Handler> handlers;
+  handlers.reserve(chunks.size());
+  for (size_t i = 0; i < chunks.size(); i++) {
+    handlers.push_back(makeHandler(i));
+  }
+
+  auto tasks = std::make_shared<ParallelTasks>(
+      chunks.size(), [&](size_t chunk) {
+        ReaderSax<Handler> sax(handlers[chunk]);
+        readChunk(chunks[chunk], sax);
+      });
+
+  // Workers only hold on to the shared state, so ones that start after we
+  // return see that there is nothing left to do
+  for (size_t i = 0; i < numWorkers && i + 1 < chunks.size(); i++) {
+    executor(std::function<void()>([tasks] { tasks->Work(); }));
+  }
+  tasks->Work();
+  tasks->Wait();
+  return handlers;
+}
+
+/** Splits a sequence into chunks of about chunkSize bytes, at records */
+inline std::vector<TextChunk> SequenceChunks(const char* begin,
+                                             const char* end,
+                                             size_t chunkSize) {
+  if (chunkSize == 0) chunkSize = kDefaultParallelReadChunkSize;
+  StringView text(begin, static_cast<size_t>(end - begin));
+  std::vector<TextChunk> chunks;
+  size_t first = 0;
+  while (first < text.Size()) {
+    size_t last = SequenceRecordStart(text, first + chunkSize);
+    chunks.push_back(TextChunk{begin + first, begin + last});
+    first = last;
+  }
+  return chunks;
+}
+
+/** Splits the features array of a FeatureCollection into chunks of whole
+ *  features of about chunkSize bytes
+ *
+ *  This only scans the structure of the text, finding where each feature ends
+ *  without parsing it.
+ *
+ *  \throws nlohmann::json::parse_error if the input is not valid JSON
+ *  \throws std::domain_error if the input is not a FeatureCollection
+ */
+inline std::vector<TextChunk> FeatureChunks(const char* begin, const char* end,
+                                            size_t chunkSize) {
+  if (chunkSize == 0) chunkSize = kDefaultParallelReadChunkSize;
+  std::vector<TextChunk> chunks;
+  bool hasFeatures = false;
+
+  TextCursor cursor(begin, end);
+  cursor.SkipWhitespace();
+  cursor.Expect('{');
+  cursor.SkipWhitespace();
+  while (cursor.Peek() != '}') {
+    bool escaped;
+    StringView key = cursor.ScanString(escaped);
+    cursor.SkipWhitespace();
+    cursor.Expect(':');
+    cursor.SkipWhitespace();
+    if (key == "type") {
+      const char* value = cursor.p;
+      cursor.SkipValue();
+      if (StringView(value, static_cast<size_t>(cursor.p - value)) !=
+          "\"FeatureCollection\"") {
+        throw std::domain_error("Expected a FeatureCollection");
+      }
+    } else if (key == "features") {
+      hasFeatures = true;
+      cursor.Expect('[');
+      cursor.SkipWhitespace();
+      const char* first = nullptr;
+      while (cursor.Peek() != ']') {
+        if (!first) first = cursor.p;
+        cursor.SkipValue();
+        if (static_cast<size_t>(cursor.p - first) >= chunkSize) {
+          chunks.push_back(TextChunk{first, cursor.p});
+          first = nullptr;
+        }
+        cursor.SkipWhitespace();
+        if (cursor.Peek() != ',') break;
+        cursor.p++;
+        cursor.SkipWhitespace();
+      }
+      cursor.Expect(']');
+      if (first) chunks.push_back(TextChunk{first, cursor.p - 1});
+    } else {
+      cursor.SkipValue();
+    }
+    cursor.SkipWhitespace();
+    if (cursor.Peek() != ',') break;
+    cursor.p++;
+    cursor.SkipWhitespace();
+  }
+  cursor.Expect('}');
+  cursor.SkipWhitespace();
+  if (!cursor.AtEnd()) cursor.Error("expected end of input");
+  if (!hasFeatures) {
+    throw std::domain_error("FeatureCollection has no features");
+  }
+  return chunks;
+}
+
+/** Reads one chunk of a sequence */
+struct ReadSequenceChunk {
+  template <typename Sax>
+  void operator()(const TextChunk& chunk, Sax& sax) const {
+    ReadRecords(begin, chunk.first, chunk.last, sax);
+  }
+
+  const char* begin;
+};
+
+/** Reads one chunk of the features of a FeatureCollection */
+struct ReadFeatureChunk {
+  template <typename Sax>
+  void operator()(const TextChunk& chunk, Sax& sax) const {
+    TextCursor cursor(begin, chunk.last);
+    cursor.p = chunk.first;
+    TextScanner<Sax>(cursor, sax).RunList();
+  }
+
+  const char* begin;
+};
+}
+
+/** Reads a GeoJSON Text Sequence (RFC 8142) held in memory in parallel
+ *
+ *  The input is split at records into chunks of about chunkSize bytes, and
+ *  each chunk is read on one of the threads into a handler of its own. The
+ *  handlers are returned in the order of the chunks, so going through them
+ *  in order sees the features in the order of the input. Each handler
+ *  numbers its features from 0, and the handlers can be created from the
+ *  index of their chunk.
+ *
+ *  \tparam MakeHandler  A callable of the form Handler(size_t chunk), where
+ *                       Handler has the methods of ReaderHandler
+ *  \param begin         The start of the sequence, e.g. a MappedFile
+ *  \param end           One past the end of the sequence
+ *  \param makeHandler   Creates the handler of each chunk, on this thread
+ *  \param numThreads    The number of threads, including the calling thread,
+ *                       0 meaning one per hardware thread
+ *  \param chunkSize     The number of bytes in each chunk
+ *
+ *  \return The handlers of the chunks, in order
+ *
+ *  \throws nlohmann::json::parse_error if a record is not valid JSON
+ *  \throws std::domain_error if a record is not valid GeoJSON
+ */
+template <typename MakeHandler>
+auto ReadSequenceParallel(const char* begin, const char* end,
+                          MakeHandler&& makeHandler, size_t numThreads = 0,
+                          size_t chunkSize = kDefaultParallelReadChunkSize)
+    -> std::vector<detail::ChunkHandler<MakeHandler>> {
+  detail::ThreadExecutor executor;
+  return detail::ReadChunksParallel(
+      detail::SequenceChunks(begin, end, chunkSize), makeHandler, executor,
+      detail::NumWorkerThreads(numThreads), detail::ReadSequenceChunk{begin});
+}
+
+/** \overload with the workers run by an executor, see
+ *  WriteFeatureCollectionParallel()
+ */
+template <typename MakeHandler, typename Executor,
+          detail::IsExecutor<Executor> = true>
+auto ReadSequenceParallel(const char* begin, const char* end,
+                          MakeHandler&& makeHandler, Executor&& executor,
+                          size_t numWorkers,
+                          size_t chunkSize = kDefaultParallelReadChunkSize)
+    -> std::vector<detail::ChunkHandler<MakeHandler>> {
+  return detail::ReadChunksParallel(
+      detail::SequenceChunks(begin, end, chunkSize), makeHandler, executor,
+      numWorkers, detail::ReadSequenceChunk{begin});
+}
+
+/** Reads the features of a FeatureCollection held in memory in parallel
+ *
+ *  A scan of the structure of the input, which is much faster than parsing
+ *  it, splits the features array into chunks of about chunkSize bytes of
+ *  whole features. Each chunk is then read on one of the threads into a
+ *  handler of its own, as with ReadSequenceParallel(). The handlers only get
+ *  the events of the features, not those of the collection itself.
+ *
+ *  \tparam MakeHandler  A callable of the form Handler(size_t chunk), where
+ *                       Handler has the methods of ReaderHandler
+ *  \param begin         The start of the FeatureCollection, e.g. a MappedFile
+ *  \param end           One past the end of the FeatureCollection
+ *  \param makeHandler   Creates the handler of each chunk, on this thread
+ *  \param numThreads    The number of threads, including the calling thread,
+ *                       0 meaning one per hardware thread
+ *  \param chunkSize     The number of bytes in each chunk
+ *
+ *  \return The handlers of the chunks, in order
+ *
+ *  \throws nlohmann::json::parse_error if the input is not valid JSON
+ *  \throws std::domain_error if the input is not a valid FeatureCollection
+ */
+template <typename MakeHandler>
+auto ReadFeatureCollectionParallel(
+    const char* begin, const char* end, MakeHandler&& makeHandler,
+    size_t numThreads = 0, size_t chunkSize = kDefaultParallelReadChunkSize)
+    -> std::vector<detail::ChunkHandler<MakeHandler>> {
+  detail::ThreadExecutor executor;
+  return detail::ReadChunksParallel(
+      detail::FeatureChunks(begin, end, chunkSize), makeHandler, executor,
+      detail::NumWorkerThreads(numThreads), detail::ReadFeatureChunk{begin});
+}
+
+/** \overload with the workers run by an executor, see
+ *  WriteFeatureCollectionParallel()
+ */
+template <typename MakeHandler, typename Executor,
+          detail::IsExecutor<Executor> = true>
+auto ReadFeatureCollectionParallel(
+    const char* begin, const char* end, MakeHandler&& makeHandler,
+    Executor&& executor, size_t numWorkers,
+    size_t chunkSize = kDefaultParallelReadChunkSize)
+    -> std::vector<detail::ChunkHandler<MakeHandler>> {
+  return detail::ReadChunksParallel(
+      detail::FeatureChunks(begin, end, chunkSize), makeHandler, executor,
+      numWorkers, detail::ReadFeatureChunk{begin});
+}
+}
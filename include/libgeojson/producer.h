@@ -0,0 +1,128 @@
+/** Pull-based FeatureCollection output for libgeojson
+ *
+ *  \file producer.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "libgeojson/libgeojson.h"
+#include "libgeojson/raw_json.h"
+#include "libgeojson/writer.h"
+
+namespace geojson {
+
+/** The default largest number of bytes in a chunk of a producer's output */
+static constexpr size_t kDefaultProducerChunkSize = 64 * 1024;
+
+namespace detail {
+
+/** Writes what a producer's callback gives back, a feature or its text */
+template <typename Writer, typename Json,
+          typename = typename std::enable_if<
+              nlohmann::detail::is_basic_json<Json>::value>::type>
+void WriteFeature(Writer& writer, const Json& feature) {
+  writer.Write(feature);
+}
+
+template <typename Writer>
+void WriteFeature(Writer& writer, const std::string& feature) {
+  writer.WriteRaw(feature);
+}
+}
+
+/** Produces the text of a FeatureCollection object (section 3.3) in chunks
+ *  of a bounded size, as the caller asks for them
+ *
+ *  Features are only made, by the callback, when the chunk being asked for
+ *  needs them, so a caller that writes each chunk to a socket before asking
+ *  for the next one never holds more than a chunk and a feature in memory,
+ *  and production slows down to the pace of the socket. Each call to Next()
+ *  can be made whenever the caller is ready, e.g. from the completion handler
+ *  of an asynchronous write.
+ *
+ *  Concatenating the chunks gives the same text as WriteFeatureCollection().
+ */
+class FeatureCollectionProducer {
+ public:
+  /** Constructor
+   *
+   *  \tparam Callback    A callable of the form nlohmann::json(size_t index),
+   *                      or std::string(size_t index) giving the text of the
+   *                      feature, e.g. from geojson::text::Feature()
+   *  \param numFeatures  The number of features in the collection
+   *  \param getFeature   Callback that takes the feature index and gives
+   *                      back the feature
+   *  \param chunkSize    The largest number of bytes in a chunk, all chunks
+   *                      but the last have exactly this many
+   */
+  template <typename Callback>
+  FeatureCollectionProducer(size_t numFeatures, Callback&& getFeature,
+                            size_t chunkSize = kDefaultProducerChunkSize)
+      : writer_(buffer_), numFeatures_(numFeatures), nextFeature_(0),
+        chunkSize_(std::max<size_t>(1, chunkSize)), offset_(0),
+        closed_(false) {
+    using Writer = BasicFeatureCollectionWriter<StringSink>;
+    auto callback = std::forward<Callback>(getFeature);
+    writeFeature_ = [callback](Writer& writer, size_t i) mutable {
+      detail::WriteFeature(writer, callback(i));
+    };
+  }
+
+  FeatureCollectionProducer(const FeatureCollectionProducer&) = delete;
+  FeatureCollectionProducer& operator=(const FeatureCollectionProducer&) =
+      delete;
+
+  /** Produces the next chunk of the collection
+   *
+   *  \param chunk  Set to the chunk, which is valid until the next call
+   *
+   *  \return Whether there was a chunk, false once the collection is done
+   */
+  bool Next(StringView& chunk) {
+    // Refill once less than a chunk is left, moving the rest to the start
+    if (buffer_.size() - offset_ < chunkSize_) {
+      buffer_.erase(0, offset_);
+      offset_ = 0;
+      while (buffer_.size() < chunkSize_ && !closed_) {
+        if (nextFeature_ < numFeatures_) {
+          writeFeature_(writer_, nextFeature_++);
+        } else {
+          writer_.Close();
+          closed_ = true;
+        }
+      }
+    }
+
+    size_t size = std::min(chunkSize_, buffer_.size() - offset_);
+    if (size == 0) return false;
+    chunk = StringView(buffer_.data() + offset_, size);
+    offset_ += size;
+    return true;
+  }
+
+  /** Returns whether all of the chunks have been produced */
+  bool Done() const { return closed_ && offset_ == buffer_.size(); }
+
+  /** Returns the number of features made so far */
+  size_t NumFeatures() const { return nextFeature_; }
+
+ private:
+  std::string buffer_;
+  BasicFeatureCollectionWriter<StringSink> writer_;
+  std::function<void(BasicFeatureCollectionWriter<StringSink>&, size_t)>
+      writeFeature_;
+  size_t numFeatures_;
+  size_t nextFeature_;
+  size_t chunkSize_;
+  size_t offset_;
+  bool closed_;
+};
+}
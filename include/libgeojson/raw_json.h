@@ -0,0 +1,581 @@
+/** Unparsed JSON values for libgeojson
+ *
+ *  \file raw_json.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#include "libgeojson/libgeojson.h"
+
+namespace geojson {
+
+/** A view of characters held elsewhere, which must outlive it */
+class StringView {
+ public:
+  StringView() : data_(nullptr), size_(0) {}
+
+  StringView(const char* data, size_t size) : data_(data), size_(size) {}
+
+  StringView(const char* str) : data_(str), size_(std::strlen(str)) {}
+
+  StringView(const std::string& str) : data_(str.data()), size_(str.size()) {}
+
+  const char* Data() const { return data_; }
+
+  size_t Size() const { return size_; }
+
+  bool Empty() const { return size_ == 0; }
+
+  const char* begin() const { return data_; }
+
+  const char* end() const { return data_ + size_; }
+
+  char operator[](size_t i) const { return data_[i]; }
+
+  /** Returns a copy of the characters */
+  std::string ToString() const { return std::string(data_, size_); }
+
+  bool operator==(const StringView& other) const {
+    return size_ == other.size_ &&
+           (size_ == 0 || std::memcmp(data_, other.data_, size_) == 0);
+  }
+
+  bool operator!=(const StringView& other) const { return !(*this == other); }
+
+ private:
+  const char* data_;
+  size_t size_;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const StringView& str) {
+  return os.write(str.Data(), static_cast<std::streamsize>(str.Size()));
+}
+
+namespace detail {
+
+/** The kinds of numbers that TextCursor::ScanNumber() can give */
+enum class NumberKind { kUnsigned, kInteger, kFloat };
+
+/** A scanned number, with the member of its kind set */
+struct NumberValue {
+  NumberKind kind;
+  std::uint64_t unsignedValue;
+  std::int64_t integerValue;
+  double floatValue;
+};
+
+/** Returns a scanned number as a double */
+inline double ToDouble(const NumberValue& number) {
+  switch (number.kind) {
+    case NumberKind::kUnsigned:
+      return static_cast<double>(number.unsignedValue);
+    case NumberKind::kInteger:
+      return static_cast<double>(number.integerValue);
+    default:
+      return number.floatValue;
+  }
+}
+
+/** Parses the decimal number in [first, last) with the C library, which must
+ *  already be valid JSON
+ */
+inline double StringToDouble(const char* first, const char* last) {
+  char buffer[64];
+  std::string large;
+  const char* str = buffer;
+  auto size = static_cast<size_t>(last - first);
+  if (size < sizeof(buffer)) {
+    std::memcpy(buffer, first, size);
+    buffer[size] = '\0';
+  } else {
+    large.assign(first, last);
+    str = large.c_str();
+  }
+  return std::strtod(str, nullptr);
+}
+
+inline bool IsLittleEndian() {
+  const std::uint16_t one = 1;
+  unsigned char first;
+  std::memcpy(&first, &one, 1);
+  return first == 1;
+}
+
+/** Returns whether the 8 bytes, loaded little-endian, are all digits */
+inline bool IsEightDigits(std::uint64_t chars) {
+  return (((chars + 0x4646464646464646) | (chars - 0x3030303030303030)) &
+          0x8080808080808080) == 0;
+}
+
+/** Returns the value of 8 digits, loaded little-endian, with three
+ *  multiplications rather than eight (from fast_float)
+ */
+inline std::uint32_t ParseEightDigits(std::uint64_t chars) {
+  const std::uint64_t kMask = 0x000000FF000000FF;
+  const std::uint64_t kMul1 = 0x000F424000000064;  // 100 + (1000000 << 32)
+  const std::uint64_t kMul2 = 0x0000271000000001;  // 1 + (10000 << 32)
+  chars -= 0x3030303030303030;
+  chars = (chars * 10) + (chars >> 8);
+  chars = (((chars & kMask) * kMul1) + (((chars >> 16) & kMask) * kMul2)) >> 32;
+  return static_cast<std::uint32_t>(chars);
+}
+
+/** A position in JSON text, with the scanning shared by the reader and
+ *  RawJson
+ */
+struct TextCursor {
+  TextCursor(const char* first, const char* last)
+      : begin(first), p(first), end(last) {}
+
+  [[noreturn]] void Error(const std::string& message) const {
+    throw nlohmann::json::parse_error::create(
+        101, static_cast<size_t>(p - begin) + 1, message, nullptr);
+  }
+
+  bool AtEnd() const { return p == end; }
+
+  char Peek() const { return p == end ? '\0' : *p; }
+
+  void SkipWhitespace() {
+    while (p != end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+      p++;
+    }
+  }
+
+  void Expect(char c) {
+    if (Peek() != c) Error(std::string("expected '") + c + "'");
+    p++;
+  }
+
+  /** Scans a string starting at its opening quote, leaving the cursor after
+   *  its closing quote
+   *
+   *  \param escaped  Set to whether the string has escape sequences
+   *
+   *  \return The contents of the string, without the quotes
+   */
+  StringView ScanString(bool& escaped) {
+    Expect('"');
+    const char* first = p;
+    escaped = false;
+    for (;;) {
+      if (p == end) Error("unterminated string");
+      char c = *p;
+      if (c == '"') break;
+      if (static_cast<unsigned char>(c) < 0x20) {
+        Error("control character in string");
+      }
+      if (c == '\\') {
+        escaped = true;
+        if (++p == end) Error("unterminated string");
+        if (*p == 'u') {
+          for (int i = 0; i < 4; i++) {
+            if (++p == end || !std::isxdigit(static_cast<unsigned char>(*p))) {
+              Error("invalid \\u escape");
+            }
+          }
+        } else if (*p == '\0' || !std::strchr("\"\\/bfnrt", *p)) {
+          Error("invalid escape");
+        }
+      }
+      p++;
+    }
+    StringView contents(first, static_cast<size_t>(p - first));
+    p++;
+    return contents;
+  }
+
+  static bool IsDelimiter(char c) {
+    switch (c) {
+      case ',':
+      case ':':
+      case ']':
+      case '}':
+      case ' ':
+      case '\n':
+      case '\r':
+      case '\t':
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  /** Skips over a literal or a number, which run until a delimiter */
+  void SkipScalar() {
+    const char* first = p;
+    while (p != end && !IsDelimiter(*p)) p++;
+    if (p == first) Error("expected a value");
+  }
+
+  static bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+  /** Scans the decimal digits of a number into its significand */
+  void ScanDigits(std::uint64_t& significand, int& numDigits) {
+    // Up to 19 digits fit in the significand, 8 can be parsed at once
+    static const bool kLittleEndian = IsLittleEndian();
+    while (kLittleEndian && end - p >= 8 && numDigits + 8 <= 19) {
+      std::uint64_t chars;
+      std::memcpy(&chars, p, 8);
+      if (!IsEightDigits(chars)) break;
+      significand = significand * 100000000 + ParseEightDigits(chars);
+      numDigits += 8;
+      p += 8;
+    }
+    while (p != end && IsDigit(*p)) {
+      significand = significand * 10 + static_cast<std::uint64_t>(*p - '0');
+      if (numDigits > 0 || *p != '0') numDigits++;
+      p++;
+    }
+  }
+
+  /** Parses the digits in [first, last), returns false on overflow */
+  static bool ParseInteger(const char* first, const char* last,
+                           std::uint64_t& value) {
+    const std::uint64_t kMax = std::numeric_limits<std::uint64_t>::max();
+    value = 0;
+    for (; first != last; first++) {
+      auto digit = static_cast<std::uint64_t>(*first - '0');
+      if (value > (kMax - digit) / 10) return false;
+      value = value * 10 + digit;
+    }
+    return true;
+  }
+
+  /** Scans a number
+   *
+   *  Integers are given as such if they fit in 64 bits. Other numbers are
+   *  computed with one exactly rounded operation when the significand and
+   *  the power of 10 are exactly representable, which is the case for
+   *  numbers with up to 15 significant digits and 22 decimals, and by the C
+   *  library otherwise.
+   */
+  void ScanNumber(NumberValue& number) {
+    static const double kPowersOf10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    const char* first = p;
+    bool negative = Peek() == '-';
+    if (negative) p++;
+    if (!IsDigit(Peek())) Error("invalid number");
+
+    std::uint64_t significand = 0;
+    int numDigits = 0;
+    if (*p == '0') {
+      p++;
+    } else {
+      ScanDigits(significand, numDigits);
+    }
+
+    bool integral = true;
+    int exponent = 0;
+    if (Peek() == '.') {
+      integral = false;
+      p++;
+      const char* fraction = p;
+      if (!IsDigit(Peek())) Error("invalid number");
+      ScanDigits(significand, numDigits);
+      exponent = -static_cast<int>(p - fraction);
+    }
+    if (Peek() == 'e' || Peek() == 'E') {
+      integral = false;
+      p++;
+      bool negativeExp = Peek() == '-';
+      if (Peek() == '+' || Peek() == '-') p++;
+      if (!IsDigit(Peek())) Error("invalid number");
+      int exp = 0;
+      while (IsDigit(Peek())) {
+        if (exp < 100000) exp = exp * 10 + (*p - '0');
+        p++;
+      }
+      exponent += negativeExp ? -exp : exp;
+    }
+
+    // The significand overflowed if it has more than 19 digits, though a 20
+    // digit integer can still fit
+    bool exact = numDigits <= 19;
+    if (integral && numDigits == 20) {
+      exact = ParseInteger(first + negative, p, significand);
+    }
+    if (integral && exact) {
+      const auto kMinMagnitude = std::uint64_t(1) << 63;
+      if (!negative) {
+        number.kind = NumberKind::kUnsigned;
+        number.unsignedValue = significand;
+        return;
+      }
+      if (significand <= kMinMagnitude) {
+        number.kind = NumberKind::kInteger;
+        number.integerValue =
+            significand == kMinMagnitude
+                ? std::numeric_limits<std::int64_t>::min()
+                : -static_cast<std::int64_t>(significand);
+        return;
+      }
+    }
+
+    number.kind = NumberKind::kFloat;
+    if (exact && significand <= (std::uint64_t(1) << 53) && exponent >= -22 &&
+        exponent <= 22) {
+      auto value = static_cast<double>(significand);
+      value = exponent < 0 ? value / kPowersOf10[-exponent]
+                           : value * kPowersOf10[exponent];
+      number.floatValue = negative ? -value : value;
+    } else {
+      number.floatValue = StringToDouble(first, p);
+    }
+  }
+
+  /** Skips over any value, checking that strings and brackets are balanced
+   *  but not the syntax of the rest
+   */
+  void SkipValue() {
+    size_t depth = 0;
+    do {
+      SkipWhitespace();
+      switch (Peek()) {
+        case '"': {
+          bool escaped;
+          ScanString(escaped);
+          break;
+        }
+        case '{':
+        case '[':
+          depth++;
+          p++;
+          break;
+        case '}':
+        case ']':
+          if (depth == 0) Error("unexpected end of a value");
+          depth--;
+          p++;
+          break;
+        case ',':
+        case ':':
+          if (depth == 0) Error("expected a value");
+          p++;
+          break;
+        case '\0':
+          if (p == end) Error("unexpected end of input");
+          Error("expected a value");
+        default:
+          SkipScalar();
+          break;
+      }
+    } while (depth > 0);
+  }
+
+  const char* begin;
+  const char* p;
+  const char* end;
+};
+
+/** Appends a code point to a string as UTF-8 */
+inline void AppendUtf8(std::string& out, std::uint32_t cp) {
+  if (cp < 0x80) {
+    out += static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    out += static_cast<char>(0xC0 | (cp >> 6));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    out += static_cast<char>(0xE0 | (cp >> 12));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (cp >> 18));
+    out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  }
+}
+
+inline std::uint32_t HexValue(const char* hex) {
+  std::uint32_t value = 0;
+  for (int i = 0; i < 4; i++) {
+    char c = hex[i];
+    value = value * 16 + static_cast<std::uint32_t>(
+                             c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+  }
+  return value;
+}
+
+/** Decodes the contents of a string, which were checked by ScanString() */
+inline void Unescape(StringView contents, std::string& out) {
+  out.clear();
+  const char* p = contents.begin();
+  const char* end = contents.end();
+  while (p != end) {
+    const char* run = p;
+    while (p != end && *p != '\\') p++;
+    out.append(run, p);
+    if (p == end) break;
+
+    char c = p[1];
+    p += 2;
+    switch (c) {
+      case 'b': out += '\b'; break;
+      case 'f': out += '\f'; break;
+      case 'n': out += '\n'; break;
+      case 'r': out += '\r'; break;
+      case 't': out += '\t'; break;
+      case 'u': {
+        std::uint32_t cp = HexValue(p);
+        p += 4;
+        if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' &&
+            p[1] == 'u') {
+          std::uint32_t low = HexValue(p + 2);
+          if (low >= 0xDC00 && low < 0xE000) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            p += 6;
+          }
+        }
+        AppendUtf8(out, cp);
+        break;
+      }
+      default: out += c; break;
+    }
+  }
+}
+}
+
+/** A JSON value that has not been parsed, viewing the text it came from
+ *
+ *  The text must outlive the value. Only the parts that are asked for are
+ *  looked at, so a value can be inspected (i.e. to filter features by a
+ *  property) without allocating.
+ */
+class RawJson {
+ public:
+  /** Constructs a missing value */
+  RawJson() {}
+
+  /** Constructor
+   *
+   *  \param text  The text of a single JSON value, without surrounding
+   *               whitespace
+   */
+  explicit RawJson(StringView text) : text_(text) {}
+
+  /** Returns the text of the value */
+  StringView Text() const { return text_; }
+
+  /** Returns whether there is no value, i.e. the result of a failed Find() */
+  bool Missing() const { return text_.Empty(); }
+
+  bool IsObject() const { return First() == '{'; }
+
+  bool IsArray() const { return First() == '['; }
+
+  bool IsString() const { return First() == '"'; }
+
+  bool IsNull() const { return First() == 'n'; }
+
+  bool IsBoolean() const { return First() == 't' || First() == 'f'; }
+
+  bool IsNumber() const {
+    char c = First();
+    return c == '-' || (c >= '0' && c <= '9');
+  }
+
+  /** Returns the contents of a string without the quotes, but with any escape
+   *  sequences still in, which is the string itself unless HasEscapes()
+   *
+   *  \throws std::domain_error if the value is not a string
+   */
+  StringView Unquoted() const {
+    if (!IsString()) throw std::domain_error("JSON value is not a string");
+    return StringView(text_.Data() + 1, text_.Size() - 2);
+  }
+
+  /** Returns whether a string has escape sequences */
+  bool HasEscapes() const {
+    StringView contents = Unquoted();
+    return std::memchr(contents.Data(), '\\', contents.Size()) != nullptr;
+  }
+
+  /** Returns a string with its escape sequences decoded
+   *
+   *  \throws std::domain_error if the value is not a string
+   */
+  std::string String() const {
+    std::string out;
+    detail::Unescape(Unquoted(), out);
+    return out;
+  }
+
+  /** Returns the value of a number
+   *
+   *  \throws std::domain_error if the value is not a number
+   */
+  double Number() const {
+    if (!IsNumber()) throw std::domain_error("JSON value is not a number");
+    detail::TextCursor cursor(text_.begin(), text_.end());
+    detail::NumberValue number;
+    cursor.ScanNumber(number);
+    return detail::ToDouble(number);
+  }
+
+  /** Returns the value of a member of an object, or a missing value if the
+   *  object has no such member
+   *
+   *  \throws std::domain_error if the value is not an object
+   *  \throws nlohmann::json::parse_error if the object is malformed
+   */
+  RawJson Find(StringView key) const {
+    if (!IsObject()) throw std::domain_error("JSON value is not an object");
+    detail::TextCursor cursor(text_.begin(), text_.end());
+    cursor.p++;
+    cursor.SkipWhitespace();
+    if (cursor.Peek() == '}') return RawJson();
+
+    std::string unescaped;
+    for (;;) {
+      cursor.SkipWhitespace();
+      bool escaped;
+      StringView name = cursor.ScanString(escaped);
+      if (escaped) {
+        detail::Unescape(name, unescaped);
+        name = StringView(unescaped);
+      }
+      cursor.SkipWhitespace();
+      cursor.Expect(':');
+      cursor.SkipWhitespace();
+      const char* first = cursor.p;
+      cursor.SkipValue();
+      if (name == key) {
+        size_t size = static_cast<size_t>(cursor.p - first);
+        return RawJson(StringView(first, size));
+      }
+      cursor.SkipWhitespace();
+      if (cursor.Peek() != ',') return RawJson();
+      cursor.p++;
+    }
+  }
+
+  /** Parses the value
+   *
+   *  \throws nlohmann::json::parse_error if the value is malformed
+   */
+  template <typename Json = nlohmann::json>
+  Json Parse() const {
+    return Json::parse(text_.begin(), text_.end());
+  }
+
+ private:
+  char First() const { return text_.Empty() ? '\0' : text_[0]; }
+
+  StringView text_;
+};
+}
@@ -0,0 +1,1039 @@
+/** Streaming GeoJSON reader for libgeojson
+ *
+ *  \file reader.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "libgeojson/libgeojson.h"
+#include "libgeojson/raw_json.h"
+
+namespace geojson {
+
+/** A handler for Read() that ignores every event
+ *
+ *  Handlers derive from this and hide the events they are interested in, the
+ *  events are dispatched statically, so the methods need not be virtual. For
+ *  each feature, the id, geometry and properties events come in the order
+ *  that the members appear in the input.
+ */
+class ReaderHandler {
+ public:
+  /** Called when a FeatureCollection object starts */
+  void OnFeatureCollectionBegin() {}
+
+  /** Called when the FeatureCollection object ends */
+  void OnFeatureCollectionEnd() {}
+
+  /** Called when a Feature object starts
+   *
+   *  \param index  The index of the feature in the collection
+   */
+  void OnFeatureBegin(size_t index) { (void)index; }
+
+  /** Called when a Feature object ends
+   *
+   *  \param index  The index of the feature in the collection
+   */
+  void OnFeatureEnd(size_t index) { (void)index; }
+
+  /** Called with the "id" member of a Feature, a string or a number */
+  void OnId(const nlohmann::json& id) { (void)id; }
+
+  /** Called with the "properties" member of a Feature */
+  void OnProperties(nlohmann::json&& properties) { (void)properties; }
+
+  /** Called with the unparsed "id" member of a Feature, instead of OnId(),
+   *  when reading from memory and the handler declares this method
+   *
+   *  The value views the input, which must outlive it if it is kept.
+   */
+  void OnRawId(const RawJson& id) { (void)id; }
+
+  /** Called with the unparsed "properties" member of a Feature, instead of
+   *  OnProperties(), when reading from memory and the handler declares this
+   *  method
+   *
+   *  The value views the input, which must outlive it if it is kept.
+   */
+  void OnRawProperties(const RawJson& properties) { (void)properties; }
+
+  /** Called with the unparsed "geometry" member of a Feature, instead of the
+   *  geometry and position events, when reading from memory and the handler
+   *  declares this method
+   *
+   *  The geometry can be read later by giving its text to Read(), i.e. once
+   *  the properties show that the feature is wanted.
+   */
+  void OnRawGeometry(const RawJson& geometry) { (void)geometry; }
+
+  /** Called when a geometry object starts, before any of its positions
+   *
+   *  Geometries of a GeometryCollection are nested between the begin and end
+   *  events of the collection.
+   */
+  void OnGeometryBegin(Type type) { (void)type; }
+
+  /** Called when a geometry object ends */
+  void OnGeometryEnd(Type type) { (void)type; }
+
+  /** Called for each position of a geometry, in order
+   *
+   *  \param lon  The longitude in decimal degrees
+   *  \param lat  The latitude in decimal degrees
+   *  \param alt  The altitude in WGS84 ellipsoidal meters, NaN if the
+   *              position has none
+   */
+  void OnPosition(double lon, double lat, double alt) {
+    (void)lon;
+    (void)lat;
+    (void)alt;
+  }
+
+  /** Called after the last position of each line of a MultiLineString */
+  void OnLineEnd() {}
+
+  /** Called after the last position of each ring of a Polygon or MultiPolygon,
+   *  the closing position is given like any other
+   */
+  void OnRingEnd() {}
+
+  /** Called after the last ring of each polygon of a MultiPolygon */
+  void OnPolygonEnd() {}
+};
+
+namespace detail {
+
+/** Returns the geometry type with the given name
+ *
+ *  \throws std::domain_error if the name is not a geometry type
+ */
+inline Type GeometryType(const std::string& name) {
+  static const Type kGeometryTypes[] = {
+      Type::Point,   Type::MultiPoint,   Type::LineString,
+      Type::MultiLineString, Type::Polygon, Type::MultiPolygon,
+      Type::GeometryCollection};
+  for (Type type : kGeometryTypes) {
+    if (name == TypeName(type)) return type;
+  }
+  throw std::domain_error("Unknown geometry type: " + name);
+}
+
+/** Returns the depth at which the positions are nested in the coordinates
+ *  array of the given geometry type, 1 being the coordinates array itself
+ */
+inline int PositionDepth(Type type) {
+  switch (type) {
+    case Type::Point:
+      return 1;
+    case Type::MultiPoint:
+    case Type::LineString:
+      return 2;
+    case Type::MultiLineString:
+    case Type::Polygon:
+      return 3;
+    case Type::MultiPolygon:
+      return 4;
+    default:
+      throw std::domain_error("Geometry type has no coordinates");
+  }
+}
+
+/** Builds a JSON value from SAX events */
+class DomBuilder {
+ public:
+  /** Returns the finished value */
+  nlohmann::json Take() { return std::move(root_); }
+
+  /** Adds a scalar value, returns whether the value is finished */
+  bool Value(nlohmann::json&& value) {
+    Add(std::move(value));
+    return stack_.empty();
+  }
+
+  void StartObject() { Open(nlohmann::json::object()); }
+
+  void StartArray() { Open(nlohmann::json::array()); }
+
+  void Key(std::string& key) { key_ = std::move(key); }
+
+  /** Ends the innermost object or array, returns whether the value is
+   *  finished
+   */
+  bool End() {
+    stack_.pop_back();
+    return stack_.empty();
+  }
+
+ private:
+  nlohmann::json* Add(nlohmann::json&& value) {
+    if (stack_.empty()) {
+      root_ = std::move(value);
+      return &root_;
+    }
+    nlohmann::json& parent = *stack_.back();
+    if (parent.is_array()) {
+      parent.push_back(std::move(value));
+      return &parent.back();
+    }
+    auto& member = parent[key_];
+    member = std::move(value);
+    return &member;
+  }
+
+  void Open(nlohmann::json&& value) {
+    stack_.push_back(Add(std::move(value)));
+  }
+
+  nlohmann::json root_;
+  std::vector<nlohmann::json*> stack_;
+  std::string key_;
+};
+
+template <typename T>
+struct Void {
+  using type = void;
+};
+
+/** The type of the OnRaw*() methods of ReaderHandler */
+using RawEvent = void (ReaderHandler::*)(const RawJson&);
+
+/** Whether a handler declares its own OnRawId(), rather than inheriting the
+ *  one of ReaderHandler
+ */
+template <typename Handler, typename = void>
+struct HasRawId : std::false_type {};
+
+template <typename Handler>
+struct HasRawId<Handler, typename Void<decltype(&Handler::OnRawId)>::type>
+    : std::integral_constant<
+          bool, !std::is_same<decltype(&Handler::OnRawId), RawEvent>::value> {
+};
+
+/** Whether a handler declares its own OnRawProperties() */
+template <typename Handler, typename = void>
+struct HasRawProperties : std::false_type {};
+
+template <typename Handler>
+struct HasRawProperties<
+    Handler, typename Void<decltype(&Handler::OnRawProperties)>::type>
+    : std::integral_constant<
+          bool, !std::is_same<decltype(&Handler::OnRawProperties),
+                              RawEvent>::value> {};
+
+/** Whether a handler declares its own OnRawGeometry() */
+template <typename Handler, typename = void>
+struct HasRawGeometry : std::false_type {};
+
+template <typename Handler>
+struct HasRawGeometry<
+    Handler, typename Void<decltype(&Handler::OnRawGeometry)>::type>
+    : std::integral_constant<
+          bool, !std::is_same<decltype(&Handler::OnRawGeometry),
+                              RawEvent>::value> {};
+
+/** Turns the SAX events of nlohmann::json into the events of a ReaderHandler
+ *
+ *  The members of an object can come in any order, so objects at the top
+ *  level are identified by the first member that tells them apart, and the
+ *  coordinates of a geometry that come before its "type" are buffered until
+ *  the type is known.
+ */
+template <typename Handler>
+class ReaderSax {
+ public:
+  explicit ReaderSax(Handler& handler)
+      : handler_(handler), numFeatures_(0), coordDepth_(0), numCoords_(0)
+  {}
+
+  bool null() { return Scalar(nlohmann::json()); }
+
+  bool boolean(bool value) { return Scalar(nlohmann::json(value)); }
+
+  bool number_integer(std::int64_t value) {
+    if (InCoordinates()) return Number(static_cast<double>(value));
+    return Scalar(nlohmann::json(value));
+  }
+
+  bool number_unsigned(std::uint64_t value) {
+    if (InCoordinates()) return Number(static_cast<double>(value));
+    return Scalar(nlohmann::json(value));
+  }
+
+  bool number_float(double value, const std::string&) {
+    if (InCoordinates()) return Number(value);
+    return Scalar(nlohmann::json(value));
+  }
+
+  bool string(std::string& value) {
+    if (Top() == Context::Properties) return Property(nlohmann::json(value));
+    if (IsObject(Top()) && key_ == "type") {
+      SetType(value);
+      return true;
+    }
+    return Scalar(nlohmann::json(std::move(value)));
+  }
+
+  bool binary(nlohmann::json::binary_t&) {
+    throw std::domain_error("Binary values are not valid GeoJSON");
+  }
+
+  bool start_object(size_t) {
+    switch (Top()) {
+      case Context::Properties:
+        properties_.StartObject();
+        return true;
+      case Context::Skip:
+        stack_.back().index++;
+        return true;
+      case Context::Root:
+        Push(Context::Object);
+        return true;
+      case Context::Features:
+        BeginFeature();
+        return true;
+      case Context::Geometries:
+        Push(Context::Geometry);
+        return true;
+      case Context::Feature:
+        if (key_ == "geometry") {
+          Push(Context::Geometry);
+          return true;
+        }
+        if (key_ == "properties") {
+          Push(Context::Properties);
+          properties_.StartObject();
+          return true;
+        }
+        return Skip();
+      default:
+        return Skip();
+    }
+  }
+
+  bool key(std::string& key) {
+    if (Top() == Context::Properties) {
+      properties_.Key(key);
+    } else if (Top() == Context::Object) {
+      key_ = std::move(key);
+      Identify();
+    } else if (Top() != Context::Skip) {
+      key_ = std::move(key);
+    }
+    return true;
+  }
+
+  bool end_object() {
+    switch (Top()) {
+      case Context::Properties:
+        if (properties_.End()) {
+          stack_.pop_back();
+          handler_.OnProperties(properties_.Take());
+        }
+        return true;
+      case Context::Skip:
+        return Unnest();
+      case Context::Feature:
+        handler_.OnFeatureEnd(stack_.back().index);
+        break;
+      case Context::Collection:
+        handler_.OnFeatureCollectionEnd();
+        break;
+      case Context::Geometry:
+        EndGeometry();
+        break;
+      case Context::Object:
+        throw std::domain_error("Object is not a GeoJSON object");
+      default:
+        break;
+    }
+    stack_.pop_back();
+    return true;
+  }
+
+  bool start_array(size_t) {
+    switch (Top()) {
+      case Context::Properties:
+        properties_.StartArray();
+        return true;
+      case Context::Skip:
+        stack_.back().index++;
+        return true;
+      case Context::Coordinates:
+        return CoordinatesToken(kStartArray);
+      case Context::Object:
+      case Context::Collection:
+        if (key_ == "features" && Top() == Context::Collection) {
+          Push(Context::Features);
+          return true;
+        }
+        return Skip();
+      case Context::Feature:
+        if (key_ == "properties") {
+          Push(Context::Properties);
+          properties_.StartArray();
+          return true;
+        }
+        return Skip();
+      case Context::Geometry:
+        if (key_ == "coordinates") {
+          Push(Context::Coordinates);
+          return CoordinatesToken(kStartArray);
+        }
+        if (key_ == "geometries") {
+          SetType(TypeName<Type::GeometryCollection>());
+          Push(Context::Geometries);
+          return true;
+        }
+        return Skip();
+      case Context::Root:
+        throw std::domain_error("GeoJSON text must be an object");
+      default:
+        throw std::domain_error("Unexpected array in GeoJSON object");
+    }
+  }
+
+  bool end_array() {
+    switch (Top()) {
+      case Context::Properties:
+        if (properties_.End()) {
+          stack_.pop_back();
+          handler_.OnProperties(properties_.Take());
+        }
+        return true;
+      case Context::Skip:
+        return Unnest();
+      case Context::Coordinates:
+        CoordinatesToken(kEndArray);
+        if (coordDepth_ == 0) stack_.pop_back();
+        return true;
+      default:
+        stack_.pop_back();
+        return true;
+    }
+  }
+
+  template <typename Exception>
+  bool parse_error(size_t, const std::string&, const Exception& ex) {
+    throw ex;
+  }
+
+  /** Returns whether the value of the current member should be given to
+   *  raw_value() rather than parsed, which is up to the producer of the
+   *  events
+   */
+  bool wants_raw() const {
+    if (Top() != Context::Feature) return false;
+    if (key_ == "geometry") return HasRawGeometry<Handler>::value;
+    if (key_ == "properties") return HasRawProperties<Handler>::value;
+    if (key_ == "id") return HasRawId<Handler>::value;
+    return false;
+  }
+
+  /** Returns the number of levels of arrays between the value of the current
+   *  member and its positions if it is the coordinates of a geometry whose
+   *  type is known, so it can be given to position() and coordinates_end(),
+   *  or -1 otherwise
+   */
+  int coordinates_levels() const {
+    if (Top() != Context::Geometry || key_ != "coordinates" ||
+        !stack_.back().hasType) {
+      return -1;
+    }
+    return PositionDepth(stack_.back().type) - 1;
+  }
+
+  /** Handles a position of the coordinates */
+  void position(double lon, double lat, double alt) {
+    handler_.OnPosition(lon, lat, alt);
+  }
+
+  /** Handles the end of an array of the coordinates, the given number of
+   *  levels above the positions
+   */
+  void coordinates_end(int levels) {
+    EndCoordinatesArray(stack_.back().type, levels);
+  }
+
+  /** Handles the unparsed value of a member that wants_raw() */
+  bool raw_value(const RawJson& value) {
+    if (key_ == "geometry") {
+      RawGeometry(value, HasRawGeometry<Handler>());
+    } else if (key_ == "properties") {
+      RawProperties(value, HasRawProperties<Handler>());
+    } else {
+      RawId(value, HasRawId<Handler>());
+    }
+    return true;
+  }
+
+ private:
+  enum class Context {
+    Root,
+    Object,  // A top-level object of a type that is not yet known
+    Collection,
+    Features,
+    Feature,
+    Geometry,
+    Geometries,
+    Coordinates,
+    Properties,
+    Skip
+  };
+
+  struct Frame {
+    Context context;
+    size_t index;  // Of a feature, or the depth of a skipped value
+    Type type;
+    bool hasType;
+  };
+
+  static constexpr char kStartArray = '[';
+  static constexpr char kEndArray = ']';
+  static constexpr char kNumber = 'n';
+
+  void RawGeometry(const RawJson& value, std::true_type) {
+    handler_.OnRawGeometry(value);
+  }
+  void RawGeometry(const RawJson&, std::false_type) {}
+
+  void RawProperties(const RawJson& value, std::true_type) {
+    handler_.OnRawProperties(value);
+  }
+  void RawProperties(const RawJson&, std::false_type) {}
+
+  void RawId(const RawJson& value, std::true_type) { handler_.OnRawId(value); }
+  void RawId(const RawJson&, std::false_type) {}
+
+  static bool IsObject(Context context) {
+    return context == Context::Object || context == Context::Collection ||
+           context == Context::Feature || context == Context::Geometry;
+  }
+
+  Context Top() const {
+    return stack_.empty() ? Context::Root : stack_.back().context;
+  }
+
+  bool InCoordinates() const { return Top() == Context::Coordinates; }
+
+  void Push(Context context, size_t index = 0) {
+    stack_.push_back(Frame{context, index, Type::Point, false});
+  }
+
+  /** Starts skipping an object or array that is not part of GeoJSON */
+  bool Skip() {
+    Push(Context::Skip, 1);
+    return true;
+  }
+
+  /** Ends an object or array inside of a skipped value */
+  bool Unnest() {
+    if (--stack_.back().index == 0) stack_.pop_back();
+    return true;
+  }
+
+  /** Identifies a top-level object from a member name */
+  void Identify() {
+    if (key_ == "features") {
+      stack_.back().context = Context::Collection;
+      handler_.OnFeatureCollectionBegin();
+    } else if (key_ == "geometry" || key_ == "properties" || key_ == "id") {
+      stack_.pop_back();
+      BeginFeature();
+    } else if (key_ == "coordinates" || key_ == "geometries") {
+      stack_.back().context = Context::Geometry;
+    }
+  }
+
+  void BeginFeature() {
+    Push(Context::Feature, numFeatures_);
+    handler_.OnFeatureBegin(numFeatures_++);
+  }
+
+  /** Handles the "type" member of an object */
+  void SetType(const std::string& name) {
+    Frame& frame = stack_.back();
+    if (frame.context == Context::Object) {
+      if (name == TypeName<Type::FeatureCollection>()) {
+        frame.context = Context::Collection;
+        handler_.OnFeatureCollectionBegin();
+        return;
+      }
+      if (name == TypeName<Type::Feature>()) {
+        stack_.pop_back();
+        BeginFeature();
+        return;
+      }
+      frame.context = Context::Geometry;
+    }
+
+    switch (frame.context) {
+      case Context::Collection:
+        if (name != TypeName<Type::FeatureCollection>()) {
+          throw std::domain_error("Expected a FeatureCollection: " + name);
+        }
+        return;
+      case Context::Feature:
+        if (name != TypeName<Type::Feature>()) {
+          throw std::domain_error("Expected a Feature: " + name);
+        }
+        return;
+      case Context::Geometry: {
+        Type type = GeometryType(name);
+        if (frame.hasType) {
+          if (type != frame.type) {
+            throw std::domain_error("Geometry has conflicting types");
+          }
+          return;
+        }
+        frame.type = type;
+        frame.hasType = true;
+        handler_.OnGeometryBegin(type);
+        ReplayCoordinates();
+        return;
+      }
+      default:
+        return;
+    }
+  }
+
+  void EndGeometry() {
+    Frame& frame = stack_.back();
+    if (!frame.hasType) {
+      throw std::domain_error("Geometry object has no type");
+    }
+    handler_.OnGeometryEnd(frame.type);
+  }
+
+  /** Handles a scalar value anywhere but in coordinates */
+  bool Scalar(nlohmann::json&& value) {
+    switch (Top()) {
+      case Context::Properties:
+        return Property(std::move(value));
+      case Context::Feature:
+        if (key_ == "id") {
+          handler_.OnId(value);
+        } else if (key_ == "properties") {
+          handler_.OnProperties(std::move(value));
+        }
+        return true;
+      case Context::Root:
+        throw std::domain_error("GeoJSON text must be an object");
+      case Context::Coordinates:
+        throw std::domain_error("Coordinates must be numbers");
+      case Context::Features:
+      case Context::Geometries:
+        throw std::domain_error("Expected a GeoJSON object");
+      default:
+        return true;
+    }
+  }
+
+  bool Property(nlohmann::json&& value) {
+    if (properties_.Value(std::move(value))) {
+      stack_.pop_back();
+      handler_.OnProperties(properties_.Take());
+    }
+    return true;
+  }
+
+  bool Number(double value) {
+    number_ = value;
+    return CoordinatesToken(kNumber);
+  }
+
+  /** Handles an event inside of a coordinates array, buffering it if the
+   *  type of the geometry is not yet known
+   */
+  bool CoordinatesToken(char token) {
+    // The geometry is the frame under the coordinates
+    const Frame& geometry = stack_[stack_.size() - 2];
+    if (!geometry.hasType) {
+      tokens_.push_back(token);
+      if (token == kNumber) numbers_.push_back(number_);
+      coordDepth_ += token == kStartArray ? 1 : token == kEndArray ? -1 : 0;
+      return true;
+    }
+    Coordinates(geometry.type, token, number_);
+    return true;
+  }
+
+  /** Plays the buffered coordinates events of the geometry on top */
+  void ReplayCoordinates() {
+    Type type = stack_.back().type;
+    size_t numberIdx = 0;
+    for (char token : tokens_) {
+      Coordinates(type, token, token == kNumber ? numbers_[numberIdx++] : 0);
+    }
+    tokens_.clear();
+    numbers_.clear();
+  }
+
+  /** Handles an event inside of a coordinates array of a known type */
+  void Coordinates(Type type, char token, double value) {
+    int positionDepth = PositionDepth(type);
+    if (token == kStartArray) {
+      if (++coordDepth_ > positionDepth) {
+        throw std::domain_error("Coordinates are nested too deeply");
+      }
+      numCoords_ = 0;
+    } else if (token == kNumber) {
+      if (coordDepth_ != positionDepth) {
+        throw std::domain_error("Coordinates are not nested deeply enough");
+      }
+      if (numCoords_ < 3) position_[numCoords_] = value;
+      numCoords_++;
+    } else {
+      if (coordDepth_ == positionDepth) {
+        if (numCoords_ < 2) {
+          throw std::domain_error("Positions must have at least 2 elements");
+        }
+        handler_.OnPosition(position_[0], position_[1],
+                            numCoords_ > 2
+                                ? position_[2]
+                                : std::numeric_limits<double>::quiet_NaN());
+      } else {
+        EndCoordinatesArray(type, positionDepth - coordDepth_);
+      }
+      coordDepth_--;
+    }
+  }
+
+  /** Emits the end of an array of positions, levels above the positions */
+  void EndCoordinatesArray(Type type, int level) {
+    switch (type) {
+      case Type::MultiLineString:
+        if (level == 1) handler_.OnLineEnd();
+        break;
+      case Type::Polygon:
+        if (level == 1) handler_.OnRingEnd();
+        break;
+      case Type::MultiPolygon:
+        if (level == 1) handler_.OnRingEnd();
+        if (level == 2) handler_.OnPolygonEnd();
+        break;
+      default:
+        break;
+    }
+  }
+
+  Handler& handler_;
+  std::vector<Frame> stack_;
+  std::string key_;
+  size_t numFeatures_;
+  DomBuilder properties_;
+
+  // The state of the coordinates array being read
+  int coordDepth_;
+  size_t numCoords_;
+  double position_[3];
+  double number_;
+
+  // Coordinates events buffered until the geometry type is known
+  std::vector<char> tokens_;
+  std::vector<double> numbers_;
+};
+
+/** Produces the SAX events of JSON text held in memory
+ *
+ *  Unlike nlohmann::json::sax_parse, it can hand the text of a value to the
+ *  SAX without parsing it, when the SAX wants_raw().
+ */
+template <typename Sax>
+class TextScanner {
+ public:
+  /** The deepest that objects and arrays can be nested */
+  static constexpr size_t kMaxDepth = 1000;
+
+  /** Constructor
+   *
+   *  \param cursor  The text of a single value, with its begin being the
+   *                 start of the input, for the positions in errors
+   *  \param sax     The SAX to give the events to
+   */
+  TextScanner(const TextCursor& cursor, Sax& sax)
+      : cursor_(cursor), sax_(sax), depth_(0) {}
+
+  void Run() {
+    cursor_.SkipWhitespace();
+    Value();
+    cursor_.SkipWhitespace();
+    if (!cursor_.AtEnd()) cursor_.Error("expected end of input");
+  }
+
+  /** Scans values separated by commas, i.e. a part of an array's elements */
+  void RunList() {
+    for (;;) {
+      cursor_.SkipWhitespace();
+      Value();
+      cursor_.SkipWhitespace();
+      if (cursor_.AtEnd()) break;
+      cursor_.Expect(',');
+    }
+  }
+
+ private:
+  void Value() {
+    switch (cursor_.Peek()) {
+      case '{':
+        Object();
+        break;
+      case '[':
+        Array();
+        break;
+      case '"':
+        String();
+        sax_.string(str_);
+        break;
+      case 't':
+        Literal("true");
+        sax_.boolean(true);
+        break;
+      case 'f':
+        Literal("false");
+        sax_.boolean(false);
+        break;
+      case 'n':
+        Literal("null");
+        sax_.null();
+        break;
+      default:
+        Number();
+        break;
+    }
+  }
+
+  void Object() {
+    Enter();
+    sax_.start_object(std::size_t(-1));
+    cursor_.SkipWhitespace();
+    if (cursor_.Peek() != '}') {
+      for (;;) {
+        cursor_.SkipWhitespace();
+        String();
+        sax_.key(str_);
+        cursor_.SkipWhitespace();
+        cursor_.Expect(':');
+        cursor_.SkipWhitespace();
+        int levels = sax_.coordinates_levels();
+        if (sax_.wants_raw()) {
+          const char* first = cursor_.p;
+          cursor_.SkipValue();
+          size_t size = static_cast<size_t>(cursor_.p - first);
+          sax_.raw_value(RawJson(StringView(first, size)));
+        } else if (levels >= 0 && cursor_.Peek() == '[') {
+          Coordinates(levels);
+        } else {
+          Value();
+        }
+        cursor_.SkipWhitespace();
+        if (cursor_.Peek() != ',') break;
+        cursor_.p++;
+      }
+    }
+    cursor_.Expect('}');
+    sax_.end_object();
+    depth_--;
+  }
+
+  void Array() {
+    Enter();
+    sax_.start_array(std::size_t(-1));
+    cursor_.SkipWhitespace();
+    if (cursor_.Peek() != ']') {
+      for (;;) {
+        cursor_.SkipWhitespace();
+        Value();
+        cursor_.SkipWhitespace();
+        if (cursor_.Peek() != ',') break;
+        cursor_.p++;
+      }
+    }
+    cursor_.Expect(']');
+    sax_.end_array();
+    depth_--;
+  }
+
+  void Enter() {
+    if (++depth_ > kMaxDepth) cursor_.Error("nesting is too deep");
+    cursor_.p++;
+  }
+
+  /** Scans a string into str_ */
+  void String() {
+    bool escaped;
+    StringView contents = cursor_.ScanString(escaped);
+    if (escaped) {
+      Unescape(contents, str_);
+    } else {
+      str_.assign(contents.Data(), contents.Size());
+    }
+  }
+
+  void Literal(const char* literal) {
+    size_t size = std::strlen(literal);
+    if (static_cast<size_t>(cursor_.end - cursor_.p) < size ||
+        std::memcmp(cursor_.p, literal, size) != 0) {
+      cursor_.Error("invalid literal");
+    }
+    cursor_.p += size;
+  }
+
+  void Number() {
+    NumberValue number;
+    cursor_.ScanNumber(number);
+    switch (number.kind) {
+      case NumberKind::kUnsigned:
+        sax_.number_unsigned(number.unsignedValue);
+        break;
+      case NumberKind::kInteger:
+        sax_.number_integer(number.integerValue);
+        break;
+      default:
+        sax_.number_float(number.floatValue, kNoString);
+        break;
+    }
+  }
+
+  static bool IsNumberStart(char c) {
+    return c == '-' || TextCursor::IsDigit(c);
+  }
+
+  /** Scans a coordinates array whose positions are the given number of
+   *  levels down, without going through the SAX events of each token
+   */
+  void Coordinates(int levels) {
+    if (levels == 0) {
+      Position();
+      return;
+    }
+    Enter();
+    cursor_.SkipWhitespace();
+    if (cursor_.Peek() != ']') {
+      for (;;) {
+        cursor_.SkipWhitespace();
+        char c = cursor_.Peek();
+        if (cursor_.AtEnd()) cursor_.Error("unexpected end of input");
+        if (c != '[') {
+          throw std::domain_error(IsNumberStart(c)
+                                      ? "Coordinates are not nested deeply "
+                                        "enough"
+                                      : "Coordinates must be numbers");
+        }
+        Coordinates(levels - 1);
+        cursor_.SkipWhitespace();
+        if (cursor_.Peek() != ',') break;
+        cursor_.p++;
+      }
+    }
+    cursor_.Expect(']');
+    sax_.coordinates_end(levels);
+    depth_--;
+  }
+
+  void Position() {
+    cursor_.p++;
+    double coords[3];
+    size_t numCoords = 0;
+    cursor_.SkipWhitespace();
+    if (cursor_.Peek() != ']') {
+      for (;;) {
+        cursor_.SkipWhitespace();
+        char c = cursor_.Peek();
+        if (cursor_.AtEnd()) cursor_.Error("unexpected end of input");
+        if (!IsNumberStart(c)) {
+          throw std::domain_error(c == '['
+                                      ? "Coordinates are nested too deeply"
+                                      : "Coordinates must be numbers");
+        }
+        NumberValue number;
+        cursor_.ScanNumber(number);
+        if (numCoords < 3) coords[numCoords] = ToDouble(number);
+        numCoords++;
+        cursor_.SkipWhitespace();
+        if (cursor_.Peek() != ',') break;
+        cursor_.p++;
+      }
+    }
+    cursor_.Expect(']');
+    if (numCoords < 2) {
+      throw std::domain_error("Positions must have at least 2 elements");
+    }
+    sax_.position(coords[0], coords[1],
+                  numCoords > 2 ? coords[2]
+                                : std::numeric_limits<double>::quiet_NaN());
+  }
+
+  const std::string kNoString;
+  TextCursor cursor_;
+  Sax& sax_;
+  size_t depth_;
+  std::string str_;
+};
+}
+
+/** Reads GeoJSON text from a stream, giving its contents to a handler as it
+ *  is parsed
+ *
+ *  Only one feature's properties are held in memory at a time, so arbitrarily
+ *  large FeatureCollections can be read in constant memory. The input can be
+ *  a FeatureCollection, a Feature or a geometry object.
+ *
+ *  \tparam Handler  A type with the methods of ReaderHandler, which it can
+ *                   derive from to ignore events
+ *  \param is        The stream to read from
+ *  \param handler   The handler for the contents of the GeoJSON
+ *
+ *  \throws nlohmann::json::parse_error if the input is not valid JSON
+ *  \throws std::domain_error if the input is not valid GeoJSON
+ */
+template <typename Handler>
+void Read(std::istream& is, Handler& handler) {
+  detail::ReaderSax<Handler> sax(handler);
+  nlohmann::json::sax_parse(is, &sax);
+}
+
+/** Reads GeoJSON text held in memory, giving its contents to a handler as
+ *  it is parsed
+ *
+ *  Strings are only copied when they are given to the handler, and a handler
+ *  that declares OnRawId(), OnRawProperties() or OnRawGeometry() gets views
+ *  of those members of each feature instead of their parsed values, so
+ *  features can be filtered without paying to parse the ones that are not
+ *  wanted.
+ *
+ *  \tparam Handler  A type with the methods of ReaderHandler, which it can
+ *                   derive from to ignore events
+ *  \param begin     The start of the text
+ *  \param end       One past the end of the text
+ *  \param handler   The handler for the contents of the GeoJSON
+ *
+ *  \throws nlohmann::json::parse_error if the input is not valid JSON
+ *  \throws std::domain_error if the input is not valid GeoJSON
+ */
+template <typename Handler>
+void Read(const char* begin, const char* end, Handler& handler) {
+  detail::ReaderSax<Handler> sax(handler);
+  detail::TextScanner<detail::ReaderSax<Handler>>(
+      detail::TextCursor(begin, end), sax)
+      .Run();
+}
+
+/** \overload */
+template <typename Handler>
+void Read(const std::string& text, Handler& handler) {
+  Read(text.data(), text.data() + text.size(), handler);
+}
+}
@@ -0,0 +1,366 @@
+/** Columnar properties for libgeojson
+ *
+ *  Collections whose features all have the same property keys can declare
+ *  them once in a PropertySchema, with a typed callback for each column that
+ *  gives the value for a feature index. The writers then write each feature's
+ *  properties straight from the callbacks, without making a properties
+ *  object, and the FlatGeobuf writer encodes them the same way.
+ *
+ *  \file schema.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "libgeojson/fragment.h"
+#include "libgeojson/libgeojson.h"
+#include "libgeojson/text.h"
+
+namespace geojson {
+
+/** The types of the values of a PropertySchema's columns */
+enum class PropertyType { Bool, Integer, Double, String, Json };
+
+namespace detail {
+
+/** Appends a JSON string, in the same format as nlohmann::json */
+inline void AppendJsonString(std::string& out, const std::string& value) {
+  // Printable ASCII other than quotes and backslashes is written as it is
+  bool plain = true;
+  for (char c : value) {
+    auto byte = static_cast<unsigned char>(c);
+    if (byte < 0x20 || byte >= 0x7f || c == '"' || c == '\\') {
+      plain = false;
+      break;
+    }
+  }
+  if (!plain) {
+    out.append(nlohmann::json(value).dump());
+    return;
+  }
+  out.push_back('"');
+  out.append(value);
+  out.push_back('"');
+}
+
+/** Appends an integer in decimal */
+inline void AppendJsonInteger(std::string& out, int64_t value) {
+  // The magnitude is taken unsigned, so the most negative value fits
+  uint64_t digits = value < 0 ? 0 - static_cast<uint64_t>(value)
+                              : static_cast<uint64_t>(value);
+  char buffer[24];
+  char* end = buffer + sizeof(buffer);
+  char* begin = end;
+  do {
+    *--begin = static_cast<char>('0' + digits % 10);
+    digits /= 10;
+  } while (digits > 0);
+  if (value < 0) *--begin = '-';
+  out.append(begin, static_cast<size_t>(end - begin));
+}
+}
+
+/** The property keys shared by the features of a collection, along with
+ *  typed callbacks that give the value of each one for a feature index
+ *
+ *  The keys are serialized once, when they are added, and the properties of
+ *  a feature are written from the callbacks in the order of their keys, so
+ *  that AppendProperties() gives the same text as Properties().dump().
+ *  Every feature has every key, with null when a column's isNull callback
+ *  says so.
+ */
+class PropertySchema {
+ public:
+  /** Callback that says whether a column has no value for a feature */
+  using IsNull = std::function<bool(size_t index)>;
+
+  /** Adds a column of booleans
+   *
+   *  \param name    The key of the property
+   *  \param get     Callback that takes the feature index and gives back the
+   *                 value
+   *  \param isNull  Callback that says whether a feature's value is null, or
+   *                 empty if it never is
+   *
+   *  \throws std::domain_error if a column already has the name
+   *
+   *  \return This schema, so columns can be chained
+   */
+  PropertySchema& AddBool(const std::string& name,
+                          std::function<bool(size_t)> get,
+                          IsNull isNull = IsNull()) {
+    AddColumn(name, PropertyType::Bool, std::move(isNull)).getBool =
+        std::move(get);
+    return *this;
+  }
+
+  /** Adds a column of integers, as AddBool() */
+  PropertySchema& AddInteger(const std::string& name,
+                             std::function<int64_t(size_t)> get,
+                             IsNull isNull = IsNull()) {
+    AddColumn(name, PropertyType::Integer, std::move(isNull)).getInteger =
+        std::move(get);
+    return *this;
+  }
+
+  /** Adds a column of numbers, as AddBool(), non-finite values are written
+   *  as null
+   */
+  PropertySchema& AddDouble(const std::string& name,
+                            std::function<double(size_t)> get,
+                            IsNull isNull = IsNull()) {
+    AddColumn(name, PropertyType::Double, std::move(isNull)).getDouble =
+        std::move(get);
+    return *this;
+  }
+
+  /** Adds a column of UTF-8 strings, as AddBool() */
+  PropertySchema& AddString(const std::string& name,
+                            std::function<std::string(size_t)> get,
+                            IsNull isNull = IsNull()) {
+    AddColumn(name, PropertyType::String, std::move(isNull)).getString =
+        std::move(get);
+    return *this;
+  }
+
+  /** Adds a column of any JSON values, e.g. arrays, as AddBool() */
+  PropertySchema& AddJson(const std::string& name,
+                          std::function<nlohmann::json(size_t)> get,
+                          IsNull isNull = IsNull()) {
+    AddColumn(name, PropertyType::Json, std::move(isNull)).getJson =
+        std::move(get);
+    return *this;
+  }
+
+  /** Returns the number of columns */
+  size_t NumColumns() const { return columns_.size(); }
+
+  /** Returns the property key of a column, in the order they were added */
+  const std::string& Name(size_t column) const {
+    return columns_.at(column).name;
+  }
+
+  /** Returns the type of the values of a column */
+  PropertyType Type(size_t column) const { return columns_.at(column).type; }
+
+  /** Returns whether a column has no value for a feature */
+  bool IsNullValue(size_t column, size_t index) const {
+    const auto& isNull = columns_[column].isNull;
+    return isNull && isNull(index);
+  }
+
+  /** Returns the value of a column for a feature, which must be of the
+   *  column's type
+   */
+  bool BoolValue(size_t column, size_t index) const {
+    return columns_[column].getBool(index);
+  }
+  int64_t IntegerValue(size_t column, size_t index) const {
+    return columns_[column].getInteger(index);
+  }
+  double DoubleValue(size_t column, size_t index) const {
+    return columns_[column].getDouble(index);
+  }
+  std::string StringValue(size_t column, size_t index) const {
+    return columns_[column].getString(index);
+  }
+  nlohmann::json JsonValue(size_t column, size_t index) const {
+    return columns_[column].getJson(index);
+  }
+
+  /** Returns the value of a column for a feature as JSON, of any type */
+  nlohmann::json Value(size_t column, size_t index) const {
+    if (IsNullValue(column, index)) return nullptr;
+    switch (columns_.at(column).type) {
+      case PropertyType::Bool:
+        return BoolValue(column, index);
+      case PropertyType::Integer:
+        return IntegerValue(column, index);
+      case PropertyType::Double:
+        return DoubleValue(column, index);
+      case PropertyType::String:
+        return StringValue(column, index);
+      default:
+        return JsonValue(column, index);
+    }
+  }
+
+  /** Returns the properties object of a feature */
+  nlohmann::json Properties(size_t index) const {
+    auto properties = nlohmann::json::object();
+    for (size_t c = 0; c < columns_.size(); c++) {
+      properties[columns_[c].name] = Value(c, index);
+    }
+    return properties;
+  }
+
+  /** Appends the text of the properties object of a feature
+   *
+   *  \param out    The string to append to
+   *  \param index  The index of the feature
+   */
+  void AppendProperties(std::string& out, size_t index) const {
+    out.push_back('{');
+    for (size_t k = 0; k < order_.size(); k++) {
+      const Column& column = columns_[order_[k]];
+      if (k > 0) out.push_back(',');
+      out.append(column.key);
+      if (column.isNull && column.isNull(index)) {
+        out.append("null", 4);
+        continue;
+      }
+      switch (column.type) {
+        case PropertyType::Bool:
+          if (column.getBool(index)) {
+            out.append("true", 4);
+          } else {
+            out.append("false", 5);
+          }
+          break;
+        case PropertyType::Integer:
+          detail::AppendJsonInteger(out, column.getInteger(index));
+          break;
+        case PropertyType::Double: {
+          text::detail::TextWriter writer(out, CoordinateFormat());
+          text::detail::WriteShortestNumber(writer, column.getDouble(index));
+          break;
+        }
+        case PropertyType::String:
+          detail::AppendJsonString(out, column.getString(index));
+          break;
+        default:
+          out.append(column.getJson(index).dump());
+          break;
+      }
+    }
+    out.push_back('}');
+  }
+
+ private:
+  struct Column {
+    std::string name;
+    std::string key;
+    PropertyType type;
+    IsNull isNull;
+    std::function<bool(size_t)> getBool;
+    std::function<int64_t(size_t)> getInteger;
+    std::function<double(size_t)> getDouble;
+    std::function<std::string(size_t)> getString;
+    std::function<nlohmann::json(size_t)> getJson;
+  };
+
+  Column& AddColumn(const std::string& name, PropertyType type,
+                    IsNull isNull) {
+    auto compare = [this](size_t column, const std::string& key) {
+      return columns_[column].name < key;
+    };
+    auto pos = std::lower_bound(order_.begin(), order_.end(), name, compare);
+    if (pos != order_.end() && columns_[*pos].name == name) {
+      throw std::domain_error("Duplicate property " + name + " in schema");
+    }
+    order_.insert(pos, columns_.size());
+
+    Column column;
+    column.name = name;
+    column.key = nlohmann::json(name).dump() + ":";
+    column.type = type;
+    column.isNull = std::move(isNull);
+    columns_.push_back(std::move(column));
+    return columns_.back();
+  }
+
+  std::vector<Column> columns_;
+
+  // The columns in the order of their keys
+  std::vector<size_t> order_;
+};
+
+namespace detail {
+
+/** Appends the text of a Feature object whose properties follow a schema
+ *
+ *  \param out       The string to append to
+ *  \param idText    The serialized ID of the feature, or empty for none
+ *  \param geometry  The geometry of the feature
+ *  \param schema    The properties of the features
+ *  \param index     The index of the feature in the schema
+ */
+inline void AppendFeature(std::string& out, const std::string& idText,
+                          const RawFragment& geometry,
+                          const PropertySchema& schema, size_t index) {
+  text::detail::AppendFeatureHead(out, geometry.Text(),
+                                  geometry.BoundingBoxBegin(),
+                                  geometry.BoundingBoxSize());
+  schema.AppendProperties(out, index);
+  text::detail::AppendFeatureTail(out, idText);
+}
+}
+
+namespace text {
+
+/** Text version of geojson::Feature() (section 3.2), with the properties of
+ *  a feature of a schema
+ *
+ *  \param geometry  The geometry of the feature
+ *  \param schema    The properties of the features
+ *  \param index     The index of the feature in the schema
+ *
+ *  \return The text of a GeoJSON Feature object
+ */
+inline std::string Feature(const RawFragment& geometry,
+                           const PropertySchema& schema, size_t index) {
+  std::string out;
+  geojson::detail::AppendFeature(out, std::string(), geometry, schema, index);
+  return out;
+}
+
+/** \overload with the ID of the feature */
+inline std::string Feature(const nlohmann::json& id,
+                           const RawFragment& geometry,
+                           const PropertySchema& schema, size_t index) {
+  std::string out;
+  geojson::detail::AppendFeature(out, id.dump(), geometry, schema, index);
+  return out;
+}
+}
+
+/** Writes a feature whose properties are those of a feature of a schema,
+ *  written straight from the schema's callbacks, to a writer of GeoJSON text
+ *
+ *  \tparam Writer    A writer with a member void WriteRaw(const std::string&),
+ *                    e.g. FeatureCollectionWriter or SequenceWriter
+ *  \param writer     The writer to write the feature to
+ *  \param geometry   The geometry of the feature
+ *  \param schema     The properties of the features
+ *  \param index      The index of the feature in the schema
+ */
+template <typename Writer>
+void WriteFeature(Writer& writer, const RawFragment& geometry,
+                  const PropertySchema& schema, size_t index) {
+  detail::LibraryScope scope;
+  std::string text;
+  detail::AppendFeature(text, std::string(), geometry, schema, index);
+  writer.WriteRaw(text);
+}
+
+/** \overload with the ID of the feature */
+template <typename Writer>
+void WriteFeature(Writer& writer, const nlohmann::json& id,
+                  const RawFragment& geometry, const PropertySchema& schema,
+                  size_t index) {
+  detail::LibraryScope scope;
+  std::string text;
+  detail::AppendFeature(text, id.dump(), geometry, schema, index);
+  writer.WriteRaw(text);
+}
+}
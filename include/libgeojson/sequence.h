@@ -0,0 +1,235 @@
+/** GeoJSON Text Sequences (RFC 8142) for libgeojson
+ *
+ *  \file sequence.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+#include "libgeojson/reader.h"
+#include "libgeojson/writer.h"
+
+namespace geojson {
+
+/** The ASCII record separator that starts each record of a sequence */
+static constexpr char kRecordSeparator = '\x1e';
+
+/** Writes a GeoJSON Text Sequence (RFC 8142), one Feature per record
+ *
+ *  Each feature is written as a record separator, its text and a line feed.
+ *  Unlike a FeatureCollection, a sequence has no header or footer, so it can
+ *  be appended to (i.e. by opening a file that is already a sequence in
+ *  append mode), concatenated with other sequences and split between any two
+ *  records.
+ *
+ *  \tparam Sink  A type with a member void Write(const char*, size_t)
+ */
+template <typename Sink>
+class BasicSequenceWriter
+    : public detail::JsonFeatureWriter<BasicSequenceWriter<Sink>> {
+ public:
+  /** Constructor
+   *
+   *  \param sink              The sink to which the records are written
+   *  \param recordSeparators  Whether to start each record with a record
+   *                           separator, as RFC 8142 requires, or to only
+   *                           end them with line feeds (newline-delimited
+   *                           GeoJSON)
+   */
+  explicit BasicSequenceWriter(Sink sink, bool recordSeparators = true)
+      : sink_(std::move(sink)), numFeatures_(0),
+        recordSeparators_(recordSeparators) {}
+
+  /** Writes an already serialized feature as a record verbatim
+   *
+   *  \param data  The serialized GeoJSON Feature object, which must not have
+   *               line feeds if the records have no separators
+   *  \param size  The number of bytes in data
+   */
+  void WriteRaw(const char* data, size_t size) {
+    if (recordSeparators_) sink_.Write(&kRecordSeparator, 1);
+    sink_.Write(data, size);
+    sink_.Write("\n", 1);
+    numFeatures_++;
+  }
+
+  /** \overload */
+  void WriteRaw(const std::string& feature) {
+    WriteRaw(feature.data(), feature.size());
+  }
+
+  /** Returns the number of features written so far */
+  size_t NumFeatures() const { return numFeatures_; }
+
+ private:
+  Sink sink_;
+  size_t numFeatures_;
+  bool recordSeparators_;
+};
+
+/** A sequence writer that writes to a std::ostream */
+using SequenceWriter = BasicSequenceWriter<StreamSink>;
+
+namespace detail {
+
+/** Writes numFeatures features from getFeature to the given sink */
+template <typename Sink, typename Callback>
+void WriteSequence(Sink sink, size_t numFeatures, Callback&& getFeature,
+                   bool recordSeparators) {
+  static_assert(detail::is_invocable_r<nlohmann::json, Callback, size_t>::value,
+                "Callback must be of the form nlohmann::json(size_t)");
+
+  BasicSequenceWriter<Sink> writer(std::move(sink), recordSeparators);
+  for (size_t i = 0; i < numFeatures; i++) {
+    writer.Write(getFeature(i));
+  }
+}
+
+/** Returns whether the text has nothing but whitespace */
+inline bool IsBlank(const char* begin, const char* end) {
+  TextCursor cursor(begin, end);
+  cursor.SkipWhitespace();
+  return cursor.AtEnd();
+}
+
+/** Reads the records of a sequence in [first, end) with the same SAX, so the
+ *  features are numbered across records
+ *
+ *  \param begin  The start of the input, for the positions in errors
+ */
+template <typename Handler>
+void ReadRecords(const char* begin, const char* first, const char* end,
+                 ReaderSax<Handler>& sax) {
+  bool separated = first != end && *first == kRecordSeparator;
+  char delimiter = separated ? kRecordSeparator : '\n';
+  while (first != end) {
+    if (*first == delimiter) first++;
+    auto last = static_cast<const char*>(
+        std::memchr(first, delimiter, static_cast<size_t>(end - first)));
+    if (!last) last = end;
+    if (!IsBlank(first, last)) {
+      TextCursor cursor(begin, last);
+      cursor.p = first;
+      TextScanner<ReaderSax<Handler>>(cursor, sax).Run();
+    }
+    first = last;
+  }
+}
+}
+
+/** Writes a GeoJSON Text Sequence (RFC 8142) to a stream, one feature at a
+ *  time
+ *
+ *  \tparam Callback          A callable of the form nlohmann::json(size_t
+ *                            index)
+ *  \param os                 The stream to write to
+ *  \param numFeatures        The number of features in the sequence
+ *  \param getFeature         Callback that takes the feature index and gives
+ *                            back the feature.
+ *  \param recordSeparators   Whether to start each record with a record
+ *                            separator, or only end them with line feeds
+ */
+template <typename Callback>
+void WriteSequence(std::ostream& os, size_t numFeatures,
+                   Callback&& getFeature, bool recordSeparators = true) {
+  detail::WriteSequence(StreamSink(os), numFeatures,
+                        std::forward<Callback>(getFeature), recordSeparators);
+}
+
+/** \overload */
+template <typename Callback>
+void WriteSequence(std::string& str, size_t numFeatures,
+                   Callback&& getFeature, bool recordSeparators = true) {
+  detail::WriteSequence(StringSink(str), numFeatures,
+                        std::forward<Callback>(getFeature), recordSeparators);
+}
+
+/** Returns the offset of the first record of a sequence that starts at or
+ *  after a byte offset
+ *
+ *  Splitting a sequence at the offsets given by this for any byte offsets
+ *  gives ranges of whole records, so workers can each read a part of a
+ *  sequence without coordinating.
+ *
+ *  \param text    The whole sequence, records are taken to start with record
+ *                 separators if its first one does, and after line feeds
+ *                 otherwise
+ *  \param offset  The byte offset
+ *
+ *  \return The offset of the start of the record, or text.Size() if there are
+ *          no records after offset
+ */
+inline size_t SequenceRecordStart(StringView text, size_t offset) {
+  if (offset >= text.Size()) return text.Size();
+  if (offset == 0) return 0;
+  bool separated = text[0] == kRecordSeparator;
+  if (!separated && text[offset - 1] == '\n') return offset;
+  auto next = static_cast<const char*>(
+      std::memchr(text.Data() + offset, separated ? kRecordSeparator : '\n',
+                  text.Size() - offset));
+  if (!next) return text.Size();
+  return static_cast<size_t>(next - text.Data()) + (separated ? 0 : 1);
+}
+
+/** Reads a GeoJSON Text Sequence (RFC 8142) held in memory, giving its
+ *  contents to a handler as it is parsed
+ *
+ *  Each record is read as with Read(const char*, const char*, Handler&),
+ *  with the features numbered across the records. Records are taken to start
+ *  with record separators if the first one does, so newline-delimited
+ *  GeoJSON, with one text per line, can be read as well. Blank records are
+ *  skipped.
+ *
+ *  \tparam Handler  A type with the methods of ReaderHandler
+ *  \param begin     The start of the sequence
+ *  \param end       One past the end of the sequence
+ *  \param handler   The handler for the contents of the records
+ *
+ *  \throws nlohmann::json::parse_error if a record is not valid JSON
+ *  \throws std::domain_error if a record is not valid GeoJSON
+ */
+template <typename Handler>
+void ReadSequence(const char* begin, const char* end, Handler& handler) {
+  detail::ReaderSax<Handler> sax(handler);
+  detail::ReadRecords(begin, begin, end, sax);
+}
+
+/** \overload */
+template <typename Handler>
+void ReadSequence(const std::string& text, Handler& handler) {
+  ReadSequence(text.data(), text.data() + text.size(), handler);
+}
+
+/** Reads a GeoJSON Text Sequence (RFC 8142) from a stream, one record at a
+ *  time, so only one record is held in memory at once
+ *
+ *  The views given to the OnRaw*() methods are only valid during the call.
+ *
+ *  \tparam Handler  A type with the methods of ReaderHandler
+ *  \param is        The stream to read from
+ *  \param handler   The handler for the contents of the records
+ *
+ *  \throws nlohmann::json::parse_error if a record is not valid JSON
+ *  \throws std::domain_error if a record is not valid GeoJSON
+ */
+template <typename Handler>
+void ReadSequence(std::istream& is, Handler& handler) {
+  detail::ReaderSax<Handler> sax(handler);
+  char delimiter = is.peek() == kRecordSeparator ? kRecordSeparator : '\n';
+  std::string record;
+  while (std::getline(is, record, delimiter)) {
+    const char* data = record.data();
+    if (detail::IsBlank(data, data + record.size())) continue;
+    detail::TextScanner<detail::ReaderSax<Handler>>(
+        detail::TextCursor(data, data + record.size()), sax)
+        .Run();
+  }
+}
+}
@@ -0,0 +1,644 @@
+/** Packed Hilbert R-tree spatial index for libgeojson
+ *
+ *  \file spatial_index.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "libgeojson/libgeojson.h"
+#include "libgeojson/writer.h"
+
+namespace geojson {
+
+/** The default number of children of each node of a PackedRTree */
+static constexpr size_t kDefaultRTreeNodeSize = 16;
+
+namespace detail {
+
+/** Returns the index along a Hilbert curve of order 16 of a point on a
+ *  65536 x 65536 grid
+ *
+ *  This is the branch-free construction of "Fast Hilbert curve generation"
+ *  by rawrunprotected, which flatbush also uses.
+ */
+inline uint32_t HilbertIndex(uint32_t x, uint32_t y) {
+  uint32_t a = x ^ y;
+  uint32_t b = 0xFFFF ^ a;
+  uint32_t c = 0xFFFF ^ (x | y);
+  uint32_t d = x & (y ^ 0xFFFF);
+
+  uint32_t A = a | (b >> 1);
+  uint32_t B = (a >> 1) ^ a;
+  uint32_t C = ((c >> 1) ^ (b & (d >> 1))) ^ c;
+  uint32_t D = ((a & (c >> 1)) ^ (d >> 1)) ^ d;
+
+  a = A;
+  b = B;
+  c = C;
+  d = D;
+  A = (a & (a >> 2)) ^ (b & (b >> 2));
+  B = (a & (b >> 2)) ^ (b & ((a ^ b) >> 2));
+  C ^= (a & (c >> 2)) ^ (b & (d >> 2));
+  D ^= (b & (c >> 2)) ^ ((a ^ b) & (d >> 2));
+
+  a = A;
+  b = B;
+  c = C;
+  d = D;
+  A = (a & (a >> 4)) ^ (b & (b >> 4));
+  B = (a & (b >> 4)) ^ (b & ((a ^ b) >> 4));
+  C ^= (a & (c >> 4)) ^ (b & (d >> 4));
+  D ^= (b & (c >> 4)) ^ ((a ^ b) & (d >> 4));
+
+  a = A;
+  b = B;
+  c = C;
+  d = D;
+  C ^= (a & (c >> 8)) ^ (b & (d >> 8));
+  D ^= (b & (c >> 8)) ^ ((a ^ b) & (d >> 8));
+
+  a = C ^ (C >> 1);
+  b = D ^ (D >> 1);
+
+  uint32_t i0 = x ^ y;
+  uint32_t i1 = b | (0xFFFF ^ (i0 | a));
+
+  i0 = (i0 | (i0 << 8)) & 0x00FF00FF;
+  i0 = (i0 | (i0 << 4)) & 0x0F0F0F0F;
+  i0 = (i0 | (i0 << 2)) & 0x33333333;
+  i0 = (i0 | (i0 << 1)) & 0x55555555;
+
+  i1 = (i1 | (i1 << 8)) & 0x00FF00FF;
+  i1 = (i1 | (i1 << 4)) & 0x0F0F0F0F;
+  i1 = (i1 | (i1 << 2)) & 0x33333333;
+  i1 = (i1 | (i1 << 1)) & 0x55555555;
+
+  return (i1 << 1) | i0;
+}
+
+/** Maps the centers of boxes within some bounds onto the Hilbert curve */
+class HilbertMapping {
+ public:
+  explicit HilbertMapping(const BoundingBox& bounds)
+      : minLon_(bounds.MinLon()), minLat_(bounds.MinLat()),
+        lonScale_(Scale(bounds.MinLon(), bounds.MaxLon())),
+        latScale_(Scale(bounds.MinLat(), bounds.MaxLat())) {}
+
+  /** Returns the Hilbert index of the center of the box, with centers outside
+   *  of the bounds taken to the nearest edge
+   */
+  uint32_t operator()(double minLon, double minLat, double maxLon,
+                      double maxLat) const {
+    return HilbertIndex(Grid(((minLon + maxLon) / 2 - minLon_) * lonScale_),
+                        Grid(((minLat + maxLat) / 2 - minLat_) * latScale_));
+  }
+
+ private:
+  static constexpr double kMaxCoordinate = 65535;
+
+  static uint32_t Grid(double coordinate) {
+    if (!(coordinate > 0)) return 0;
+    return static_cast<uint32_t>(
+        coordinate < kMaxCoordinate ? coordinate : kMaxCoordinate);
+  }
+
+  static double Scale(double min, double max) {
+    return max > min ? kMaxCoordinate / (max - min) : 0;
+  }
+
+  double minLon_;
+  double minLat_;
+  double lonScale_;
+  double latScale_;
+};
+
+/** Appends the bytes of a value to a buffer */
+template <typename T>
+void AppendBytes(std::string& out, const T* values, size_t count) {
+  out.append(reinterpret_cast<const char*>(values), count * sizeof(T));
+}
+
+/** Reads values from the bytes of a buffer, advancing through it
+ *
+ *  \throws std::domain_error if the buffer is too short
+ */
+template <typename T>
+void ReadBytes(const char*& p, const char* end, T* values, size_t count) {
+  if (static_cast<size_t>(end - p) / sizeof(T) < count) {
+    throw std::domain_error("Spatial index data is truncated");
+  }
+  if (count == 0) {
+    return;  // values may be null
+  }
+  std::memcpy(values, p, count * sizeof(T));
+  p += count * sizeof(T);
+}
+}
+
+/** A static R-tree over boxes, packed in the order of the Hilbert curve
+ *
+ *  The boxes are added in bulk and the tree is built once by Finish(), by
+ *  sorting them along a Hilbert curve through their centers and grouping
+ *  every nodeSize consecutive boxes into a parent node. The nodes are held in
+ *  two flat arrays, so the tree takes about 40 bytes per box, is built in
+ *  O(n log n) and serializes as a copy of those arrays. This is the layout of
+ *  flatbush.
+ */
+class PackedRTree {
+ public:
+  /** Constructor
+   *
+   *  \param numItems  The number of boxes that will be added
+   *  \param nodeSize  The number of children of each node, in [2, 65535]
+   */
+  explicit PackedRTree(size_t numItems = 0,
+                       size_t nodeSize = kDefaultRTreeNodeSize)
+      : numItems_(numItems), nodeSize_(nodeSize), numAdded_(0) {
+    if (nodeSize < 2 || nodeSize > 65535) {
+      throw std::domain_error("R-tree node size must be in [2, 65535]");
+    }
+    // The number of nodes before the end of each level, from the leaves up
+    size_t count = numItems;
+    size_t numNodes = numItems;
+    levelBounds_.push_back(numNodes);
+    if (numItems > 0) {
+      do {
+        count = (count + nodeSize - 1) / nodeSize;
+        numNodes += count;
+        levelBounds_.push_back(numNodes);
+      } while (count != 1);
+    }
+    boxes_.reserve(numNodes * 4);
+    indices_.reserve(numNodes);
+  }
+
+  /** Adds a box, all of them must be added before Finish() is called
+   *
+   *  \return The index of the box, which Search() gives back
+   *
+   *  \throws std::logic_error if all of the boxes have been added
+   */
+  size_t Add(double minLon, double minLat, double maxLon, double maxLat) {
+    if (numAdded_ == numItems_) {
+      throw std::logic_error("Added more boxes to the R-tree than it holds");
+    }
+    boxes_.push_back(minLon);
+    boxes_.push_back(minLat);
+    boxes_.push_back(maxLon);
+    boxes_.push_back(maxLat);
+    indices_.push_back(numAdded_);
+    bounds_.Extend(minLon, minLat);
+    bounds_.Extend(maxLon, maxLat);
+    return numAdded_++;
+  }
+
+  /** \overload */
+  size_t Add(const BoundingBox& box) {
+    return Add(box.MinLon(), box.MinLat(), box.MaxLon(), box.MaxLat());
+  }
+
+  /** Sorts the boxes and builds the nodes of the tree
+   *
+   *  \throws std::logic_error if fewer boxes were added than the tree holds
+   */
+  void Finish() {
+    if (numAdded_ != numItems_) {
+      throw std::logic_error("Added fewer boxes to the R-tree than it holds");
+    }
+    if (IsFinished()) return;
+
+    if (numItems_ > nodeSize_) SortItems();
+
+    // Each parent bounds the next nodeSize nodes of the level below, and
+    // holds the position of the first of them
+    size_t pos = 0;
+    for (size_t level = 0; level + 1 < levelBounds_.size(); level++) {
+      size_t end = levelBounds_[level];
+      while (pos < end) {
+        size_t first = pos;
+        double minLon = boxes_[4 * pos], minLat = boxes_[4 * pos + 1];
+        double maxLon = boxes_[4 * pos + 2], maxLat = boxes_[4 * pos + 3];
+        for (pos++; pos < end && pos < first + nodeSize_; pos++) {
+          minLon = std::min(minLon, boxes_[4 * pos]);
+          minLat = std::min(minLat, boxes_[4 * pos + 1]);
+          maxLon = std::max(maxLon, boxes_[4 * pos + 2]);
+          maxLat = std::max(maxLat, boxes_[4 * pos + 3]);
+        }
+        boxes_.push_back(minLon);
+        boxes_.push_back(minLat);
+        boxes_.push_back(maxLon);
+        boxes_.push_back(maxLat);
+        indices_.push_back(first);
+      }
+    }
+  }
+
+  /** Returns whether Finish() has built the tree */
+  bool IsFinished() const { return indices_.size() == levelBounds_.back(); }
+
+  /** Returns the number of boxes in the tree */
+  size_t NumItems() const { return numItems_; }
+
+  /** Returns the number of children of each node */
+  size_t NodeSize() const { return nodeSize_; }
+
+  /** Returns the bounds of every box in the tree */
+  const BoundingBox& Bounds() const { return bounds_; }
+
+  /** Calls found(index) with the index of every box that intersects the query
+   *  box, in no particular order
+   *
+   *  \throws std::logic_error if the tree has not been finished
+   */
+  template <typename Callback>
+  void Search(double minLon, double minLat, double maxLon, double maxLat,
+              Callback&& found) const {
+    if (!IsFinished()) {
+      throw std::logic_error("The R-tree must be finished before searching");
+    }
+    if (numItems_ == 0) return;
+
+    // Pairs of the first node of a group to check and its level
+    std::vector<std::pair<size_t, size_t>> stack;
+    stack.emplace_back(indices_.size() - 1, levelBounds_.size() - 1);
+    while (!stack.empty()) {
+      size_t node = stack.back().first;
+      size_t level = stack.back().second;
+      stack.pop_back();
+      size_t end = std::min(node + nodeSize_, levelBounds_[level]);
+      for (size_t pos = node; pos < end; pos++) {
+        const double* box = &boxes_[4 * pos];
+        if (box[2] < minLon || box[3] < minLat || box[0] > maxLon ||
+            box[1] > maxLat) {
+          continue;
+        }
+        if (level == 0) {
+          found(indices_[pos]);
+        } else {
+          stack.emplace_back(indices_[pos], level - 1);
+        }
+      }
+    }
+  }
+
+  /** \overload */
+  template <typename Callback>
+  void Search(const BoundingBox& query, Callback&& found) const {
+    Search(query.MinLon(), query.MinLat(), query.MaxLon(), query.MaxLat(),
+           std::forward<Callback>(found));
+  }
+
+  /** Returns the indices of the boxes that intersect the query box */
+  std::vector<size_t> Search(const BoundingBox& query) const {
+    std::vector<size_t> results;
+    Search(query, [&](size_t index) { results.push_back(index); });
+    return results;
+  }
+
+  /** Appends the finished tree to a buffer, in the byte order of this
+   *  machine
+   */
+  void Serialize(std::string& out) const {
+    uint64_t header[3] = {kMagic, numItems_, nodeSize_};
+    detail::AppendBytes(out, header, 3);
+    detail::AppendBytes(out, boxes_.data(), boxes_.size());
+    std::vector<uint64_t> indices(indices_.begin(), indices_.end());
+    detail::AppendBytes(out, indices.data(), indices.size());
+  }
+
+  /** Returns a finished tree read from a buffer written by Serialize(),
+   *  advancing data past it
+   *
+   *  \throws std::domain_error if the data is not a serialized tree
+   */
+  static PackedRTree Deserialize(const char*& data, const char* end) {
+    uint64_t header[3];
+    detail::ReadBytes(data, end, header, 3);
+    if (header[0] != kMagic) {
+      throw std::domain_error("Data is not a serialized R-tree");
+    }
+    // Each item takes a box and an index, so check that many are left before
+    // the tree allocates for them
+    const uint64_t kNodeBytes = 4 * sizeof(double) + sizeof(uint64_t);
+    if (static_cast<uint64_t>(end - data) / kNodeBytes < header[1]) {
+      throw std::domain_error("Spatial index data is truncated");
+    }
+    PackedRTree tree(static_cast<size_t>(header[1]),
+                     static_cast<size_t>(header[2]));
+    size_t numNodes = tree.levelBounds_.back();
+    if (static_cast<size_t>(end - data) / (4 * sizeof(double)) < numNodes) {
+      throw std::domain_error("Spatial index data is truncated");
+    }
+    tree.boxes_.resize(numNodes * 4);
+    detail::ReadBytes(data, end, tree.boxes_.data(), numNodes * 4);
+    std::vector<uint64_t> indices(numNodes);
+    detail::ReadBytes(data, end, indices.data(), numNodes);
+    // Search() follows the indices, so each must be a box of the tree: an
+    // item for a leaf, and a node of the level below for the others
+    size_t level = 0, levelBegin = 0;
+    for (size_t i = 0; i < numNodes; i++) {
+      while (i == tree.levelBounds_[level]) {
+        levelBegin = level == 0 ? 0 : tree.levelBounds_[level - 1];
+        level++;
+      }
+      uint64_t index = indices[i];
+      bool valid = level == 0 ? index < tree.numItems_
+                              : index >= levelBegin &&
+                                    index < tree.levelBounds_[level - 1];
+      if (!valid) throw std::domain_error("Spatial index data is corrupt");
+    }
+    tree.indices_.assign(indices.begin(), indices.end());
+    tree.numAdded_ = tree.numItems_;
+    for (size_t i = 0; i < tree.numItems_; i++) {
+      tree.bounds_.Extend(tree.boxes_[4 * i], tree.boxes_[4 * i + 1]);
+      tree.bounds_.Extend(tree.boxes_[4 * i + 2], tree.boxes_[4 * i + 3]);
+    }
+    return tree;
+  }
+
+ private:
+  /** "GJRTREE1" as a little-endian integer */
+  static constexpr uint64_t kMagic = 0x3145455254524a47ull;
+
+  /** Sorts the leaves by the Hilbert index of their centers */
+  void SortItems() {
+    detail::HilbertMapping hilbert(bounds_);
+    std::vector<std::pair<uint32_t, size_t>> order(numItems_);
+    for (size_t i = 0; i < numItems_; i++) {
+      const double* box = &boxes_[4 * i];
+      order[i] = std::make_pair(hilbert(box[0], box[1], box[2], box[3]), i);
+    }
+    std::sort(order.begin(), order.end());
+
+    std::vector<double> boxes(4 * numItems_);
+    for (size_t i = 0; i < numItems_; i++) {
+      std::copy_n(&boxes_[4 * order[i].second], 4, &boxes[4 * i]);
+      indices_[i] = order[i].second;
+    }
+    std::copy(boxes.begin(), boxes.end(), boxes_.begin());
+  }
+
+  size_t numItems_;
+  size_t nodeSize_;
+  size_t numAdded_;
+  std::vector<size_t> levelBounds_;
+  std::vector<double> boxes_;
+  std::vector<size_t> indices_;
+  BoundingBox bounds_;
+};
+
+/** A spatial index of the features of a FeatureCollection, written alongside
+ *  it by an IndexedFeatureCollectionWriter
+ *
+ *  Each feature with a geometry is indexed by the bbox of its feature, along
+ *  with where its text is in the written collection, so the features in a
+ *  viewport can be read straight out of a MappedFile of the collection.
+ */
+class FeatureIndex {
+ public:
+  /** A feature found by Search() */
+  struct Entry {
+    /** The index of the feature in the collection */
+    size_t feature;
+
+    /** The byte offset of the text of the feature in the collection */
+    size_t offset;
+
+    /** The number of bytes of the text of the feature */
+    size_t size;
+  };
+
+  FeatureIndex() {}
+
+  /** Constructor, from a finished tree and the features of its boxes */
+  FeatureIndex(PackedRTree tree, std::vector<Entry> entries)
+      : tree_(std::move(tree)), entries_(std::move(entries)) {
+    if (entries_.size() != tree_.NumItems()) {
+      throw std::logic_error("Feature index needs an entry for every box");
+    }
+  }
+
+  /** Returns the number of indexed features */
+  size_t NumFeatures() const { return entries_.size(); }
+
+  /** Returns the tree over the bboxes of the features */
+  const PackedRTree& Tree() const { return tree_; }
+
+  /** Calls found(entry) for every feature whose bbox intersects the query
+   *  box, in no particular order
+   */
+  template <typename Callback>
+  void Search(const BoundingBox& query, Callback&& found) const {
+    tree_.Search(query, [&](size_t i) { found(entries_[i]); });
+  }
+
+  /** Returns the features whose bboxes intersect the query box, in the order
+   *  of the collection
+   */
+  std::vector<Entry> Search(const BoundingBox& query) const {
+    std::vector<Entry> results;
+    Search(query, [&](const Entry& entry) { results.push_back(entry); });
+    std::sort(results.begin(), results.end(),
+              [](const Entry& a, const Entry& b) {
+                return a.feature < b.feature;
+              });
+    return results;
+  }
+
+  /** Returns the serialized index, in the byte order of this machine */
+  std::string Serialize() const {
+    std::string out;
+    tree_.Serialize(out);
+    std::vector<uint64_t> entries;
+    entries.reserve(3 * entries_.size());
+    for (const auto& entry : entries_) {
+      entries.push_back(entry.feature);
+      entries.push_back(entry.offset);
+      entries.push_back(entry.size);
+    }
+    detail::AppendBytes(out, entries.data(), entries.size());
+    return out;
+  }
+
+  /** Returns an index read from data written by Serialize()
+   *
+   *  \throws std::domain_error if the data is not a serialized index
+   */
+  static FeatureIndex Deserialize(const char* data, size_t size) {
+    const char* end = data + size;
+    auto tree = PackedRTree::Deserialize(data, end);
+    std::vector<uint64_t> values(3 * tree.NumItems());
+    detail::ReadBytes(data, end, values.data(), values.size());
+    if (data != end) {
+      throw std::domain_error("Spatial index data has trailing bytes");
+    }
+    std::vector<Entry> entries(tree.NumItems());
+    for (size_t i = 0; i < entries.size(); i++) {
+      entries[i] = Entry{static_cast<size_t>(values[3 * i]),
+                         static_cast<size_t>(values[3 * i + 1]),
+                         static_cast<size_t>(values[3 * i + 2])};
+    }
+    return FeatureIndex(std::move(tree), std::move(entries));
+  }
+
+  /** \overload */
+  static FeatureIndex Deserialize(const std::string& data) {
+    return Deserialize(data.data(), data.size());
+  }
+
+ private:
+  PackedRTree tree_;
+  std::vector<Entry> entries_;
+};
+
+namespace detail {
+
+/** A sink that counts the bytes written through it */
+template <typename Sink>
+class CountingSink {
+ public:
+  CountingSink(Sink sink, size_t* count)
+      : sink_(std::move(sink)), count_(count) {}
+
+  void Write(const char* data, size_t size) {
+    sink_.Write(data, size);
+    *count_ += size;
+  }
+
+  void Flush() { FlushSink(sink_); }
+
+ private:
+  Sink sink_;
+  size_t* count_;
+};
+}
+
+/** Writes a FeatureCollection along with a spatial index of its features
+ *
+ *  The features are written as by BasicFeatureCollectionWriter, and the
+ *  bbox and position in the output of each one are kept, which takes a few
+ *  dozen bytes per feature. Close() writes the end of the collection and
+ *  builds the index, which can then be serialized next to the collection.
+ *
+ *  \tparam Sink  A type with a member void Write(const char*, size_t)
+ */
+template <typename Sink>
+class BasicIndexedFeatureCollectionWriter {
+ public:
+  /** Constructor, writes the header of the collection
+   *
+   *  \param sink      The sink to which the collection is written
+   *  \param nodeSize  The number of children of each node of the index
+   */
+  explicit BasicIndexedFeatureCollectionWriter(
+      Sink sink, size_t nodeSize = kDefaultRTreeNodeSize)
+      : numBytes_(0),
+        writer_(detail::CountingSink<Sink>(std::move(sink), &numBytes_)),
+        nodeSize_(nodeSize), closed_(false) {}
+
+  /** Writes a feature to the collection
+   *
+   *  \param feature  A GeoJSON Feature object, which must have a bbox member
+   *                  (see CoordinateFormat::WithBoundingBoxes()) unless its
+   *                  geometry is null
+   *
+   *  \throws std::domain_error if a feature with a geometry has no bbox
+   */
+  template <typename Json>
+  void Write(const Json& feature) {
+    detail::LibraryScope scope;
+    auto text = feature.dump();
+    auto bbox = feature.find("bbox");
+    if (bbox != feature.end()) {
+      WriteRaw(text.data(), text.size(), BoundingBox::FromJson(*bbox));
+      return;
+    }
+    auto geometry = feature.find("geometry");
+    if (geometry == feature.end() || !geometry->is_null()) {
+      throw std::domain_error("Indexed features must have a bbox member");
+    }
+    WriteRaw(text.data(), text.size(), BoundingBox());
+  }
+
+  /** Writes an already serialized feature to the collection verbatim
+   *
+   *  \param data    The serialized GeoJSON Feature object
+   *  \param size    The number of bytes in data
+   *  \param bounds  The bounds of the feature, which is not indexed if they
+   *                 are empty
+   */
+  void WriteRaw(const char* data, size_t size, const BoundingBox& bounds) {
+    writer_.WriteRaw(data, size);
+    if (!bounds.Empty()) {
+      boxes_.push_back(bounds);
+      entries_.push_back(FeatureIndex::Entry{writer_.NumFeatures() - 1,
+                                             numBytes_ - size, size});
+    }
+  }
+
+  /** Writes the end of the collection and returns the index of its features
+   *
+   *  \throws std::logic_error if the collection is already closed
+   */
+  FeatureIndex Close() {
+    if (closed_) throw std::logic_error("FeatureCollection is already closed");
+    closed_ = true;
+    writer_.Close();
+    PackedRTree tree(boxes_.size(), nodeSize_);
+    for (const auto& box : boxes_) tree.Add(box);
+    tree.Finish();
+    boxes_ = std::vector<BoundingBox>();
+    return FeatureIndex(std::move(tree), std::move(entries_));
+  }
+
+  /** Returns the number of features written so far */
+  size_t NumFeatures() const { return writer_.NumFeatures(); }
+
+ private:
+  size_t numBytes_;
+  BasicFeatureCollectionWriter<detail::CountingSink<Sink>> writer_;
+  size_t nodeSize_;
+  bool closed_;
+  std::vector<BoundingBox> boxes_;
+  std::vector<FeatureIndex::Entry> entries_;
+};
+
+/** An indexed FeatureCollection writer that writes to a std::ostream */
+using IndexedFeatureCollectionWriter =
+    BasicIndexedFeatureCollectionWriter<StreamSink>;
+
+/** Writes a FeatureCollection object (section 3.3) to a stream, one feature at
+ *  a time, and its spatial index to another
+ *
+ *  \tparam Callback    A callable of the form nlohmann::json(size_t index),
+ *                      giving features with bbox members
+ *  \param os           The stream to write the collection to
+ *  \param indexOs      The stream to write the serialized FeatureIndex to
+ *  \param numFeatures  The number of features in the collection
+ *  \param getFeature   Callback that takes the feature index and gives back
+ *                      the feature.
+ *
+ *  \throws std::domain_error if a feature with a geometry has no bbox
+ */
+template <typename Callback>
+void WriteIndexedFeatureCollection(std::ostream& os, std::ostream& indexOs,
+                                   size_t numFeatures, Callback&& getFeature) {
+  IndexedFeatureCollectionWriter writer{StreamSink(os)};
+  for (size_t i = 0; i < numFeatures; i++) {
+    writer.Write(getFeature(i));
+  }
+  auto index = writer.Close().Serialize();
+  indexOs.write(index.data(), static_cast<std::streamsize>(index.size()));
+}
+}
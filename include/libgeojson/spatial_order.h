@@ -0,0 +1,454 @@
+/** Spatially ordered FeatureCollection output for libgeojson
+ *
+ *  \file spatial_order.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "libgeojson/libgeojson.h"
+#include "libgeojson/spatial_index.h"
+#include "libgeojson/writer.h"
+
+namespace geojson {
+
+/** The default number of bytes of features sorted in memory at a time */
+static constexpr size_t kDefaultSortRunSize = 64 * 1024 * 1024;
+
+namespace detail {
+
+/** The sort key of features without a bbox, after every Hilbert index */
+static constexpr uint64_t kUnboundedSortKey = uint64_t(1) << 32;
+
+/** The smallest buffer with which a sorted run is read back */
+static constexpr size_t kMinSortedRunBuffer = 64 * 1024;
+
+/** An anonymous temporary file, which is removed when it is closed
+ *
+ *  It is only appended to until it is first read.
+ */
+class TemporaryFile {
+ public:
+  /** Constructor, creates the file
+   *
+   *  \throws std::system_error if the file cannot be created
+   */
+  TemporaryFile() : file_(std::tmpfile()), size_(0) {
+    if (!file_) Fail();
+  }
+
+  TemporaryFile(const TemporaryFile&) = delete;
+  TemporaryFile& operator=(const TemporaryFile&) = delete;
+
+  ~TemporaryFile() { std::fclose(file_); }
+
+  /** Appends bytes to the end of the file */
+  void Append(const void* data, size_t size) {
+    if (size > 0 && std::fwrite(data, 1, size, file_) != size) Fail();
+    size_ += size;
+  }
+
+  /** Reads size bytes from an offset in the file */
+  void ReadAt(uint64_t offset, void* data, size_t size) {
+    // fseek() takes a long, which is 32 bits on some platforms
+#ifdef _WIN32
+    int result = _fseeki64(file_, static_cast<__int64>(offset), SEEK_SET);
+#else
+    int result = fseeko(file_, static_cast<off_t>(offset), SEEK_SET);
+#endif
+    if (result != 0 || std::fread(data, 1, size, file_) != size) Fail();
+  }
+
+  /** Returns the number of bytes in the file */
+  uint64_t Size() const { return size_; }
+
+ private:
+  [[noreturn]] static void Fail() {
+    int error = errno ? errno : EIO;
+    throw std::system_error(error, std::generic_category(),
+                            "Temporary file for sorting features");
+  }
+
+  FILE* file_;
+  uint64_t size_;
+};
+
+/** A feature held in memory by a HilbertFeatureSorter */
+struct SortedFeature {
+  uint64_t key;
+  size_t offset;
+  size_t size;
+  BoundingBox bounds;
+};
+
+/** The header of a feature in a sorted run, followed by its text */
+struct SortedFeatureHeader {
+  uint64_t key;
+  uint64_t size;
+  BoundingBox bounds;
+};
+
+/** Reads the features of one sorted run back from a temporary file */
+class SortedRunReader {
+ public:
+  SortedRunReader(TemporaryFile& file, uint64_t begin, uint64_t end,
+                  size_t bufferSize)
+      : file_(&file), pos_(begin), end_(end), bufferSize_(bufferSize),
+        bufferPos_(0) {}
+
+  /** Reads the next feature of the run, returning false at its end */
+  bool Next() {
+    if (pos_ == end_ && bufferPos_ == buffer_.size()) return false;
+    Read(reinterpret_cast<char*>(&header_), sizeof(header_));
+    text_.resize(static_cast<size_t>(header_.size));
+    if (!text_.empty()) Read(&text_[0], text_.size());
+    return true;
+  }
+
+  /** Returns the header of the current feature */
+  const SortedFeatureHeader& Header() const { return header_; }
+
+  /** Returns the text of the current feature */
+  const std::string& Text() const { return text_; }
+
+ private:
+  void Read(char* data, size_t size) {
+    while (size > 0) {
+      if (bufferPos_ == buffer_.size()) Refill();
+      size_t count = std::min(size, buffer_.size() - bufferPos_);
+      std::memcpy(data, &buffer_[bufferPos_], count);
+      bufferPos_ += count;
+      data += count;
+      size -= count;
+    }
+  }
+
+  void Refill() {
+    auto count = static_cast<size_t>(
+        std::min<uint64_t>(bufferSize_, end_ - pos_));
+    if (count == 0) {
+      throw std::logic_error("Sorted run of features is truncated");
+    }
+    buffer_.resize(count);
+    file_->ReadAt(pos_, &buffer_[0], count);
+    pos_ += count;
+    bufferPos_ = 0;
+  }
+
+  TemporaryFile* file_;
+  uint64_t pos_;
+  uint64_t end_;
+  size_t bufferSize_;
+  std::vector<char> buffer_;
+  size_t bufferPos_;
+  SortedFeatureHeader header_;
+  std::string text_;
+};
+}
+
+/** Sorts serialized features along a Hilbert curve through the centers of
+ *  their bboxes, in bounded memory
+ *
+ *  Features are held in memory until about runSize bytes of them have been
+ *  added, then sorted and appended to an anonymous temporary file as a run.
+ *  Drain() merges the runs back together, reading each one through a buffer
+ *  of its own, so sorting any number of features takes about runSize bytes
+ *  of memory. If all of the features fit in one run, nothing is written to
+ *  disk.
+ *
+ *  As the features are streamed, the curve is laid over an extent given up
+ *  front rather than the bounds of the features, which is the whole world by
+ *  default. Centers outside of the extent are taken to its nearest edge.
+ *  Features without a bbox, i.e. with a null geometry, are placed after all of
+ *  the others, and features with the same Hilbert index keep the order in
+ *  which they were added.
+ */
+class HilbertFeatureSorter {
+ public:
+  /** Constructor
+   *
+   *  \param extent   The area over which the features are ordered
+   *  \param runSize  The number of bytes of features sorted in memory
+   */
+  explicit HilbertFeatureSorter(
+      const BoundingBox& extent = BoundingBox::FromCorners(-180, -90, 180, 90),
+      size_t runSize = kDefaultSortRunSize)
+      : hilbert_(extent), runSize_(runSize), numFeatures_(0) {}
+
+  /** Adds a feature to be sorted
+   *
+   *  \param feature  A GeoJSON Feature object, which must have a bbox member
+   *                  (see CoordinateFormat::WithBoundingBoxes()) unless its
+   *                  geometry is null
+   *
+   *  \throws std::domain_error if a feature with a geometry has no bbox
+   */
+  template <typename Json>
+  void Add(const Json& feature) {
+    auto text = feature.dump();
+    auto bbox = feature.find("bbox");
+    if (bbox != feature.end()) {
+      AddRaw(text.data(), text.size(), BoundingBox::FromJson(*bbox));
+      return;
+    }
+    auto geometry = feature.find("geometry");
+    if (geometry == feature.end() || !geometry->is_null()) {
+      throw std::domain_error("Sorted features must have a bbox member");
+    }
+    AddRaw(text.data(), text.size(), BoundingBox());
+  }
+
+  /** Adds an already serialized feature to be sorted
+   *
+   *  \param data    The serialized GeoJSON Feature object
+   *  \param size    The number of bytes in data
+   *  \param bounds  The bounds of the feature, which is placed after the
+   *                 others if they are empty
+   */
+  void AddRaw(const char* data, size_t size, const BoundingBox& bounds) {
+    features_.push_back(
+        detail::SortedFeature{SortKey(bounds), text_.size(), size, bounds});
+    text_.append(data, size);
+    numFeatures_++;
+    if (text_.size() + features_.size() * sizeof(detail::SortedFeature) >=
+        runSize_) {
+      SpillRun();
+    }
+  }
+
+  /** Returns the key by which a feature with the given bounds is ordered
+   *
+   *  Drain() gives the features in the order of a stable sort by their keys.
+   */
+  uint64_t SortKey(const BoundingBox& bounds) const {
+    if (bounds.Empty()) return detail::kUnboundedSortKey;
+    return hilbert_(bounds.MinLon(), bounds.MinLat(), bounds.MaxLon(),
+                    bounds.MaxLat());
+  }
+
+  /** Returns the number of features added since the last Drain() */
+  size_t NumFeatures() const { return numFeatures_; }
+
+  /** Gives the features to a callback in order and empties the sorter
+   *
+   *  \tparam Callback  A callable of the form
+   *                    void(const char* data, size_t size,
+   *                         const BoundingBox& bounds)
+   *
+   *  \throws std::system_error if the temporary file cannot be read
+   */
+  template <typename Callback>
+  void Drain(Callback&& write) {
+    if (runs_.empty()) {
+      SortRun();
+      for (const auto& feature : features_) {
+        write(text_.data() + feature.offset, feature.size, feature.bounds);
+      }
+    } else {
+      if (!features_.empty()) SpillRun();
+      MergeRuns(write);
+    }
+    features_.clear();
+    text_.clear();
+    runs_.clear();
+    file_.reset();
+    numFeatures_ = 0;
+  }
+
+ private:
+  void SortRun() {
+    std::stable_sort(features_.begin(), features_.end(),
+                     [](const detail::SortedFeature& a,
+                        const detail::SortedFeature& b) {
+                       return a.key < b.key;
+                     });
+  }
+
+  /** Sorts the features in memory and appends them to the file as a run */
+  void SpillRun() {
+    SortRun();
+    if (!file_) file_.reset(new detail::TemporaryFile());
+    uint64_t begin = file_->Size();
+    for (const auto& feature : features_) {
+      detail::SortedFeatureHeader header{feature.key, feature.size,
+                                         feature.bounds};
+      file_->Append(&header, sizeof(header));
+      file_->Append(text_.data() + feature.offset, feature.size);
+    }
+    runs_.push_back(std::make_pair(begin, file_->Size()));
+    features_.clear();
+    text_.clear();
+  }
+
+  /** Merges the runs in the file, taking the earlier run on ties */
+  template <typename Callback>
+  void MergeRuns(Callback& write) {
+    size_t bufferSize =
+        std::max(detail::kMinSortedRunBuffer, runSize_ / runs_.size());
+    std::vector<detail::SortedRunReader> readers;
+    readers.reserve(runs_.size());
+    using Next = std::pair<uint64_t, size_t>;
+    std::priority_queue<Next, std::vector<Next>, std::greater<Next>> next;
+    for (const auto& run : runs_) {
+      readers.emplace_back(*file_, run.first, run.second, bufferSize);
+      if (readers.back().Next()) {
+        next.push(Next(readers.back().Header().key, readers.size() - 1));
+      }
+    }
+    while (!next.empty()) {
+      auto& reader = readers[next.top().second];
+      next.pop();
+      const auto& text = reader.Text();
+      write(text.data(), text.size(), reader.Header().bounds);
+      if (reader.Next()) {
+        next.push(Next(reader.Header().key,
+                       static_cast<size_t>(&reader - readers.data())));
+      }
+    }
+  }
+
+  detail::HilbertMapping hilbert_;
+  size_t runSize_;
+  size_t numFeatures_;
+  std::vector<detail::SortedFeature> features_;
+  std::string text_;
+  std::unique_ptr<detail::TemporaryFile> file_;
+  std::vector<std::pair<uint64_t, uint64_t>> runs_;
+};
+
+/** Writes a FeatureCollection object (section 3.3) with its features in the
+ *  order of a Hilbert curve through the centers of their bboxes
+ *
+ *  The features are held by a HilbertFeatureSorter, spilling to a temporary
+ *  file once there are more than a run of them, and written out in order by
+ *  Close(). Features that are near each other thus end up near each other in
+ *  the output, so a reader of a range of its bytes sees a compact area.
+ *
+ *  \tparam Sink  A type with a member void Write(const char*, size_t)
+ */
+template <typename Sink>
+class BasicHilbertFeatureCollectionWriter {
+ public:
+  /** Constructor, writes the header of the collection
+   *
+   *  \param sink     The sink to which the collection is written
+   *  \param extent   The area over which the features are ordered
+   *  \param runSize  The number of bytes of features sorted in memory
+   */
+  explicit BasicHilbertFeatureCollectionWriter(
+      Sink sink,
+      const BoundingBox& extent = BoundingBox::FromCorners(-180, -90, 180, 90),
+      size_t runSize = kDefaultSortRunSize)
+      : writer_(std::move(sink)), sorter_(extent, runSize), closed_(false) {}
+
+  /** Destructor, closes the collection if Close() was not called, ignoring
+   *  errors, so call Close() to see them
+   */
+  ~BasicHilbertFeatureCollectionWriter() {
+    try {
+      Close();
+    } catch (...) {
+    }
+  }
+
+  /** Adds a feature to the collection
+   *
+   *  \param feature  A GeoJSON Feature object, which must have a bbox member
+   *                  unless its geometry is null
+   *
+   *  \throws std::domain_error if a feature with a geometry has no bbox
+   *  \throws std::logic_error if the collection is closed
+   */
+  template <typename Json>
+  void Write(const Json& feature) {
+    CheckOpen();
+    sorter_.Add(feature);
+  }
+
+  /** Adds an already serialized feature to the collection verbatim
+   *
+   *  \param data    The serialized GeoJSON Feature object
+   *  \param size    The number of bytes in data
+   *  \param bounds  The bounds of the feature, which is written after the
+   *                 others if they are empty
+   *
+   *  \throws std::logic_error if the collection is closed
+   */
+  void WriteRaw(const char* data, size_t size, const BoundingBox& bounds) {
+    CheckOpen();
+    sorter_.AddRaw(data, size, bounds);
+  }
+
+  /** Writes the features in order and the closing brackets of the collection,
+   *  further calls are no-ops
+   */
+  void Close() {
+    if (closed_) return;
+    closed_ = true;
+    sorter_.Drain([this](const char* data, size_t size, const BoundingBox&) {
+      writer_.WriteRaw(data, size);
+    });
+    writer_.Close();
+  }
+
+  /** Returns the number of features written so far */
+  size_t NumFeatures() const {
+    return writer_.NumFeatures() + sorter_.NumFeatures();
+  }
+
+ private:
+  void CheckOpen() const {
+    if (closed_) {
+      throw std::logic_error("Cannot write to a closed FeatureCollection");
+    }
+  }
+
+  BasicFeatureCollectionWriter<Sink> writer_;
+  HilbertFeatureSorter sorter_;
+  bool closed_;
+};
+
+/** A Hilbert-ordered FeatureCollection writer that writes to a std::ostream */
+using HilbertFeatureCollectionWriter =
+    BasicHilbertFeatureCollectionWriter<StreamSink>;
+
+/** Writes a FeatureCollection object (section 3.3) to a stream, with its
+ *  features in the order of a Hilbert curve through their bboxes
+ *
+ *  \tparam Callback    A callable of the form nlohmann::json(size_t index),
+ *                      giving features with bbox members
+ *  \param os           The stream to write to
+ *  \param numFeatures  The number of features in the collection
+ *  \param getFeature   Callback that takes the feature index and gives back
+ *                      the feature.
+ *  \param extent       The area over which the features are ordered
+ *
+ *  \throws std::domain_error if a feature with a geometry has no bbox
+ */
+template <typename Callback>
+void WriteHilbertFeatureCollection(
+    std::ostream& os, size_t numFeatures, Callback&& getFeature,
+    const BoundingBox& extent = BoundingBox::FromCorners(-180, -90, 180, 90)) {
+  HilbertFeatureCollectionWriter writer(StreamSink(os), extent);
+  for (size_t i = 0; i < numFeatures; i++) {
+    writer.Write(getFeature(i));
+  }
+  writer.Close();
+}
+}
@@ -0,0 +1,1321 @@
+/** Direct-to-text GeoJSON encoders
+ *
+ *  The functions in this file mirror the geometry builders in libgeojson.h,
+ *  taking the same callbacks, but write the GeoJSON text straight into a
+ *  character buffer instead of building a nlohmann::json tree first.
+ *
+ *  \file text.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "libgeojson/libgeojson.h"
+
+namespace geojson {
+namespace text {
+namespace detail {
+
+using geojson::detail::CallbackDimension;
+using geojson::detail::CallbackDims;
+using geojson::detail::Dimension;
+using geojson::detail::Instrument;
+using geojson::detail::IsPointCallback;
+using geojson::detail::LibraryScope;
+using geojson::detail::PositionChecker;
+using geojson::detail::ReadPoint;
+using geojson::detail::SpanPoints;
+using geojson::detail::is_invocable_r;
+
+/** The buffer that the text encoders append to, along with the format that
+ *  coordinates are written in
+ */
+class TextWriter {
+ public:
+  /** Constructor
+   *
+   *  \param buffer  The buffer to append to, must outlive the writer
+   *  \param format  How the coordinates are encoded
+   *  \param bounds  The bounds to extend by every position written, as
+   *                 rounded by the format, or null, must outlive the writer
+   */
+  TextWriter(std::string& buffer, const CoordinateFormat& format,
+             BoundingBox* bounds = nullptr)
+      : buffer_(&buffer), format_(format), bounds_(bounds) {}
+
+  /** Appends a character */
+  void Put(char c) { buffer_->push_back(c); }
+
+  /** Appends a null-terminated string */
+  void Append(const char* str) { buffer_->append(str); }
+
+  /** Appends size characters from str */
+  void Append(const char* str, size_t size) { buffer_->append(str, size); }
+
+  /** Appends a string */
+  void Append(const std::string& str) { buffer_->append(str); }
+
+  /** Makes room for size more characters */
+  void Reserve(size_t size) {
+    size_t capacity = buffer_->capacity();
+    buffer_->reserve(buffer_->size() + size);
+    if (buffer_->capacity() != capacity) {
+      Instrument::OnAllocation(buffer_->capacity());
+    }
+  }
+
+  /** Returns how coordinates are encoded */
+  const CoordinateFormat& Format() const { return format_; }
+
+  /** Adds a position to the bounds given on construction, if any */
+  void Accumulate(double lon, double lat) {
+    if (bounds_) bounds_->Extend(format_.Round(lon), format_.Round(lat));
+  }
+
+  /** \overload */
+  void Accumulate(double lon, double lat, double alt) {
+    if (bounds_) {
+      bounds_->Extend(format_.Round(lon), format_.Round(lat),
+                      format_.Round(alt));
+    }
+  }
+
+ private:
+  std::string* buffer_;
+  CoordinateFormat format_;
+  BoundingBox* bounds_;
+};
+
+/** The most characters a number takes in the shortest format, as in
+ *  -2.2250738585072014e-308
+ */
+static constexpr size_t kMaxShortestNumberLength = 24;
+
+/** The most characters a number takes in a fixed format: a sign, the 16
+ *  digits of an exactly rounded value and the decimal point. Values too large
+ *  to be rounded are written in the shortest format, which may be longer.
+ */
+static constexpr size_t kMaxFixedNumberLength = 18;
+
+/** The most characters in the type and closing brace of a coordinates
+ *  object, as in {"type":"MultiLineString","coordinates":}
+ */
+static constexpr size_t kMaxCoordinatesObjectLength = 48;
+
+/** Reserves enough room in the buffer for a coordinates object, so that it
+ *  is written without reallocating
+ *
+ *  \param out           The buffer that will be written to
+ *  \param numPositions  The number of positions in the object
+ *  \param numArrays     The number of arrays of positions, including the
+ *                       arrays that hold them
+ *  \param dims          The number of coordinates in each position
+ */
+inline void ReserveCoordinatesObject(TextWriter& out, size_t numPositions,
+                                     size_t numArrays, size_t dims) {
+  size_t maxNumberLength = out.Format().IsFixed() ? kMaxFixedNumberLength
+                                                  : kMaxShortestNumberLength;
+
+  // Numbers and the commas and brackets around them, plus the separator
+  size_t maxPositionLength = dims * (maxNumberLength + 1) + 2;
+  out.Reserve(kMaxCoordinatesObjectLength + numPositions * maxPositionLength +
+              numArrays * 3);
+}
+
+/** Appends a number in the shortest text that round-trips, in the same
+ *  format as nlohmann::json
+ *
+ *  \param out    The buffer to append to
+ *  \param value  The number to append, non-finite values are written as null
+ */
+inline void WriteShortestNumber(TextWriter& out, double value) {
+  if (!std::isfinite(value)) {
+    out.Append("null", 4);
+    return;
+  }
+
+  // This is the same Grisu2 shortest round-trip formatter used by dump()
+  char buffer[64];
+  char* end =
+      nlohmann::detail::to_chars(buffer, buffer + sizeof(buffer), value);
+  out.Append(buffer, static_cast<size_t>(end - buffer));
+}
+
+/** Appends a number rounded to the number of decimals in the writer's format
+ *
+ *  The value is scaled and rounded to an integer, whose digits are written
+ *  from the back with the decimal point and trailing zeros of the fraction
+ *  dropped. Values that cannot be rounded exactly are written in full.
+ *
+ *  \param out    The buffer to append to
+ *  \param value  The number to append
+ */
+inline void WriteFixedNumber(TextWriter& out, double value) {
+  const auto& format = out.Format();
+  double scaled = std::round(value * format.Scale());
+  if (!(std::fabs(scaled) < CoordinateFormat::kMaxExactInteger)) {
+    WriteShortestNumber(out, value);
+    return;
+  }
+
+  auto digits = static_cast<uint64_t>(std::fabs(scaled));
+  int decimals = format.Decimals();
+  while (decimals > 0 && digits % 10 == 0) {
+    digits /= 10;
+    decimals--;
+  }
+
+  // Sign, 16 digits of an exact integer, decimal point and leading zeros
+  char buffer[40];
+  char* end = buffer + sizeof(buffer);
+  char* begin = end;
+  for (int i = 0; i < decimals; i++) {
+    *--begin = static_cast<char>('0' + digits % 10);
+    digits /= 10;
+  }
+  if (decimals > 0) *--begin = '.';
+  do {
+    *--begin = static_cast<char>('0' + digits % 10);
+    digits /= 10;
+  } while (digits > 0);
+  if (scaled < 0) *--begin = '-';
+
+  out.Append(begin, static_cast<size_t>(end - begin));
+}
+
+/** Appends a coordinate value in the writer's format
+ *
+ *  \param out    The buffer to append to
+ *  \param value  The number to append, non-finite values are written as null
+ */
+inline void WriteNumber(TextWriter& out, double value) {
+  if (out.Format().IsFixed() && std::isfinite(value)) {
+    WriteFixedNumber(out, value);
+  } else {
+    WriteShortestNumber(out, value);
+  }
+}
+
+/** Appends a position array (section 3.1.1) to the buffer
+ *
+ *  \param out  The buffer to append to
+ *  \param lon  The longitude in decimal degrees
+ *  \param lat  The latitude in decimal degrees
+ *  \param alt  The altitude in WGS84 ellipsoidal meters
+ */
+inline void WritePosition(TextWriter& out, double lon, double lat,
+                          double alt) {
+  out.Accumulate(lon, lat, alt);
+  Instrument::OnVertices(1);
+  out.Put('[');
+  WriteNumber(out, lon);
+  out.Put(',');
+  WriteNumber(out, lat);
+  out.Put(',');
+  WriteNumber(out, alt);
+  out.Put(']');
+}
+
+/** \overload */
+inline void WritePosition(TextWriter& out, double lon, double lat) {
+  out.Accumulate(lon, lat);
+  Instrument::OnVertices(1);
+  out.Put('[');
+  WriteNumber(out, lon);
+  out.Put(',');
+  WriteNumber(out, lat);
+  out.Put(']');
+}
+
+/** Appends a position array of Dims coordinates */
+inline void WritePosition(TextWriter& out, Dimension<2>, const double* pos) {
+  WritePosition(out, pos[0], pos[1]);
+}
+
+/** \overload */
+inline void WritePosition(TextWriter& out, Dimension<3>, const double* pos) {
+  WritePosition(out, pos[0], pos[1], pos[2]);
+}
+
+/** Appends the start of a GeoJSON object with a "type" and "coordinates",
+ *  the caller then appends the coordinates and calls WriteObjectEnd()
+ */
+template <Type T>
+void WriteCoordinatesObjectBegin(TextWriter& out) {
+  out.Append("{\"type\":\"");
+  out.Append(TypeName<T>());
+  out.Append("\",\"coordinates\":");
+}
+
+/** Appends the end of a GeoJSON object */
+inline void WriteObjectEnd(TextWriter& out) { out.Put('}'); }
+
+/** Returns the bounds for a writer to extend by the positions of a
+ *  geometry, if the format asks for bounding boxes
+ */
+inline BoundingBox* BoundsToAccumulate(const CoordinateFormat& format,
+                                       BoundingBox& bounds) {
+  return format.HasBoundingBoxes() ? &bounds : nullptr;
+}
+
+/** Returns the bounds for a writer to extend by the positions held in
+ *  contiguous memory
+ *
+ *  Simplified or repaired positions are bounded as they are written, as only
+ *  the kept ones are in the bbox, and the others in one pass over the memory.
+ */
+inline BoundingBox* SpanBoundsToAccumulate(const CoordinateFormat& format,
+                                           BoundingBox& bounds) {
+  return format.HasBoundingBoxes() &&
+                 geojson::detail::RewritesPositions(format)
+             ? &bounds
+             : nullptr;
+}
+
+/** Appends a "bbox" member to the object being written, unless the bounds
+ *  are empty
+ */
+inline void WriteBoundingBox(TextWriter& out, const BoundingBox& bounds) {
+  if (bounds.Empty()) return;
+  out.Append(",\"bbox\":[");
+  for (size_t i = 0; i < bounds.NumValues(); i++) {
+    if (i > 0) out.Put(',');
+    WriteNumber(out, bounds.Value(i));
+  }
+  out.Put(']');
+}
+
+/** Appends the "bbox" member of positions held in contiguous memory, if the
+ *  writer's format asks for bounding boxes
+ *
+ *  \param out        The writer, made with SpanBoundsToAccumulate()
+ *  \param positions  The positions written
+ *  \param bounds     The bounds of the positions kept by simplifying or
+ *                    repairing
+ */
+inline void WriteBoundingBox(TextWriter& out, const PositionSpan& positions,
+                             const BoundingBox& bounds) {
+  if (!out.Format().HasBoundingBoxes()) return;
+  WriteBoundingBox(out, geojson::detail::RewritesPositions(out.Format())
+                            ? bounds
+                            : out.Format().Round(positions.Bounds()));
+}
+
+/** Finds the "bbox" member that ends the text of an object written by this
+ *  namespace, without scanning the rest of the object
+ *
+ *  \param object  The text of the object
+ *  \param begin   Set to the offset of the '[' of the bbox array
+ *
+ *  \return Whether the object ends with a bbox member
+ */
+inline bool FindBoundingBox(const std::string& object, size_t& begin) {
+  static constexpr char kKey[] = "\"bbox\":";
+  static constexpr size_t kKeyLength = sizeof(kKey) - 1;
+  size_t size = object.size();
+  if (size < 2 || object[size - 1] != '}' || object[size - 2] != ']') {
+    return false;
+  }
+  size_t open = object.rfind('[', size - 2);
+  if (open == std::string::npos || open < kKeyLength ||
+      object.compare(open - kKeyLength, kKeyLength, kKey) != 0) {
+    return false;
+  }
+  for (size_t i = open + 1; i < size - 2; i++) {
+    char c = object[i];
+    if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+          c == 'e' || c == 'E' || c == ',')) {
+      return false;
+    }
+  }
+  begin = open;
+  return true;
+}
+
+/** Adds the bbox member that ends the text of an object to the bounds
+ *
+ *  \return Whether the object ends with a bbox member
+ */
+inline bool ExtendBounds(BoundingBox& bounds, const std::string& object) {
+  size_t begin;
+  if (!FindBoundingBox(object, begin)) return false;
+  double values[6];
+  size_t numValues = 0;
+  const char* p = object.c_str() + begin;
+  while (*p != ']') {
+    char* end;
+    double value = std::strtod(p + 1, &end);
+    if (end == p + 1 || numValues == 6) return false;
+    values[numValues++] = value;
+    p = end;
+  }
+  if (numValues == 4) {
+    bounds.Extend(BoundingBox::FromCorners(values[0], values[1], values[2],
+                                           values[3]));
+  } else if (numValues == 6) {
+    bounds.Extend(BoundingBox::FromCorners(values[0], values[1], values[2],
+                                           values[3], values[4], values[5]));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/** Appends the array of the positions given by a point callback
+ *
+ *  \param out        The buffer to append to
+ *  \param dims       The dimension of the positions
+ *  \param numPoints  The number of points
+ *  \param checker    Checks each position as it is read
+ *  \param getPoint   A callback that takes the indices followed by the point
+ *                    index and sets the coordinates
+ *  \param indices    The leading indices given to the callback
+ */
+template <int Dims, typename GetPoint, typename... Indices>
+void WriteMultiPointCoordinates(TextWriter& out, Dimension<Dims> dims,
+                                size_t numPoints, PositionChecker checker,
+                                GetPoint& getPoint, Indices... indices) {
+  LibraryScope scope;
+  out.Put('[');
+  double pos[Dims];
+  for (size_t i = 0; i < numPoints; i++) {
+    if (i > 0) out.Put(',');
+    ReadPoint(dims, pos, getPoint, indices..., i);
+    checker(dims, pos, i);
+    WritePosition(out, dims, pos);
+  }
+  out.Put(']');
+}
+
+/** Appends the coordinates array of a MultiPoint object (section 3.1.3)
+ *
+ *  \tparam Callable A callable of the form
+ *                   void(size_t index, double& lon, double& lat,
+ *                        double& alt)
+ *                   or void(size_t index, double& lon, double& lat)
+ *  \param out       The buffer to append to
+ *  \param numPoints The number of points
+ *  \param getPoint  A callback that takes the point index and sets the
+ *                   lat/lon/altitude
+ */
+template <typename Callable, IsPointCallback<Callable, size_t> = true>
+void WriteMultiPointCoordinates(TextWriter& out, size_t numPoints,
+                                Callable&& getPoint) {
+  WriteMultiPointCoordinates(out, CallbackDimension<Callable, size_t>(),
+                             numPoints, PositionChecker(), getPoint);
+}
+
+/** \overload */
+inline void WriteMultiPointCoordinates(
+    TextWriter& out, const PositionSpan& positions,
+    PositionChecker checker = PositionChecker()) {
+  SpanPoints points(positions);
+  if (positions.HasAltitude()) {
+    WriteMultiPointCoordinates(out, Dimension<3>(), positions.Size(), checker,
+                               points);
+  } else {
+    WriteMultiPointCoordinates(out, Dimension<2>(), positions.Size(), checker,
+                               points);
+  }
+}
+
+/** Appends the coordinates array of a line given by a point callback */
+template <int Dims, typename GetPoint, typename... Indices>
+void WriteLineStringCoordinates(TextWriter& out, Dimension<Dims> dims,
+                                size_t numPoints, GetPoint& getPoint,
+                                Indices... indices) {
+  if (numPoints <= 1) {
+    throw std::domain_error("LineString objects must have at least 2 points");
+  }
+  if (geojson::detail::BuffersPositions(out.Format())) {
+    auto line =
+        geojson::detail::ReadPositions(dims, numPoints, getPoint, indices...);
+    geojson::detail::PositionBuffer storage;
+    WriteMultiPointCoordinates(out, geojson::detail::PreparePositions(
+                                        line.Span(), false, out.Format(),
+                                        storage));
+    return;
+  }
+  WriteMultiPointCoordinates(out, dims, numPoints,
+                             PositionChecker(out.Format(), false), getPoint,
+                             indices...);
+}
+
+/** Appends the coordinates array of a LineString object (section 3.1.4)
+ *
+ *  \tparam Callable A callable of the form
+ *                   void(size_t index, double& lon, double& lat, double& alt)
+ *                   or void(size_t index, double& lon, double& lat)
+ *  \param out       The buffer to append to
+ *  \param numPoints The number of points
+ *  \param getPoint  A callback that takes the point index and sets the
+ *                   lat/lon/altitude
+ */
+template <typename Callable, IsPointCallback<Callable, size_t> = true>
+void WriteLineStringCoordinates(TextWriter& out, size_t numPoints,
+                                Callable&& getPoint) {
+  WriteLineStringCoordinates(out, CallbackDimension<Callable, size_t>(),
+                             numPoints, getPoint);
+}
+
+/** \overload */
+inline void WriteLineStringCoordinates(TextWriter& out,
+                                       const PositionSpan& positions) {
+  if (positions.Size() <= 1) {
+    throw std::domain_error("LineString objects must have at least 2 points");
+  }
+  if (geojson::detail::BuffersPositions(out.Format())) {
+    geojson::detail::PositionBuffer storage;
+    WriteMultiPointCoordinates(out, geojson::detail::PreparePositions(
+                                        positions, false, out.Format(),
+                                        storage));
+    return;
+  }
+  WriteMultiPointCoordinates(out, positions,
+                             PositionChecker(out.Format(), false));
+}
+
+/** Appends the coordinates array of a MultiLineString object
+ * (section 3.1.5)
+ *
+ *  \tparam GetLineLength A callable of the form size_t(size_t index)
+ *  \tparam GetPoint      A callable of the form
+ *                        void(size_t lineIndex, size_t pointIndex,
+ *                             double& lon, double& lat, double& alt)
+ *                        or void(size_t lineIndex, size_t pointIndex,
+ *                                double& lon, double& lat)
+ *  \param out            The buffer to append to
+ *  \param numLines       The number of lines
+ *  \param getLineLength  A callback that takes the line index and returns
+ *                        the length of the line
+ *  \param getPoint       A callback that takes the line and point indices and
+ *                        sets the lat/lon/altitude
+ */
+template <typename GetLineLength, typename GetPoint,
+          IsPointCallback<GetPoint, size_t, size_t> = true>
+void WriteMultiLineStringCoordinates(TextWriter& out, size_t numLines,
+                                     GetLineLength&& getLineLength,
+                                     GetPoint&& getPoint) {
+  CallbackDimension<GetPoint, size_t, size_t> dims;
+  out.Put('[');
+  for (size_t i = 0; i < numLines; i++) {
+    if (i > 0) out.Put(',');
+    WriteLineStringCoordinates(out, dims, getLineLength(i), getPoint, i);
+  }
+  out.Put(']');
+}
+
+/** \overload */
+inline void WriteMultiLineStringCoordinates(TextWriter& out,
+                                            const PositionSpan& positions,
+                                            const size_t* lineOffsets,
+                                            size_t numLines) {
+  geojson::detail::CheckOffsets(lineOffsets, numLines, positions.Size());
+  out.Put('[');
+  for (size_t i = 0; i < numLines; i++) {
+    if (i > 0) out.Put(',');
+    WriteLineStringCoordinates(
+        out, positions.Slice(lineOffsets[i], lineOffsets[i + 1]));
+  }
+  out.Put(']');
+}
+
+/** Appends the positions of a ring given by a point callback in CW or CCW
+ *  order, closing it
+ *
+ *  The ring is read through the callback once to find its orientation and
+ *  once more to write it, backwards if it needs to be reversed.
+ */
+template <int Dims, typename GetPoint, typename... Indices>
+void WriteClosedRing(TextWriter& out, Dimension<Dims> dims, size_t numPoints,
+                     bool ccw, PositionChecker checker, GetPoint& getPoint,
+                     Indices... indices) {
+  LibraryScope scope;
+  bool reverse =
+      geojson::detail::IsCcw(dims, numPoints, getPoint, indices...) != ccw;
+  if (reverse) Instrument::OnRingReversed();
+
+  out.Put('[');
+  double first[Dims], pos[Dims];
+  size_t index = reverse ? numPoints - 1 : 0;
+  ReadPoint(dims, first, getPoint, indices..., index);
+  checker(dims, first, index);
+  WritePosition(out, dims, first);
+  for (size_t i = 1; i < numPoints; i++) {
+    out.Put(',');
+    index = reverse ? numPoints - i - 1 : i;
+    ReadPoint(dims, pos, getPoint, indices..., index);
+    checker(dims, pos, index);
+    WritePosition(out, dims, pos);
+  }
+  checker.Close();
+
+  // Close the ring
+  out.Put(',');
+  WritePosition(out, dims, first);
+  out.Put(']');
+}
+
+/** Appends the positions of a ring in CW or CCW order, closing it */
+inline void WriteClosedRing(TextWriter& out, const PositionSpan& positions,
+                            bool ccw,
+                            PositionChecker checker = PositionChecker()) {
+  SpanPoints points(positions);
+  if (positions.HasAltitude()) {
+    WriteClosedRing(out, Dimension<3>(), positions.Size(), ccw, checker,
+                    points);
+  } else {
+    WriteClosedRing(out, Dimension<2>(), positions.Size(), ccw, checker,
+                    points);
+  }
+}
+
+/** Appends the coordinates array of a linear ring given by a point callback,
+ *  checking and simplifying it as the format asks
+ */
+template <int Dims, typename GetPoint, typename... Indices>
+void WriteLinearRingCoordinates(TextWriter& out, Dimension<Dims> dims,
+                                size_t numPoints, bool ccw, GetPoint& getPoint,
+                                Indices... indices) {
+  // We must be at least a triangle
+  if (numPoints < 3) {
+    throw std::domain_error("Linear rings must have at least 3 points");
+  }
+  if (geojson::detail::BuffersPositions(out.Format())) {
+    auto ring =
+        geojson::detail::ReadPositions(dims, numPoints, getPoint, indices...);
+    geojson::detail::PositionBuffer storage;
+    WriteClosedRing(out,
+                    geojson::detail::PreparePositions(ring.Span(), true,
+                                                      out.Format(), storage),
+                    ccw);
+    return;
+  }
+  WriteClosedRing(out, dims, numPoints, ccw,
+                  PositionChecker(out.Format(), true), getPoint, indices...);
+}
+
+/** Appends the coordinates array for a linear ring, ensures the vertices are
+ * in CW or CCW order and closes the ring.
+ *
+ *  \tparam GetPoint A callable of the form
+ *                   void(size_t index, double& lon, double& lat, double& alt)
+ *                   or void(size_t index, double& lon, double& lat)
+ *  \param out       The buffer to append to
+ *  \param numPoints The number of points in the ring
+ *  \param ccw       Whether the ring should be CCW
+ *  \param getPoint  A callback that takes the point index and sets the
+ *                   lat/lon/altitude
+ */
+template <typename GetPoint, IsPointCallback<GetPoint, size_t> = true>
+void WriteLinearRingCoordinates(TextWriter& out, size_t numPoints, bool ccw,
+                                GetPoint&& getPoint) {
+  WriteLinearRingCoordinates(out, CallbackDimension<GetPoint, size_t>(),
+                             numPoints, ccw, getPoint);
+}
+
+/** \overload */
+inline void WriteLinearRingCoordinates(TextWriter& out,
+                                       const PositionSpan& positions,
+                                       bool ccw) {
+  if (positions.Size() < 3) {
+    throw std::domain_error("Linear rings must have at least 3 points");
+  }
+  if (geojson::detail::BuffersPositions(out.Format())) {
+    geojson::detail::PositionBuffer storage;
+    WriteClosedRing(out,
+                    geojson::detail::PreparePositions(positions, true,
+                                                      out.Format(), storage),
+                    ccw);
+    return;
+  }
+  WriteClosedRing(out, positions, ccw, PositionChecker(out.Format(), true));
+}
+
+/** Appends the coordinates array of a polygon given by point callbacks,
+ *  whose ring lengths and positions take the given leading indices
+ */
+template <int Dims, typename GetRingLength, typename GetPoint,
+          typename... Indices>
+void WritePolygonCoordinates(TextWriter& out, Dimension<Dims> dims,
+                             size_t numRings, GetRingLength& getRingLength,
+                             GetPoint& getPoint, Indices... indices) {
+  out.Put('[');
+  for (size_t i = 0; i < numRings; i++) {
+    if (i > 0) out.Put(',');
+    WriteLinearRingCoordinates(out, dims, getRingLength(indices..., i), i == 0,
+                               getPoint, indices..., i);
+  }
+  out.Put(']');
+}
+
+/** Appends the coordinates array of a Polygon object (section 3.1.6)
+ *
+ *  \tparam GetRingLength A callable of the form size_t(size_t index)
+ *  \tparam GetPoint      A callable of the form
+ *                        void(size_t ringIndex, size_t pointIndex, double& lon,
+ *                             double& lat, double& alt)
+ *                        or void(size_t ringIndex, size_t pointIndex,
+ *                                double& lon, double& lat)
+ *  \param out            The buffer to append to
+ *  \param numRings       The number of rings
+ *  \param getRingLength  A callback that takes the ring index and returns the
+ *                        length of the ring
+ *  \param getPoint       A callback that takes the ring and point indices and
+ *                        sets the lat/lon/altitude
+ */
+template <typename GetRingLength, typename GetPoint,
+          IsPointCallback<GetPoint, size_t, size_t> = true>
+void WritePolygonCoordinates(TextWriter& out, size_t numRings,
+                             GetRingLength&& getRingLength,
+                             GetPoint&& getPoint) {
+  WritePolygonCoordinates(out, CallbackDimension<GetPoint, size_t, size_t>(),
+                          numRings, getRingLength, getPoint);
+}
+
+/** \overload */
+inline void WritePolygonCoordinates(TextWriter& out,
+                                    const PositionSpan& positions,
+                                    const size_t* ringOffsets,
+                                    size_t numRings) {
+  geojson::detail::CheckOffsets(ringOffsets, numRings, positions.Size());
+  out.Put('[');
+  for (size_t i = 0; i < numRings; i++) {
+    if (i > 0) out.Put(',');
+    WriteLinearRingCoordinates(
+        out, positions.Slice(ringOffsets[i], ringOffsets[i + 1]), i == 0);
+  }
+  out.Put(']');
+}
+
+/** Appends the coordinates array of a MultiPolygon object (section 3.1.7)
+ *
+ *  \tparam GetNumRings   A callable of the form size_t(size_t index)
+ *  \tparam GetRingLength A callable of the form
+ *                        size_t(size_t polyIndex, size_t ringIndex)
+ *  \tparam GetPoint      A callable of the form
+ *                        void(size_t polyIndex, size_t ringIndex,
+ *                             size_t pointIndex, double& lon, double& lat,
+ *                             double& alt)
+ *                        or the same without the altitude
+ *  \param out            The buffer to append to
+ *  \param numPolygons    The number of polygons
+ *  \param getNumRings    A callback that takes the polygon index and returns
+ *                        the number of rings
+ *  \param getRingLength  A callback that takes the polygon and ring indices and
+ *                        returns the length of the ring
+ *  \param getPoint       A callback that takes the polygon, ring and point
+ *                        indices and sets the lat/lon/altitude
+ */
+template <typename GetNumRings, typename GetRingLength, typename GetPoint,
+          IsPointCallback<GetPoint, size_t, size_t, size_t> = true>
+void WriteMultiPolygonCoordinates(TextWriter& out, size_t numPolygons,
+                                  GetNumRings&& getNumRings,
+                                  GetRingLength&& getRingLength,
+                                  GetPoint&& getPoint) {
+  CallbackDimension<GetPoint, size_t, size_t, size_t> dims;
+  out.Put('[');
+  for (size_t i = 0; i < numPolygons; i++) {
+    if (i > 0) out.Put(',');
+    WritePolygonCoordinates(out, dims, getNumRings(i), getRingLength,
+                            getPoint, i);
+  }
+  out.Put(']');
+}
+
+/** \overload */
+inline void WriteMultiPolygonCoordinates(TextWriter& out,
+                                         const PositionSpan& positions,
+                                         const size_t* polygonOffsets,
+                                         size_t numPolygons,
+                                         const size_t* ringOffsets,
+                                         size_t numRings) {
+  geojson::detail::CheckOffsets(polygonOffsets, numPolygons, numRings);
+  out.Put('[');
+  for (size_t i = 0; i < numPolygons; i++) {
+    if (i > 0) out.Put(',');
+    WritePolygonCoordinates(out, positions, ringOffsets + polygonOffsets[i],
+                            polygonOffsets[i + 1] - polygonOffsets[i]);
+  }
+  out.Put(']');
+}
+}
+
+/** Text version of geojson::Point() (section 3.1.2)
+ *
+ *  \param lon     The longitude in decimal degrees
+ *  \param lat     The latitude in decimal degrees
+ *  \param alt     The altitude in WGS84 ellipsoidal meters
+ *  \param format  How the coordinates are encoded
+ *
+ *  \return The text of a GeoJSON Point object
+ */
+inline std::string Point(double lon, double lat, double alt,
+                         const CoordinateFormat& format = CoordinateFormat()) {
+  std::string str;
+  BoundingBox bounds;
+  detail::TextWriter out(str, format,
+                         detail::BoundsToAccumulate(format, bounds));
+  detail::WriteCoordinatesObjectBegin<Type::Point>(out);
+  detail::WritePosition(out, lon, lat, alt);
+  detail::WriteBoundingBox(out, bounds);
+  detail::WriteObjectEnd(out);
+  return str;
+}
+
+/** \overload */
+inline std::string Point(double lon, double lat,
+                         const CoordinateFormat& format = CoordinateFormat()) {
+  std::string str;
+  BoundingBox bounds;
+  detail::TextWriter out(str, format,
+                         detail::BoundsToAccumulate(format, bounds));
+  detail::WriteCoordinatesObjectBegin<Type::Point>(out);
+  detail::WritePosition(out, lon, lat);
+  detail::WriteBoundingBox(out, bounds);
+  detail::WriteObjectEnd(out);
+  return str;
+}
+
+/** Text version of geojson::MultiPoint() (section 3.1.3)
+ *
+ *  \tparam Callable A callable of the form
+ *                   void(size_t, double&, double&, double&) or
+ *                   void(size_t, double&, double&)
+ *  \param numPoints The number of points
+ *  \param getPoint  A callback that takes the point index and sets the
+ *                   lat/lon/altitude
+ *  \param format    How the coordinates are encoded
+ *
+ *  \return The text of a GeoJSON MultiPoint object
+ */
+template <typename Callable>
+std::string MultiPoint(size_t numPoints, Callable&& getPoint,
+                       const CoordinateFormat& format = CoordinateFormat()) {
+  static_assert(
+      detail::is_invocable_r<void, Callable, size_t, double&, double&,
+                             double&>::value ||
+          detail::is_invocable_r<void, Callable, size_t, double&,
+                                 double&>::value,
+      "Callback must either be void(size_t, double&, double&, double&) or "
+      "void(size_t, double&, double&)");
+  std::string str;
+  BoundingBox bounds;
+  detail::TextWriter out(str, format,
+                         detail::BoundsToAccumulate(format, bounds));
+  detail::ReserveCoordinatesObject(out, numPoints, 1,
+                                   detail::CallbackDims<Callable, size_t>());
+  detail::WriteCoordinatesObjectBegin<Type::MultiPoint>(out);
+  detail::WriteMultiPointCoordinates(out, numPoints,
+                                     std::forward<Callable>(getPoint));
+  detail::WriteBoundingBox(out, bounds);
+  detail::WriteObjectEnd(out);
+  return str;
+}
+
+/** Text version of geojson::MultiPoint() (section 3.1.3) for positions held
+ *  in contiguous memory
+ *
+ *  \param positions  The points
+ *  \param format     How the coordinates are encoded
+ *
+ *  \return The text of a GeoJSON MultiPoint object
+ */
+inline std::string MultiPoint(
+    const PositionSpan& positions,
+    const CoordinateFormat& format = CoordinateFormat()) {
+  std::string str;
+  BoundingBox bounds;
+  detail::TextWriter out(str, format,
+                         detail::SpanBoundsToAccumulate(format, bounds));
+  detail::ReserveCoordinatesObject(out, positions.Size(), 1,
+                                   positions.HasAltitude() ? 3 : 2);
+  detail::WriteCoordinatesObjectBegin<Type::MultiPoint>(out);
+  detail::WriteMultiPointCoordinates(out, positions);
+  detail::WriteBoundingBox(out, positions, bounds);
+  detail::WriteObjectEnd(out);
+  return str;
+}
+
+/** Text version of geojson::LineString() (section 3.1.4)
+ *
+ *  \tparam Callable A callable of the form
+ *                   void(size_t index, double& lon, double& lat, double& alt)
+ *                   or void(size_t index, double& lon, double& lat)
+ *  \param numPoints The number of points
+ *  \param getPoint  A callback that takes the point index and sets the
+ *                   lat/lon/altitude
+ *  \param format    How the coordinates are encoded
+ *
+ *  \return The text of a GeoJSON LineString object
+ */
+template <typename Callable>
+std::string LineString(size_t numPoints, Callable&& getPoint,
+                       const CoordinateFormat& format = CoordinateFormat()) {
+  static_assert(
+      detail::is_invocable_r<void, Callable, size_t, double&, double&,
+                             double&>::value ||
+          detail::is_invocable_r<void, Callable, size_t, double&,
+                                 double&>::value,
+      "Callback must either be void(size_t, double&, double&, double&) or "
+      "void(size_t, double&, double&)");
+  std::string str;
+  BoundingBox bounds;
+  detail::TextWriter out(str, format,
+                         detail::BoundsToAccumulate(format, bounds));
+  detail::ReserveCoordinatesObject(out, numPoints, 1,
+                                   detail::CallbackDims<Callable, size_t>());
+  detail::WriteCoordinatesObjectBegin<Type::LineString>(out);
+  detail::WriteLineStringCoordinates(out, numPoints,
+                                     std::forward<Callable>(getPoint));
+  detail::WriteBoundingBox(out, bounds);
+  detail::WriteObjectEnd(out);
+  return str;
+}
+
+/** Text version of geojson::LineString() (section 3.1.4) for positions held
+ *  in contiguous memory
+ *
+ *  \param positions  The points of the line
+ *  \param format     How the coordinates are encoded
+ *
+ *  \return The text of a GeoJSON LineString object
+ */
+inline std::string LineString(
+    const PositionSpan& positions,
+    const CoordinateFormat& format = CoordinateFormat()) {
+  std::string str;
+  BoundingBox bounds;
+  detail::TextWriter out(str, format,
+                         detail::SpanBoundsToAccumulate(format, bounds));
+  detail::ReserveCoordinatesObject(out, positions.Size(), 1,
+                                   positions.HasAltitude() ? 3 : 2);
+  detail::WriteCoordinatesObjectBegin<Type::LineString>(out);
+  detail::WriteLineStringCoordinates(out, positions);
+  detail::WriteBoundingBox(out, positions, bounds);
+  detail::WriteObjectEnd(out);
+  return str;
+}
+
+/** Text version of geojson::MultiLineString() (section 3.1.5)
+ *
+ *  \tparam GetLineLength A callable of the form size_t(size_t index)
+ *  \tparam GetPoint      A callable of the form
+ *                        void(size_t lineIndex, size_t pointIndex,
+ *                             double& lon, double& lat, double& alt)
+ *  \param numLineStrings The number of lines
+ *  \param getLineLength  A callback that takes the line index and returns
+ *                        the length of the line
+ *  \param getPoint       A callback that takes the line and point indices and
+ *                        sets the lat/lon/altitude
+ *  \param format         How the coordinates are encoded
+ *
+ *  \return The text of a GeoJSON MultiLineString object
+ */
+template <typename GetLineLength, typename GetPoint>
+std::string MultiLineString(
+    size_t numLineStrings, GetLineLength&& getLineLength, GetPoint&& getPoint,
+    const CoordinateFormat& format = CoordinateFormat()) {
+  static_assert(
+      detail::is_invocable_r<void, GetPoint, size_t, size_t, double&, double&,
+                             double&>::value ||
+          detail::is_invocable_r<void, GetPoint, size_t, size_t, double&,
+                                 double&>::value,
+      "GetPoint callback must either be void(size_t, size_t, double&, "
+      "double&, double&) or void(size_t, size_t, double&, double&)");
+  std::string str;
+  BoundingBox bounds;
+  detail::TextWriter out(str, format,
+                         detail::BoundsToAccumulate(format, bounds));
+  // The lengths are kept for the lines, so each is only asked for once
+  std::vector<size_t> lineLengths(numLineStrings);
+  size_t numPositions = 0;
+  for (size_t i = 0; i < numLineStrings; i++) {
+    numPositions += lineLengths[i] = getLineLength(i);
+  }
+  detail::ReserveCoordinatesObject(
+      out, numPositions, numLineStrings + 1,
+      detail::CallbackDims<GetPoint, size_t, size_t>());
+  detail::WriteCoordinatesObjectBegin<Type::MultiLineString>(out);
+  detail::WriteMultiLineStringCoordinates(
+      out, numLineStrings, [&](size_t i) { return lineLengths[i]; },
+      std::forward<GetPoint>(getPoint));
+  detail::WriteBoundingBox(out, bounds);
+  detail::WriteObjectEnd(out);
+  return str;
+}
+
+/** Text version of geojson::MultiLineString() (section 3.1.5) for positions
+ *  held in contiguous memory
+ *
+ *  \param positions    The points of all of the lines
+ *  \param lineOffsets  Array of numLines + 1 offsets into positions, line i
+ *                      is made of positions [lineOffsets[i], lineOffsets[i+1])
+ *  \param numLines     The number of lines
+ *  \param format       How the coordinates are encoded
+ *
+ *  \return The text of a GeoJSON MultiLineString object
+ */
+inline std::string MultiLineString(
+    const PositionSpan& positions, const size_t* lineOffsets, size_t numLines,
+    const CoordinateFormat& format = CoordinateFormat()) {
+  std::string str;
+  BoundingBox bounds;
+  detail::TextWriter out(str, format,
+                         detail::SpanBoundsToAccumulate(format, bounds));
+  detail::ReserveCoordinatesObject(out, positions.Size(), numLines + 1,
+                                   positions.HasAltitude() ? 3 : 2);
+  detail::WriteCoordinatesObjectBegin<Type::MultiLineString>(out);
+  detail::WriteMultiLineStringCoordinates(out, positions, lineOffsets,
+                                          numLines);
+  detail::WriteBoundingBox(
+      out, geojson::detail::OffsetPositions(positions, lineOffsets, numLines),
+      bounds);
+  detail::WriteObjectEnd(out);
+  return str;
+}
+
+/** Text version of geojson::Polygon() (section 3.1.6)
+ *
+ *  \tparam GetRingLength A callable of the form size_t(size_t index)
+ *  \tparam GetPoint      A callable of the form
+ *                        void(size_t ringIndex, size_t pointIndex, double& lon,
+ *                             double& lat, double& alt)
+ *  \param numRings       The number of rings
+ *  \param getRingLength  A callback that takes the ring index and returns the
+ *                        length of the ring
+ *  \param getPoint       A callback that takes the ring and point indices and
+ *                        sets the lat/lon/altitude
+ *  \param format         How the coordinates are encoded
+ *
+ *  \return The text of a GeoJSON Polygon object
+ */
+template <typename GetRingLength, typename GetPoint>
+std::string Polygon(size_t numRings, GetRingLength&& getRingLength,
+                    GetPoint&& getPoint,
+                    const CoordinateFormat& format = CoordinateFormat()) {
+  static_assert(
+      detail::is_invocable_r<void, GetPoint, size_t, size_t, double&, double&,
+                             double&>::value ||
+          detail::is_invocable_r<void, GetPoint, size_t, size_t, double&,
+                                 double&>::value,
+      "GetPoint callback must either be void(size_t, size_t, double&, "
+      "double&, double&) or void(size_t, size_t, double&, double&)");
+  std::string str;
+  BoundingBox bounds;
+  detail::TextWriter out(str, format,
+                         detail::BoundsToAccumulate(format, bounds));
+  // Each ring gets an extra position to close it, and the lengths are kept
+  // for the rings, so each is only asked for once
+  std::vector<size_t> ringLengths(numRings);
+  size_t numPositions = numRings;
+  for (size_t i = 0; i < numRings; i++) {
+    numPositions += ringLengths[i] = getRingLength(i);
+  }
+  detail::ReserveCoordinatesObject(
+      out, numPositions, numRings + 1,
+      detail::CallbackDims<GetPoint, size_t, size_t>());
+  detail::WriteCoordinatesObjectBegin<Type::Polygon>(out);
+  detail::WritePolygonCoordinates(
+      out, numRings, [&](size_t i) { return ringLengths[i]; },
+      std::forward<GetPoint>(getPoint));
+  detail::WriteBoundingBox(out, bounds);
+  detail::WriteObjectEnd(out);
+  return str;
+}
+
+/** Text version of geojson::Polygon() (section 3.1.6) for positions held in
+ *  contiguous memory
+ *
+ *  \param positions    The points of all of the rings
+ *  \param ringOffsets  Array of numRings + 1 offsets into positions, ring i
+ *                      is made of positions [ringOffsets[i], ringOffsets[i+1])
+ *  \param numRings     The number of rings, the first being the outer ring
+ *  \param format       How the coordinates are encoded
+ *
+ *  \return The text of a GeoJSON Polygon object
+ */
+inline std::string Polygon(
+    const PositionSpan& positions, const size_t* ringOffsets, size_t numRings,
+    const CoordinateFormat& format = CoordinateFormat()) {
+  std::string str;
+  BoundingBox bounds;
+  detail::TextWriter out(str, format,
+                         detail::SpanBoundsToAccumulate(format, bounds));
+  detail::ReserveCoordinatesObject(out, positions.Size() + numRings,
+                                   numRings + 1,
+                                   positions.HasAltitude() ? 3 : 2);
+  detail::WriteCoordinatesObjectBegin<Type::Polygon>(out);
+  detail::WritePolygonCoordinates(out, positions, ringOffsets, numRings);
+  detail::WriteBoundingBox(
+      out, geojson::detail::OffsetPositions(positions, ringOffsets, numRings),
+      bounds);
+  detail::WriteObjectEnd(out);
+  return str;
+}
+
+/** Text version of geojson::MultiPolygon() (section 3.1.7)
+ *
+ *  \tparam GetNumRings   A callable of the form size_t(size_t index)
+ *  \tparam GetRingLength A callable of the form
+ *                        size_t(size_t polyIndex, size_t ringIndex)
+ *  \tparam GetPoint      A callable of the form
+ *                        void(size_t polyIndex, size_t ringIndex,
+ *                             size_t pointIndex, double& lon, double& lat,
+ *                             double& alt)
+ *  \param numPolygons    The number of polygons
+ *  \param getNumRings    A callback that takes the polygon index and returns
+ *                        the number of rings
+ *  \param getRingLength  A callback that takes the polygon and ring indices and
+ *                        returns the length of the ring
+ *  \param getPoint       A callback that takes the polygon, ring and point
+ *                        indices and sets the lat/lon/altitude
+ *  \param format         How the coordinates are encoded
+ *
+ *  \return The text of a GeoJSON MultiPolygon object
+ */
+template <typename GetNumRings, typename GetRingLength, typename GetPoint>
+std::string MultiPolygon(size_t numPolygons, GetNumRings&& getNumRings,
+                         GetRingLength&& getRingLength, GetPoint&& getPoint,
+                         const CoordinateFormat& format = CoordinateFormat()) {
+  static_assert(
+      detail::is_invocable_r<void, GetPoint, size_t, size_t, size_t, double&,
+                             double&, double&>::value ||
+          detail::is_invocable_r<void, GetPoint, size_t, size_t, size_t,
+                                 double&, double&>::value,
+      "GetPoint callback must either be void(size_t, size_t, size_t, double&, "
+      "double&, double&) or void(size_t, size_t, size_t, double&, double&)");
+  std::string str;
+  BoundingBox bounds;
+  detail::TextWriter out(str, format,
+                         detail::BoundsToAccumulate(format, bounds));
+  // Each ring gets an extra position to close it. The ring counts and
+  // lengths are kept, with polygon i's rings from firstRings[i] on, so each
+  // is only asked for once
+  std::vector<size_t> firstRings(numPolygons + 1, 0), ringLengths;
+  size_t numPositions = 0;
+  for (size_t i = 0; i < numPolygons; i++) {
+    size_t numRings = getNumRings(i);
+    firstRings[i + 1] = firstRings[i] + numRings;
+    numPositions += numRings;
+    for (size_t j = 0; j < numRings; j++) {
+      ringLengths.push_back(getRingLength(i, j));
+      numPositions += ringLengths.back();
+    }
+  }
+  detail::ReserveCoordinatesObject(
+      out, numPositions, numPolygons + 1 + ringLengths.size(),
+      detail::CallbackDims<GetPoint, size_t, size_t, size_t>());
+  detail::WriteCoordinatesObjectBegin<Type::MultiPolygon>(out);
+  detail::WriteMultiPolygonCoordinates(
+      out, numPolygons,
+      [&](size_t i) { return firstRings[i + 1] - firstRings[i]; },
+      [&](size_t i, size_t j) { return ringLengths[firstRings[i] + j]; },
+      std::forward<GetPoint>(getPoint));
+  detail::WriteBoundingBox(out, bounds);
+  detail::WriteObjectEnd(out);
+  return str;
+}
+
+/** Text version of geojson::MultiPolygon() (section 3.1.7) for positions held
+ *  in contiguous memory
+ *
+ *  \param positions       The points of all of the rings of all polygons
+ *  \param polygonOffsets  Array of numPolygons + 1 offsets into ringOffsets,
+ *                         polygon i is made of rings
+ *                         [polygonOffsets[i], polygonOffsets[i+1])
+ *  \param numPolygons     The number of polygons
+ *  \param ringOffsets     Array of numRings + 1 offsets into positions, ring
+ *                         j is made of positions
+ *                         [ringOffsets[j], ringOffsets[j+1])
+ *  \param numRings        The number of rings, which the polygon offsets
+ *                         must not go past
+ *  \param format          How the coordinates are encoded
+ *
+ *  \return The text of a GeoJSON MultiPolygon object
+ */
+inline std::string MultiPolygon(
+    const PositionSpan& positions, const size_t* polygonOffsets,
+    size_t numPolygons, const size_t* ringOffsets, size_t numRings,
+    const CoordinateFormat& format = CoordinateFormat()) {
+  std::string str;
+  BoundingBox bounds;
+  detail::TextWriter out(str, format,
+                         detail::SpanBoundsToAccumulate(format, bounds));
+  detail::ReserveCoordinatesObject(out, positions.Size() + numRings,
+                                   numPolygons + numRings + 1,
+                                   positions.HasAltitude() ? 3 : 2);
+  detail::WriteCoordinatesObjectBegin<Type::MultiPolygon>(out);
+  detail::WriteMultiPolygonCoordinates(out, positions, polygonOffsets,
+                                       numPolygons, ringOffsets, numRings);
+  detail::WriteBoundingBox(
+      out, positions.Slice(ringOffsets[polygonOffsets[0]],
+                           ringOffsets[polygonOffsets[numPolygons]]),
+      bounds);
+  detail::WriteObjectEnd(out);
+  return str;
+}
+
+/** Text version of geojson::GeometryCollection() (section 3.1.8)
+ *
+ *  \tparam Callable      A callable of the form std::string(size_t index)
+ *  \param numGeometries  The number of geometries
+ *  \param getGeometry    A callback that takes the geometry index and returns
+ *                        the text of the geometry object
+ *
+ *  \return The text of a GeometryCollection object
+ */
+template <typename Callable>
+std::string GeometryCollection(size_t numGeometries, Callable&& getGeometry) {
+  std::string out("{\"type\":\"");
+  out.append(TypeName<Type::GeometryCollection>());
+  out.append("\",\"geometries\":[");
+  BoundingBox bounds;
+  bool bounded = numGeometries > 0;
+  for (size_t i = 0; i < numGeometries; i++) {
+    if (i > 0) out.push_back(',');
+    std::string geometry = getGeometry(i);
+    bounded = bounded && detail::ExtendBounds(bounds, geometry);
+    out.append(geometry);
+  }
+  out.push_back(']');
+  if (bounded) {
+    detail::TextWriter writer(out, CoordinateFormat());
+    detail::WriteBoundingBox(writer, bounds);
+  }
+  out.push_back('}');
+  return out;
+}
+
+namespace detail {
+
+/** Appends the start of a Feature object, through the name of its
+ *  properties member, whose value the caller appends next
+ *
+ *  \param out        The string to append to
+ *  \param geometry   The text of a GeoJSON geometry object
+ *  \param bboxBegin  The offset of the bbox array that ends the geometry
+ *  \param bboxSize   The length of the bbox array, or 0 if there is none
+ */
+inline void AppendFeatureHead(std::string& out, const std::string& geometry,
+                              size_t bboxBegin, size_t bboxSize) {
+  static constexpr char kHeader[] = "{\"type\":\"Feature\",";
+  static constexpr char kBbox[] = "\"bbox\":";
+  static constexpr char kGeometry[] = "\"geometry\":";
+  static constexpr char kProperties[] = ",\"properties\":";
+
+  out.append(kHeader, sizeof(kHeader) - 1);
+  if (bboxSize > 0) {
+    out.append(kBbox, sizeof(kBbox) - 1);
+    out.append(geometry, bboxBegin, bboxSize);
+    out.push_back(',');
+  }
+  out.append(kGeometry, sizeof(kGeometry) - 1);
+  out.append(geometry);
+  out.append(kProperties, sizeof(kProperties) - 1);
+}
+
+/** Appends the end of a Feature object, after the value of its properties
+ *
+ *  \param out     The string to append to
+ *  \param idText  The serialized ID of the feature, or empty for none
+ */
+inline void AppendFeatureTail(std::string& out, const std::string& idText) {
+  static constexpr char kId[] = ",\"id\":";
+  if (!idText.empty()) {
+    out.append(kId, sizeof(kId) - 1);
+    out.append(idText);
+  }
+  out.push_back('}');
+}
+
+/** The most characters of a Feature object outside of its members' values,
+ *  as in {"type":"Feature","bbox":,"geometry":,"properties":,"id":}
+ */
+static constexpr size_t kMaxFeatureObjectLength = 64;
+
+/** Appends the text of a Feature object
+ *
+ *  \param out         The string to append to
+ *  \param idText      The serialized ID of the feature, or empty for none
+ *  \param geometry    The text of a GeoJSON geometry object
+ *  \param bboxBegin   The offset of the bbox array that ends the geometry
+ *  \param bboxSize    The length of the bbox array, or 0 if there is none
+ *  \param properties  The text of the properties of the feature
+ */
+inline void AppendFeatureText(std::string& out, const std::string& idText,
+                              const std::string& geometry, size_t bboxBegin,
+                              size_t bboxSize, const std::string& properties) {
+  out.reserve(out.size() + kMaxFeatureObjectLength + bboxSize +
+              geometry.size() + properties.size() + idText.size());
+  AppendFeatureHead(out, geometry, bboxBegin, bboxSize);
+  out.append(properties);
+  AppendFeatureTail(out, idText);
+}
+
+/** Returns the text of a Feature object
+ *
+ *  \param idText     The serialized ID of the feature, or empty for none
+ *  \param geometry   The text of a GeoJSON geometry object
+ *  \param properties A JSON object holding properties for the feature
+ */
+inline std::string FeatureText(const std::string& idText,
+                               const std::string& geometry,
+                               const nlohmann::json& properties) {
+  // The bbox of the geometry is copied to the feature
+  size_t bboxBegin = geometry.size(), bboxSize = 0;
+  if (FindBoundingBox(geometry, bboxBegin)) {
+    bboxSize = geometry.size() - 1 - bboxBegin;
+  }
+
+  std::string out;
+  AppendFeatureText(out, idText, geometry, bboxBegin, bboxSize,
+                    properties.dump());
+  return out;
+}
+}
+
+/** Text version of geojson::Feature() (section 3.2)
+ *
+ *  \param geometry   The text of a GeoJSON geometry object, as returned by the
+ *                    functions in this namespace
+ *  \param properties A JSON object holding properties for the feature
+ *
+ *  \return The text of a GeoJSON Feature object
+ */
+inline std::string Feature(const std::string& geometry,
+                           const nlohmann::json& properties) {
+  return detail::FeatureText(std::string(), geometry, properties);
+}
+
+/** Text version of geojson::Feature() (section 3.2)
+ *
+ *  \param id         The ID of the feature
+ *  \param geometry   The text of a GeoJSON geometry object, as returned by the
+ *                    functions in this namespace
+ *  \param properties A JSON object holding properties for the feature
+ *
+ *  \return The text of a GeoJSON Feature object
+ */
+inline std::string Feature(const std::string& id, const std::string& geometry,
+                           const nlohmann::json& properties) {
+  return detail::FeatureText(nlohmann::json(id).dump(), geometry, properties);
+}
+
+/** \overload */
+template <typename T, typename = typename std::enable_if<
+                          std::is_arithmetic<T>::value>::type>
+inline std::string Feature(T id, const std::string& geometry,
+                           const nlohmann::json& properties) {
+  return detail::FeatureText(nlohmann::json(id).dump(), geometry, properties);
+}
+}
+}
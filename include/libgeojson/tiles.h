@@ -0,0 +1,739 @@
+/** XYZ tile output for libgeojson
+ *
+ *  \file tiles.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "libgeojson/flat_geometry.h"
+#include "libgeojson/parallel.h"
+#include "libgeojson/text.h"
+#include "libgeojson/writer.h"
+
+namespace geojson {
+
+/** The deepest zoom level of a tile */
+static constexpr uint32_t kMaxTileZoom = 30;
+
+/** The latitude of the north and south edges of the Web Mercator tiles */
+static constexpr double kMaxTileLatitude = 85.0511287798066;
+
+/** The number of tiles that a BasicTileWriter keeps open by default, well
+ *  below the usual limit of 1024 open files
+ */
+static constexpr size_t kDefaultMaxOpenTiles = 256;
+
+namespace detail {
+
+static constexpr double kTilePi = 3.14159265358979323846;
+
+/** Checks that a zoom level has tiles */
+inline void CheckTileZoom(uint32_t zoom) {
+  if (zoom > kMaxTileZoom) {
+    throw std::domain_error("Tile zoom must be in [0, 30]");
+  }
+}
+
+/** Returns the number of tiles across a zoom level */
+inline double TilesAcross(uint32_t zoom) {
+  return std::ldexp(1.0, static_cast<int>(zoom));
+}
+
+/** Returns the fractional tile column of a longitude */
+inline double TileX(double lon, double n) { return (lon + 180) / 360 * n; }
+
+/** Returns the fractional tile row of a latitude, clamped to the tiles */
+inline double TileY(double lat, double n) {
+  lat = std::max(-kMaxTileLatitude, std::min(kMaxTileLatitude, lat));
+  double phi = lat * kTilePi / 180;
+  return (1 - std::log(std::tan(phi) + 1 / std::cos(phi)) / kTilePi) / 2 * n;
+}
+
+/** Returns the longitude of a fractional tile column */
+inline double TileLon(double x, double n) { return x / n * 360 - 180; }
+
+/** Returns the latitude of a fractional tile row */
+inline double TileLat(double y, double n) {
+  return std::atan(std::sinh(kTilePi * (1 - 2 * y / n))) * 180 / kTilePi;
+}
+
+/** Returns the index of the tile holding a fractional tile coordinate */
+inline uint32_t TileIndex(double t, double n) {
+  if (!(t > 0)) return 0;
+  if (t >= n) return static_cast<uint32_t>(n - 1);
+  return static_cast<uint32_t>(t);
+}
+}
+
+/** An XYZ tile of the Web Mercator tile pyramid, with rows growing south */
+struct TileId {
+  uint32_t z;
+  uint32_t x;
+  uint32_t y;
+
+  /** Returns the bounds of the tile in decimal degrees
+   *
+   *  \param buffer  How far to grow the tile on each side, as a fraction of
+   *                 its size
+   */
+  BoundingBox Bounds(double buffer = 0) const {
+    double n = detail::TilesAcross(z);
+    return BoundingBox::FromCorners(detail::TileLon(x - buffer, n),
+                                    detail::TileLat(y + 1 + buffer, n),
+                                    detail::TileLon(x + 1 + buffer, n),
+                                    detail::TileLat(y - buffer, n));
+  }
+
+  bool operator==(const TileId& other) const {
+    return z == other.z && x == other.x && y == other.y;
+  }
+
+  bool operator!=(const TileId& other) const { return !(*this == other); }
+
+  bool operator<(const TileId& other) const {
+    if (z != other.z) return z < other.z;
+    if (y != other.y) return y < other.y;
+    return x < other.x;
+  }
+};
+
+/** Returns the tiles of a zoom level that the bounds touch, row by row
+ *
+ *  \param bounds  The bounds in decimal degrees
+ *  \param zoom    The zoom level, at most kMaxTileZoom
+ *  \param buffer  As in TileId::Bounds()
+ */
+inline std::vector<TileId> CoveringTiles(const BoundingBox& bounds,
+                                         uint32_t zoom, double buffer = 0) {
+  detail::CheckTileZoom(zoom);
+  std::vector<TileId> tiles;
+  if (bounds.Empty()) return tiles;
+
+  double n = detail::TilesAcross(zoom);
+  uint32_t minX = detail::TileIndex(detail::TileX(bounds.MinLon(), n) - buffer,
+                                    n);
+  uint32_t maxX = detail::TileIndex(detail::TileX(bounds.MaxLon(), n) + buffer,
+                                    n);
+  uint32_t minY = detail::TileIndex(detail::TileY(bounds.MaxLat(), n) - buffer,
+                                    n);
+  uint32_t maxY = detail::TileIndex(detail::TileY(bounds.MinLat(), n) + buffer,
+                                    n);
+  tiles.reserve(static_cast<size_t>(maxX - minX + 1) * (maxY - minY + 1));
+  for (uint32_t y = minY; y <= maxY; y++) {
+    for (uint32_t x = minX; x <= maxX; x++) tiles.push_back({zoom, x, y});
+  }
+  return tiles;
+}
+
+namespace detail {
+
+/** Returns whether a position is inside the box, including its edges */
+inline bool InBox(const BoundingBox& box, double lon, double lat) {
+  return lon >= box.MinLon() && lon <= box.MaxLon() && lat >= box.MinLat() &&
+         lat <= box.MaxLat();
+}
+
+/** Returns whether the bounds are inside the box */
+inline bool WithinBox(const BoundingBox& bounds, const BoundingBox& box) {
+  return InBox(box, bounds.MinLon(), bounds.MinLat()) &&
+         InBox(box, bounds.MaxLon(), bounds.MaxLat());
+}
+
+/** Returns whether the bounds and the box do not touch */
+inline bool DisjointBox(const BoundingBox& bounds, const BoundingBox& box) {
+  return bounds.Empty() || bounds.MinLon() > box.MaxLon() ||
+         bounds.MaxLon() < box.MinLon() || bounds.MinLat() > box.MaxLat() ||
+         bounds.MaxLat() < box.MinLat();
+}
+
+/** Copies the i'th position of a span into pos */
+inline void ReadPosition(const PositionSpan& positions, size_t i,
+                         double* pos) {
+  pos[0] = positions.Lon(i);
+  pos[1] = positions.Lat(i);
+  if (positions.HasAltitude()) pos[2] = positions.Alt(i);
+}
+
+/** Appends the position t of the way from a to b, which is exactly a or b at
+ *  the ends
+ */
+inline void AppendBetween(std::vector<double>& out, const double* a,
+                          const double* b, size_t dims, double t) {
+  for (size_t d = 0; d < dims; d++) {
+    out.push_back(t <= 0 ? a[d] : t >= 1 ? b[d] : a[d] + t * (b[d] - a[d]));
+  }
+}
+
+/** Clips the segment from a to b to the box (Liang-Barsky)
+ *
+ *  \param t0  Set to how far along the segment it enters the box
+ *  \param t1  Set to how far along the segment it leaves the box
+ *
+ *  \return Whether any of the segment is in the box
+ */
+inline bool ClipSegment(const double* a, const double* b,
+                        const BoundingBox& box, double& t0, double& t1) {
+  double dx = b[0] - a[0], dy = b[1] - a[1];
+  const double p[] = {-dx, dx, -dy, dy};
+  const double q[] = {a[0] - box.MinLon(), box.MaxLon() - a[0],
+                      a[1] - box.MinLat(), box.MaxLat() - a[1]};
+  t0 = 0;
+  t1 = 1;
+  for (int k = 0; k < 4; k++) {
+    if (p[k] == 0) {
+      if (q[k] < 0) return false;
+      continue;
+    }
+    double r = q[k] / p[k];
+    if (p[k] < 0) {
+      if (r > t1) return false;
+      t0 = std::max(t0, r);
+    } else {
+      if (r < t0) return false;
+      t1 = std::min(t1, r);
+    }
+  }
+  return true;
+}
+
+/** Adds interleaved positions to the end of a geometry */
+inline void AddPositions(FlatGeometry& out, const std::vector<double>& coords,
+                         size_t dims) {
+  for (size_t i = 0; i < coords.size(); i += dims) {
+    if (dims == 3) {
+      out.AddPosition(coords[i], coords[i + 1], coords[i + 2]);
+    } else {
+      out.AddPosition(coords[i], coords[i + 1]);
+    }
+  }
+}
+
+/** Ends a piece of a clipped line, adding it to the geometry unless it is a
+ *  single point
+ */
+inline void EndClippedLine(FlatGeometry& out, std::vector<double>& piece,
+                           size_t dims) {
+  if (piece.size() >= 2 * dims &&
+      !(piece.size() == 2 * dims &&
+        std::equal(piece.begin(), piece.begin() + dims,
+                   piece.begin() + dims))) {
+    AddPositions(out, piece, dims);
+    out.EndPart();
+  }
+  piece.clear();
+}
+
+/** Clips a line to the box, adding each piece of it inside the box to the
+ *  geometry as a line
+ */
+inline void ClipLine(const PositionSpan& line, const BoundingBox& box,
+                     FlatGeometry& out) {
+  size_t dims = line.HasAltitude() ? 3 : 2;
+  std::vector<double> piece;
+  double a[3], b[3];
+  if (line.Size() > 0) ReadPosition(line, 0, b);
+  for (size_t i = 1; i < line.Size(); i++) {
+    std::copy(b, b + 3, a);
+    ReadPosition(line, i, b);
+
+    double t0, t1;
+    if (!ClipSegment(a, b, box, t0, t1)) {
+      EndClippedLine(out, piece, dims);
+      continue;
+    }
+    if (piece.empty() || t0 > 0) {
+      EndClippedLine(out, piece, dims);
+      AppendBetween(piece, a, b, dims, t0);
+    }
+    AppendBetween(piece, a, b, dims, t1);
+    if (t1 < 1) EndClippedLine(out, piece, dims);
+  }
+  EndClippedLine(out, piece, dims);
+}
+
+/** Clips an open ring to one side of an edge of the box (Sutherland-Hodgman)
+ *
+ *  \param in      The interleaved positions of the ring
+ *  \param out     Set to the clipped ring
+ *  \param axis    0 to clip by longitude, 1 by latitude
+ *  \param value   The coordinate of the edge
+ *  \param keepLow Whether the positions below the edge are kept, rather than
+ *                 those above it
+ */
+inline void ClipRingEdge(const std::vector<double>& in,
+                         std::vector<double>& out, size_t dims, size_t axis,
+                         double value, bool keepLow) {
+  out.clear();
+  size_t n = in.size() / dims;
+  if (n == 0) return;
+
+  const double* prev = in.data() + (n - 1) * dims;
+  bool prevInside = keepLow ? prev[axis] <= value : prev[axis] >= value;
+  for (size_t i = 0; i < n; i++) {
+    const double* cur = in.data() + i * dims;
+    bool curInside = keepLow ? cur[axis] <= value : cur[axis] >= value;
+    if (curInside != prevInside) {
+      double t = (value - prev[axis]) / (cur[axis] - prev[axis]);
+      AppendBetween(out, prev, cur, dims, t);
+      out[out.size() - dims + axis] = value;
+    }
+    if (curInside) out.insert(out.end(), cur, cur + dims);
+    prev = cur;
+    prevInside = curInside;
+  }
+}
+
+/** Clips a ring to the box, adding it to the geometry if it keeps at least
+ *  3 distinct positions
+ *
+ *  \return Whether the ring was added
+ */
+inline bool ClipRing(const PositionSpan& ring, const BoundingBox& box,
+                     FlatGeometry& out) {
+  size_t dims = ring.HasAltitude() ? 3 : 2;
+  std::vector<double> clipped, work;
+  clipped.reserve(ring.Size() * dims);
+  double pos[3];
+  for (size_t i = 0; i < ring.Size(); i++) {
+    ReadPosition(ring, i, pos);
+    clipped.insert(clipped.end(), pos, pos + dims);
+  }
+  ClipRingEdge(clipped, work, dims, 0, box.MinLon(), false);
+  ClipRingEdge(work, clipped, dims, 0, box.MaxLon(), true);
+  ClipRingEdge(clipped, work, dims, 1, box.MinLat(), false);
+  ClipRingEdge(work, clipped, dims, 1, box.MaxLat(), true);
+
+  // Positions on the edges of the box can be repeated
+  work.clear();
+  for (size_t i = 0; i < clipped.size(); i += dims) {
+    if (!work.empty() &&
+        std::equal(work.end() - dims, work.end(), clipped.begin() + i)) {
+      continue;
+    }
+    work.insert(work.end(), clipped.begin() + i, clipped.begin() + i + dims);
+  }
+  if (work.size() > dims &&
+      std::equal(work.end() - dims, work.end(), work.begin())) {
+    work.resize(work.size() - dims);
+  }
+  if (work.size() < 3 * dims) return false;
+
+  AddPositions(out, work, dims);
+  out.EndRing();
+  return true;
+}
+
+/** Clips the rings [begin, end) of a polygon to the box, dropping the
+ *  polygon if its exterior ring does not survive
+ *
+ *  \return Whether the polygon was added
+ */
+inline bool ClipPolygon(const FlatGeometry& geometry, size_t begin,
+                        size_t end, const BoundingBox& box,
+                        FlatGeometry& out) {
+  if (begin == end || !ClipRing(geometry.Part(begin), box, out)) return false;
+  for (size_t i = begin + 1; i < end; i++) {
+    ClipRing(geometry.Part(i), box, out);
+  }
+  return true;
+}
+
+/** Returns whether a geometry has no positions and no members */
+inline bool IsEmptyGeometry(const FlatGeometry& geometry) {
+  return geometry.NumPositions() == 0 && geometry.Geometries().empty();
+}
+}
+
+/** Clips a geometry to a box in decimal degrees
+ *
+ *  Lines are cut where they cross the edges of the box (Liang-Barsky), so a
+ *  LineString that leaves and enters the box becomes a MultiLineString, and
+ *  rings are clipped with Sutherland-Hodgman, which keeps them closed along
+ *  the edges of the box. Rings left with fewer than 3 positions are dropped,
+ *  with the rest of their polygon if it is an exterior ring, and
+ *  GeometryCollections drop the members that are clipped away.
+ *
+ *  \param geometry  The geometry to clip
+ *  \param box       The box to clip to
+ *
+ *  \return The clipped geometry, which has no positions or members if none of
+ *          the geometry is in the box
+ */
+inline FlatGeometry ClipGeometry(const FlatGeometry& geometry,
+                                 const BoundingBox& box) {
+  BoundingBox bounds = geometry.Bounds();
+  if (detail::WithinBox(bounds, box)) return geometry;
+
+  Type type = geometry.GetType();
+  size_t dims = geometry.Dims();
+  if (detail::DisjointBox(bounds, box)) return FlatGeometry(type, dims);
+
+  switch (type) {
+    case Type::Point:
+    case Type::MultiPoint: {
+      FlatGeometry clipped(type, dims);
+      auto positions = geometry.Positions();
+      for (size_t i = 0; i < positions.Size(); i++) {
+        if (!detail::InBox(box, positions.Lon(i), positions.Lat(i))) continue;
+        if (dims == 3) {
+          clipped.AddPosition(positions.Lon(i), positions.Lat(i),
+                              positions.Alt(i));
+        } else {
+          clipped.AddPosition(positions.Lon(i), positions.Lat(i));
+        }
+      }
+      return clipped;
+    }
+    case Type::LineString: {
+      FlatGeometry clipped(Type::MultiLineString, dims);
+      detail::ClipLine(geometry.Positions(), box, clipped);
+      if (clipped.NumParts() == 0) return FlatGeometry(type, dims);
+      if (clipped.NumParts() == 1) {
+        return FlatGeometry::LineString(clipped.Positions());
+      }
+      return clipped;
+    }
+    case Type::MultiLineString: {
+      FlatGeometry clipped(type, dims);
+      for (size_t i = 0; i < geometry.NumParts(); i++) {
+        detail::ClipLine(geometry.Part(i), box, clipped);
+      }
+      return clipped;
+    }
+    case Type::Polygon: {
+      FlatGeometry clipped(type, dims);
+      detail::ClipPolygon(geometry, 0, geometry.NumParts(), box, clipped);
+      return clipped;
+    }
+    case Type::MultiPolygon: {
+      FlatGeometry clipped(type, dims);
+      const size_t* offsets = geometry.PolygonOffsets();
+      for (size_t i = 0; i < geometry.NumPolygons(); i++) {
+        if (detail::ClipPolygon(geometry, offsets[i], offsets[i + 1], box,
+                                clipped)) {
+          clipped.EndPolygon();
+        }
+      }
+      return clipped;
+    }
+    default: {
+      FlatGeometry clipped(type, dims);
+      for (const auto& member : geometry.Geometries()) {
+        auto g = ClipGeometry(member, box);
+        if (!detail::IsEmptyGeometry(g)) clipped.AddGeometry(std::move(g));
+      }
+      return clipped;
+    }
+  }
+}
+
+/** A feature for WriteTiles() */
+struct TileFeature {
+  FlatGeometry geometry;
+  nlohmann::json properties;
+};
+
+/** A feature clipped to a tile, serialized for the tile's collection */
+struct ClippedFeature {
+  TileId tile;
+  std::string text;
+};
+
+/** Clips features to the XYZ tiles of a zoom level and writes the features
+ *  of each tile to a FeatureCollection of its own
+ *
+ *  Each feature is clipped with ClipGeometry() to every tile it touches and
+ *  written to the collection of each tile it is left in, which is opened the
+ *  first time a feature lands in it. Only the sinks of the most recently
+ *  written tiles are kept open: when a tile is opened with maxOpenTiles
+ *  already open, the least recently written one is flushed and closed, and
+ *  it is reopened for append when a feature next lands in it. Close() writes
+ *  the end of every collection, reopening those that were closed. So the
+ *  memory and file handles used are bounded, whatever the number of tiles
+ *  or features.
+ *
+ *  \tparam Sink  A type with a member void Write(const char*, size_t), and
+ *                optionally void Flush(), which is called before a tile is
+ *                closed
+ */
+template <typename Sink>
+class BasicTileWriter {
+ public:
+  /** Gives the sink that the collection of a tile is written to
+   *
+   *  append is false when the tile is first opened, and true when it is
+   *  reopened after being closed to make room for others, in which case the
+   *  sink must write after what was written before, e.g. a file opened with
+   *  std::ios::app.
+   */
+  using OpenTile = std::function<Sink(const TileId& tile, bool append)>;
+
+  /** Constructor
+   *
+   *  \param zoom          The zoom level of the tiles, at most kMaxTileZoom
+   *  \param openTile      Opens the sink of a tile
+   *  \param format        How the coordinates are encoded
+   *  \param buffer        How far the tiles reach past their edges, as a
+   *                       fraction of their size in [0, 1], so that renderers
+   *                       do not draw the cuts
+   *  \param maxOpenTiles  The number of tiles whose sinks are kept open
+   */
+  BasicTileWriter(uint32_t zoom, OpenTile openTile,
+                  const CoordinateFormat& format = CoordinateFormat(),
+                  double buffer = 0,
+                  size_t maxOpenTiles = kDefaultMaxOpenTiles)
+      : zoom_(zoom), openTile_(std::move(openTile)), format_(format),
+        buffer_(buffer), maxOpenTiles_(maxOpenTiles), closed_(false) {
+    detail::CheckTileZoom(zoom);
+    if (!(buffer >= 0 && buffer <= 1)) {
+      throw std::domain_error("Tile buffer must be in [0, 1]");
+    }
+    if (maxOpenTiles == 0) {
+      throw std::domain_error("At least one tile must be kept open");
+    }
+  }
+
+  BasicTileWriter(const BasicTileWriter&) = delete;
+  BasicTileWriter& operator=(const BasicTileWriter&) = delete;
+
+  /** Destructor, closes the tiles if Close() was not called, ignoring
+   *  errors, so call Close() to see them
+   */
+  ~BasicTileWriter() {
+    try {
+      Close();
+    } catch (...) {
+    }
+  }
+
+  /** Clips a feature to the tiles it touches, without writing it
+   *
+   *  This does not change the writer, so it can be called from several
+   *  threads at once, with the results given to WriteClipped() in order.
+   *
+   *  \param geometry    The geometry of the feature
+   *  \param properties  A JSON object holding properties for the feature
+   *
+   *  \return The feature in each tile it is left in
+   */
+  std::vector<ClippedFeature> Clip(const FlatGeometry& geometry,
+                                   const nlohmann::json& properties) const {
+    std::vector<ClippedFeature> clipped;
+    for (const auto& tile : CoveringTiles(geometry.Bounds(), zoom_, buffer_)) {
+      auto g = ClipGeometry(geometry, tile.Bounds(buffer_));
+      if (detail::IsEmptyGeometry(g)) continue;
+      clipped.push_back(
+          {tile, text::Feature(text::Geometry(g, format_), properties)});
+    }
+    return clipped;
+  }
+
+  /** Writes a feature returned by Clip() to the collection of its tile,
+   *  opening the tile if it is not open
+   */
+  void WriteClipped(const ClippedFeature& feature) {
+    if (closed_) throw std::logic_error("Cannot write to closed tiles");
+    auto& tile = tiles_[feature.tile];
+    Sink& sink = Open(feature.tile, tile);
+    if (tile.numFeatures > 0) sink.Write(",", 1);
+    sink.Write(feature.text.data(), feature.text.size());
+    tile.numFeatures++;
+  }
+
+  /** Clips a feature and writes it to the tiles it touches
+   *
+   *  \param geometry    The geometry of the feature
+   *  \param properties  A JSON object holding properties for the feature
+   */
+  void Write(const FlatGeometry& geometry,
+             const nlohmann::json& properties = nlohmann::json::object()) {
+    geojson::detail::LibraryScope scope;
+    for (const auto& feature : Clip(geometry, properties)) {
+      WriteClipped(feature);
+    }
+  }
+
+  /** Writes the end of the collections of all of the tiles and closes
+   *  them, further calls are no-ops
+   */
+  void Close() {
+    if (closed_) return;
+    closed_ = true;
+    // The open tiles are ended first, so none is closed to make room for
+    // another and then reopened
+    std::vector<TileId> ended(recent_.begin(), recent_.end());
+    for (const auto& id : ended) {
+      auto& tile = tiles_[id];
+      tile.sink->Write("]}", 2);
+      Release(tile);
+    }
+    std::sort(ended.begin(), ended.end());
+    for (auto& tile : tiles_) {
+      if (std::binary_search(ended.begin(), ended.end(), tile.first)) continue;
+      Open(tile.first, tile.second).Write("]}", 2);
+      Release(tile.second);
+    }
+  }
+
+  /** Returns the tiles that have been opened, in row order */
+  std::vector<TileId> Tiles() const {
+    std::vector<TileId> tiles;
+    tiles.reserve(tiles_.size());
+    for (const auto& tile : tiles_) tiles.push_back(tile.first);
+    return tiles;
+  }
+
+  /** Returns the number of features written to a tile */
+  size_t NumFeatures(const TileId& tile) const {
+    auto it = tiles_.find(tile);
+    return it == tiles_.end() ? 0 : it->second.numFeatures;
+  }
+
+  /** Returns the zoom level of the tiles */
+  uint32_t Zoom() const { return zoom_; }
+
+ private:
+  /** A tile that has been opened, whose sink is held while it is open */
+  struct Tile {
+    Tile() : numFeatures(0) {}
+
+    std::unique_ptr<Sink> sink;
+    std::list<TileId>::iterator recent;
+    size_t numFeatures;
+  };
+
+  /** Returns the sink of a tile, opening it and writing the header of its
+   *  collection if needed, and marks it as the most recently written
+   */
+  Sink& Open(const TileId& id, Tile& tile) {
+    if (tile.sink) {
+      recent_.splice(recent_.begin(), recent_, tile.recent);
+      return *tile.sink;
+    }
+    if (recent_.size() >= maxOpenTiles_) Release(tiles_[recent_.back()]);
+    bool append = tile.numFeatures > 0;
+    tile.sink.reset(new Sink(openTile_(id, append)));
+    recent_.push_front(id);
+    tile.recent = recent_.begin();
+    if (!append) {
+      tile.sink->Write(detail::kFeatureCollectionHeader,
+                       sizeof(detail::kFeatureCollectionHeader) - 1);
+    }
+    return *tile.sink;
+  }
+
+  /** Flushes and closes the sink of an open tile */
+  void Release(Tile& tile) {
+    recent_.erase(tile.recent);
+    std::unique_ptr<Sink> sink(std::move(tile.sink));
+    detail::FlushSink(*sink);
+  }
+
+  uint32_t zoom_;
+  OpenTile openTile_;
+  CoordinateFormat format_;
+  double buffer_;
+  size_t maxOpenTiles_;
+  bool closed_;
+  std::map<TileId, Tile> tiles_;
+  /** The open tiles, the most recently written first */
+  std::list<TileId> recent_;
+};
+
+/** A tile writer whose tiles are each written to a stream it opens, e.g.
+ *
+ *      [](const TileId& t, bool append) {
+ *        return std::unique_ptr<std::ofstream>(new std::ofstream(
+ *            path, append ? std::ios::app : std::ios::out));
+ *      }
+ */
+using TileWriter = BasicTileWriter<OwnedStreamSink>;
+
+namespace detail {
+
+/** Clips numFeatures features from getFeature on the workers given to the
+ *  executor and writes them to the writer's tiles in index order
+ */
+template <typename Sink, typename Callback, typename Executor>
+void WriteTiles(BasicTileWriter<Sink>& writer, size_t numFeatures,
+                Callback& getFeature, Executor& executor, size_t numWorkers,
+                size_t chunkSize) {
+  if (chunkSize == 0) chunkSize = kDefaultParallelChunkSize;
+  size_t numChunks = (numFeatures + chunkSize - 1) / chunkSize;
+
+  using Chunks = BasicParallelChunks<std::vector<ClippedFeature>>;
+  const auto& clipper = writer;
+  auto chunks = std::make_shared<Chunks>(
+      numChunks, 4 * (numWorkers + 1),
+      [&](size_t chunk, std::vector<ClippedFeature>& out) {
+        size_t begin = chunk * chunkSize;
+        size_t end = std::min(numFeatures, begin + chunkSize);
+        for (size_t i = begin; i < end; i++) {
+          TileFeature feature = getFeature(i);
+          auto clipped = clipper.Clip(feature.geometry, feature.properties);
+          std::move(clipped.begin(), clipped.end(), std::back_inserter(out));
+        }
+      });
+
+  size_t numWritten = 0;
+  try {
+    chunks->StartWorkers(executor, numWorkers);
+    for (; numWritten < numChunks; numWritten++) {
+      for (const auto& feature : chunks->Take(numWritten)) {
+        writer.WriteClipped(feature);
+      }
+      chunks->MarkWritten(numWritten);
+      chunks->StartWorkers(executor, numWorkers);
+    }
+  } catch (...) {
+    chunks->Cancel(numWritten);
+    throw;
+  }
+  writer.Close();
+}
+}
+
+/** Clips a collection of features to tiles and writes the collection of each
+ *  tile, with the features produced and clipped in parallel
+ *
+ *  The features are split into chunks of consecutive features, which are
+ *  clipped and serialized by the workers and written to their tiles in index
+ *  order, so each tile is identical to the one written by calling
+ *  writer.Write() on each feature. getFeature is called concurrently from
+ *  several threads. The writer is closed afterwards.
+ *
+ *  \tparam Callback    A callable of the form TileFeature(size_t index)
+ *  \param writer       The writer of the tiles
+ *  \param numFeatures  The number of features
+ *  \param getFeature   Callback that takes the feature index and gives back
+ *                      the feature
+ *  \param numThreads   The number of threads, including the calling thread,
+ *                      0 meaning one per hardware thread
+ *  \param chunkSize    The number of features in each chunk
+ */
+template <typename Sink, typename Callback>
+void WriteTiles(BasicTileWriter<Sink>& writer, size_t numFeatures,
+                Callback&& getFeature, size_t numThreads = 0,
+                size_t chunkSize = kDefaultParallelChunkSize) {
+  static_assert(detail::is_invocable_r<TileFeature, Callback, size_t>::value,
+                "Callback must be of the form TileFeature(size_t)");
+  detail::ThreadExecutor executor;
+  detail::WriteTiles(writer, numFeatures, getFeature, executor,
+                     detail::NumWorkerThreads(numThreads), chunkSize);
+}
+}
@@ -0,0 +1,293 @@
+/** Streaming writers for libgeojson
+ *
+ *  \file writer.h
+ *  \author Dr. Philip Salvaggio (salvaggio.philip@gmail.com)
+ *  \date 14 Oct 2026
+ */
+
+#pragma once
+
+#include <ios>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "libgeojson/libgeojson.h"
+
+namespace geojson {
+
+namespace detail {
+
+/** Throws if a stream has failed, e.g. because its disk is full */
+inline void CheckStream(const std::ostream& os) {
+  if (os.fail()) throw std::ios_base::failure("Failed to write to a stream");
+}
+}
+
+/** A writer sink that forwards all output to a std::ostream
+ *
+ *  \throws std::ios_base::failure from Write() and Flush() once the stream
+ *          has failed
+ */
+class StreamSink {
+ public:
+  /** Constructor (implicit, so a std::ostream can be given to a writer)
+   *
+   *  \param os  The stream to write to, must outlive the sink
+   */
+  StreamSink(std::ostream& os) : os_(&os) {}
+
+  /** Writes size bytes from data to the stream */
+  void Write(const char* data, size_t size) {
+    os_->write(data, static_cast<std::streamsize>(size));
+    detail::CheckStream(*os_);
+    detail::Instrument::OnBytesWritten(size);
+  }
+
+  /** Flushes the stream, so that errors writing its buffer are seen */
+  void Flush() {
+    os_->flush();
+    detail::CheckStream(*os_);
+  }
+
+ private:
+  std::ostream* os_;
+};
+
+/** A writer sink that owns the std::ostream it writes to, e.g. a file
+ *  opened for the writer
+ *
+ *  \throws std::ios_base::failure from Write() and Flush() once the stream
+ *          has failed
+ */
+class OwnedStreamSink {
+ public:
+  /** Constructor (implicit, so an opened stream can be given to a writer)
+   *
+   *  \param os  The stream to write to
+   */
+  template <typename Stream>
+  OwnedStreamSink(std::unique_ptr<Stream> os) : os_(std::move(os)) {}
+
+  /** Writes size bytes from data to the stream */
+  void Write(const char* data, size_t size) {
+    os_->write(data, static_cast<std::streamsize>(size));
+    detail::CheckStream(*os_);
+    detail::Instrument::OnBytesWritten(size);
+  }
+
+  /** Flushes the stream, so that errors writing its buffer are seen */
+  void Flush() {
+    os_->flush();
+    detail::CheckStream(*os_);
+  }
+
+ private:
+  std::unique_ptr<std::ostream> os_;
+};
+
+/** A writer sink that appends all output to a std::string */
+class StringSink {
+ public:
+  /** Constructor (implicit, so a std::string can be given to a writer)
+   *
+   *  \param str  The string to append to, must outlive the sink
+   */
+  StringSink(std::string& str) : str_(&str) {}
+
+  /** Appends size bytes from data to the string */
+  void Write(const char* data, size_t size) {
+    str_->append(data, size);
+    detail::Instrument::OnBytesWritten(size);
+  }
+
+  /** Does nothing, a string has no buffer */
+  void Flush() {}
+
+ private:
+  std::string* str_;
+};
+
+namespace detail {
+
+/** The text of a FeatureCollection before its first feature */
+static constexpr char kFeatureCollectionHeader[] =
+    "{\"type\":\"FeatureCollection\",\"features\":[";
+
+/** Flushes a sink that has a member void Flush() */
+template <typename Sink>
+auto FlushSink(Sink& sink, int) -> decltype(sink.Flush()) {
+  sink.Flush();
+}
+
+/** \overload for sinks without one, which have nothing to flush */
+template <typename Sink>
+void FlushSink(Sink&, long) {}
+
+/** Flushes a sink if it can be flushed */
+template <typename Sink>
+void FlushSink(Sink& sink) {
+  FlushSink(sink, 0);
+}
+
+/** The Write() members of the writers of GeoJSON text, which serialize a
+ *  feature and give it to the writer's WriteRaw()
+ *
+ *  \tparam Writer  The writer deriving from this, with a member
+ *                  void WriteRaw(const char*, size_t)
+ */
+template <typename Writer>
+class JsonFeatureWriter {
+ public:
+  /** Writes a feature
+   *
+   *  \param feature  A GeoJSON Feature object
+   */
+  void Write(const nlohmann::json& feature) {
+    LibraryScope scope;
+    auto text = feature.dump();
+    static_cast<Writer&>(*this).WriteRaw(text.data(), text.size());
+  }
+
+  /** \overload for other nlohmann::basic_json types, e.g. ArenaJson */
+  template <typename Json,
+            typename = typename std::enable_if<
+                nlohmann::detail::is_basic_json<Json>::value &&
+                !std::is_same<Json, nlohmann::json>::value>::type>
+  void Write(const Json& feature) {
+    LibraryScope scope;
+    auto text = feature.dump();
+    static_cast<Writer&>(*this).WriteRaw(text.data(), text.size());
+  }
+
+ protected:
+  ~JsonFeatureWriter() = default;
+};
+}
+
+/** Writes a FeatureCollection object (section 3.3) incrementally
+ *
+ *  The header of the collection is written on construction, each feature is
+ *  serialized and written to the sink as soon as it is given and the closing
+ *  brackets are written by Close(). Only one feature is held in memory at a
+ *  time, regardless of the size of the collection.
+ *
+ *  Errors of the sink, e.g. a stream that has failed, are thrown from the
+ *  call that sees them, so Close() must be called to see those writing the
+ *  end of the collection.
+ *
+ *  \tparam Sink  A type with a member void Write(const char*, size_t), and
+ *                optionally void Flush(), which Close() calls
+ */
+template <typename Sink>
+class BasicFeatureCollectionWriter
+    : public detail::JsonFeatureWriter<BasicFeatureCollectionWriter<Sink>> {
+ public:
+  /** Constructor, writes the header of the collection
+   *
+   *  \param sink  The sink to which the collection is written
+   */
+  explicit BasicFeatureCollectionWriter(Sink sink)
+      : sink_(std::move(sink)), numFeatures_(0), closed_(false) {
+    sink_.Write(detail::kFeatureCollectionHeader,
+                sizeof(detail::kFeatureCollectionHeader) - 1);
+  }
+
+  BasicFeatureCollectionWriter(const BasicFeatureCollectionWriter&) = delete;
+  BasicFeatureCollectionWriter& operator=(const BasicFeatureCollectionWriter&) =
+      delete;
+
+  /** Destructor, closes the collection if Close() was not called, ignoring
+   *  errors, so call Close() to see them
+   */
+  ~BasicFeatureCollectionWriter() {
+    try {
+      Close();
+    } catch (...) {
+    }
+  }
+
+  /** Writes an already serialized feature to the collection verbatim
+   *
+   *  \param data  The serialized GeoJSON Feature object
+   *  \param size  The number of bytes in data
+   */
+  void WriteRaw(const char* data, size_t size) {
+    if (closed_) {
+      throw std::logic_error("Cannot write to a closed FeatureCollection");
+    }
+    if (numFeatures_ > 0) sink_.Write(",", 1);
+    sink_.Write(data, size);
+    numFeatures_++;
+  }
+
+  /** \overload */
+  void WriteRaw(const std::string& feature) {
+    WriteRaw(feature.data(), feature.size());
+  }
+
+  /** Writes the closing brackets of the collection and flushes the sink,
+   *  further calls are no-ops
+   */
+  void Close() {
+    if (closed_) return;
+    closed_ = true;
+    sink_.Write("]}", 2);
+    detail::FlushSink(sink_);
+  }
+
+  /** Returns the number of features written so far */
+  size_t NumFeatures() const { return numFeatures_; }
+
+ private:
+  Sink sink_;
+  size_t numFeatures_;
+  bool closed_;
+};
+
+/** A FeatureCollection writer that writes to a std::ostream */
+using FeatureCollectionWriter = BasicFeatureCollectionWriter<StreamSink>;
+
+namespace detail {
+
+/** Writes numFeatures features from getFeature to the given sink */
+template <typename Sink, typename Callback>
+void WriteFeatureCollection(Sink sink, size_t numFeatures,
+                            Callback&& getFeature) {
+  static_assert(detail::is_invocable_r<nlohmann::json, Callback, size_t>::value,
+                "Callback must be of the form nlohmann::json(size_t)");
+
+  BasicFeatureCollectionWriter<Sink> writer(std::move(sink));
+  for (size_t i = 0; i < numFeatures; i++) {
+    writer.Write(getFeature(i));
+  }
+  writer.Close();
+}
+}
+
+/** Writes a FeatureCollection object (section 3.3) to a stream, one feature at
+ *  a time
+ *
+ *  \tparam Callback    A callable of the form nlohmann::json(size_t index)
+ *  \param os           The stream to write to
+ *  \param numFeatures  The number of features in the collection
+ *  \param getFeature   Callback that takes the feature index and gives back
+ *                      the feature.
+ */
+template <typename Callback>
+void WriteFeatureCollection(std::ostream& os, size_t numFeatures,
+                            Callback&& getFeature) {
+  detail::WriteFeatureCollection(StreamSink(os), numFeatures,
+                                 std::forward<Callback>(getFeature));
+}
+
+/** \overload */
+template <typename Callback>
+void WriteFeatureCollection(std::string& str, size_t numFeatures,
+                            Callback&& getFeature) {
+  detail::WriteFeatureCollection(StringSink(str), numFeatures,
+                                 std::forward<Callback>(getFeature));
+}
+}
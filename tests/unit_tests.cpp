@@ -5,12 +5,44 @@
  *  \date 17 Jan 2020
  */
 
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
 #include <vector>
 
 #include <gtest/gtest.h>
 
+// Count what the library does, to test the instrumentation hooks
+#define LIBGEOJSON_INSTRUMENTATION geojson::CountingInstrumentation
+
 #include "Predicates.h"
+#include "libgeojson/append.h"
+#include "libgeojson/arena.h"
+#include "libgeojson/cbor.h"
+#include "libgeojson/flat_geometry.h"
+#include "libgeojson/fragment.h"
+#include "libgeojson/flatgeobuf.h"
 #include "libgeojson/libgeojson.h"
+#include "libgeojson/mapped_file.h"
+#include "libgeojson/parallel.h"
+#include "libgeojson/parallel_reader.h"
+#include "libgeojson/producer.h"
+#include "libgeojson/reader.h"
+#include "libgeojson/raw_json.h"
+#include "libgeojson/schema.h"
+#include "libgeojson/sequence.h"
+#include "libgeojson/spatial_index.h"
+#include "libgeojson/spatial_order.h"
+#include "libgeojson/text.h"
+#include "libgeojson/tiles.h"
+#include "libgeojson/writer.h"
 
 // A simple struct to hold a 3D point
 struct Pt3D {
@@ -141,6 +173,35 @@ TEST(LibgeojsonTest, IsCcwTest) {
                             1, 1.5, 1, 0.5, 2, 0.5, 2, 0};
   EXPECT_FALSE(geojson::detail::IsCcw(
       geojson::detail::LineStringCoordinates(pts.size() / 2, getPoint)));
+  EXPECT_FALSE(geojson::detail::IsCcw(pts.size() / 2, getPoint));
+
+  // CCW C shape, straight from the callback
+  pts = std::vector<double>{0, 0,   2, 0,   2, 0.5, 1, 0.5,
+                            1, 1.5, 2, 1.5, 2, 2,   0, 2};
+  EXPECT_TRUE(geojson::detail::IsCcw(pts.size() / 2, getPoint));
+  EXPECT_TRUE(geojson::detail::IsCcw(
+      pts.size() / 2, [&](size_t i, double& x, double& y, double& z) {
+        getPoint(i, x, y);
+        z = 0;
+      }));
+}
+
+TEST(LibgeojsonTest, LinearRingCoordinates2DTest) {
+  std::vector<double> pts{0, 0, 0, 1, 1, 1, 1, 0};
+  size_t numCalls = 0;
+  auto getPoint = [&](size_t i, double& x, double& y) {
+    numCalls++;
+    x = pts[2 * i];
+    y = pts[2 * i + 1];
+  };
+
+  // The CW input is reversed, one read for the winding and one to build
+  auto j = geojson::detail::LinearRingCoordinates(4, true, getPoint);
+  EXPECT_EQ(numCalls, 8u);
+  EXPECT_EQ(j, nlohmann::json::parse("[[1,0],[1,1],[0,1],[0,0],[1,0]]"));
+
+  j = geojson::detail::LinearRingCoordinates(4, false, getPoint);
+  EXPECT_EQ(j, nlohmann::json::parse("[[0,0],[0,1],[1,1],[1,0],[0,0]]"));
 }
 
 TEST(LibgeojsonTest, LinearRingCoordinatesTest) {
@@ -236,6 +297,2689 @@ TEST(LibgeojsonTest, FeatureCollectionTest) {
   });
 }
 
+TEST(LibgeojsonTest, FeatureCollectionWriterTest) {
+  std::vector<Pt3D> pts{Pt3D(1, 2, 3), Pt3D(2, 3, 4), Pt3D(3, 4, 5)};
+  auto getFeature = [&](size_t i) -> nlohmann::json {
+    return geojson::Feature(i, geojson::Point(pts[i].x, pts[i].y, pts[i].z),
+                            nlohmann::json(Props("bar", pts[i].x)));
+  };
+
+  std::ostringstream os;
+  {
+    geojson::FeatureCollectionWriter writer(os);
+    for (size_t i = 0; i < pts.size(); i++) {
+      writer.Write(getFeature(i));
+    }
+    EXPECT_EQ(writer.NumFeatures(), pts.size());
+    writer.Close();
+    EXPECT_THROW(writer.Write(getFeature(0)), std::logic_error);
+  }
+  EXPECT_EQ(nlohmann::json::parse(os.str()),
+            geojson::FeatureCollection(pts.size(), getFeature));
+
+  std::string str;
+  geojson::WriteFeatureCollection(str, pts.size(), getFeature);
+  EXPECT_EQ(str, os.str());
+
+  // An empty collection is still a valid document
+  str.clear();
+  geojson::WriteFeatureCollection(str, 0, getFeature);
+  EXPECT_EQ(nlohmann::json::parse(str),
+            geojson::FeatureCollection(0, getFeature));
+
+  // A failed stream throws from the write that sees it, and from Close()
+  std::ostringstream failing;
+  geojson::FeatureCollectionWriter failingWriter(failing);
+  failingWriter.Write(getFeature(0));
+  failing.setstate(std::ios::badbit);
+  EXPECT_THROW(failingWriter.Write(getFeature(1)), std::ios_base::failure);
+  EXPECT_THROW(failingWriter.Close(), std::ios_base::failure);
+  std::ofstream missing("no/such/directory/out.geojson");
+  EXPECT_THROW(geojson::FeatureCollectionWriter{missing},
+               std::ios_base::failure);
+}
+
+TEST(LibgeojsonTest, FeatureCollectionProducerTest) {
+  std::vector<Pt3D> pts{Pt3D(1, 2, 3), Pt3D(2, 3, 4), Pt3D(3, 4, 5)};
+  size_t numMade = 0;
+  auto getFeature = [&](size_t i) -> nlohmann::json {
+    numMade++;
+    return geojson::Feature(i, geojson::Point(pts[i].x, pts[i].y, pts[i].z),
+                            nlohmann::json(Props("bar", pts[i].x)));
+  };
+  std::string expected;
+  geojson::WriteFeatureCollection(expected, pts.size(), getFeature);
+  numMade = 0;
+
+  // Features are made as the chunks need them, the header is 40 bytes
+  geojson::FeatureCollectionProducer producer(pts.size(), getFeature, 16);
+  std::string text;
+  geojson::StringView chunk;
+  ASSERT_TRUE(producer.Next(chunk));
+  EXPECT_EQ(chunk.Size(), 16u);
+  EXPECT_EQ(numMade, 0u);
+  text.append(chunk.Data(), chunk.Size());
+  ASSERT_TRUE(producer.Next(chunk));
+  text.append(chunk.Data(), chunk.Size());
+  EXPECT_EQ(numMade, 0u);
+  ASSERT_TRUE(producer.Next(chunk));
+  EXPECT_EQ(numMade, 1u);
+  text.append(chunk.Data(), chunk.Size());
+  while (producer.Next(chunk)) {
+    EXPECT_LE(chunk.Size(), 16u);
+    text.append(chunk.Data(), chunk.Size());
+  }
+  EXPECT_TRUE(producer.Done());
+  EXPECT_FALSE(producer.Next(chunk));
+  EXPECT_EQ(producer.NumFeatures(), pts.size());
+  EXPECT_EQ(text, expected);
+
+  // Text features, in chunks larger than the whole collection
+  geojson::FeatureCollectionProducer textProducer(
+      pts.size(), [&](size_t i) { return getFeature(i).dump(); });
+  ASSERT_TRUE(textProducer.Next(chunk));
+  EXPECT_EQ(std::string(chunk.Data(), chunk.Size()), expected);
+  EXPECT_FALSE(textProducer.Next(chunk));
+
+  geojson::FeatureCollectionProducer empty(0, getFeature, 1);
+  text.clear();
+  while (empty.Next(chunk)) text.append(chunk.Data(), chunk.Size());
+  EXPECT_EQ(nlohmann::json::parse(text),
+            geojson::FeatureCollection(0, getFeature));
+}
+
+TEST(LibgeojsonTest, FragmentTest) {
+  std::vector<Pt3D> pts{Pt3D(1, 2, 3), Pt3D(2, 3, 4), Pt3D(3, 4, 5)};
+  auto getPoint = [&](size_t i, double& lon, double& lat) {
+    lon = pts[i].x;
+    lat = pts[i].y;
+  };
+  auto format = geojson::CoordinateFormat().WithBoundingBoxes();
+  auto geometry = geojson::text::LineString(3, getPoint, format);
+  nlohmann::json props(Props("bar", 1.5));
+
+  // Fragments give the same text as the geometry and properties they hold
+  auto fragment = geojson::RawFragment::FromText(geometry);
+  EXPECT_GT(fragment.BoundingBoxSize(), 0u);
+  EXPECT_EQ(geojson::text::Feature(fragment, props),
+            geojson::text::Feature(geometry, props));
+  EXPECT_EQ(geojson::text::Feature(7, fragment, props),
+            geojson::text::Feature(7, geometry, props));
+  EXPECT_EQ(geojson::text::Feature("a", geojson::RawFragment(), props),
+            geojson::text::Feature("a", "null", props));
+
+  // Each ID is made once, and the same text is only held once
+  geojson::FragmentCache cache;
+  size_t numMade = 0;
+  auto make = [&]() {
+    numMade++;
+    return geometry;
+  };
+  const auto& a = cache.Get("a", make);
+  EXPECT_TRUE(cache.Get("a", make).SharesText(a));
+  EXPECT_TRUE(cache.Get("b", make).SharesText(a));
+  auto json = cache.Get("c", [&]() { return nlohmann::json(props); });
+  EXPECT_EQ(json.Text(), props.dump());
+  EXPECT_EQ(numMade, 2u);
+  EXPECT_EQ(cache.Size(), 3u);
+  EXPECT_EQ(cache.NumDistinct(), 2u);
+  EXPECT_TRUE(cache.Contains("b"));
+
+  // The writers splice the fragments into each feature
+  std::string str, sequence;
+  {
+    geojson::BasicFeatureCollectionWriter<geojson::StringSink> writer(str);
+    geojson::BasicSequenceWriter<geojson::StringSink> records(sequence);
+    for (size_t i = 0; i < 3; i++) {
+      geojson::WriteFeature(writer, i, cache.Get("a", make),
+                            cache.Get("c", make));
+      geojson::WriteFeature(records, cache.Get("a", make), props);
+    }
+  }
+  auto expected = geojson::FeatureCollection(3, [&](size_t i) {
+    return nlohmann::json::parse(geojson::text::Feature(i, geometry, props));
+  });
+  EXPECT_EQ(nlohmann::json::parse(str)["features"], expected["features"]);
+  std::string expectedSequence;
+  for (size_t i = 0; i < 3; i++) {
+    expectedSequence += "\x1e" + geojson::text::Feature(geometry, props) + "\n";
+  }
+  EXPECT_EQ(sequence, expectedSequence);
+  EXPECT_EQ(numMade, 2u);
+}
+
+TEST(LibgeojsonTest, PropertySchemaTest) {
+  namespace fgb = geojson::fgb;
+  std::vector<std::string> names{"main st", "say \"hi\"", "caf\xc3\xa9"};
+  geojson::PropertySchema schema;
+  schema.AddString("name", [&](size_t i) { return names[i]; })
+      .AddInteger("lanes", [](size_t i) { return -3 + 2 * int64_t(i); })
+      .AddDouble("speed", [](size_t i) { return i == 2 ? NAN : 12.5 * i; })
+      .AddBool("open", [](size_t i) { return i % 2 == 0; },
+               [](size_t i) { return i == 1; })
+      .AddJson("tags", [](size_t i) { return nlohmann::json{i, "x"}; });
+  EXPECT_EQ(schema.NumColumns(), 5u);
+  EXPECT_EQ(schema.Name(1), "lanes");
+  EXPECT_EQ(schema.Type(2), geojson::PropertyType::Double);
+  EXPECT_THROW(schema.AddBool("name", [](size_t) { return true; }),
+               std::domain_error);
+
+  // The text is that of the properties object, null where a value is
+  for (size_t i = 0; i < names.size(); i++) {
+    auto properties = schema.Properties(i);
+    std::string text;
+    schema.AppendProperties(text, i);
+    EXPECT_EQ(text, properties.dump());
+  }
+  EXPECT_EQ(schema.Properties(1)["open"], nullptr);
+  EXPECT_EQ(schema.Properties(0)["lanes"], -3);
+
+  // Features and the writers write the same text as from the objects
+  auto geometry = geojson::RawFragment::FromText(geojson::text::Point(
+      1, 2, geojson::CoordinateFormat().WithBoundingBoxes()));
+  EXPECT_EQ(geojson::text::Feature(geometry, schema, 0),
+            geojson::text::Feature(geometry, schema.Properties(0)));
+  EXPECT_EQ(geojson::text::Feature(4, geometry, schema, 1),
+            geojson::text::Feature(4, geometry, schema.Properties(1)));
+  std::string str, expected;
+  {
+    geojson::BasicFeatureCollectionWriter<geojson::StringSink> writer(str);
+    geojson::BasicFeatureCollectionWriter<geojson::StringSink> objects(
+        expected);
+    for (size_t i = 0; i < names.size(); i++) {
+      geojson::WriteFeature(writer, "f" + std::to_string(i), geometry, schema,
+                            i);
+      geojson::WriteFeature(objects, "f" + std::to_string(i), geometry,
+                            schema.Properties(i));
+    }
+  }
+  EXPECT_EQ(str, expected);
+  std::string sequence;
+  {
+    geojson::BasicSequenceWriter<geojson::StringSink> records(sequence);
+    geojson::WriteFeature(records, geometry, schema, 2);
+  }
+  EXPECT_EQ(sequence, "\x1e" + geojson::text::Feature(
+                                    geometry, schema.Properties(2)) + "\n");
+
+  // FlatGeobuf files hold the same columns, in the schema's order
+  auto columns = fgb::Columns(schema);
+  ASSERT_EQ(columns.size(), 5u);
+  EXPECT_EQ(columns[0].name, "name");
+  EXPECT_EQ(columns[0].type, fgb::ColumnType::String);
+  EXPECT_EQ(columns[1].type, fgb::ColumnType::Long);
+  EXPECT_EQ(columns[3].type, fgb::ColumnType::Bool);
+  {
+    std::string file;
+    fgb::BasicFeatureCollectionWriter<geojson::StringSink> writer(
+        file, "", {{"lanes", fgb::ColumnType::Byte}}, 0);
+    for (size_t i = 0; i < names.size(); i++) {
+      writer.Write(geojson::FlatGeometry::Point(i, 2), schema, i);
+    }
+    ASSERT_EQ(writer.Columns().size(), 5u);
+    EXPECT_EQ(writer.Columns()[0].name, "lanes");
+    EXPECT_EQ(writer.Columns()[1].name, "name");
+  }
+
+  // With the columns in key order, as objects are, the values are the same
+  geojson::PropertySchema sorted;
+  sorted.AddInteger("lanes", [](size_t i) { return -3 + 2 * int64_t(i); })
+      .AddString("name", [&](size_t i) { return names[i]; })
+      .AddBool("open", [](size_t i) { return i % 2 == 0; },
+               [](size_t i) { return i == 1; })
+      .AddDouble("speed", [](size_t i) { return i == 2 ? NAN : 12.5 * i; })
+      .AddJson("tags", [](size_t i) { return nlohmann::json{i, "x"}; });
+  std::string fromSchema, fromObjects;
+  {
+    fgb::BasicFeatureCollectionWriter<geojson::StringSink> writer(
+        fromSchema, "", fgb::Columns(sorted), 0);
+    fgb::BasicFeatureCollectionWriter<geojson::StringSink> objects(
+        fromObjects, "", fgb::Columns(sorted), 0);
+    for (size_t i = 0; i < names.size(); i++) {
+      auto point = geojson::FlatGeometry::Point(i, 2);
+      writer.Write(point, sorted, i);
+      objects.Write(point, sorted.Properties(i));
+    }
+  }
+  EXPECT_EQ(fromSchema, fromObjects);
+}
+
+TEST(LibgeojsonTest, TextPointTest) {
+  EXPECT_EQ(geojson::text::Point(5.3, 10.4),
+            "{\"type\":\"Point\",\"coordinates\":[5.3,10.4]}");
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::Point(2.1, -3.4, 0)),
+            geojson::Point(2.1, -3.4, 0));
+}
+
+TEST(LibgeojsonTest, TextLineStringTest) {
+  std::vector<double> pts2d{0, 0.5, 1, 1.5, 2, 2.5};
+  auto getPoint2d = [&](size_t i, double& lon, double& lat) {
+    lon = pts2d[2 * i];
+    lat = pts2d[2 * i + 1];
+  };
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::MultiPoint(3, getPoint2d)),
+            geojson::MultiPoint(3, getPoint2d));
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::LineString(3, getPoint2d)),
+            geojson::LineString(3, getPoint2d));
+  EXPECT_THROW(geojson::text::LineString(1, getPoint2d), std::domain_error);
+
+  std::vector<std::vector<std::array<double, 3>>> pts3d{
+      {{0, 1, 2}, {3, 4.1, 5}}, {{3, 4, 5}, {6, 7, 8}, {9, 10, 11}}};
+  auto getLineLength = [&](size_t l) -> size_t { return pts3d[l].size(); };
+  auto getPoint3d = [&](size_t l, size_t p, double& lon, double& lat,
+                        double& alt) {
+    lon = pts3d[l][p][0];
+    lat = pts3d[l][p][1];
+    alt = pts3d[l][p][2];
+  };
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::MultiLineString(
+                pts3d.size(), getLineLength, getPoint3d)),
+            geojson::MultiLineString(pts3d.size(), getLineLength, getPoint3d));
+}
+
+TEST(LibgeojsonTest, TextPolygonTest) {
+  std::vector<std::vector<std::array<double, 3>>> outers{
+      {{0, 0, 0.5}, {1.5, 0, 0.3}, {1.5, 1.5, 0.6}, {0, 1.5, 0.9}},
+      {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}}};
+  std::vector<std::vector<std::vector<std::array<double, 3>>>> inners{
+      {{{0.25, 0.25, 0.5}, {0.35, 0.75, 0.6}, {0.5, 0.25, 0.7}},
+       {{1, 0.25, 0.5}, {1.25, 0.25, 0.6}, {1.125, 0.5, 0.7}}},
+      {}};
+  auto getNumRings = [&](size_t poly) -> size_t {
+    return inners[poly].size() + 1;
+  };
+  auto getRingLength = [&](size_t poly, size_t ring) -> size_t {
+    return ring == 0 ? outers[poly].size() : inners[poly][ring - 1].size();
+  };
+  auto getPoint3d = [&](size_t poly, size_t ring, size_t pt, double& lon,
+                        double& lat, double& alt) {
+    const auto& p =
+        ring == 0 ? outers[poly][pt] : inners[poly][ring - 1][pt];
+    lon = p[0];
+    lat = p[1];
+    alt = p[2];
+  };
+  auto getPoint2d = [&](size_t poly, size_t ring, size_t pt, double& lon,
+                        double& lat) {
+    double alt;
+    getPoint3d(poly, ring, pt, lon, lat, alt);
+  };
+
+  auto getPolyRingLength = [&](size_t ring) { return getRingLength(0, ring); };
+  auto getPolyPoint = [&](size_t ring, size_t pt, double& lon, double& lat) {
+    getPoint2d(0, ring, pt, lon, lat);
+  };
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::Polygon(
+                getNumRings(0), getPolyRingLength, getPolyPoint)),
+            geojson::Polygon(getNumRings(0), getPolyRingLength, getPolyPoint));
+
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::MultiPolygon(
+                outers.size(), getNumRings, getRingLength, getPoint3d)),
+            geojson::MultiPolygon(outers.size(), getNumRings, getRingLength,
+                                  getPoint3d));
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::MultiPolygon(
+                outers.size(), getNumRings, getRingLength, getPoint2d)),
+            geojson::MultiPolygon(outers.size(), getNumRings, getRingLength,
+                                  getPoint2d));
+}
+
+TEST(LibgeojsonTest, TextFeatureTest) {
+  nlohmann::json props(Props("bar", 4.3));
+  auto geomText = geojson::text::GeometryCollection(
+      2, [](size_t i) { return geojson::text::Point(i, i + 1.5); });
+  auto geomJ = geojson::GeometryCollection(
+      2, [](size_t i) { return geojson::Point(i, i + 1.5); });
+  EXPECT_EQ(nlohmann::json::parse(geomText), geomJ);
+
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::Feature(geomText, props)),
+            geojson::Feature(geomJ, props));
+  EXPECT_EQ(
+      nlohmann::json::parse(geojson::text::Feature("f\"oo", geomText, props)),
+      geojson::Feature("f\"oo", geomJ, props));
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::Feature(7, geomText, props)),
+            geojson::Feature(7, geomJ, props));
+
+  std::string str;
+  {
+    geojson::BasicFeatureCollectionWriter<geojson::StringSink> writer(str);
+    writer.WriteRaw(geojson::text::Feature(geomText, props));
+  }
+  EXPECT_EQ(nlohmann::json::parse(str),
+            geojson::FeatureCollection(1, [&](size_t) {
+              return geojson::Feature(geomJ, props);
+            }));
+}
+
+TEST(LibgeojsonTest, CoordinateFormatTest) {
+  EXPECT_THROW(geojson::CoordinateFormat::Fixed(-1), std::domain_error);
+  EXPECT_THROW(geojson::CoordinateFormat::Fixed(16), std::domain_error);
+  EXPECT_FALSE(geojson::CoordinateFormat().IsFixed());
+
+  auto format = geojson::CoordinateFormat::Fixed(6);
+  EXPECT_EQ(format.Round(-77.03653512345), -77.036535);
+  EXPECT_EQ(format.Round(1e300), 1e300);
+
+  EXPECT_TRUE(TestPoint(geojson::Point(-77.03653512345, 38.8976763, format),
+                        -77.036535, 38.897676));
+  EXPECT_EQ(geojson::Point(1.23456789, 2, 3.5, format).dump(),
+            "{\"coordinates\":[1.234568,2.0,3.5],\"type\":\"Point\"}");
+
+  std::vector<double> pts{0.1234565, -0.0000004, 179.9999999, -90.25};
+  auto getPoint = [&](size_t i, double& lon, double& lat) {
+    lon = pts[2 * i];
+    lat = pts[2 * i + 1];
+  };
+  EXPECT_EQ(geojson::text::LineString(2, getPoint, format),
+            "{\"type\":\"LineString\",\"coordinates\":"
+            "[[0.123457,0],[180,-90.25]]}");
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::LineString(2, getPoint, format)),
+            geojson::LineString(2, getPoint, format));
+  EXPECT_EQ(geojson::text::Point(-1.5, 2.25, geojson::CoordinateFormat::Fixed(0)),
+            "{\"type\":\"Point\",\"coordinates\":[-2,2]}");
+  EXPECT_EQ(geojson::text::Point(1e300, -12.5, format),
+            "{\"type\":\"Point\",\"coordinates\":[1e+300,-12.5]}");
+}
+
+TEST(LibgeojsonTest, PositionSpanTest) {
+  // Interleaved with an unused fourth value per position
+  std::vector<double> xyzw{0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1};
+  auto span3d = geojson::PositionSpan::Interleaved(xyzw.data(), 3, 3, 4);
+  auto getPoint3d = [&](size_t i, double& lon, double& lat, double& alt) {
+    lon = xyzw[4 * i];
+    lat = xyzw[4 * i + 1];
+    alt = xyzw[4 * i + 2];
+  };
+  EXPECT_EQ(geojson::MultiPoint(span3d), geojson::MultiPoint(3, getPoint3d));
+  EXPECT_EQ(geojson::LineString(span3d), geojson::LineString(3, getPoint3d));
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::LineString(span3d)),
+            geojson::LineString(3, getPoint3d));
+  EXPECT_THROW(geojson::LineString(span3d.Slice(0, 1)), std::domain_error);
+  EXPECT_THROW(span3d.Slice(2, 4), std::out_of_range);
+  EXPECT_THROW(geojson::PositionSpan::Interleaved(xyzw.data(), 3, 4),
+               std::domain_error);
+
+  std::vector<double> lons{0, 1, 2, 3, 4}, lats{0.5, 1.5, 2.5, 3.5, 4.5};
+  auto span2d = geojson::PositionSpan::Separate(lons.data(), lats.data(), 5);
+  std::vector<size_t> lineOffsets{0, 2, 5};
+  auto getLineLength = [&](size_t l) {
+    return lineOffsets[l + 1] - lineOffsets[l];
+  };
+  auto getLinePoint = [&](size_t l, size_t p, double& lon, double& lat) {
+    lon = lons[lineOffsets[l] + p];
+    lat = lats[lineOffsets[l] + p];
+  };
+  EXPECT_EQ(geojson::MultiLineString(span2d, lineOffsets.data(), 2),
+            geojson::MultiLineString(2, getLineLength, getLinePoint));
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::MultiLineString(
+                span2d, lineOffsets.data(), 2)),
+            geojson::MultiLineString(2, getLineLength, getLinePoint));
+  lineOffsets.back() = 6;
+  EXPECT_THROW(geojson::MultiLineString(span2d, lineOffsets.data(), 2),
+               std::out_of_range);
+}
+
+TEST(LibgeojsonTest, PositionSpanPolygonTest) {
+  // A CW outer ring of two polygons and a CW inner ring of the first one
+  std::vector<double> pts{0,   0,   0, 1.5, 1.5, 1.5, 1.5, 0,   0.25, 0.25,
+                          0.5, 0.25, 0.35, 0.75, 5, 5, 6, 6,   7,    5};
+  std::vector<size_t> polygonOffsets{0, 2, 3};
+  std::vector<size_t> ringOffsets{0, 4, 7, 10};
+  auto positions = geojson::PositionSpan::Interleaved(pts.data(), 10, 2);
+
+  auto getNumRings = [&](size_t poly) {
+    return polygonOffsets[poly + 1] - polygonOffsets[poly];
+  };
+  auto getRingLength = [&](size_t poly, size_t ring) {
+    size_t r = polygonOffsets[poly] + ring;
+    return ringOffsets[r + 1] - ringOffsets[r];
+  };
+  auto getPoint = [&](size_t poly, size_t ring, size_t pt, double& lon,
+                      double& lat) {
+    size_t idx = ringOffsets[polygonOffsets[poly] + ring] + pt;
+    lon = pts[2 * idx];
+    lat = pts[2 * idx + 1];
+  };
+
+  auto expected =
+      geojson::MultiPolygon(2, getNumRings, getRingLength, getPoint);
+  EXPECT_EQ(geojson::MultiPolygon(positions, polygonOffsets.data(), 2,
+                                  ringOffsets.data(), 3),
+            expected);
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::MultiPolygon(
+                positions, polygonOffsets.data(), 2, ringOffsets.data(), 3)),
+            expected);
+  // The last polygon ends past the 2 rings given
+  EXPECT_THROW(geojson::MultiPolygon(positions, polygonOffsets.data(), 2,
+                                     ringOffsets.data(), 2),
+               std::out_of_range);
+  EXPECT_THROW(geojson::text::MultiPolygon(positions, polygonOffsets.data(), 2,
+                                           ringOffsets.data(), 2),
+               std::out_of_range);
+
+  EXPECT_EQ(geojson::Polygon(positions, ringOffsets.data(), 2),
+            geojson::Polygon(
+                2, [&](size_t ring) { return getRingLength(0, ring); },
+                [&](size_t ring, size_t pt, double& lon, double& lat) {
+                  getPoint(0, ring, pt, lon, lat);
+                }));
+}
+
+TEST(LibgeojsonTest, DimensionTest) {
+  using geojson::detail::CallbackDims;
+  auto get2 = [](size_t, size_t, double&, double&) {};
+  auto get3 = [](size_t, size_t, double&, double&, double&) {};
+  static_assert(CallbackDims<decltype(get2), size_t, size_t>() == 2, "2D");
+  static_assert(CallbackDims<decltype(get3), size_t, size_t>() == 3, "3D");
+
+  // Rings to be rewound in 3D, given as callbacks and as a span
+  std::vector<double> pts{0,    0,    1, 0,   1.5,  2, 1.5,  1.5,  3,
+                          1.5,  0,    4, 0.25, 0.25, 5, 0.5,  0.25, 6,
+                          0.35, 0.75, 7, 5,    5,    8, 6,    6,    9,
+                          7,    5,    10};
+  std::vector<size_t> polygonOffsets{0, 2, 3};
+  std::vector<size_t> ringOffsets{0, 4, 7, 10};
+  auto positions = geojson::PositionSpan::Interleaved(pts.data(), 10, 3);
+  size_t numReads = 0;
+  auto getNumRings = [&](size_t poly) {
+    return polygonOffsets[poly + 1] - polygonOffsets[poly];
+  };
+  auto getRingLength = [&](size_t poly, size_t ring) {
+    size_t r = polygonOffsets[poly] + ring;
+    return ringOffsets[r + 1] - ringOffsets[r];
+  };
+  auto getPoint = [&](size_t poly, size_t ring, size_t pt, double& lon,
+                      double& lat, double& alt) {
+    numReads++;
+    size_t idx = ringOffsets[polygonOffsets[poly] + ring] + pt;
+    lon = pts[3 * idx];
+    lat = pts[3 * idx + 1];
+    alt = pts[3 * idx + 2];
+  };
+
+  // Each position is read once for the winding and once to be written
+  auto expected =
+      geojson::MultiPolygon(2, getNumRings, getRingLength, getPoint);
+  EXPECT_EQ(numReads, 20u);
+  EXPECT_EQ(expected["coordinates"][0][0][0], nlohmann::json({1.5, 0, 4}));
+  EXPECT_EQ(expected["coordinates"][0][1][0], nlohmann::json({0.35, 0.75, 7}));
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::MultiPolygon(
+                2, getNumRings, getRingLength, getPoint)),
+            expected);
+  EXPECT_EQ(numReads, 40u);
+  EXPECT_EQ(geojson::MultiPolygon(positions, polygonOffsets.data(), 2,
+                                  ringOffsets.data(), 3),
+            expected);
+  EXPECT_EQ(geojson::Geometry(geojson::FlatGeometry::MultiPolygon(
+                2, getNumRings, getRingLength, getPoint)),
+            expected);
+
+  // Dropping the altitudes takes the 2D kernel
+  auto flat = [&](size_t poly, size_t ring, size_t pt, double& lon,
+                  double& lat) {
+    double alt;
+    getPoint(poly, ring, pt, lon, lat, alt);
+  };
+  auto expected2D =
+      geojson::MultiPolygon(2, getNumRings, getRingLength, flat);
+  EXPECT_EQ(expected2D["coordinates"][0][0][0], nlohmann::json({1.5, 0}));
+  EXPECT_EQ(geojson::text::MultiPolygon(2, getNumRings, getRingLength, flat),
+            geojson::text::MultiPolygon(
+                geojson::PositionSpan::Interleaved(pts.data(), 10, 2, 3),
+                polygonOffsets.data(), 2, ringOffsets.data(), 3));
+}
+
+TEST(LibgeojsonTest, InstrumentationTest) {
+  using geojson::CountingInstrumentation;
+
+  // A CW ring that is reversed to be an exterior ring, and read slowly once
+  std::vector<double> ring{0, 0, 0, 1, 1, 1, 1, 0};
+  size_t numReads = 0;
+  auto getRingLength = [](size_t) -> size_t { return 4; };
+  auto getPoint = [&](size_t, size_t pt, double& lon, double& lat) {
+    if (numReads++ == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    lon = ring[2 * pt];
+    lat = ring[2 * pt + 1];
+  };
+
+  auto before = CountingInstrumentation::ThreadCounters();
+  auto polygon = geojson::Polygon(1, getRingLength, getPoint);
+  auto counters = CountingInstrumentation::ThreadCounters() - before;
+  EXPECT_EQ(counters.vertices, 5u);
+  EXPECT_EQ(counters.ringsReversed, 1u);
+  EXPECT_EQ(counters.bytesWritten, 0u);
+  EXPECT_GE(counters.allocations, 2u);
+  EXPECT_GE(counters.allocatedBytes, 6 * sizeof(nlohmann::json));
+  EXPECT_GE(counters.callbackNanos, 2000000u);
+
+  // The text encoders count the same positions and rings
+  before = CountingInstrumentation::ThreadCounters();
+  EXPECT_EQ(nlohmann::json::parse(
+                geojson::text::Polygon(1, getRingLength, getPoint)),
+            polygon);
+  counters = CountingInstrumentation::ThreadCounters() - before;
+  EXPECT_EQ(counters.vertices, 5u);
+  EXPECT_EQ(counters.ringsReversed, 1u);
+  EXPECT_GE(counters.allocations, 1u);
+
+  // Reading a span is library code, with no callback time
+  size_t ringOffsets[] = {0, 4};
+  before = CountingInstrumentation::ThreadCounters();
+  auto span = geojson::PositionSpan::Interleaved(ring.data(), 4, 2);
+  EXPECT_EQ(geojson::Polygon(span, ringOffsets, 1), polygon);
+  counters = CountingInstrumentation::ThreadCounters() - before;
+  EXPECT_EQ(counters.vertices, 5u);
+  EXPECT_EQ(counters.callbackNanos, 0u);
+
+  // Sinks count what they write, and other threads are in the totals
+  std::string out;
+  auto total = CountingInstrumentation::TotalCounters();
+  std::thread thread([&] {
+    geojson::BasicFeatureCollectionWriter<geojson::StringSink> writer(out);
+    writer.Write(geojson::Feature(polygon, nlohmann::json::object()));
+    writer.Close();
+  });
+  thread.join();
+  total = CountingInstrumentation::TotalCounters() - total;
+  EXPECT_EQ(total.bytesWritten, out.size());
+  EXPECT_EQ(total.ringsReversed, 0u);
+}
+
+TEST(LibgeojsonTest, TextReserveTest) {
+  // The longest numbers in each format must still fit in the reserved space
+  std::vector<double> worst{-2.2250738585072014e-308, -1.7976931348623157e+308,
+                            -9007199254.740991, -0.000001};
+  auto getPoint = [&](size_t ring, size_t pt, double& lon, double& lat,
+                      double& alt) {
+    lon = worst[(ring + pt) % 4];
+    lat = worst[(ring + pt + 1) % 4];
+    alt = -worst[(ring + pt + 2) % 4] * (pt + 1);
+  };
+  auto getRingLength = [](size_t ring) -> size_t { return 50 + ring; };
+
+  for (auto format : {geojson::CoordinateFormat(),
+                      geojson::CoordinateFormat::Fixed(6)}) {
+    std::string str;
+    geojson::text::detail::TextWriter out(str, format);
+    size_t numPositions = 3 + getRingLength(0) + getRingLength(1) +
+                          getRingLength(2);
+    geojson::text::detail::ReserveCoordinatesObject(out, numPositions, 4, 3);
+    size_t capacity = str.capacity();
+
+    geojson::text::detail::WriteCoordinatesObjectBegin<geojson::Type::Polygon>(
+        out);
+    geojson::text::detail::WritePolygonCoordinates(out, 3, getRingLength,
+                                                   getPoint);
+    geojson::text::detail::WriteObjectEnd(out);
+    EXPECT_EQ(str.capacity(), capacity);
+    EXPECT_EQ(str, geojson::text::Polygon(3, getRingLength, getPoint, format));
+  }
+
+  // The reserved space is estimated without asking for any length twice
+  size_t numCalls = 0;
+  auto countedLength = [&](size_t ring) -> size_t {
+    numCalls++;
+    return getRingLength(ring);
+  };
+  geojson::text::Polygon(3, countedLength, getPoint);
+  EXPECT_EQ(numCalls, 3);
+  numCalls = 0;
+  geojson::text::MultiLineString(3, countedLength, getPoint);
+  EXPECT_EQ(numCalls, 3);
+  numCalls = 0;
+  geojson::text::MultiPolygon(
+      2,
+      [&](size_t) -> size_t {
+        numCalls++;
+        return 3;
+      },
+      [&](size_t, size_t ring) { return countedLength(ring); },
+      [&](size_t, size_t ring, size_t pt, double& lon, double& lat,
+          double& alt) { getPoint(ring, pt, lon, lat, alt); });
+  EXPECT_EQ(numCalls, 2 + 2 * 3);
+}
+
+TEST(LibgeojsonTest, ArenaTest) {
+  std::vector<Pt3D> pts{Pt3D(1, 2, 3), Pt3D(2, 3, 4), Pt3D(3, 4, 5)};
+  std::vector<double> ring{0, 0, 1, 0, 1, 1, 0, 1};
+  size_t offsets[] = {0, 4};
+  auto span = geojson::PositionSpan::Interleaved(ring.data(), 4, 2);
+
+  auto getFeature = [&](size_t i) -> nlohmann::json {
+    return geojson::Feature(i, geojson::Point(pts[i].x, pts[i].y, pts[i].z),
+                            nlohmann::json(Props("bar", pts[i].x)));
+  };
+  auto expected = geojson::FeatureCollection(pts.size(), getFeature);
+  auto expectedPolygon = geojson::Polygon(span, offsets, 1);
+
+  geojson::MonotonicArena arena(256);
+  {
+    geojson::ArenaScope scope(arena);
+    auto j = geojson::FeatureCollection<geojson::ArenaJson>(
+        pts.size(), [&](size_t i) {
+          return geojson::Feature(
+              i, geojson::Point<geojson::ArenaJson>(pts[i].x, pts[i].y,
+                                                    pts[i].z),
+              nlohmann::json(Props("bar", pts[i].x)));
+        });
+    EXPECT_EQ(j.dump(), expected.dump());
+    EXPECT_EQ(geojson::Polygon<geojson::ArenaJson>(span, offsets, 1).dump(),
+              expectedPolygon.dump());
+
+    std::string str;
+    {
+      geojson::BasicFeatureCollectionWriter<geojson::StringSink> writer(str);
+      for (const auto& feature : j["features"]) writer.Write(feature);
+    }
+    EXPECT_EQ(nlohmann::json::parse(str), expected);
+  }
+  EXPECT_GT(arena.BytesUsed(), 0u);
+  EXPECT_GE(arena.BytesReserved(), arena.BytesUsed());
+
+  // Arena values can only be built inside of a scope
+  EXPECT_THROW(geojson::Point<geojson::ArenaJson>(1, 2), std::logic_error);
+
+  arena.Release();
+  EXPECT_EQ(arena.BytesUsed(), 0u);
+  EXPECT_EQ(arena.BytesReserved(), 0u);
+}
+
+TEST(LibgeojsonTest, ParallelFeatureCollectionTest) {
+  const size_t numFeatures = 1000;
+  auto getFeature = [](size_t i) -> nlohmann::json {
+    return geojson::Feature(i, geojson::Point(i * 0.001, -(i * 0.002)),
+                            nlohmann::json(Props("bar", i * 0.5)));
+  };
+  auto getText = [](size_t i) {
+    return geojson::text::Feature(
+        i, geojson::text::Point(i * 0.001, -(i * 0.002)),
+        nlohmann::json(Props("bar", i * 0.5)));
+  };
+
+  std::string sequential;
+  geojson::WriteFeatureCollection(sequential, numFeatures, getFeature);
+
+  for (size_t chunkSize : {1, 7, 64, 5000}) {
+    std::string str;
+    geojson::WriteFeatureCollectionParallel(str, numFeatures, getFeature, 4,
+                                            chunkSize);
+    EXPECT_EQ(str, sequential);
+
+    std::ostringstream os;
+    geojson::WriteFeatureCollectionParallel(os, numFeatures, getText, 3,
+                                            chunkSize);
+    EXPECT_EQ(nlohmann::json::parse(os.str()),
+              nlohmann::json::parse(sequential));
+  }
+
+  // A single thread and an empty collection
+  std::string str;
+  geojson::WriteFeatureCollectionParallel(str, numFeatures, getFeature, 1);
+  EXPECT_EQ(str, sequential);
+  str.clear();
+  geojson::WriteFeatureCollectionParallel(str, 0, getFeature);
+  EXPECT_EQ(str, "{\"type\":\"FeatureCollection\",\"features\":[]}");
+
+  // Tasks given to an executor
+  std::vector<std::thread> threads;
+  str.clear();
+  geojson::WriteFeatureCollectionParallel(
+      str, numFeatures, getFeature,
+      [&](std::function<void()> task) {
+        threads.emplace_back(std::move(task));
+      },
+      2, 10);
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(str, sequential);
+
+  // An executor that runs the tasks inline, or never, does not deadlock
+  size_t numTasks = 0;
+  str.clear();
+  geojson::WriteFeatureCollectionParallel(
+      str, numFeatures, getFeature,
+      [&](std::function<void()> task) {
+        numTasks++;
+        task();
+      },
+      2, 10);
+  EXPECT_EQ(str, sequential);
+  EXPECT_GT(numTasks, 1u);
+  str.clear();
+  geojson::WriteFeatureCollectionParallel(
+      str, numFeatures, getFeature, [](std::function<void()>) {}, 2, 10);
+  EXPECT_EQ(str, sequential);
+
+  // The first error in index order is rethrown
+  str.clear();
+  EXPECT_THROW(geojson::WriteFeatureCollectionParallel(
+                   str, numFeatures,
+                   [&](size_t i) {
+                     if (i >= 500) throw std::domain_error("bad feature");
+                     return getFeature(i);
+                   },
+                   4, 16),
+               std::domain_error);
+}
+
+TEST(LibgeojsonTest, FeatureMoveTest) {
+  std::vector<double> pts{0, 0, 1, 0, 1, 1};
+  auto span = geojson::PositionSpan::Interleaved(pts.data(), 3, 2);
+  nlohmann::json props(Props("bar", 4.3));
+
+  // Copies leave the arguments as they were
+  auto geomJ = geojson::LineString(span);
+  auto copied = geojson::Feature("foo", geomJ, props);
+  EXPECT_TRUE(TestFeature(copied, geomJ, props));
+  EXPECT_EQ(copied["id"], "foo");
+  EXPECT_EQ(geomJ, geojson::LineString(span));
+
+  // Moves reuse the geometry and properties
+  const auto* coords =
+      geomJ["coordinates"].get_ref<nlohmann::json::array_t&>().data();
+  const auto* name = props["name"].get_ptr<std::string*>();
+  auto moved = geojson::Feature(7, std::move(geomJ), std::move(props));
+  EXPECT_EQ(moved["geometry"]["coordinates"]
+                .get_ref<nlohmann::json::array_t&>()
+                .data(),
+            coords);
+  EXPECT_EQ(moved["properties"]["name"].get_ptr<std::string*>(), name);
+  EXPECT_EQ(moved["id"], 7);
+  EXPECT_EQ(moved["type"], "Feature");
+  EXPECT_EQ(moved, geojson::Feature(7, geojson::LineString(span),
+                                    nlohmann::json(Props("bar", 4.3))));
+
+  // Features without an ID do not get one
+  EXPECT_FALSE(geojson::Feature(geojson::LineString(span), nullptr)
+                   .contains("id"));
+
+  // A feature may have a null geometry (section 3.2), or one in braces
+  auto unlocated = geojson::Feature(nullptr, props);
+  EXPECT_EQ(unlocated["type"], "Feature");
+  EXPECT_TRUE(unlocated["geometry"].is_null());
+  EXPECT_FALSE(unlocated.contains("bbox"));
+  EXPECT_EQ(geojson::Feature("foo", nullptr, props)["id"], "foo");
+  EXPECT_TRUE(geojson::Feature(3, nullptr, props)["geometry"].is_null());
+  EXPECT_EQ(geojson::Feature({{"type", "Point"}, {"coordinates", {1, 2}}},
+                             props)["geometry"],
+            geojson::Point(1, 2));
+  EXPECT_EQ(geojson::Feature(7, {{"type", "Point"}, {"coordinates", {1, 2}}},
+                             props)["id"],
+            7);
+}
+
+// Records the events of Read() as strings
+struct RecordingHandler : public geojson::ReaderHandler {
+  void OnFeatureCollectionBegin() { events.push_back("collection"); }
+  void OnFeatureCollectionEnd() { events.push_back("/collection"); }
+  void OnFeatureBegin(size_t i) {
+    events.push_back("feature " + std::to_string(i));
+  }
+  void OnFeatureEnd(size_t i) {
+    events.push_back("/feature " + std::to_string(i));
+  }
+  void OnId(const nlohmann::json& id) { ids.push_back(id); }
+  void OnProperties(nlohmann::json&& props) {
+    properties.push_back(std::move(props));
+  }
+  void OnGeometryBegin(geojson::Type type) {
+    events.push_back(geojson::TypeName(type));
+  }
+  void OnGeometryEnd(geojson::Type type) {
+    events.push_back(std::string("/") + geojson::TypeName(type));
+  }
+  void OnPosition(double lon, double lat, double alt) {
+    std::ostringstream os;
+    os << lon << " " << lat;
+    if (!std::isnan(alt)) os << " " << alt;
+    events.push_back(os.str());
+  }
+  void OnLineEnd() { events.push_back("/line"); }
+  void OnRingEnd() { events.push_back("/ring"); }
+  void OnPolygonEnd() { events.push_back("/polygon"); }
+
+  std::vector<std::string> events;
+  std::vector<nlohmann::json> ids;
+  std::vector<nlohmann::json> properties;
+};
+
+TEST(LibgeojsonTest, ReaderTest) {
+  using Events = std::vector<std::string>;
+  std::vector<double> square{0, 0, 1, 0, 1, 1};
+  std::vector<double> line{0, 0, 10, 2, 3, 4, 5, 6};
+  auto ring = geojson::PositionSpan::Interleaved(square.data(), 3, 2);
+  auto spans = geojson::PositionSpan::Interleaved(line.data(), 2, 3);
+  std::vector<size_t> ringOffsets{0, 3, 6};
+  std::vector<size_t> polyOffsets{0, 2};
+  std::vector<double> twoRings(square);
+  twoRings.insert(twoRings.end(), square.begin(), square.end());
+  auto rings = geojson::PositionSpan::Interleaved(twoRings.data(), 6, 2);
+
+  auto getFeature = [&](size_t i) -> nlohmann::json {
+    switch (i) {
+      case 0:
+        return geojson::Feature("a",
+                                geojson::Polygon(ring, ringOffsets.data(), 1),
+                                nlohmann::json(Props("bar", 1.5)));
+      case 1:
+        return geojson::Feature(
+            7,
+            geojson::MultiPolygon(rings, polyOffsets.data(), 1,
+                                  ringOffsets.data(), 2),
+            nullptr);
+      default:
+        return geojson::Feature(
+            geojson::GeometryCollection(2,
+                                        [&](size_t j) -> nlohmann::json {
+                                          if (j == 0) {
+                                            return geojson::Point(1, 2, 3);
+                                          }
+                                          return geojson::LineString(spans);
+                                        }),
+            nlohmann::json::array({1, "x"}));
+    }
+  };
+  Events expected{"collection",
+                  "feature 0",
+                  "Polygon",
+                  "0 0", "1 0", "1 1", "0 0", "/ring",
+                  "/Polygon",
+                  "/feature 0",
+                  "feature 1",
+                  "MultiPolygon",
+                  "0 0", "1 0", "1 1", "0 0", "/ring",
+                  "1 1", "1 0", "0 0", "1 1", "/ring", "/polygon",
+                  "/MultiPolygon",
+                  "/feature 1",
+                  "feature 2",
+                  "GeometryCollection",
+                  "Point", "1 2 3", "/Point",
+                  "LineString", "0 0 10", "2 3 4", "/LineString",
+                  "/GeometryCollection",
+                  "/feature 2",
+                  "/collection"};
+
+  // The DOM dumps the members in sorted order, so it has coordinates before
+  // types, and writer output has them after
+  std::string text;
+  geojson::WriteFeatureCollection(text, 3, getFeature);
+  auto dom = geojson::FeatureCollection(3, getFeature);
+  for (const std::string& input : {text, dom.dump()}) {
+    RecordingHandler handler;
+    geojson::Read(input, handler);
+    EXPECT_EQ(handler.events, expected);
+    EXPECT_EQ(handler.ids,
+              std::vector<nlohmann::json>({nlohmann::json("a"),
+                                           nlohmann::json(7)}));
+    EXPECT_EQ(handler.properties,
+              std::vector<nlohmann::json>(
+                  {nlohmann::json(Props("bar", 1.5)), nlohmann::json(),
+                   nlohmann::json::array({1, "x"})}));
+  }
+
+  // Features and geometries on their own, from a stream
+  std::vector<double> lines{0, 0, 1, 1, 2, 2, 3, 3};
+  std::vector<size_t> lineOffsets{0, 2, 4};
+  std::istringstream is(
+      geojson::Feature(geojson::MultiLineString(
+                           geojson::PositionSpan::Interleaved(lines.data(),
+                                                              4, 2),
+                           lineOffsets.data(), 2),
+                       nullptr)
+          .dump());
+  RecordingHandler handler;
+  geojson::Read(is, handler);
+  EXPECT_EQ(handler.events,
+            Events({"feature 0", "MultiLineString", "0 0", "1 1", "/line",
+                    "2 2", "3 3", "/line", "/MultiLineString", "/feature 0"}));
+
+  handler = RecordingHandler();
+  geojson::Read(R"({"bbox": [0, 0, 1, 1], "type": "MultiPoint",
+                    "coordinates": [[0, 0], [1.5, -2]], "foo": {"a": [1]}})",
+                handler);
+  EXPECT_EQ(handler.events,
+            Events({"MultiPoint", "0 0", "1.5 -2", "/MultiPoint"}));
+
+  // Errors
+  EXPECT_THROW(geojson::Read("[1, 2]", handler), std::domain_error);
+  EXPECT_THROW(geojson::Read(R"({"foo": 1})", handler), std::domain_error);
+  EXPECT_THROW(geojson::Read(R"({"coordinates": [0, 0]})", handler),
+               std::domain_error);
+  EXPECT_THROW(
+      geojson::Read(R"({"type": "Circle", "coordinates": [0, 0]})", handler),
+      std::domain_error);
+  EXPECT_THROW(
+      geojson::Read(R"({"type": "Point", "coordinates": [[0, 0]]})", handler),
+      std::domain_error);
+  EXPECT_THROW(
+      geojson::Read(R"({"type": "LineString", "coordinates": [0, 0]})",
+                    handler),
+      std::domain_error);
+  EXPECT_THROW(
+      geojson::Read(R"({"type": "Point", "coordinates": [0]})", handler),
+      std::domain_error);
+  EXPECT_THROW(geojson::Read(R"({"type": "Point", "coordinates": [0, )",
+                             handler),
+               nlohmann::json::parse_error);
+}
+
+TEST(LibgeojsonTest, RawJsonTest) {
+  std::string text =
+      R"({"name": "a\"bé😀", "n": -1.5e2, "plain": "xyz",)"
+      R"( "nested": {"name": 1}, "list": [1, {"a": "]"}], "z": null})";
+  geojson::RawJson raw{geojson::StringView(text)};
+  ASSERT_TRUE(raw.IsObject());
+
+  geojson::RawJson name = raw.Find("name");
+  EXPECT_TRUE(name.IsString());
+  EXPECT_TRUE(name.HasEscapes());
+  EXPECT_EQ(name.String(), "a\"b\xc3\xa9\xf0\x9f\x98\x80");
+  EXPECT_EQ(name.String(), name.Parse().get<std::string>());
+
+  // Strings without escapes are views of the text
+  geojson::StringView plain = raw.Find("plain").Unquoted();
+  EXPECT_EQ(plain, "xyz");
+  EXPECT_GT(plain.Data(), text.data());
+  EXPECT_LT(plain.Data(), text.data() + text.size());
+  EXPECT_FALSE(raw.Find("plain").HasEscapes());
+
+  EXPECT_DOUBLE_EQ(raw.Find("n").Number(), -150);
+  EXPECT_EQ(raw.Find("nested").Text(), R"({"name": 1})");
+  EXPECT_EQ(raw.Find("list").Parse(),
+            nlohmann::json::parse(R"([1, {"a": "]"}])"));
+  EXPECT_TRUE(raw.Find("z").IsNull());
+  EXPECT_TRUE(raw.Find("missing").Missing());
+  EXPECT_EQ(raw.Parse(), nlohmann::json::parse(text));
+
+  EXPECT_THROW(raw.Find("n").Unquoted(), std::domain_error);
+  EXPECT_THROW(raw.Find("plain").Number(), std::domain_error);
+  EXPECT_THROW(name.Find("name"), std::domain_error);
+  EXPECT_THROW(geojson::RawJson(geojson::StringView(R"({"a": "b)")).Find("x"),
+               nlohmann::json::parse_error);
+}
+
+// Keeps features whose "keep" property is true, reading only their geometries
+struct FilteringHandler : public geojson::ReaderHandler {
+  void OnRawId(const geojson::RawJson& id) { ids.push_back(id.Text()); }
+  void OnRawProperties(const geojson::RawJson& props) {
+    if (props.Find("keep").Text() == "true") {
+      names.push_back(props.Find("name").Unquoted());
+      geojson::Read(geometry.Text().begin(), geometry.Text().end(), positions);
+    }
+  }
+  void OnRawGeometry(const geojson::RawJson& geom) { geometry = geom; }
+
+  std::vector<geojson::StringView> ids;
+  std::vector<geojson::StringView> names;
+  geojson::RawJson geometry;
+  RecordingHandler positions;
+};
+
+TEST(LibgeojsonTest, MappedReaderTest) {
+  auto getFeature = [](size_t i) {
+    nlohmann::json props{{"keep", i % 2 == 0},
+                         {"name", "f" + std::to_string(i)}};
+    return geojson::text::Feature(
+        i, geojson::text::Point(i, -static_cast<double>(i)), props);
+  };
+  std::string path = ::testing::TempDir() + "libgeojson_mapped.geojson";
+  {
+    std::ofstream os(path);
+    geojson::FeatureCollectionWriter writer(os);
+    for (size_t i = 0; i < 5; i++) writer.WriteRaw(getFeature(i));
+  }
+
+  geojson::MappedFile file(path);
+  FilteringHandler handler;
+  geojson::Read(file.Data(), file.Data() + file.Size(), handler);
+  ASSERT_EQ(handler.ids.size(), 5);
+  EXPECT_EQ(handler.ids[3], "3");
+  EXPECT_GE(handler.ids[3].Data(), file.Data());
+  EXPECT_LT(handler.ids[3].Data(), file.Data() + file.Size());
+  EXPECT_EQ(handler.names,
+            std::vector<geojson::StringView>({"f0", "f2", "f4"}));
+  EXPECT_EQ(handler.positions.events,
+            std::vector<std::string>({"Point", "0 -0", "/Point", "Point",
+                                      "2 -2", "/Point", "Point", "4 -4",
+                                      "/Point"}));
+
+  // Handlers without raw events get the parsed members
+  RecordingHandler recorder;
+  geojson::ReadFile(path, recorder);
+  std::ifstream is(path);
+  RecordingHandler expected;
+  geojson::Read(is, expected);
+  EXPECT_EQ(recorder.events, expected.events);
+  EXPECT_EQ(recorder.ids, expected.ids);
+  EXPECT_EQ(recorder.properties, expected.properties);
+  EXPECT_EQ(recorder.events.size(), 27);
+
+  std::remove(path.c_str());
+  EXPECT_THROW(geojson::MappedFile file2(path), std::system_error);
+}
+
+TEST(LibgeojsonTest, SequenceTest) {
+  auto getFeature = [](size_t i) -> nlohmann::json {
+    return geojson::Feature(i, geojson::Point(i * 0.5, -(i * 0.25)),
+                            nlohmann::json(Props("bar", i * 0.5)));
+  };
+  const size_t numFeatures = 20;
+
+  std::string text;
+  geojson::WriteSequence(text, numFeatures, getFeature);
+  std::string first = getFeature(0).dump();
+  EXPECT_EQ(text.substr(0, first.size() + 2), "\x1e" + first + "\n");
+
+  RecordingHandler expected;
+  for (size_t i = 0; i < numFeatures; i++) {
+    std::string feature = getFeature(i).dump();
+    geojson::Read(feature, expected);
+  }
+  // Each Read() numbers its features from 0
+  auto renumber = [](std::vector<std::string> events) {
+    for (auto& event : events) {
+      if (event.find("feature") != std::string::npos) {
+        event = event.substr(0, event.find(' '));
+      }
+    }
+    return events;
+  };
+
+  RecordingHandler handler;
+  geojson::ReadSequence(text, handler);
+  EXPECT_EQ(renumber(handler.events), renumber(expected.events));
+  EXPECT_EQ(handler.events.back(), "/feature 19");
+  EXPECT_EQ(handler.properties, expected.properties);
+
+  // Newline-delimited, from a stream, with blank lines and CRLFs
+  std::ostringstream os;
+  geojson::SequenceWriter writer(os, false);
+  for (size_t i = 0; i < numFeatures; i++) {
+    writer.Write(getFeature(i));
+    if (i == 5) os << "\r\n\n";
+  }
+  EXPECT_EQ(writer.NumFeatures(), numFeatures);
+  EXPECT_EQ(os.str().find('\x1e'), std::string::npos);
+  std::istringstream is(os.str());
+  handler = RecordingHandler();
+  geojson::ReadSequence(is, handler);
+  EXPECT_EQ(handler.events.back(), "/feature 19");
+  EXPECT_EQ(renumber(handler.events), renumber(expected.events));
+
+  // Appending to a sequence continues it
+  std::string appended;
+  geojson::WriteSequence(appended, 10, getFeature);
+  geojson::WriteSequence(appended, 10, [&](size_t i) {
+    return getFeature(i + 10);
+  });
+  EXPECT_EQ(appended, text);
+
+  // Splitting at arbitrary offsets gives whole records
+  for (const std::string& input : {text, os.str()}) {
+    geojson::StringView view(input);
+    std::vector<std::string> events;
+    size_t numParts = 7;
+    for (size_t part = 0; part < numParts; part++) {
+      size_t begin =
+          geojson::SequenceRecordStart(view, part * input.size() / numParts);
+      size_t end = geojson::SequenceRecordStart(
+          view, (part + 1) * input.size() / numParts);
+      RecordingHandler partHandler;
+      geojson::ReadSequence(input.data() + begin, input.data() + end,
+                            partHandler);
+      events.insert(events.end(), partHandler.events.begin(),
+                    partHandler.events.end());
+    }
+    EXPECT_EQ(renumber(events), renumber(expected.events));
+  }
+  EXPECT_EQ(geojson::SequenceRecordStart(geojson::StringView(text), 1),
+            first.size() + 2);
+  EXPECT_EQ(geojson::SequenceRecordStart(geojson::StringView(text),
+                                         text.size() - 1),
+            text.size());
+
+  // A truncated record
+  std::string truncated = text.substr(0, text.size() - 10);
+  EXPECT_THROW(geojson::ReadSequence(truncated, handler),
+               nlohmann::json::parse_error);
+}
+
+TEST(LibgeojsonTest, AppendTest) {
+  auto getFeature = [](size_t i) -> nlohmann::json {
+    return geojson::Feature(i, geojson::Point(i * 0.5, -(i * 0.25)),
+                            nlohmann::json(Props("bar", i * 0.5)));
+  };
+  auto readFile = [](const std::string& path) {
+    std::ifstream is(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(is), {});
+  };
+  std::string path = ::testing::TempDir() + "libgeojson_append.geojson";
+  std::string indexPath = path + ".idx";
+  std::remove(path.c_str());
+  std::remove(indexPath.c_str());
+
+  // An existing collection, with whitespace after its brackets
+  {
+    std::ofstream os(path);
+    geojson::FeatureCollectionWriter writer(os);
+    for (size_t i = 0; i < 3; i++) writer.Write(getFeature(i));
+    writer.Close();
+    os << " \n\n\n\n\n\n\n\n\n\n\n";
+  }
+  {
+    geojson::FeatureAppender appender(path);
+    appender.Write(getFeature(3));
+    appender.Flush();
+    EXPECT_EQ(nlohmann::json::parse(readFile(path))["features"].size(), 4u);
+    appender.Write(getFeature(4));
+    EXPECT_EQ(appender.NumFeatures(), 2u);
+    EXPECT_TRUE(appender.Extents().empty());
+    EXPECT_THROW(appender.Remove(0), std::logic_error);
+  }
+  auto collection = nlohmann::json::parse(readFile(path));
+  ASSERT_EQ(collection["features"].size(), 5u);
+  EXPECT_EQ(collection["features"][4], getFeature(4));
+
+  // The index is built by scanning the file, then kept up to date
+  {
+    geojson::FeatureAppender appender(
+        path, geojson::AppendFormat::FeatureCollection, indexPath);
+    ASSERT_EQ(appender.Extents().size(), 5u);
+    appender.Write(getFeature(5));
+    appender.Replace(1, getFeature(9));
+    appender.Replace(2, getFeature(1000000));
+    appender.Remove(3);
+    EXPECT_THROW(appender.Remove(6), std::out_of_range);
+  }
+  std::string text = readFile(path);
+  collection = nlohmann::json::parse(text);
+  ASSERT_EQ(collection["features"].size(), 7u);
+  EXPECT_EQ(collection["features"][1], getFeature(9));
+  EXPECT_EQ(collection["features"][3]["geometry"], nullptr);
+  EXPECT_EQ(collection["features"][6], getFeature(1000000));
+
+  auto extents = geojson::ReadOffsetIndex(indexPath);
+  ASSERT_EQ(extents.size(), 6u);
+  auto featureAt = [&](size_t i) {
+    return nlohmann::json::parse(text.substr(
+        static_cast<size_t>(extents[i].offset), extents[i].size));
+  };
+  EXPECT_EQ(featureAt(1), getFeature(9));
+  EXPECT_EQ(featureAt(2), getFeature(1000000));
+  EXPECT_EQ(extents[3].removed, 1u);
+  EXPECT_EQ(featureAt(5), getFeature(5));
+
+  // Writing without the index makes it out of date, so it is rebuilt
+  geojson::FeatureAppender(path).Write(getFeature(6));
+  {
+    geojson::FeatureAppender appender(
+        path, geojson::AppendFormat::FeatureCollection, indexPath);
+    ASSERT_EQ(appender.Extents().size(), 8u);
+    EXPECT_EQ(appender.Extents()[3].removed, 1u);
+  }
+  std::remove(path.c_str());
+  std::remove(indexPath.c_str());
+
+  // Sequences have records added at the end, and removed ones left blank
+  {
+    geojson::FeatureAppender appender(path, geojson::AppendFormat::Sequence,
+                                      indexPath);
+    for (size_t i = 0; i < 3; i++) appender.Write(getFeature(i));
+    appender.Remove(1);
+  }
+  std::string expected;
+  geojson::WriteSequence(expected, 3, getFeature);
+  auto removed = getFeature(1).dump();
+  expected.replace(expected.find(removed), removed.size(),
+                   std::string(removed.size(), ' '));
+  EXPECT_EQ(readFile(path), expected);
+  RecordingHandler handler;
+  geojson::ReadSequence(expected, handler);
+  EXPECT_EQ(handler.events.back(), "/feature 1");
+  EXPECT_THROW(
+      geojson::FeatureAppender(path, geojson::AppendFormat::NewlineDelimited),
+      std::domain_error);
+  std::remove(path.c_str());
+  std::remove(indexPath.c_str());
+
+  // Only collections ending with the features array can be appended to
+  {
+    std::ofstream os(path);
+    os << R"({"features":[],"type":"FeatureCollection"})";
+  }
+  EXPECT_THROW(geojson::FeatureAppender appender(path), std::domain_error);
+  std::remove(path.c_str());
+}
+
+TEST(LibgeojsonTest, ParallelReaderTest) {
+  const size_t numFeatures = 500;
+  auto getFeature = [](size_t i) -> nlohmann::json {
+    return geojson::Feature(i, geojson::Point(i * 0.5, -(i * 0.25)),
+                            nlohmann::json(Props("bar", i * 0.5)));
+  };
+  std::string collection, sequence;
+  geojson::WriteFeatureCollection(collection, numFeatures, getFeature);
+  geojson::WriteSequence(sequence, numFeatures, getFeature);
+  // Members around the features are skipped
+  collection.insert(1, R"("bbox": [0, -1, 1, 0], )");
+
+  RecordingHandler expected;
+  geojson::ReadSequence(sequence, expected);
+
+  auto makeHandler = [](size_t) { return RecordingHandler(); };
+  auto positions = [](const std::vector<RecordingHandler>& handlers) {
+    std::vector<std::string> events;
+    for (const auto& handler : handlers) {
+      for (const auto& event : handler.events) {
+        if (event.find(' ') != std::string::npos &&
+            event.find("feature") == std::string::npos) {
+          events.push_back(event);
+        }
+      }
+    }
+    return events;
+  };
+  auto ids = [](const std::vector<RecordingHandler>& handlers) {
+    std::vector<nlohmann::json> all;
+    for (const auto& handler : handlers) {
+      all.insert(all.end(), handler.ids.begin(), handler.ids.end());
+    }
+    return all;
+  };
+  std::vector<RecordingHandler> whole{expected};
+
+  for (size_t chunkSize : {1, 100, 1000, 1 << 20}) {
+    auto handlers = geojson::ReadSequenceParallel(
+        sequence.data(), sequence.data() + sequence.size(), makeHandler, 4,
+        chunkSize);
+    EXPECT_EQ(positions(handlers), positions(whole));
+    EXPECT_EQ(ids(handlers), ids(whole));
+    if (chunkSize == 1) {
+      EXPECT_EQ(handlers.size(), numFeatures);
+    }
+
+    handlers = geojson::ReadFeatureCollectionParallel(
+        collection.data(), collection.data() + collection.size(),
+        makeHandler, 3, chunkSize);
+    EXPECT_EQ(positions(handlers), positions(whole));
+    EXPECT_EQ(ids(handlers), ids(whole));
+    for (const auto& handler : handlers) {
+      EXPECT_EQ(handler.events.front(), "feature 0");
+    }
+  }
+
+  // Tasks given to an executor
+  std::vector<std::thread> threads;
+  auto handlers = geojson::ReadFeatureCollectionParallel(
+      collection.data(), collection.data() + collection.size(), makeHandler,
+      [&](std::function<void()> task) {
+        threads.emplace_back(std::move(task));
+      },
+      2, 500);
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(positions(handlers), positions(whole));
+
+  // Errors
+  std::string empty = R"({"type": "FeatureCollection", "features": []})";
+  EXPECT_TRUE(geojson::ReadFeatureCollectionParallel(
+                  empty.data(), empty.data() + empty.size(), makeHandler)
+                  .empty());
+  std::string notCollection = getFeature(0).dump();
+  EXPECT_THROW(geojson::ReadFeatureCollectionParallel(
+                   notCollection.data(),
+                   notCollection.data() + notCollection.size(), makeHandler),
+               std::domain_error);
+  std::string bad = sequence;
+  bad.insert(bad.find('\x1e', bad.size() / 2) + 1, "x");
+  EXPECT_THROW(geojson::ReadSequenceParallel(
+                   bad.data(), bad.data() + bad.size(), makeHandler, 4, 100),
+               nlohmann::json::parse_error);
+}
+
+TEST(LibgeojsonTest, NumberTest) {
+  // Numbers are parsed exactly as nlohmann::json does, both on the fast path
+  // and the fallback
+  std::vector<std::string> numbers{
+      "0", "-0", "1", "-1", "0.5", "-77.0365", "38.897699999999998",
+      "1e10", "1E-10", "1.5e+300", "2.2250738585072014e-308", "4.9e-324",
+      "0.000001234567890123", "123456789012345678901234567890",
+      "9007199254740993", "9007199254740993.0", "0.1", "1e22", "1e23",
+      "18446744073709551615", "18446744073709551616",
+      "9223372036854775807", "-9223372036854775808",
+      "-9223372036854775809", "12345678.87654321", "1.7976931348623157e308"};
+  std::uint64_t state = 42;
+  for (int i = 0; i < 2000; i++) {
+    state = state * 6364136223846793005 + 1442695040888963407;
+    double value;
+    std::uint64_t bits = state;
+    std::memcpy(&value, &bits, sizeof(value));
+    if (std::isfinite(value)) numbers.push_back(nlohmann::json(value).dump());
+    double coord = static_cast<double>(state >> 11) / (1ull << 53) * 360 - 180;
+    numbers.push_back(nlohmann::json(coord).dump());
+  }
+
+  for (const std::string& number : numbers) {
+    auto expected = nlohmann::json::parse(number);
+    RecordingHandler handler;
+    std::string props = R"({"properties": [)" + number + "]}";
+    geojson::Read(props, handler);
+    ASSERT_EQ(handler.properties.size(), 1);
+    EXPECT_EQ(handler.properties[0][0], expected) << number;
+    EXPECT_EQ(handler.properties[0][0].type(), expected.type()) << number;
+
+    double value = expected.get<double>();
+    EXPECT_EQ(geojson::RawJson(geojson::StringView(number)).Number(), value)
+        << number;
+  }
+
+  // Positions take the same path
+  RecordingHandler handler;
+  geojson::Read(R"({"type": "Point", "coordinates": [1e-3, -0.25, 12]})",
+                handler);
+  EXPECT_EQ(handler.events[1], "0.001 -0.25 12");
+  EXPECT_THROW(geojson::Read(R"({"type": "Point", "coordinates": [1, 01]})",
+                             handler),
+               nlohmann::json::parse_error);
+  EXPECT_THROW(geojson::Read(R"({"type": "Point", "coordinates": [1, -]})",
+                             handler),
+               nlohmann::json::parse_error);
+  EXPECT_THROW(geojson::Read(R"({"type": "Point", "coordinates": [1, 2.]})",
+                             handler),
+               nlohmann::json::parse_error);
+  EXPECT_THROW(geojson::Read(R"({"type": "Point", "coordinates": [1, "2"]})",
+                             handler),
+               std::domain_error);
+  EXPECT_THROW(
+      geojson::Read(R"({"type": "Polygon", "coordinates": [[1, 2]]})",
+                    handler),
+      std::domain_error);
+}
+
+TEST(LibgeojsonTest, FlatGeometryTest) {
+  // A square with a square hole, and a triangle
+  std::vector<double> coords{0, 0, 4, 0, 4, 4, 0, 4, 1, 1, 1, 3, 3, 3,
+                             3, 1, 5, 5, 6, 5, 6, 6};
+  auto positions = geojson::PositionSpan::Interleaved(coords.data(), 11, 2);
+  size_t ringOffsets[] = {0, 4, 8, 11};
+  size_t polygonOffsets[] = {0, 2, 3};
+
+  auto multiPolygon = geojson::FlatGeometry::MultiPolygon(
+      positions, polygonOffsets, 2, ringOffsets);
+  EXPECT_EQ(multiPolygon.GetType(), geojson::Type::MultiPolygon);
+  EXPECT_EQ(multiPolygon.NumPositions(), 11);
+  EXPECT_EQ(multiPolygon.NumParts(), 3);
+  EXPECT_EQ(multiPolygon.NumPolygons(), 2);
+  EXPECT_EQ(multiPolygon.Part(1).Size(), 4);
+  EXPECT_EQ(multiPolygon.Part(1).Lon(0), 1);
+  EXPECT_THROW(multiPolygon.Part(3), std::out_of_range);
+  EXPECT_EQ(geojson::Geometry(multiPolygon),
+            geojson::MultiPolygon(positions, polygonOffsets, 2, ringOffsets,
+                                  3));
+  EXPECT_EQ(geojson::text::Geometry(multiPolygon),
+            geojson::text::MultiPolygon(positions, polygonOffsets, 2,
+                                        ringOffsets, 3));
+
+  auto polygon = geojson::FlatGeometry::Polygon(positions, ringOffsets, 2);
+  EXPECT_EQ(geojson::Geometry(polygon),
+            geojson::Polygon(positions, ringOffsets, 2));
+
+  auto lines =
+      geojson::FlatGeometry::MultiLineString(positions, ringOffsets, 3);
+  EXPECT_EQ(geojson::Geometry(lines),
+            geojson::MultiLineString(positions, ringOffsets, 3));
+  EXPECT_THROW(geojson::FlatGeometry::MultiLineString(positions.Slice(0, 5),
+                                                      ringOffsets, 3),
+               std::out_of_range);
+
+  // Geometries can be built a position at a time
+  geojson::FlatGeometry line(geojson::Type::LineString);
+  line.AddPosition(1, 2, 3);
+  line.AddPosition(4, 5, 6);
+  EXPECT_TRUE(line.HasAltitude());
+  EXPECT_EQ(geojson::Geometry(line),
+            geojson::LineString(
+                geojson::PositionSpan::Interleaved(line.Coordinates(), 2, 3)));
+
+  auto collection = geojson::FlatGeometry::GeometryCollection(
+      {geojson::FlatGeometry::Point(1, 2), line, multiPolygon});
+  auto expected = geojson::Geometry(collection);
+  EXPECT_EQ(expected["geometries"][0], geojson::Point(1, 2));
+  EXPECT_EQ(expected["geometries"][2], geojson::Geometry(multiPolygon));
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::Geometry(collection)),
+            expected);
+
+  // Reading gives back the same geometry, in much less memory than the DOM
+  auto read = geojson::ReadFlatGeometry(expected.dump());
+  EXPECT_EQ(geojson::Geometry(read), expected);
+  ASSERT_EQ(read.Geometries().size(), 3);
+  EXPECT_EQ(read.Geometries()[2].NumPolygons(), 2);
+
+  std::vector<double> track;
+  for (int i = 0; i < 1000; i++) {
+    track.push_back(i * 0.001);
+    track.push_back(i * -0.002);
+  }
+  auto trackJson = geojson::LineString(
+      geojson::PositionSpan::Interleaved(track.data(), 1000, 2));
+  auto trackFlat = geojson::ReadFlatGeometry(trackJson.dump());
+  EXPECT_EQ(geojson::Geometry(trackFlat), trackJson);
+  size_t domBytes = 1000 * (sizeof(nlohmann::json) * 3 +
+                            sizeof(nlohmann::json::array_t));
+  EXPECT_LT(trackFlat.MemoryUsage() * 4, domBytes);
+
+  // Features are read one geometry at a time
+  struct Features : geojson::FlatGeometryBuilder {
+    void OnFeatureEnd(size_t) {
+      geometries.push_back(HasGeometry() ? TakeGeometry()
+                                         : geojson::FlatGeometry());
+    }
+    std::vector<geojson::FlatGeometry> geometries;
+  } features;
+  geojson::Read(geojson::FeatureCollection(2, [&](size_t i) {
+                  return geojson::Feature(
+                      i == 0 ? geojson::Geometry(line)
+                             : geojson::Geometry(polygon),
+                      {{"index", i}});
+                }).dump(),
+                features);
+  ASSERT_EQ(features.geometries.size(), 2);
+  EXPECT_EQ(features.geometries[0].GetType(), geojson::Type::LineString);
+  EXPECT_EQ(features.geometries[1].NumParts(), 2);
+
+  EXPECT_THROW(geojson::ReadFlatGeometry(R"({"type": "Feature",
+                   "geometry": null, "properties": null})"),
+               std::domain_error);
+  EXPECT_THROW(geojson::FlatGeometry(geojson::Type::Feature),
+               std::domain_error);
+  EXPECT_THROW(geojson::Geometry(geojson::FlatGeometry(geojson::Type::Point)),
+               std::domain_error);
+  EXPECT_THROW(geojson::FlatGeometryBuilder().TakeGeometry(),
+               std::logic_error);
+}
+
+TEST(LibgeojsonTest, BoundingBoxTest) {
+  auto format = geojson::CoordinateFormat().WithBoundingBoxes();
+  std::vector<double> coords{0, 0, 4, -1, 4, 4, 0, 4, 1, 1, 1, 3, 3, 3,
+                             3, 1, 5, 5, 6, 5, 6, 6};
+  auto positions = geojson::PositionSpan::Interleaved(coords.data(), 11, 2);
+  auto getPoint = [&](size_t i, double& lon, double& lat) {
+    lon = coords[2 * i];
+    lat = coords[2 * i + 1];
+  };
+  nlohmann::json bbox{0, -1, 6, 6};
+
+  // Off by default
+  EXPECT_EQ(geojson::LineString(positions).count("bbox"), 0);
+  EXPECT_EQ(geojson::text::LineString(positions).find("bbox"),
+            std::string::npos);
+
+  // The callbacks and the spans give the same bounds
+  EXPECT_EQ(geojson::LineString(11, getPoint, format)["bbox"], bbox);
+  EXPECT_EQ(geojson::LineString(positions, format)["bbox"], bbox);
+  EXPECT_EQ(geojson::MultiPoint(11, getPoint, format)["bbox"], bbox);
+  EXPECT_EQ(geojson::MultiPoint(positions, format)["bbox"], bbox);
+  EXPECT_EQ(geojson::Point(1, 2, format)["bbox"],
+            nlohmann::json({1, 2, 1, 2}));
+
+  size_t ringOffsets[] = {0, 4, 8, 11};
+  size_t polygonOffsets[] = {0, 2, 3};
+  EXPECT_EQ(
+      geojson::Polygon(positions, ringOffsets, 2, format)["bbox"],
+      nlohmann::json({0, -1, 4, 4}));
+  EXPECT_EQ(geojson::Polygon(
+                1, [](size_t) -> size_t { return 4; },
+                [&](size_t, size_t j, double& lon, double& lat) {
+                  getPoint(j, lon, lat);
+                },
+                format)["bbox"],
+            nlohmann::json({0, -1, 4, 4}));
+  EXPECT_EQ(
+      geojson::MultiLineString(positions, ringOffsets + 1, 2, format)["bbox"],
+      nlohmann::json({1, 1, 6, 6}));
+  auto multiPolygon = geojson::MultiPolygon(positions, polygonOffsets, 2,
+                                            ringOffsets, 3, format);
+  EXPECT_EQ(multiPolygon["bbox"], bbox);
+
+  // The text encoders write the same members
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::MultiPolygon(
+                positions, polygonOffsets, 2, ringOffsets, 3, format)),
+            multiPolygon);
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::LineString(11, getPoint,
+                                                            format)),
+            geojson::LineString(positions, format));
+
+  // Altitudes are bounded when every position has one
+  std::vector<double> xyz{1, 2, 30, -1, 5, 10, 2, 0, 20};
+  auto xyzSpan = geojson::PositionSpan::Interleaved(xyz.data(), 3, 3);
+  EXPECT_EQ(geojson::LineString(xyzSpan, format)["bbox"],
+            nlohmann::json({-1, 0, 10, 2, 5, 30}));
+  EXPECT_EQ(geojson::LineString(
+                3,
+                [&](size_t i, double& lon, double& lat, double& alt) {
+                  lon = xyz[3 * i];
+                  lat = xyz[3 * i + 1];
+                  alt = xyz[3 * i + 2];
+                },
+                format)["bbox"],
+            nlohmann::json({-1, 0, 10, 2, 5, 30}));
+
+  // Rounded coordinates have rounded bounds
+  auto fixed = geojson::CoordinateFormat::Fixed(1).WithBoundingBoxes();
+  std::vector<double> fine{0.04, 0.26, 1.96, -0.34};
+  auto fineSpan = geojson::PositionSpan::Interleaved(fine.data(), 2, 2);
+  EXPECT_EQ(geojson::LineString(fineSpan, fixed)["bbox"],
+            nlohmann::json({0.0, -0.3, 2.0, 0.3}));
+  EXPECT_EQ(geojson::text::LineString(fineSpan, fixed),
+            R"({"type":"LineString","coordinates":[[0,0.3],[2,-0.3]],)"
+            R"("bbox":[0,-0.3,2,0.3]})");
+
+  // The bounds go up to collections and features
+  auto collection = geojson::GeometryCollection(2, [&](size_t i) {
+    return i == 0 ? geojson::Point(-10, 0, format) : multiPolygon;
+  });
+  EXPECT_EQ(collection["bbox"], nlohmann::json({-10, -1, 6, 6}));
+  auto feature = geojson::Feature(collection, nlohmann::json::object());
+  EXPECT_EQ(feature["bbox"], collection["bbox"]);
+  auto features = geojson::FeatureCollection(3, [&](size_t i) {
+    return i == 0   ? feature
+           : i == 1 ? geojson::Feature(nlohmann::json(), {})
+                    : geojson::Feature(geojson::Point(20, 30, format), {});
+  });
+  EXPECT_EQ(features["bbox"], nlohmann::json({-10, -1, 20, 30}));
+  EXPECT_EQ(geojson::FeatureCollection(2, [&](size_t i) {
+              return i == 0 ? feature
+                            : geojson::Feature(geojson::Point(20, 30), {});
+            }).count("bbox"),
+            0);
+
+  auto textCollection = geojson::text::GeometryCollection(2, [&](size_t i) {
+    return i == 0 ? geojson::text::Point(-10, 0, format)
+                  : geojson::text::MultiPolygon(positions, polygonOffsets, 2,
+                                                ringOffsets, 3, format);
+  });
+  EXPECT_EQ(nlohmann::json::parse(textCollection), collection);
+  EXPECT_EQ(nlohmann::json::parse(
+                geojson::text::Feature(textCollection, {{"a", 1}})),
+            geojson::Feature(collection, {{"a", 1}}));
+  EXPECT_EQ(geojson::text::GeometryCollection(1, [&](size_t) {
+              return geojson::text::Point(1, 2);
+            }).find("bbox"),
+            std::string::npos);
+
+  // The span kernel handles every layout, odd sizes and NaN coordinates
+  std::vector<double> lon, lat;
+  std::vector<double> strided;
+  for (int i = 0; i < 7; i++) {
+    lon.push_back(i * 1.5 - 3);
+    lat.push_back(10 - i * i);
+    strided.insert(strided.end(), {lon.back(), lat.back(), 0, 0});
+  }
+  lon[3] = NAN;
+  strided[12] = NAN;
+  for (auto span :
+       {geojson::PositionSpan::Separate(lon.data(), lat.data(), 7),
+        geojson::PositionSpan::Interleaved(strided.data(), 7, 2, 4)}) {
+    auto bounds = span.Bounds();
+    EXPECT_EQ(bounds.MinLon(), -3);
+    EXPECT_EQ(bounds.MaxLon(), 6);
+    EXPECT_EQ(bounds.MinLat(), -26);
+    EXPECT_EQ(bounds.MaxLat(), 10);
+    EXPECT_FALSE(bounds.HasAltitude());
+  }
+  EXPECT_TRUE(positions.Slice(3, 3).Bounds().Empty());
+  EXPECT_THROW(geojson::BoundingBox::FromJson(nlohmann::json({1, 2, 3})),
+               std::domain_error);
+}
+
+TEST(LibgeojsonTest, SimplificationTest) {
+  geojson::CoordinateFormat format;
+  EXPECT_THROW(format.WithSimplification(-1), std::domain_error);
+  EXPECT_THROW(format.WithSimplification(std::nan("")), std::domain_error);
+  EXPECT_THROW(format.WithSimplification(
+                   std::numeric_limits<double>::infinity()), std::domain_error);
+  EXPECT_FALSE(format.WithSimplification(0).IsSimplified());
+  auto simplify = format.WithSimplification(0.1);
+  EXPECT_EQ(simplify.SimplificationTolerance(), 0.1);
+
+  // A line with one corner, which is kept, and some noise, which is not
+  std::vector<double> line;
+  for (size_t i = 0; i <= 1000; i++) {
+    double noise = (i % 2) * 0.001;
+    line.push_back(i <= 500 ? i * 0.01 : 5 + noise);
+    line.push_back(i <= 500 ? noise : (i - 500) * 0.002);
+  }
+  auto span = geojson::PositionSpan::Interleaved(line.data(), 1001, 2);
+  auto getPoint = [&](size_t i, double& lon, double& lat) {
+    lon = line[2 * i];
+    lat = line[2 * i + 1];
+  };
+  nlohmann::json simplified{{0, 0}, {5, 0}, {5, 1}};
+  EXPECT_EQ(geojson::LineString(span, simplify)["coordinates"], simplified);
+  EXPECT_EQ(geojson::LineString(1001, getPoint, simplify)["coordinates"],
+            simplified);
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::LineString(span, simplify)),
+            geojson::LineString(span, simplify));
+  EXPECT_EQ(nlohmann::json::parse(
+                geojson::text::LineString(1001, getPoint, simplify)),
+            geojson::LineString(span, simplify));
+  EXPECT_EQ(geojson::LineString(span, format.WithSimplification(0)),
+            geojson::LineString(span));
+
+  // The bbox only bounds the positions that are kept
+  auto coarse = simplify.WithSimplification(2).WithBoundingBoxes();
+  EXPECT_EQ(geojson::LineString(span, coarse)["coordinates"],
+            nlohmann::json({{0, 0}, {5, 1}}));
+  EXPECT_EQ(geojson::LineString(span, coarse)["bbox"],
+            nlohmann::json({0, 0, 5, 1}));
+  EXPECT_EQ(geojson::LineString(1001, getPoint, coarse)["bbox"],
+            nlohmann::json({0, 0, 5, 1}));
+  EXPECT_EQ(geojson::LineString(span, format.WithBoundingBoxes())["bbox"],
+            nlohmann::json({0, 0, 5.001, 1}));
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::LineString(span, coarse)),
+            geojson::LineString(span, coarse));
+
+  // A CW circle with a CW hole, which are rewound and stay valid triangles
+  // at any tolerance
+  std::vector<double> rings;
+  for (size_t r = 0; r < 2; r++) {
+    for (size_t i = 0; i < 360; i++) {
+      double angle = -static_cast<double>(i) * std::acos(-1.0) / 180;
+      rings.push_back((r ? 2 : 10) * std::cos(angle));
+      rings.push_back((r ? 2 : 10) * std::sin(angle));
+    }
+  }
+  auto ringSpan = geojson::PositionSpan::Interleaved(rings.data(), 720, 2);
+  size_t ringOffsets[] = {0, 360, 720};
+  for (double tolerance : {0.01, 0.5, 5.0, 100.0}) {
+    auto polygon = geojson::Polygon(ringSpan, ringOffsets, 2,
+                                    format.WithSimplification(tolerance));
+    const auto& outer = polygon["coordinates"][0];
+    const auto& hole = polygon["coordinates"][1];
+    EXPECT_LT(outer.size(), 361);
+    EXPECT_GE(outer.size(), 4);
+    EXPECT_GE(hole.size(), 4);
+    EXPECT_EQ(outer.front(), outer.back());
+    EXPECT_EQ(hole.front(), hole.back());
+    EXPECT_EQ(std::set<nlohmann::json>(outer.begin(), outer.end()).size(),
+              outer.size() - 1);
+    EXPECT_TRUE(geojson::detail::IsCcw(outer));
+    EXPECT_FALSE(geojson::detail::IsCcw(hole));
+    EXPECT_EQ(nlohmann::json::parse(geojson::text::Polygon(
+                  ringSpan, ringOffsets, 2,
+                  format.WithSimplification(tolerance))),
+              polygon);
+  }
+  auto getRingPoint = [&](size_t, size_t j, double& lon, double& lat) {
+    lon = rings[2 * j];
+    lat = rings[2 * j + 1];
+  };
+  auto polygon = geojson::Polygon(
+      1, [](size_t) -> size_t { return 360; }, getRingPoint,
+      format.WithSimplification(100));
+  EXPECT_EQ(polygon["coordinates"][0].size(), 4);
+  EXPECT_EQ(polygon, geojson::Polygon(ringSpan, ringOffsets, 1,
+                                      format.WithSimplification(100)));
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::Polygon(
+                1, [](size_t) -> size_t { return 360; }, getRingPoint,
+                format.WithSimplification(100))),
+            polygon);
+}
+
+TEST(LibgeojsonTest, ValidationTest) {
+  auto basic = geojson::CoordinateFormat().WithValidation(
+      geojson::Validation::Basic());
+  auto strict = geojson::CoordinateFormat().WithValidation(
+      geojson::Validation::Basic().WithSelfIntersections());
+  auto repair = geojson::CoordinateFormat().WithValidation(
+      geojson::Validation().WithRepair());
+  EXPECT_FALSE(geojson::Validation().ChecksPositions());
+  EXPECT_TRUE(geojson::Validation().WithRepair().ChecksPositions());
+
+  // Each builder and encoder fails at the same position, by callback or span
+  auto expectInvalid = [](const std::vector<double>& coords, bool ring,
+                          const geojson::CoordinateFormat& format,
+                          size_t index) {
+    auto span = geojson::PositionSpan::Interleaved(coords.data(),
+                                                   coords.size() / 2, 2);
+    auto getPoint = [&](size_t i, double& lon, double& lat) {
+      lon = coords[2 * i];
+      lat = coords[2 * i + 1];
+    };
+    size_t offsets[] = {0, span.Size()};
+    std::vector<std::function<void()>> builders;
+    if (ring) {
+      builders.push_back([&] {
+        geojson::detail::LinearRingCoordinates(span.Size(), true, getPoint,
+                                               format);
+      });
+      builders.push_back([&] {
+        geojson::detail::LinearRingCoordinates(span, false, format);
+      });
+      builders.push_back([&] {
+        geojson::text::Polygon(span, offsets, 1, format);
+      });
+      builders.push_back([&] {
+        geojson::text::Polygon(
+            1, [&](size_t) { return span.Size(); },
+            [&](size_t, size_t i, double& lon, double& lat) {
+              getPoint(i, lon, lat);
+            },
+            format);
+      });
+    } else {
+      builders.push_back(
+          [&] { geojson::LineString(span.Size(), getPoint, format); });
+      builders.push_back([&] { geojson::LineString(span, format); });
+      builders.push_back(
+          [&] { geojson::text::LineString(span.Size(), getPoint, format); });
+      builders.push_back([&] { geojson::text::LineString(span, format); });
+    }
+    for (const auto& build : builders) {
+      try {
+        build();
+        ADD_FAILURE() << "Expected a ValidationError";
+      } catch (const geojson::ValidationError& e) {
+        EXPECT_EQ(e.Index(), index) << e.what();
+      }
+    }
+  };
+
+  // Positions that pass are encoded as they would be without the checks
+  std::vector<double> line{0, 0, 1, 0, 1, 1, 2, 1};
+  auto span = geojson::PositionSpan::Interleaved(line.data(), 4, 2);
+  EXPECT_EQ(geojson::LineString(span, strict), geojson::LineString(span));
+  EXPECT_EQ(geojson::text::LineString(span, basic),
+            geojson::text::LineString(span));
+  EXPECT_EQ(geojson::LineString(span, repair), geojson::LineString(span));
+
+  double nan = std::nan("");
+  for (const auto& format : {basic, strict}) {
+    expectInvalid({0, 0, nan, 1, 2, 2}, false, format, 1);
+    expectInvalid({0, 0, 181, 1, 2, 2}, false, format, 1);
+    expectInvalid({0, 0, 1, 1, 2, -90.5}, false, format, 2);
+    expectInvalid({0, 0, 1, 1, 1, 1, 2, 2}, false, format, 2);
+    expectInvalid({0, 0, 1, 0, 1, 1, 0, 0}, true, format, 3);
+    expectInvalid({0, 0, 1, 0, 1, 0, 1, 1}, true, format, 2);
+  }
+
+  // Positions that only differ below the precision repeat once rounded
+  auto fixed = geojson::CoordinateFormat::Fixed(3).WithValidation(
+      geojson::Validation::Basic());
+  expectInvalid({0, 0, 1, 1, 1.0001, 1}, false, fixed, 2);
+  EXPECT_NO_THROW(geojson::LineString(
+      span, geojson::CoordinateFormat::Fixed(3)));
+
+  // Crossing, touching and folding back on itself, but not meeting at the
+  // ends of a closed line
+  expectInvalid({0, 0, 2, 2, 2, 0, 0, 2}, false, strict, 2);
+  expectInvalid({0, 0, 2, 0, 1, 0, 1, 1}, false, strict, 1);
+  expectInvalid({0, 0, 2, 0, 2, 2, 1, 0}, false, strict, 2);
+  expectInvalid({0, 0, 2, 0, 2, 2, 0, 2, 2, 0, 3, -1}, false, strict, 4);
+  expectInvalid({0, 0, 2, 0, 0, 2, 2, 2}, true, strict, 3);
+  expectInvalid({0, 0, 2, 0, 1, 0}, true, strict, 2);
+  EXPECT_NO_THROW(geojson::LineString(
+      geojson::PositionSpan::Interleaved(
+          std::vector<double>{0, 0, 1, 0, 1, 1, 0, 0}.data(), 4, 2),
+      strict));
+  EXPECT_NO_THROW(geojson::text::LineString(span, strict));
+
+  // A circle of many vertices is simple, and stays so however it is read
+  std::vector<double> circle;
+  for (size_t i = 0; i < 1000; i++) {
+    double angle = -static_cast<double>(i) * std::acos(-1.0) / 500;
+    circle.push_back(10 * std::cos(angle));
+    circle.push_back(10 * std::sin(angle));
+  }
+  auto circleSpan = geojson::PositionSpan::Interleaved(circle.data(), 1000, 2);
+  size_t circleOffsets[] = {0, 1000};
+  auto polygon = geojson::Polygon(circleSpan, circleOffsets, 1);
+  EXPECT_EQ(geojson::Polygon(circleSpan, circleOffsets, 1, strict), polygon);
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::Polygon(
+                circleSpan, circleOffsets, 1, strict)),
+            polygon);
+
+  // A bow tie is caught wherever its crossing falls in the sweep
+  std::vector<double> bowTie = circle;
+  std::swap(bowTie[500], bowTie[1500]);
+  std::swap(bowTie[501], bowTie[1501]);
+  try {
+    geojson::Polygon(geojson::PositionSpan::Interleaved(bowTie.data(), 1000, 2),
+                     circleOffsets, 1, strict);
+    ADD_FAILURE() << "Expected a ValidationError";
+  } catch (const geojson::ValidationError&) {
+  }
+  EXPECT_NO_THROW(geojson::Polygon(
+      geojson::PositionSpan::Interleaved(bowTie.data(), 1000, 2),
+      circleOffsets, 1, basic));
+
+  // Repairing drops bad and repeated positions and wraps longitudes, and
+  // the bbox bounds what is written
+  std::vector<double> dirty{0, 0, 0, 0, nan, 5, 1, 0, 361, 1, 0, 1, 0, 0};
+  auto dirtySpan = geojson::PositionSpan::Interleaved(dirty.data(), 7, 2);
+  size_t dirtyOffsets[] = {0, 7};
+  auto repaired = geojson::Polygon(dirtySpan, dirtyOffsets, 1,
+                                   repair.WithBoundingBoxes());
+  EXPECT_EQ(repaired["coordinates"],
+            nlohmann::json({{{0, 0}, {1, 0}, {1, 1}, {0, 1}, {0, 0}}}));
+  EXPECT_EQ(repaired["bbox"], nlohmann::json({0, 0, 1, 1}));
+  EXPECT_EQ(nlohmann::json::parse(geojson::text::Polygon(
+                dirtySpan, dirtyOffsets, 1, repair.WithBoundingBoxes())),
+            repaired);
+  EXPECT_EQ(geojson::Polygon(
+                1, [](size_t) -> size_t { return 7; },
+                [&](size_t, size_t i, double& lon, double& lat) {
+                  lon = dirty[2 * i];
+                  lat = dirty[2 * i + 1];
+                },
+                repair.WithBoundingBoxes()),
+            repaired);
+  auto bytes = geojson::cbor::Geometry(
+      geojson::FlatGeometry::Polygon(dirtySpan, dirtyOffsets, 1),
+      geojson::cbor::Coordinates::Float64, repair);
+  EXPECT_EQ(geojson::Geometry(geojson::cbor::ReadGeometry(bytes)),
+            geojson::Polygon(dirtySpan, dirtyOffsets, 1, repair));
+  expectInvalid({0, 0, 0, 0, nan, 1}, false, repair, 0);
+  expectInvalid({0, 0, 1, 1, 0, 91}, false, repair, 2);
+}
+
+TEST(LibgeojsonTest, SpatialIndexTest) {
+  // Searches give the same boxes as a linear scan
+  std::vector<geojson::BoundingBox> boxes;
+  std::uint64_t state = 7;
+  auto random = [&] {
+    state = state * 6364136223846793005 + 1442695040888963407;
+    return static_cast<double>(state >> 11) / (1ull << 53);
+  };
+  for (int i = 0; i < 1000; i++) {
+    double lon = random() * 360 - 180, lat = random() * 180 - 90;
+    boxes.push_back(geojson::BoundingBox::FromCorners(
+        lon, lat, lon + random() * 5, lat + random() * 5));
+  }
+  for (size_t numItems : {0, 1, 5, 16, 17, 1000}) {
+    geojson::PackedRTree tree(numItems, 4);
+    for (size_t i = 0; i < numItems; i++) EXPECT_EQ(tree.Add(boxes[i]), i);
+    if (numItems > 0) {
+      EXPECT_THROW(tree.Search(geojson::BoundingBox()), std::logic_error);
+    }
+    tree.Finish();
+
+    std::string data;
+    tree.Serialize(data);
+    const char* p = data.data();
+    auto copy = geojson::PackedRTree::Deserialize(p, data.data() + data.size());
+    EXPECT_EQ(p, data.data() + data.size());
+
+    // Indices that are not boxes of the tree throw rather than be searched
+    size_t numNodes = (data.size() - 24) / 40;
+    for (size_t node : {size_t(0), numNodes - 1}) {
+      for (uint64_t index : {uint64_t(numNodes), ~uint64_t(0)}) {
+        if (numItems == 0) break;
+        std::string corrupt = data;
+        std::memcpy(&corrupt[24 + 32 * numNodes + 8 * node], &index, 8);
+        p = corrupt.data();
+        EXPECT_THROW(geojson::PackedRTree::Deserialize(
+                         p, corrupt.data() + corrupt.size()),
+                     std::domain_error);
+      }
+    }
+
+    for (int q = 0; q < 20; q++) {
+      double lon = random() * 360 - 180, lat = random() * 180 - 90;
+      auto query = geojson::BoundingBox::FromCorners(lon, lat, lon + 40,
+                                                     lat + 20);
+      std::vector<size_t> expected;
+      for (size_t i = 0; i < numItems; i++) {
+        if (boxes[i].MaxLon() >= query.MinLon() &&
+            boxes[i].MinLon() <= query.MaxLon() &&
+            boxes[i].MaxLat() >= query.MinLat() &&
+            boxes[i].MinLat() <= query.MaxLat()) {
+          expected.push_back(i);
+        }
+      }
+      auto found = tree.Search(query);
+      std::sort(found.begin(), found.end());
+      EXPECT_EQ(found, expected) << numItems;
+      found = copy.Search(query);
+      std::sort(found.begin(), found.end());
+      EXPECT_EQ(found, expected) << numItems;
+    }
+  }
+  geojson::PackedRTree full(1);
+  full.Add(0, 0, 1, 1);
+  EXPECT_THROW(full.Add(0, 0, 1, 1), std::logic_error);
+  EXPECT_THROW(geojson::PackedRTree(1).Finish(), std::logic_error);
+  EXPECT_THROW(geojson::PackedRTree(1, 1), std::domain_error);
+
+  // A corrupt header throws before the tree allocates for its items
+  std::string corrupt;
+  full.Finish();
+  full.Serialize(corrupt);
+  for (uint64_t numItems : {uint64_t(1) << 40, ~uint64_t(0)}) {
+    std::memcpy(&corrupt[8], &numItems, sizeof(numItems));
+    const char* p = corrupt.data();
+    EXPECT_THROW(
+        geojson::PackedRTree::Deserialize(p, corrupt.data() + corrupt.size()),
+        std::domain_error);
+  }
+
+  // The index written with a collection finds the text of its features
+  auto format = geojson::CoordinateFormat().WithBoundingBoxes();
+  auto getFeature = [&](size_t i) {
+    if (i == 3) return geojson::Feature(nlohmann::json(), {{"i", i}});
+    auto center = boxes[i];
+    return geojson::Feature(
+        i, geojson::Point(center.MinLon(), center.MinLat(), format),
+        {{"i", i}});
+  };
+  std::ostringstream os, indexOs;
+  geojson::WriteIndexedFeatureCollection(os, indexOs, 100, getFeature);
+  std::string collection = os.str();
+  EXPECT_EQ(nlohmann::json::parse(collection)["features"],
+            geojson::FeatureCollection(100, getFeature)["features"]);
+
+  auto index = geojson::FeatureIndex::Deserialize(indexOs.str());
+  EXPECT_EQ(index.NumFeatures(), 99);
+  auto query = geojson::BoundingBox::FromCorners(-90, -45, 90, 45);
+  auto entries = index.Search(query);
+  size_t expected = 0;
+  for (size_t i = 0; i < 100; i++) {
+    if (i != 3 && boxes[i].MinLon() >= -90 && boxes[i].MinLon() <= 90 &&
+        boxes[i].MinLat() >= -45 && boxes[i].MinLat() <= 45) {
+      ASSERT_LT(expected, entries.size());
+      EXPECT_EQ(entries[expected].feature, i);
+      EXPECT_EQ(nlohmann::json::parse(collection.substr(
+                    entries[expected].offset, entries[expected].size)),
+                getFeature(i));
+      expected++;
+    }
+  }
+  EXPECT_EQ(entries.size(), expected);
+
+  geojson::IndexedFeatureCollectionWriter writer{geojson::StreamSink(os)};
+  EXPECT_THROW(writer.Write(geojson::Feature(geojson::Point(1, 2), {})),
+               std::domain_error);
+  EXPECT_THROW(geojson::FeatureIndex::Deserialize(indexOs.str().substr(1)),
+               std::domain_error);
+  EXPECT_THROW(geojson::FeatureIndex::Deserialize(
+                   indexOs.str().substr(0, indexOs.str().size() - 1)),
+               std::domain_error);
+}
+
+TEST(LibgeojsonTest, SpatialOrderTest) {
+  std::uint64_t state = 3;
+  auto random = [&] {
+    state = state * 6364136223846793005 + 1442695040888963407;
+    return static_cast<double>(state >> 11) / (1ull << 53);
+  };
+  std::vector<nlohmann::json> features;
+  auto format = geojson::CoordinateFormat::Fixed(4).WithBoundingBoxes();
+  for (size_t i = 0; i < 500; i++) {
+    if (i % 50 == 7) {
+      features.push_back(geojson::Feature(i, nlohmann::json(), {}));
+      continue;
+    }
+    // Some of the features are outside of the extent
+    double lon = random() * 400 - 200, lat = random() * 200 - 100;
+    features.push_back(geojson::Feature(
+        i, geojson::LineString(2, [&](size_t pt, double& x, double& y) {
+          x = lon + pt * random();
+          y = lat + pt * random();
+        }, format), {{"i", i}}));
+  }
+  auto key = [](const nlohmann::json& feature) -> std::uint64_t {
+    if (!feature.count("bbox")) return std::uint64_t(1) << 32;
+    auto bounds = geojson::BoundingBox::FromJson(feature["bbox"]);
+    return geojson::detail::HilbertMapping(geojson::BoundingBox::FromCorners(
+        -180, -90, 180, 90))(bounds.MinLon(), bounds.MinLat(),
+                             bounds.MaxLon(), bounds.MaxLat());
+  };
+  auto expected = features;
+  std::stable_sort(expected.begin(), expected.end(),
+                   [&](const nlohmann::json& a, const nlohmann::json& b) {
+                     return key(a) < key(b);
+                   });
+
+  // The same order comes out of memory and out of many spilled runs
+  for (size_t runSize : {geojson::kDefaultSortRunSize, size_t(1000)}) {
+    std::string text;
+    geojson::BasicHilbertFeatureCollectionWriter<geojson::StringSink> writer(
+        text, geojson::BoundingBox::FromCorners(-180, -90, 180, 90), runSize);
+    for (const auto& feature : features) writer.Write(feature);
+    EXPECT_EQ(writer.NumFeatures(), features.size());
+    writer.Close();
+    EXPECT_EQ(writer.NumFeatures(), features.size());
+    EXPECT_THROW(writer.Write(features[0]), std::logic_error);
+    EXPECT_EQ(nlohmann::json::parse(text)["features"],
+              nlohmann::json(expected))
+        << runSize;
+  }
+
+  std::ostringstream os;
+  geojson::WriteHilbertFeatureCollection(
+      os, features.size(), [&](size_t i) { return features[i]; });
+  EXPECT_EQ(nlohmann::json::parse(os.str())["features"],
+            nlohmann::json(expected));
+
+  // A sorter can be drained into an indexed writer, and reused
+  geojson::HilbertFeatureSorter sorter(
+      geojson::BoundingBox::FromCorners(-180, -90, 180, 90), 1000);
+  for (int pass = 0; pass < 2; pass++) {
+    for (const auto& feature : features) sorter.Add(feature);
+    std::string text;
+    geojson::BasicIndexedFeatureCollectionWriter<geojson::StringSink> indexed(
+        text);
+    sorter.Drain([&](const char* data, size_t size,
+                     const geojson::BoundingBox& bounds) {
+      indexed.WriteRaw(data, size, bounds);
+    });
+    EXPECT_EQ(sorter.NumFeatures(), 0);
+    auto index = indexed.Close();
+    EXPECT_EQ(nlohmann::json::parse(text)["features"],
+              nlohmann::json(expected));
+    EXPECT_EQ(index.NumFeatures(), 490);
+  }
+  EXPECT_THROW(sorter.Add(geojson::Feature(geojson::Point(1, 2), {})),
+               std::domain_error);
+}
+
+// Just enough of a FlatBuffers reader to check the FlatGeobuf output
+struct FlatBufferReader {
+  template <typename T>
+  T Get(size_t pos) const {
+    T value;
+    std::memcpy(&value, data + pos, sizeof(T));
+    return value;
+  }
+
+  size_t Root() const { return Get<std::uint32_t>(0); }
+
+  // The position of a field of a table, or 0 if it is not set
+  size_t Field(size_t table, size_t id) const {
+    size_t vtable = table - Get<std::int32_t>(table);
+    if (4 + 2 * id >= Get<std::uint16_t>(vtable)) return 0;
+    auto offset = Get<std::uint16_t>(vtable + 4 + 2 * id);
+    return offset ? table + offset : 0;
+  }
+
+  size_t Deref(size_t pos) const { return pos + Get<std::uint32_t>(pos); }
+
+  template <typename T>
+  std::vector<T> Vector(size_t table, size_t id) const {
+    std::vector<T> values;
+    size_t field = Field(table, id);
+    if (!field) return values;
+    size_t vector = Deref(field);
+    for (size_t i = 0; i < Get<std::uint32_t>(vector); i++) {
+      values.push_back(Get<T>(vector + 4 + i * sizeof(T)));
+    }
+    return values;
+  }
+
+  std::vector<size_t> Tables(size_t table, size_t id) const {
+    std::vector<size_t> tables;
+    size_t field = Field(table, id);
+    if (!field) return tables;
+    size_t vector = Deref(field);
+    for (size_t i = 0; i < Get<std::uint32_t>(vector); i++) {
+      tables.push_back(Deref(vector + 4 + 4 * i));
+    }
+    return tables;
+  }
+
+  std::string String(size_t table, size_t id) const {
+    size_t field = Field(table, id);
+    if (!field) return std::string();
+    size_t str = Deref(field);
+    return std::string(data + str + 4, Get<std::uint32_t>(str));
+  }
+
+  const char* data;
+};
+
+TEST(LibgeojsonTest, FlatGeobufTest) {
+  using geojson::FlatGeometry;
+  namespace fgb = geojson::fgb;
+
+  // The callback builders make the same geometries as the DOM ones
+  auto getRingLength = [](size_t ring) -> size_t { return ring == 0 ? 4 : 3; };
+  auto getPoint = [](size_t ring, size_t pt, double& lon, double& lat) {
+    double size = ring == 0 ? 10 : 1;
+    lon = (pt == 1 || pt == 2 ? size : 0) + ring;
+    lat = (pt >= 2 ? size : 0) + ring;
+    if (ring == 1 && pt == 2) lon = 1;
+  };
+  auto polygon = FlatGeometry::Polygon(2, getRingLength, getPoint);
+  EXPECT_EQ(geojson::Geometry(polygon),
+            geojson::Polygon(2, getRingLength, getPoint));
+  auto getPoint3 = [](size_t line, size_t pt, double& lon, double& lat,
+                      double& alt) {
+    lon = line;
+    lat = pt;
+    alt = -1;
+  };
+  auto getLineLength = [](size_t line) -> size_t { return line + 2; };
+  EXPECT_EQ(geojson::Geometry(
+                FlatGeometry::MultiLineString(2, getLineLength, getPoint3)),
+            geojson::MultiLineString(2, getLineLength, getPoint3));
+  auto getNumRings = [](size_t) -> size_t { return 1; };
+  auto getPolygonPoint = [](size_t poly, size_t, size_t pt, double& lon,
+                            double& lat) {
+    lon = (pt == 1 ? 1 : 0) + 5 * poly;
+    lat = pt == 2 ? 1 : 0;
+  };
+  auto getPolygonRingLength = [](size_t, size_t) -> size_t { return 3; };
+  auto multiPolygon = FlatGeometry::MultiPolygon(
+      2, getNumRings, getPolygonRingLength, getPolygonPoint);
+  EXPECT_EQ(geojson::Geometry(multiPolygon),
+            geojson::MultiPolygon(2, getNumRings, getPolygonRingLength,
+                                  getPolygonPoint));
+  EXPECT_THROW(FlatGeometry::LineString(1, [](size_t, double&, double&) {}),
+               std::domain_error);
+
+  std::vector<fgb::Feature> features;
+  for (size_t i = 0; i < 40; i++) {
+    features.push_back(fgb::Feature(
+        FlatGeometry::LineString(3, [&](size_t pt, double& lon, double& lat) {
+          lon = -170.0 + 8 * i + pt;
+          lat = 80.0 - 4 * i - pt;
+        }),
+        {{"id", i}, {"name", "road " + std::to_string(i)}, {"len", 2.5 * i},
+         {"open", i % 2 == 0}, {"tags", {i, "x"}}, {"gone", nullptr}}));
+  }
+  features.push_back(fgb::Feature(polygon, {{"id", 40}}));
+  features.push_back(fgb::Feature(multiPolygon, {{"id", 41}}));
+  features.push_back(fgb::Feature(FlatGeometry::Point(1, 2, 3), {{"id", 42}}));
+  features.push_back(fgb::Feature(nlohmann::json{{"id", 43}}));
+
+  std::ostringstream os;
+  fgb::WriteFeatureCollection(
+      os, features.size(), [&](size_t i) { return features[i]; }, "roads");
+  std::string file = os.str();
+  ASSERT_GT(file.size(), 12);
+  EXPECT_EQ(file.substr(0, 8), std::string("fgb\x03" "fgb\0", 8));
+
+  std::uint32_t headerSize;
+  std::memcpy(&headerSize, file.data() + 8, 4);
+  FlatBufferReader header{file.data() + 12};
+  size_t root = header.Root();
+  EXPECT_EQ(header.String(root, 0), "roads");
+  EXPECT_EQ(header.Get<std::uint8_t>(header.Field(root, 2)), 0);  // Unknown
+  EXPECT_EQ(header.Get<std::uint8_t>(header.Field(root, 3)), 0);  // has_z
+  EXPECT_EQ(header.Get<std::uint64_t>(header.Field(root, 8)), 44);
+  EXPECT_EQ(header.Get<std::uint16_t>(header.Field(root, 9)), 16);
+  EXPECT_EQ(header.Vector<double>(root, 1),
+            std::vector<double>({-170, -78, 144, 80}));
+  std::vector<std::pair<std::string, int>> columns;
+  for (size_t column : header.Tables(root, 7)) {
+    columns.emplace_back(header.String(column, 0),
+                         header.Get<std::uint8_t>(header.Field(column, 1)));
+  }
+  // nlohmann::json sorts the properties by name
+  EXPECT_EQ(columns, (std::vector<std::pair<std::string, int>>{
+                         {"id", 7}, {"len", 10}, {"name", 11}, {"open", 2},
+                         {"tags", 12}}));
+  size_t crs = header.Deref(header.Field(root, 10));
+  EXPECT_EQ(header.String(crs, 0), "EPSG");
+  EXPECT_EQ(header.Get<std::int32_t>(header.Field(crs, 1)), 4326);
+
+  // 44 leaves, 3 nodes above them and the root
+  const char* index = file.data() + 12 + headerSize;
+  size_t numNodes = 48;
+  const char* first = index + numNodes * 40;
+  auto node = [&](size_t i, size_t field) {
+    double value;
+    std::memcpy(&value, index + 40 * i + 8 * field, 8);
+    return value;
+  };
+  EXPECT_EQ(node(0, 0), -170);
+  EXPECT_EQ(node(0, 3), 80);
+
+  std::set<size_t> ids;
+  std::uint64_t lastOffset = 0;
+  for (size_t leaf = 4; leaf < numNodes; leaf++) {
+    std::uint64_t offset;
+    std::memcpy(&offset, index + 40 * leaf + 32, 8);
+    if (leaf > 4) {
+      EXPECT_GT(offset, lastOffset);
+    }
+    lastOffset = offset;
+
+    FlatBufferReader feature{first + offset + 4};
+    size_t table = feature.Root();
+    auto properties = feature.Vector<std::uint8_t>(table, 1);
+    ASSERT_GE(properties.size(), 10);
+    EXPECT_EQ(properties[0] | properties[1] << 8, 0);
+    std::uint64_t id;
+    std::memcpy(&id, properties.data() + 2, 8);
+    ids.insert(id);
+    const auto& input = features[id];
+    EXPECT_EQ(feature.Field(table, 0) != 0, input.hasGeometry);
+    if (!input.hasGeometry) continue;
+
+    // Positions are closed and wound as in GeoJSON, with the altitudes
+    // of the Point dropped as the file is 2D
+    size_t geometry = feature.Deref(feature.Field(table, 0));
+    auto type = feature.Get<std::uint8_t>(feature.Field(geometry, 6));
+    auto xy = feature.Vector<double>(geometry, 1);
+    EXPECT_TRUE(feature.Vector<double>(geometry, 2).empty());
+    if (id < 40) {
+      EXPECT_EQ(type, 2);
+      EXPECT_EQ(xy.size(), 6);
+      EXPECT_EQ(xy[2], -169.0 + 8 * id);
+      std::string text(properties.begin(), properties.end());
+      EXPECT_NE(text.find("road " + std::to_string(id)), std::string::npos);
+    } else if (id == 40) {
+      EXPECT_EQ(type, 3);
+      EXPECT_EQ(feature.Vector<std::uint32_t>(geometry, 0),
+                std::vector<std::uint32_t>({5, 9}));
+      auto expected = geojson::Polygon(2, getRingLength, getPoint);
+      std::vector<double> coords;
+      for (const auto& ring : expected["coordinates"]) {
+        for (const auto& pos : ring) {
+          coords.push_back(pos[0]);
+          coords.push_back(pos[1]);
+        }
+      }
+      EXPECT_EQ(xy, coords);
+    } else if (id == 41) {
+      EXPECT_EQ(type, 6);
+      auto parts = feature.Tables(geometry, 7);
+      ASSERT_EQ(parts.size(), 2);
+      auto part = feature.Vector<double>(parts[1], 1);
+      EXPECT_EQ(part, std::vector<double>({5, 0, 6, 0, 5, 1, 5, 0}));
+    } else {
+      EXPECT_EQ(type, 1);
+      EXPECT_EQ(xy, std::vector<double>({1, 2}));
+    }
+  }
+  EXPECT_EQ(ids.size(), features.size());
+
+  // One type of geometry is given in the header, and there may be no index
+  std::string text;
+  {
+    fgb::BasicFeatureCollectionWriter<geojson::StringSink> writer(
+        text, "", {{"id", fgb::ColumnType::UByte}}, 0);
+    for (size_t i = 0; i < 3; i++) writer.Write(features[2 - i]);
+    EXPECT_THROW(writer.Write(fgb::Feature(nlohmann::json{{"id", 256}})),
+                 std::domain_error);
+    EXPECT_EQ(writer.NumFeatures(), 3);
+  }
+  std::memcpy(&headerSize, text.data() + 8, 4);
+  FlatBufferReader lines{text.data() + 12};
+  root = lines.Root();
+  EXPECT_EQ(lines.Get<std::uint8_t>(lines.Field(root, 2)), 2);
+  EXPECT_EQ(lines.Get<std::uint16_t>(lines.Field(root, 9)), 0);
+  EXPECT_EQ(lines.Tables(root, 7).size(), 5);
+  FlatBufferReader firstLine{text.data() + 12 + headerSize + 4};
+  auto properties = firstLine.Vector<std::uint8_t>(firstLine.Root(), 1);
+  ASSERT_GE(properties.size(), 3);
+  EXPECT_EQ(properties[2], 2);  // Written in order
+  EXPECT_THROW(fgb::FeatureCollectionWriter(geojson::StreamSink(os), "", {},
+                                            1),
+               std::domain_error);
+
+  // Over a small area, the extent of the dataset orders the features so that
+  // each node above the leaves covers a 4 x 4 block of a 16 x 16 grid, which
+  // the whole world is too coarse to tell apart
+  const double kSpacing = 1e-4;
+  auto extent = geojson::BoundingBox::FromCorners(-77.05, 38.88,
+                                                  -77.05 + 15 * kSpacing,
+                                                  38.88 + 15 * kSpacing);
+  std::string city;
+  {
+    fgb::BasicFeatureCollectionWriter<geojson::StringSink> writer(
+        city, "", {}, 16, extent);
+    for (size_t i = 0; i < 256; i++) {
+      size_t cell = i * 97 % 256;  // Scattered over the grid
+      writer.Write(FlatGeometry::Point(extent.MinLon() + cell % 16 * kSpacing,
+                                       extent.MinLat() + cell / 16 * kSpacing),
+                   nlohmann::json::object());
+    }
+  }
+  std::memcpy(&headerSize, city.data() + 8, 4);
+  const char* cityIndex = city.data() + 12 + headerSize;
+  for (size_t parent = 1; parent <= 16; parent++) {
+    double box[4];
+    std::memcpy(box, cityIndex + 40 * parent, sizeof(box));
+    EXPECT_NEAR(box[2] - box[0], 3 * kSpacing, 1e-9) << parent;
+    EXPECT_NEAR(box[3] - box[1], 3 * kSpacing, 1e-9) << parent;
+  }
+}
+
+TEST(LibgeojsonTest, TileTest) {
+  // The tile pyramid
+  EXPECT_THROW(geojson::CoveringTiles(geojson::BoundingBox(), 31),
+               std::domain_error);
+  auto world = geojson::TileId{0, 0, 0}.Bounds();
+  EXPECT_DOUBLE_EQ(world.MinLon(), -180);
+  EXPECT_DOUBLE_EQ(world.MaxLon(), 180);
+  EXPECT_NEAR(world.MaxLat(), geojson::kMaxTileLatitude, 1e-9);
+  EXPECT_NEAR(world.MinLat(), -geojson::kMaxTileLatitude, 1e-9);
+  auto northEast = geojson::TileId{1, 1, 0}.Bounds();
+  EXPECT_DOUBLE_EQ(northEast.MinLon(), 0);
+  EXPECT_NEAR(northEast.MinLat(), 0, 1e-12);
+  auto tiles = geojson::CoveringTiles(
+      geojson::BoundingBox::FromCorners(-77.2, 38.8, -77.1, 39), 10);
+  ASSERT_EQ(tiles.size(), 2);
+  EXPECT_EQ(tiles[0], (geojson::TileId{10, 292, 391}));
+  EXPECT_EQ(tiles[1], (geojson::TileId{10, 292, 392}));
+  EXPECT_EQ(geojson::CoveringTiles(
+                geojson::BoundingBox::FromCorners(-200, -89, 200, 89), 2)
+                .size(),
+            16);
+
+  // Clipping to [0, 10] x [0, 10]
+  auto box = geojson::BoundingBox::FromCorners(0, 0, 10, 10);
+  auto clip = [&](const geojson::FlatGeometry& g) {
+    return geojson::Geometry(geojson::ClipGeometry(g, box));
+  };
+  std::vector<double> coords{-5, 5, 5, 5, 5, 15, 8, 15, 8, 5, 15, 5};
+  auto line = geojson::PositionSpan::Interleaved(coords.data(), 6, 2);
+  EXPECT_EQ(clip(geojson::FlatGeometry::LineString(line)),
+            nlohmann::json::parse(
+                R"({"type":"MultiLineString","coordinates":)"
+                R"([[[0,5],[5,5],[5,10]],[[8,10],[8,5],[10,5]]]})"));
+  EXPECT_EQ(clip(geojson::FlatGeometry::LineString(line.Slice(0, 2))),
+            nlohmann::json::parse(R"({"type":"LineString","coordinates":)"
+                                  R"([[0,5],[5,5]]})"));
+  EXPECT_EQ(clip(geojson::FlatGeometry::MultiPoint(line))["coordinates"],
+            nlohmann::json::parse("[[5,5],[8,5]]"));
+
+  // A square over the corner of the box, with a hole that is clipped away
+  std::vector<double> square{5, 5, 15, 5, 15, 15, 5, 15,
+                             12, 12, 13, 12, 13, 13};
+  size_t ringOffsets[] = {0, 4, 7};
+  auto polygon = geojson::FlatGeometry::Polygon(
+      geojson::PositionSpan::Interleaved(square.data(), 7, 2), ringOffsets,
+      2);
+  EXPECT_EQ(clip(polygon),
+            nlohmann::json::parse(R"({"type":"Polygon","coordinates":)"
+                                  R"([[[5,10],[5,5],[10,5],[10,10],[5,10]]]})"));
+  auto inside = geojson::BoundingBox::FromCorners(0, 0, 20, 20);
+  EXPECT_EQ(geojson::Geometry(geojson::ClipGeometry(polygon, inside)),
+            geojson::Geometry(polygon));
+  auto outside = geojson::BoundingBox::FromCorners(20, 20, 30, 30);
+  EXPECT_EQ(geojson::ClipGeometry(polygon, outside).NumPositions(), 0);
+
+  // A triangle whose clipped part is only a corner of the box
+  std::vector<double> sliver{-10, 0, 0, -10, -10, -10};
+  size_t triangleOffsets[] = {0, 3};
+  auto triangle = geojson::FlatGeometry::Polygon(
+      geojson::PositionSpan::Interleaved(sliver.data(), 3, 2),
+      triangleOffsets, 1);
+  EXPECT_EQ(geojson::ClipGeometry(triangle, box).NumPositions(), 0);
+
+  // Fanned out to the tiles of zoom 1, in parallel or not
+  auto getFeature = [&](size_t i) {
+    double shift = 0.5 * i;
+    std::vector<double> pts{shift - 90, 45, shift + 90, 45, shift + 90, -45};
+    return geojson::TileFeature{
+        geojson::FlatGeometry::LineString(
+            geojson::PositionSpan::Interleaved(pts.data(), 3, 2)),
+        {{"id", i}}};
+  };
+  std::map<geojson::TileId, std::string> sequential, parallel;
+  geojson::BasicTileWriter<geojson::StringSink> writer(
+      1, [&](const geojson::TileId& tile, bool) {
+        return geojson::StringSink(sequential[tile]);
+      });
+  for (size_t i = 0; i < 100; i++) {
+    auto feature = getFeature(i);
+    writer.Write(feature.geometry, feature.properties);
+  }
+  writer.Close();
+  EXPECT_THROW(writer.Write(getFeature(0).geometry), std::logic_error);
+  ASSERT_EQ(writer.Tiles().size(), 3);
+  EXPECT_EQ(writer.NumFeatures({1, 0, 0}), 100);
+  EXPECT_EQ(writer.NumFeatures({1, 0, 1}), 0);
+  auto northWest = nlohmann::json::parse(sequential[{1, 0, 0}]);
+  EXPECT_EQ(northWest["features"][3]["geometry"],
+            nlohmann::json::parse(R"({"type":"LineString","coordinates":)"
+                                  R"([[-88.5,45],[0,45]]})"));
+  EXPECT_EQ(northWest["features"][3]["properties"]["id"], 3);
+  auto southEast = nlohmann::json::parse(sequential[{1, 1, 1}]);
+  EXPECT_EQ(southEast["features"].size(), 100);
+
+  geojson::BasicTileWriter<geojson::StringSink> parallelWriter(
+      1, [&](const geojson::TileId& tile, bool) {
+        return geojson::StringSink(parallel[tile]);
+      });
+  geojson::WriteTiles(parallelWriter, 100, getFeature, 4, 7);
+  EXPECT_EQ(parallel, sequential);
+
+  // The buffer reaches into the neighbouring tiles
+  std::map<geojson::TileId, std::string> buffered;
+  geojson::BasicTileWriter<geojson::StringSink> bufferedWriter(
+      1,
+      [&](const geojson::TileId& tile, bool) {
+        return geojson::StringSink(buffered[tile]);
+      },
+      geojson::CoordinateFormat(), 0.25);
+  bufferedWriter.Write(geojson::FlatGeometry::Point(-10, 10));
+  bufferedWriter.Close();
+  EXPECT_EQ(bufferedWriter.Tiles().size(), 4);
+
+  // The destructor closes the collections of a writer that was not closed
+  std::map<geojson::TileId, std::string> unclosed;
+  {
+    geojson::BasicTileWriter<geojson::StringSink> unclosedWriter(
+        1, [&](const geojson::TileId& tile, bool) {
+          return geojson::StringSink(unclosed[tile]);
+        });
+    unclosedWriter.Write(geojson::FlatGeometry::Point(-10, 10));
+  }
+  ASSERT_EQ(unclosed.size(), 1);
+  EXPECT_EQ(nlohmann::json::parse(unclosed.begin()->second)["features"].size(),
+            1);
+  EXPECT_THROW(geojson::BasicTileWriter<geojson::StringSink>(
+                   1, nullptr, geojson::CoordinateFormat(), -1),
+               std::domain_error);
+  EXPECT_THROW(geojson::BasicTileWriter<geojson::StringSink>(
+                   1, nullptr, geojson::CoordinateFormat(), 0, 0),
+               std::domain_error);
+
+  // With more tiles than may be open, the least recently written are closed
+  // and reopened for append, which gives the same collections
+  auto tilePath = [](const geojson::TileId& tile) {
+    return ::testing::TempDir() + "libgeojson_tile_" +
+           std::to_string(tile.x) + "_" + std::to_string(tile.y) + ".geojson";
+  };
+  size_t numOpened = 0, numReopened = 0;
+  geojson::TileWriter fileWriter(
+      2,
+      [&](const geojson::TileId& tile, bool append) {
+        numOpened++;
+        if (append) numReopened++;
+        return std::unique_ptr<std::ofstream>(new std::ofstream(
+            tilePath(tile), append ? std::ios::app : std::ios::out));
+      },
+      geojson::CoordinateFormat(), 0, 3);
+  std::map<geojson::TileId, std::string> unlimited;
+  geojson::BasicTileWriter<geojson::StringSink> unlimitedWriter(
+      2, [&](const geojson::TileId& tile, bool) {
+        return geojson::StringSink(unlimited[tile]);
+      });
+  const double rowLats[] = {75, 30, -30, -75};
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < 16; i++) {
+      auto center = geojson::FlatGeometry::Point(-135 + 90 * (i % 4),
+                                                 rowLats[i / 4]);
+      fileWriter.Write(center, {{"round", round}});
+      unlimitedWriter.Write(center, {{"round", round}});
+    }
+  }
+  fileWriter.Close();
+  unlimitedWriter.Close();
+  EXPECT_EQ(fileWriter.Tiles().size(), 16);
+  // Each tile is opened once, then reopened by each write after the first
+  // round and to end the 13 tiles left closed
+  EXPECT_EQ(numOpened - numReopened, 16);
+  EXPECT_EQ(numReopened, 32 + 13);
+  for (const auto& tile : unlimited) {
+    std::ifstream is(tilePath(tile.first), std::ios::binary);
+    EXPECT_EQ(std::string(std::istreambuf_iterator<char>(is), {}),
+              tile.second);
+    EXPECT_EQ(nlohmann::json::parse(tile.second)["features"].size(), 3);
+    std::remove(tilePath(tile.first).c_str());
+  }
+
+  // A tile whose stream fails throws
+  geojson::TileWriter failingWriter(0, [](const geojson::TileId&, bool) {
+    return std::unique_ptr<std::ofstream>(
+        new std::ofstream("no/such/directory/tile.geojson"));
+  });
+  EXPECT_THROW(failingWriter.Write(geojson::FlatGeometry::Point(0, 0)),
+               std::ios_base::failure);
+}
+
+TEST(LibgeojsonTest, CborTest) {
+  using geojson::FlatGeometry;
+  namespace cbor = geojson::cbor;
+  auto ignoreTags = nlohmann::json::cbor_tag_handler_t::ignore;
+
+  std::vector<Pt3D> track;
+  for (size_t i = 0; i < 100; i++) {
+    track.emplace_back(-77.0 + 1e-4 * i, 38.9 + 2e-4 * i, 10.0 + i);
+  }
+  auto line = FlatGeometry::LineString(
+      track.size(), [&](size_t i, double& lon, double& lat, double& alt) {
+        lon = track[i].x;
+        lat = track[i].y;
+        alt = track[i].z;
+      });
+
+  // Any CBOR decoder reads the encoding, the positions as a typed array
+  std::string bytes = cbor::Geometry(line);
+  auto decoded = nlohmann::json::from_cbor(bytes, true, true, ignoreTags);
+  EXPECT_EQ(decoded["type"], "LineString");
+  ASSERT_EQ(decoded["coordinates"].size(), 2);
+  EXPECT_EQ(decoded["coordinates"][0], nlohmann::json({100, 3}));
+  EXPECT_EQ(decoded["coordinates"][1].get_binary().size(), 100 * 3 * 8);
+  EXPECT_EQ(geojson::Geometry(cbor::ReadGeometry(bytes)),
+            geojson::Geometry(line));
+
+  // Float32 halves the coordinates, delta encoding shrinks them further
+  std::string singles = cbor::Geometry(line, cbor::Coordinates::Float32);
+  EXPECT_LT(singles.size(), bytes.size() / 2 + 64);
+  auto floats = cbor::ReadGeometry(singles);
+  ASSERT_EQ(floats.NumPositions(), 100);
+  EXPECT_NEAR(floats.Positions().Lon(99), track[99].x, 1e-5);
+  auto fixed = geojson::CoordinateFormat::Fixed(6);
+  std::string deltas = cbor::Geometry(line, cbor::Coordinates::Delta, fixed);
+  EXPECT_LT(deltas.size(), singles.size());
+  EXPECT_LT(deltas.size(), bytes.size() / 2);
+  auto quantized = cbor::ReadGeometry(deltas);
+  ASSERT_EQ(quantized.NumPositions(), 100);
+  for (size_t i = 0; i < track.size(); i++) {
+    EXPECT_NEAR(quantized.Positions().Lon(i), track[i].x, 1e-9);
+    EXPECT_NEAR(quantized.Positions().Lat(i), track[i].y, 1e-9);
+    EXPECT_NEAR(quantized.Positions().Alt(i), track[i].z, 1e-9);
+  }
+  decoded = nlohmann::json::from_cbor(deltas, true, true, ignoreTags);
+  EXPECT_EQ(decoded["decimals"], 6);
+  EXPECT_EQ(decoded["coordinates"][1][0], -77000000);
+  EXPECT_EQ(decoded["coordinates"][1][3], 100);
+  EXPECT_THROW(cbor::Geometry(line, cbor::Coordinates::Delta),
+               std::domain_error);
+  EXPECT_THROW(cbor::Geometry(FlatGeometry::Point(1e300, 0),
+                              cbor::Coordinates::Delta, fixed),
+               std::domain_error);
+
+  // Rings are closed and wound as the text builders do, with bboxes
+  auto getRingLength = [](size_t ring) -> size_t { return ring == 0 ? 4 : 3; };
+  auto getPoint = [](size_t ring, size_t pt, double& lon, double& lat) {
+    double size = ring == 0 ? 10 : 1;
+    lon = (pt == 1 || pt == 2 ? size : 0) + ring;
+    lat = (pt >= 2 ? size : 0) + ring;
+    if (ring == 1 && pt == 2) lon = 1;
+  };
+  auto polygon = FlatGeometry::Polygon(2, getRingLength, getPoint);
+  auto bboxes = geojson::CoordinateFormat().WithBoundingBoxes();
+  for (auto mode : {cbor::Coordinates::Float64, cbor::Coordinates::Float32,
+                    cbor::Coordinates::Delta}) {
+    auto format = mode == cbor::Coordinates::Delta
+                      ? geojson::CoordinateFormat::Fixed(3).WithBoundingBoxes()
+                      : bboxes;
+    std::string encoded = cbor::Geometry(polygon, mode, format);
+    EXPECT_EQ(geojson::Geometry(cbor::ReadGeometry(encoded), bboxes),
+              geojson::Polygon(2, getRingLength, getPoint, bboxes));
+    decoded = nlohmann::json::from_cbor(encoded, true, true, ignoreTags);
+    EXPECT_EQ(decoded["bbox"], nlohmann::json({0, 0, 10, 10}));
+    EXPECT_EQ(decoded["coordinates"][0][0], nlohmann::json({5, 2}));
+  }
+
+  // Plain arrays of positions, as nlohmann::json writes them, are read too
+  auto multiPoint = FlatGeometry::MultiPoint(
+      3, [](size_t i, double& lon, double& lat) { lon = lat = 0.5 * i; });
+  auto collection = FlatGeometry(geojson::Type::GeometryCollection);
+  collection.AddGeometry(FlatGeometry::Point(1, 2, 3));
+  collection.AddGeometry(multiPoint);
+  collection.AddGeometry(polygon);
+  EXPECT_EQ(geojson::Geometry(cbor::ReadGeometry(cbor::Geometry(collection))),
+            geojson::Geometry(collection));
+  auto json = nlohmann::json::to_cbor(geojson::Geometry(collection));
+  EXPECT_EQ(geojson::Geometry(
+                cbor::ReadGeometry(std::string(json.begin(), json.end()))),
+            geojson::Geometry(collection));
+  EXPECT_THROW(cbor::ReadGeometry(bytes.substr(0, bytes.size() - 1)),
+               std::domain_error);
+  std::string wrongSize = bytes;
+  wrongSize[wrongSize.find("coordinates") + 16] = 99;
+  EXPECT_THROW(cbor::ReadGeometry(wrongSize), std::domain_error);
+  EXPECT_THROW(cbor::ReadGeometry(std::string("\xa0", 1)), std::domain_error);
+  json = nlohmann::json::to_cbor({{"type", "Box"}});
+  EXPECT_THROW(cbor::ReadGeometry(std::string(json.begin(), json.end())),
+               std::domain_error);
+
+  // Corrupt lengths and deep nesting throw rather than allocate or recurse
+  std::string header("\xa2\x64type\x6aLineString\x6b" "coordinates", 29);
+  std::string hugeCount = header + std::string(
+      "\xd8\x28\x82\x82\x1b\x00\x00\x01\x00\x00\x00\x00\x00\x02"
+      "\xd8\x56\x40", 17);
+  EXPECT_THROW(cbor::ReadGeometry(hugeCount), std::domain_error);
+  std::string deep("\xa3\x64type\x65Point\x6b" "coordinates\x82\x01\x02"
+                   "\x61x", 29);
+  deep += std::string(100000, '\x81') + '\x00';
+  EXPECT_THROW(cbor::ReadGeometry(deep), std::domain_error);
+  std::string nested;
+  for (int i = 0; i < 100000; i++) {
+    nested += std::string("\xa2\x64type\x72GeometryCollection\x6a"
+                          "geometries\x81", 37);
+  }
+  EXPECT_THROW(cbor::ReadGeometry(nested), std::domain_error);
+
+  // Feature collections stream, and decode with their properties
+  std::string collectionBytes;
+  {
+    cbor::BasicFeatureCollectionWriter<geojson::StringSink> writer(
+        geojson::StringSink(collectionBytes), cbor::Coordinates::Delta,
+        fixed);
+    writer.Write(line, {{"id", 0}, {"name", "track"}});
+    writer.WriteRaw(cbor::Feature(cbor::Geometry(polygon), {{"id", 1}}));
+    writer.Write(collection);
+    EXPECT_EQ(writer.NumFeatures(), 3);
+    writer.Close();
+    EXPECT_THROW(writer.Write(line), std::logic_error);
+  }
+  decoded = nlohmann::json::from_cbor(collectionBytes, true, true, ignoreTags);
+  EXPECT_EQ(decoded["type"], "FeatureCollection");
+  ASSERT_EQ(decoded["features"].size(), 3);
+  EXPECT_EQ(decoded["features"][1]["properties"]["id"], 1);
+  std::vector<FlatGeometry> geometries;
+  std::vector<nlohmann::json> properties;
+  cbor::ReadFeatureCollection(
+      collectionBytes, [&](FlatGeometry geometry, nlohmann::json props) {
+        geometries.push_back(std::move(geometry));
+        properties.push_back(std::move(props));
+      });
+  ASSERT_EQ(geometries.size(), 3);
+  EXPECT_EQ(geometries[0].NumPositions(), 100);
+  EXPECT_EQ(geojson::Geometry(geometries[1]), geojson::Geometry(polygon));
+  EXPECT_EQ(geometries[2].Geometries().size(), 3);
+  EXPECT_EQ(properties[0], nlohmann::json({{"id", 0}, {"name", "track"}}));
+  EXPECT_EQ(properties[2], nlohmann::json::object());
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();